@@ -0,0 +1,670 @@
+#include "lib_channel.h"
+
+#include "toy_common.h"
+#include "memory.h"
+#include "event_loop.h"
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+//a bounded lock-free MPMC queue - each cell's sequence number says whose turn it is
+typedef struct ChannelCell {
+	atomic_size_t sequence;
+	Literal literal;
+} ChannelCell;
+
+struct Channel {
+	ChannelCell* cells;
+	size_t mask;
+	unsigned char padding0[64]; //keep the producers and consumers off each other's cache lines
+	atomic_size_t sendPosition;
+	unsigned char padding1[64];
+	atomic_size_t receivePosition;
+	unsigned char padding2[64];
+	atomic_bool closed;
+
+	//scripts parked on a full or empty channel - only touched under the lock
+	atomic_flag waitLock;
+	atomic_int waiterCount;
+	struct ChannelWaiter* senders;
+	struct ChannelWaiter* receivers;
+};
+
+//a script whose send or receive couldn't finish yet - whoever makes room, sends or closes finishes it
+typedef struct ChannelWaiter {
+	AsyncToken* token;
+	EventLoop* loop; //where results from other threads are posted
+	const void* thread; //tokens can only be completed directly on this thread
+	Literal message; //what a sender is waiting to send
+	struct ChannelWaiter* next;
+} ChannelWaiter;
+
+//its address tells threads apart
+static TOY_THREAD_LOCAL char threadMarker;
+
+//make the literal safe to hand to another thread, without copying anything that doesn't need it
+static bool isolateLiteral(Literal* literal) {
+	switch(literal->type) {
+		case LITERAL_NULL:
+		case LITERAL_BOOLEAN:
+		case LITERAL_INTEGER:
+		case LITERAL_FLOAT:
+		case LITERAL_OPAQUE:
+			return true;
+
+		case LITERAL_STRING:
+		case LITERAL_IDENTIFIER: {
+			//sole owners can just pass the string along - frozen strings are copied, since their program can be freed while the message is in flight
+			RefString* refString = literal->type == LITERAL_STRING ? AS_STRING(*literal) : AS_IDENTIFIER(*literal);
+
+			if (countRefString(refString) == 1) {
+				return true;
+			}
+
+			Literal copy = literal->type == LITERAL_STRING ? TO_STRING_LITERAL(deepCopyRefString(refString)) : TO_IDENTIFIER_LITERAL(deepCopyRefString(refString));
+			freeLiteral(*literal);
+			*literal = copy;
+			return true;
+		}
+
+		//packed arrays own their buffer outright
+		case LITERAL_PACKED_ARRAY:
+			return true;
+
+		//compounds are always owned by whoever holds them unless frozen, only their contents may be shared
+		case LITERAL_ARRAY:
+			if (AS_ARRAY(*literal)->frozen) {
+				*literal = detachLiteral(*literal); //frozen compounds are never freed by their holder
+				return true;
+			}
+
+			for (int i = 0; i < AS_ARRAY(*literal)->count; i++) {
+				if (!isolateLiteral(&AS_ARRAY(*literal)->literals[i])) {
+					return false;
+				}
+			}
+			return true;
+
+		case LITERAL_DICTIONARY:
+			if (AS_DICTIONARY(*literal)->frozen) {
+				*literal = detachLiteral(*literal);
+				return true;
+			}
+
+			for (int i = 0; i < AS_DICTIONARY(*literal)->capacity; i++) {
+				if (!isolateLiteral(&AS_DICTIONARY(*literal)->entries[i].key) || !isolateLiteral(&AS_DICTIONARY(*literal)->entries[i].value)) {
+					return false;
+				}
+			}
+			return true;
+
+		case LITERAL_TYPE:
+			for (int i = 0; i < AS_TYPE(*literal).count; i++) {
+				if (!isolateLiteral(&((Literal*)(AS_TYPE(*literal).subtypes))[i])) {
+					return false;
+				}
+			}
+			return true;
+
+		default:
+			//functions are tied to their interpreter
+			return false;
+	}
+}
+
+//the queue itself
+static bool pushCell(Channel* channel, Literal literal) {
+	if (atomic_load_explicit(&channel->closed, memory_order_relaxed)) {
+		return false;
+	}
+
+	size_t position = atomic_load_explicit(&channel->sendPosition, memory_order_relaxed);
+	ChannelCell* cell;
+
+	for (;;) {
+		cell = &channel->cells[position & channel->mask];
+		size_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+		intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+
+		if (difference == 0) {
+			//this cell is free, try to claim it
+			if (atomic_compare_exchange_weak_explicit(&channel->sendPosition, &position, position + 1, memory_order_relaxed, memory_order_relaxed)) {
+				break;
+			}
+		}
+		else if (difference < 0) {
+			return false; //full
+		}
+		else {
+			position = atomic_load_explicit(&channel->sendPosition, memory_order_relaxed);
+		}
+	}
+
+	cell->literal = literal;
+	atomic_store_explicit(&cell->sequence, position + 1, memory_order_release);
+
+	return true;
+}
+
+static bool popCell(Channel* channel, Literal* literal) {
+	size_t position = atomic_load_explicit(&channel->receivePosition, memory_order_relaxed);
+	ChannelCell* cell;
+
+	for (;;) {
+		cell = &channel->cells[position & channel->mask];
+		size_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+		intptr_t difference = (intptr_t)sequence - (intptr_t)(position + 1);
+
+		if (difference == 0) {
+			//this cell is filled, try to claim it
+			if (atomic_compare_exchange_weak_explicit(&channel->receivePosition, &position, position + 1, memory_order_relaxed, memory_order_relaxed)) {
+				break;
+			}
+		}
+		else if (difference < 0) {
+			return false; //empty
+		}
+		else {
+			position = atomic_load_explicit(&channel->receivePosition, memory_order_relaxed);
+		}
+	}
+
+	*literal = cell->literal;
+	cell->literal = TO_NULL_LITERAL;
+	atomic_store_explicit(&cell->sequence, position + channel->mask + 1, memory_order_release);
+
+	return true;
+}
+
+//the waiters
+static void lockWaiters(Channel* channel) {
+	while (atomic_flag_test_and_set_explicit(&channel->waitLock, memory_order_acquire)) {
+		yieldThread();
+	}
+}
+
+static void unlockWaiters(Channel* channel) {
+	atomic_flag_clear_explicit(&channel->waitLock, memory_order_release);
+}
+
+//tokens are completed on their own thread, or posted to their event loop
+static void finishWaiter(Channel* channel, ChannelWaiter* waiter, Literal result) {
+	if (waiter->thread == &threadMarker) {
+		completeAsync(waiter->token, result);
+		freeLiteral(result);
+	}
+	else {
+		postAsyncCompletion(waiter->loop, waiter->token, result);
+	}
+
+	FREE(ChannelWaiter, waiter);
+	atomic_fetch_sub(&channel->waiterCount, 1);
+}
+
+//finishes every waiter the queue's state allows - the lock must be held
+static void serveWaitersLocked(Channel* channel) {
+	bool progress = true;
+
+	while (progress) {
+		progress = false;
+
+		//parked senders go first, oldest first
+		while (channel->senders != NULL) {
+			ChannelWaiter* waiter = channel->senders;
+			bool sent = pushCell(channel, waiter->message);
+
+			if (!sent && !atomic_load(&channel->closed)) {
+				break; //full
+			}
+
+			if (!sent) {
+				freeLiteral(waiter->message);
+			}
+
+			channel->senders = waiter->next;
+			finishWaiter(channel, waiter, TO_BOOLEAN_LITERAL(sent));
+			progress = true;
+		}
+
+		while (channel->receivers != NULL) {
+			ChannelWaiter* waiter = channel->receivers;
+			Literal message = TO_NULL_LITERAL;
+
+			if (!popCell(channel, &message)) {
+				if (!atomic_load(&channel->closed)) {
+					break; //empty
+				}
+
+				//check again after seeing the close, in case a send landed in between
+				popCell(channel, &message);
+			}
+
+			channel->receivers = waiter->next;
+			finishWaiter(channel, waiter, message);
+			progress = true;
+		}
+	}
+}
+
+static void serveWaiters(Channel* channel) {
+	//pairs with the fence in parkWaiter(), so either the waiter sees this change to the queue, or this sees the waiter
+	atomic_thread_fence(memory_order_seq_cst);
+
+	if (atomic_load_explicit(&channel->waiterCount, memory_order_relaxed) == 0) {
+		return;
+	}
+
+	lockWaiters(channel);
+	serveWaitersLocked(channel);
+	unlockWaiters(channel);
+}
+
+//the token may be completed before this returns, if the queue changed in the meantime
+static void parkWaiter(Channel* channel, EventLoop* loop, bool sender, AsyncToken* token, Literal message) {
+	ChannelWaiter* waiter = ALLOCATE(ChannelWaiter, 1);
+
+	waiter->token = token;
+	waiter->loop = loop;
+	waiter->thread = &threadMarker;
+	waiter->message = message;
+	waiter->next = NULL;
+
+	lockWaiters(channel);
+
+	ChannelWaiter** it = sender ? &channel->senders : &channel->receivers;
+	while (*it != NULL) {
+		it = &(*it)->next;
+	}
+	*it = waiter;
+
+	atomic_fetch_add(&channel->waiterCount, 1);
+	atomic_thread_fence(memory_order_seq_cst);
+
+	serveWaitersLocked(channel);
+
+	unlockWaiters(channel);
+}
+
+//exposed API
+Channel* createChannel(int capacity) {
+	size_t size = 2;
+	while (size < (size_t)capacity) {
+		size *= 2;
+	}
+
+	Channel* channel = ALLOCATE(Channel, 1);
+	channel->cells = ALLOCATE(ChannelCell, size);
+	channel->mask = size - 1;
+
+	for (size_t i = 0; i < size; i++) {
+		atomic_init(&channel->cells[i].sequence, i);
+		channel->cells[i].literal = TO_NULL_LITERAL;
+	}
+
+	atomic_init(&channel->sendPosition, 0);
+	atomic_init(&channel->receivePosition, 0);
+	atomic_init(&channel->closed, false);
+
+	atomic_flag_clear(&channel->waitLock);
+	atomic_init(&channel->waiterCount, 0);
+	channel->senders = NULL;
+	channel->receivers = NULL;
+
+	return channel;
+}
+
+void freeChannel(Channel* channel) {
+	//every token must be completed, even if its run was abandoned
+	while (channel->senders != NULL) {
+		ChannelWaiter* waiter = channel->senders;
+		channel->senders = waiter->next;
+		freeLiteral(waiter->message);
+		finishWaiter(channel, waiter, TO_BOOLEAN_LITERAL(false));
+	}
+
+	while (channel->receivers != NULL) {
+		ChannelWaiter* waiter = channel->receivers;
+		channel->receivers = waiter->next;
+		finishWaiter(channel, waiter, TO_NULL_LITERAL);
+	}
+
+	//release anything left in the queue
+	Literal literal;
+	while (popCell(channel, &literal)) {
+		freeLiteral(literal);
+	}
+
+	FREE_ARRAY(ChannelCell, channel->cells, channel->mask + 1);
+	FREE(Channel, channel);
+}
+
+void closeChannel(Channel* channel) {
+	atomic_store(&channel->closed, true);
+	serveWaiters(channel);
+}
+
+bool trySendChannel(Channel* channel, Literal literal) {
+	if (!pushCell(channel, literal)) {
+		return false;
+	}
+
+	serveWaiters(channel);
+	return true;
+}
+
+bool tryReceiveChannel(Channel* channel, Literal* literal) {
+	if (!popCell(channel, literal)) {
+		return false;
+	}
+
+	serveWaiters(channel);
+	return true;
+}
+
+//utils
+static Channel* popChannel(Interpreter* interpreter, LiteralArray* arguments, char* name) {
+	Literal channelLiteral = popLiteralArray(arguments);
+
+	Literal channelLiteralIdn = channelLiteral;
+	if (IS_IDENTIFIER(channelLiteral) && parseIdentifierToValue(interpreter, &channelLiteral)) {
+		freeLiteral(channelLiteralIdn);
+	}
+
+	if (!IS_OPAQUE(channelLiteral) || OPAQUE_TAG(channelLiteral) != CHANNEL_TAG) {
+		interpreter->errorOutput("Incorrect argument type passed to ");
+		interpreter->errorOutput(name);
+		interpreter->errorOutput("\n");
+		freeLiteral(channelLiteral);
+		return NULL;
+	}
+
+	Channel* channel = AS_OPAQUE(channelLiteral);
+	freeLiteral(channelLiteral);
+
+	return channel;
+}
+
+static bool popMessage(Interpreter* interpreter, LiteralArray* arguments, char* name, Literal* message) {
+	*message = popLiteralArray(arguments);
+
+	Literal messageIdn = *message;
+	if (IS_IDENTIFIER(*message) && parseIdentifierToValue(interpreter, message)) {
+		freeLiteral(messageIdn);
+	}
+
+	if (!isolateLiteral(message)) {
+		interpreter->errorOutput("Can't send functions through a channel in ");
+		interpreter->errorOutput(name);
+		interpreter->errorOutput("\n");
+		freeLiteral(*message);
+		return false;
+	}
+
+	return true;
+}
+
+static void pushBoolean(Interpreter* interpreter, bool b) {
+	Literal result = TO_BOOLEAN_LITERAL(b);
+	pushLiteralArray(&interpreter->stack, result);
+	freeLiteral(result);
+}
+
+//callbacks
+static int nativeSendChannel(Interpreter* interpreter, LiteralArray* arguments) {
+	if (arguments->count != 2) {
+		interpreter->errorOutput("Incorrect number of arguments to _sendChannel\n");
+		return -1;
+	}
+
+	Literal message;
+	if (!popMessage(interpreter, arguments, "_sendChannel", &message)) {
+		return -1;
+	}
+
+	Channel* channel = popChannel(interpreter, arguments, "_sendChannel");
+	if (channel == NULL) {
+		freeLiteral(message);
+		return -1;
+	}
+
+	bool sent = trySendChannel(channel, message);
+
+	//backpressure: on an event loop, park until a receiver makes room, so other scripts on this thread can run
+	EventLoop* loop = getCurrentEventLoop();
+
+	if (!sent && !atomic_load(&channel->closed) && loop != NULL) {
+		AsyncToken* token = beginAsync(interpreter);
+
+		if (token != NULL) {
+			parkWaiter(channel, loop, true, token, message);
+			return NATIVE_PENDING;
+		}
+	}
+
+	//this run can't wait, so hold the thread instead
+	while (!sent && !atomic_load(&channel->closed)) {
+		yieldThread();
+		sent = trySendChannel(channel, message);
+	}
+
+	if (!sent) {
+		freeLiteral(message);
+	}
+
+	pushBoolean(interpreter, sent);
+
+	return 1;
+}
+
+static int nativeTrySendChannel(Interpreter* interpreter, LiteralArray* arguments) {
+	if (arguments->count != 2) {
+		interpreter->errorOutput("Incorrect number of arguments to _trySendChannel\n");
+		return -1;
+	}
+
+	Literal message;
+	if (!popMessage(interpreter, arguments, "_trySendChannel", &message)) {
+		return -1;
+	}
+
+	Channel* channel = popChannel(interpreter, arguments, "_trySendChannel");
+	if (channel == NULL) {
+		freeLiteral(message);
+		return -1;
+	}
+
+	bool sent = trySendChannel(channel, message);
+
+	if (!sent) {
+		freeLiteral(message);
+	}
+
+	pushBoolean(interpreter, sent);
+
+	return 1;
+}
+
+static int nativeReceiveChannel(Interpreter* interpreter, LiteralArray* arguments) {
+	if (arguments->count != 1) {
+		interpreter->errorOutput("Incorrect number of arguments to _receiveChannel\n");
+		return -1;
+	}
+
+	Channel* channel = popChannel(interpreter, arguments, "_receiveChannel");
+	if (channel == NULL) {
+		return -1;
+	}
+
+	//wait for a sender, or for the channel to close
+	EventLoop* loop = getCurrentEventLoop();
+	Literal message = TO_NULL_LITERAL;
+
+	while (!tryReceiveChannel(channel, &message)) {
+		//BUGFIX: check again after seeing the close, in case a send landed in between
+		if (atomic_load(&channel->closed)) {
+			tryReceiveChannel(channel, &message);
+			break;
+		}
+
+		//on an event loop, park until a sender arrives, so other scripts on this thread can run
+		AsyncToken* token = loop != NULL ? beginAsync(interpreter) : NULL;
+
+		if (token != NULL) {
+			parkWaiter(channel, loop, false, token, TO_NULL_LITERAL);
+			return NATIVE_PENDING;
+		}
+
+		//this run can't wait, so hold the thread instead
+		yieldThread();
+	}
+
+	pushLiteralArray(&interpreter->stack, message);
+	freeLiteral(message);
+
+	return 1;
+}
+
+static int nativeTryReceiveChannel(Interpreter* interpreter, LiteralArray* arguments) {
+	if (arguments->count != 1) {
+		interpreter->errorOutput("Incorrect number of arguments to _tryReceiveChannel\n");
+		return -1;
+	}
+
+	Channel* channel = popChannel(interpreter, arguments, "_tryReceiveChannel");
+	if (channel == NULL) {
+		return -1;
+	}
+
+	//null when there's nothing waiting
+	Literal message = TO_NULL_LITERAL;
+	tryReceiveChannel(channel, &message);
+
+	pushLiteralArray(&interpreter->stack, message);
+	freeLiteral(message);
+
+	return 1;
+}
+
+static int nativeGetChannelCount(Interpreter* interpreter, LiteralArray* arguments) {
+	if (arguments->count != 1) {
+		interpreter->errorOutput("Incorrect number of arguments to _getChannelCount\n");
+		return -1;
+	}
+
+	Channel* channel = popChannel(interpreter, arguments, "_getChannelCount");
+	if (channel == NULL) {
+		return -1;
+	}
+
+	//only a snapshot while others are using the channel
+	size_t sent = atomic_load(&channel->sendPosition);
+	size_t received = atomic_load(&channel->receivePosition);
+
+	Literal result = TO_INTEGER_LITERAL(sent > received ? (int)(sent - received) : 0);
+	pushLiteralArray(&interpreter->stack, result);
+	freeLiteral(result);
+
+	return 1;
+}
+
+static int nativeCloseChannel(Interpreter* interpreter, LiteralArray* arguments) {
+	if (arguments->count != 1) {
+		interpreter->errorOutput("Incorrect number of arguments to _closeChannel\n");
+		return -1;
+	}
+
+	Channel* channel = popChannel(interpreter, arguments, "_closeChannel");
+	if (channel == NULL) {
+		return -1;
+	}
+
+	closeChannel(channel);
+
+	return 0;
+}
+
+static int nativeIsChannelClosed(Interpreter* interpreter, LiteralArray* arguments) {
+	if (arguments->count != 1) {
+		interpreter->errorOutput("Incorrect number of arguments to _isChannelClosed\n");
+		return -1;
+	}
+
+	Channel* channel = popChannel(interpreter, arguments, "_isChannelClosed");
+	if (channel == NULL) {
+		return -1;
+	}
+
+	pushBoolean(interpreter, atomic_load(&channel->closed));
+
+	return 1;
+}
+
+//call the hook
+typedef struct Natives {
+	char* name;
+	NativeFn fn;
+} Natives;
+
+int hookChannel(Interpreter* interpreter, Literal identifier, Literal alias) {
+	//build the natives list
+	Natives natives[] = {
+		{"_sendChannel", nativeSendChannel},
+		{"_trySendChannel", nativeTrySendChannel},
+		{"_receiveChannel", nativeReceiveChannel},
+		{"_tryReceiveChannel", nativeTryReceiveChannel},
+		{"_getChannelCount", nativeGetChannelCount},
+		{"_closeChannel", nativeCloseChannel},
+		{"_isChannelClosed", nativeIsChannelClosed},
+		{NULL, NULL}
+	};
+
+	//store the library in an aliased dictionary
+	if (!IS_NULL(alias)) {
+		//make sure the name isn't taken
+		if (isDelcaredScopeVariable(interpreter->scope, alias)) {
+			interpreter->errorOutput("Can't override an existing variable\n");
+			freeLiteral(alias);
+			return false;
+		}
+
+		//create the dictionary to load up with functions
+		LiteralDictionary* dictionary = ALLOCATE(LiteralDictionary, 1);
+		initLiteralDictionary(dictionary);
+
+		//load the dict with functions
+		for (int i = 0; natives[i].name; i++) {
+			Literal name = TO_STRING_LITERAL(createRefString(natives[i].name));
+			Literal func = TO_FUNCTION_LITERAL((void*)natives[i].fn, 0);
+			func.type = LITERAL_FUNCTION_NATIVE;
+
+			setLiteralDictionary(dictionary, name, func);
+
+			freeLiteral(name);
+			freeLiteral(func);
+		}
+
+		//build the type
+		Literal type = TO_TYPE_LITERAL(LITERAL_DICTIONARY, true);
+		Literal strType = TO_TYPE_LITERAL(LITERAL_STRING, true);
+		Literal fnType = TO_TYPE_LITERAL(LITERAL_FUNCTION_NATIVE, true);
+		TYPE_PUSH_SUBTYPE(&type, strType);
+		TYPE_PUSH_SUBTYPE(&type, fnType);
+
+		//set scope
+		Literal dict = TO_DICTIONARY_LITERAL(dictionary);
+		declareScopeVariable(interpreter->scope, alias, type);
+		setScopeVariable(interpreter->scope, alias, dict, false);
+
+		//cleanup
+		freeLiteral(dict);
+		freeLiteral(type);
+		return 0;
+	}
+
+	//default
+	for (int i = 0; natives[i].name; i++) {
+		injectNativeFn(interpreter, natives[i].name, natives[i].fn);
+	}
+
+	return 0;
+}
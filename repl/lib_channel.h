@@ -0,0 +1,20 @@
+#pragma once
+
+#include "interpreter.h"
+
+int hookChannel(Interpreter* interpreter, Literal identifier, Literal alias);
+
+//a bounded queue that any number of interpreters, on any number of threads, can send to and receive from
+//NOTE: tasks in an event loop park on a full or empty channel instead of holding the thread, and are woken from any thread
+//everything else waits by yielding the thread, since nothing could wake it from another thread
+typedef struct Channel Channel;
+
+//opaque tag, so timers and matrices aren't mistaken for channels - hosts wrap channels with it too
+#define CHANNEL_TAG 0x636861
+
+//for the host, i.e. to hand a channel to scripts through the exports - scripts can't create or free channels, so the host owns every one
+Channel* createChannel(int capacity); //rounded up to a power of 2
+void freeChannel(Channel* channel); //NOTE: nobody may be using the channel
+void closeChannel(Channel* channel); //wakes up receivers once the channel is drained
+bool trySendChannel(Channel* channel, Literal literal); //false when full or closed - the literal is only taken on success
+bool tryReceiveChannel(Channel* channel, Literal* literal); //false when empty
@@ -0,0 +1,559 @@
+#include "lib_matrix.h"
+
+#include "lib_vector.h"
+
+#include "toy_common.h"
+#include "memory.h"
+#include "packed_array.h"
+
+#include <limits.h>
+#include <string.h>
+
+//the edge of the square blocks multiply and transpose work in, so each block stays in the cache
+#define MATRIX_BLOCK 64
+
+//opaque tag, so timers and channels aren't mistaken for matrices
+#define MATRIX_TAG 0x6D6174
+
+//a dense, row-major matrix - opaque values are shared rather than copied, so it lives until destroyMatrix()
+typedef struct Matrix {
+	int rows;
+	int cols;
+	float* elements;
+} Matrix;
+
+//utils
+static Matrix* createMatrix(int rows, int cols) {
+	Matrix* matrix = ALLOCATE(Matrix, 1);
+
+	matrix->rows = rows;
+	matrix->cols = cols;
+	matrix->elements = ALLOCATE(float, rows * cols);
+
+	if (rows * cols > 0) {
+		memset(matrix->elements, 0, sizeof(float) * rows * cols);
+	}
+
+	return matrix;
+}
+
+static void freeMatrix(Matrix* matrix) {
+	FREE_ARRAY(float, matrix->elements, matrix->rows * matrix->cols);
+	FREE(Matrix, matrix);
+}
+
+static bool validDimensions(int rows, int cols) {
+	return rows >= 0 && cols >= 0 && (cols == 0 || rows <= INT_MAX / cols);
+}
+
+//replaces an identifier with its value, in place
+static void resolveLiteral(Interpreter* interpreter, Literal* literal) {
+	Literal idn = *literal;
+	if (IS_IDENTIFIER(*literal) && parseIdentifierToValue(interpreter, literal)) {
+		freeLiteral(idn);
+	}
+}
+
+//pops an argument, reading through any identifier
+static Literal popArgument(Interpreter* interpreter, LiteralArray* arguments) {
+	Literal literal = popLiteralArray(arguments);
+	resolveLiteral(interpreter, &literal);
+	return literal;
+}
+
+static void argumentError(Interpreter* interpreter, char* message, char* name) {
+	interpreter->errorOutput(message);
+	interpreter->errorOutput(name);
+	interpreter->errorOutput("\n");
+}
+
+//NULL if the argument isn't a matrix - nothing needs freeing either way, since opaque literals own nothing
+static Matrix* popMatrix(Interpreter* interpreter, LiteralArray* arguments, char* name) {
+	Literal literal = popArgument(interpreter, arguments);
+
+	if (!IS_OPAQUE(literal) || OPAQUE_TAG(literal) != MATRIX_TAG) {
+		argumentError(interpreter, "Incorrect argument type passed to ", name);
+		freeLiteral(literal);
+		return NULL;
+	}
+
+	return AS_OPAQUE(literal);
+}
+
+static bool readIndex(Interpreter* interpreter, Literal literal, int limit, int* index, char* name) {
+	if (!IS_INTEGER(literal)) {
+		argumentError(interpreter, "Incorrect argument type passed to ", name);
+		return false;
+	}
+
+	if (AS_INTEGER(literal) < 0 || AS_INTEGER(literal) >= limit) {
+		argumentError(interpreter, "Index out of bounds in ", name);
+		return false;
+	}
+
+	*index = AS_INTEGER(literal);
+	return true;
+}
+
+static void pushMatrix(Interpreter* interpreter, Matrix* matrix) {
+	Literal literal = TO_OPAQUE_LITERAL(matrix, MATRIX_TAG);
+	pushLiteralArray(&interpreter->stack, literal);
+}
+
+//reads one row of a nested array into the buffer, either packed or plain numbers
+static bool readRow(Interpreter* interpreter, Literal row, float* out, int cols) {
+	if (IS_PACKED_ARRAY(row)) {
+		if (AS_PACKED_ARRAY(row)->count != cols) {
+			return false;
+		}
+
+		for (int i = 0; i < cols; i++) {
+			out[i] = AS_PACKED_ARRAY(row)->elementType == LITERAL_FLOAT ? AS_PACKED_ARRAY(row)->as.floats[i] : (float)AS_PACKED_ARRAY(row)->as.integers[i];
+		}
+
+		return true;
+	}
+
+	if (!IS_ARRAY(row) || AS_ARRAY(row)->count != cols) {
+		return false;
+	}
+
+	for (int i = 0; i < cols; i++) {
+		//array literals can still hold identifiers when passed straight to a native
+		resolveLiteral(interpreter, &AS_ARRAY(row)->literals[i]);
+		Literal element = AS_ARRAY(row)->literals[i];
+
+		if (!IS_INTEGER(element) && !IS_FLOAT(element)) {
+			return false;
+		}
+
+		out[i] = IS_FLOAT(element) ? AS_FLOAT(element) : (float)AS_INTEGER(element);
+	}
+
+	return true;
+}
+
+static int rowLength(Literal row) {
+	if (IS_PACKED_ARRAY(row)) {
+		return AS_PACKED_ARRAY(row)->count;
+	}
+
+	return IS_ARRAY(row) ? AS_ARRAY(row)->count : -1;
+}
+
+//callbacks
+static int nativeCreateMatrix(Interpreter* interpreter, LiteralArray* arguments) {
+	//either the rows as nested arrays, or the dimensions of a zeroed matrix
+	if (arguments->count != 1 && arguments->count != 2) {
+		interpreter->errorOutput("Incorrect number of arguments to createMatrix\n");
+		return -1;
+	}
+
+	if (arguments->count == 2) {
+		Literal colsLiteral = popArgument(interpreter, arguments);
+		Literal rowsLiteral = popArgument(interpreter, arguments);
+
+		if (!IS_INTEGER(rowsLiteral) || !IS_INTEGER(colsLiteral) || !validDimensions(AS_INTEGER(rowsLiteral), AS_INTEGER(colsLiteral))) {
+			interpreter->errorOutput("Incorrect argument type passed to createMatrix\n");
+			freeLiteral(rowsLiteral);
+			freeLiteral(colsLiteral);
+			return -1;
+		}
+
+		pushMatrix(interpreter, createMatrix(AS_INTEGER(rowsLiteral), AS_INTEGER(colsLiteral)));
+		return 1;
+	}
+
+	Literal nested = popArgument(interpreter, arguments);
+
+	if (!IS_ARRAY(nested)) {
+		interpreter->errorOutput("Incorrect argument type passed to createMatrix\n");
+		freeLiteral(nested);
+		return -1;
+	}
+
+	for (int i = 0; i < AS_ARRAY(nested)->count; i++) {
+		resolveLiteral(interpreter, &AS_ARRAY(nested)->literals[i]);
+	}
+
+	int rows = AS_ARRAY(nested)->count;
+	int cols = rows > 0 ? rowLength(AS_ARRAY(nested)->literals[0]) : 0;
+
+	if (!validDimensions(rows, cols)) {
+		interpreter->errorOutput("Incorrect argument type passed to createMatrix\n");
+		freeLiteral(nested);
+		return -1;
+	}
+
+	Matrix* matrix = createMatrix(rows, cols);
+
+	for (int i = 0; i < rows; i++) {
+		if (!readRow(interpreter, AS_ARRAY(nested)->literals[i], matrix->elements + i * cols, cols)) {
+			interpreter->errorOutput("Rows must be numeric arrays of the same length in createMatrix\n");
+			freeMatrix(matrix);
+			freeLiteral(nested);
+			return -1;
+		}
+	}
+
+	pushMatrix(interpreter, matrix);
+	freeLiteral(nested);
+
+	return 1;
+}
+
+static int nativeDestroyMatrix(Interpreter* interpreter, LiteralArray* arguments) {
+	if (arguments->count != 1) {
+		interpreter->errorOutput("Incorrect number of arguments to _destroyMatrix\n");
+		return -1;
+	}
+
+	Matrix* matrix = popMatrix(interpreter, arguments, "_destroyMatrix");
+
+	if (matrix == NULL) {
+		return -1;
+	}
+
+	freeMatrix(matrix);
+
+	return 0;
+}
+
+static int dimension(Interpreter* interpreter, LiteralArray* arguments, bool rows, char* name) {
+	if (arguments->count != 1) {
+		argumentError(interpreter, "Incorrect number of arguments to ", name);
+		return -1;
+	}
+
+	Matrix* matrix = popMatrix(interpreter, arguments, name);
+
+	if (matrix == NULL) {
+		return -1;
+	}
+
+	Literal result = TO_INTEGER_LITERAL(rows ? matrix->rows : matrix->cols);
+	pushLiteralArray(&interpreter->stack, result);
+
+	return 1;
+}
+
+static int nativeRows(Interpreter* interpreter, LiteralArray* arguments) {
+	return dimension(interpreter, arguments, true, "_rows");
+}
+
+static int nativeCols(Interpreter* interpreter, LiteralArray* arguments) {
+	return dimension(interpreter, arguments, false, "_cols");
+}
+
+static int nativeElement(Interpreter* interpreter, LiteralArray* arguments) {
+	if (arguments->count != 3) {
+		interpreter->errorOutput("Incorrect number of arguments to _element\n");
+		return -1;
+	}
+
+	//the indexes are checked once the matrix is known
+	Literal colLiteral = popArgument(interpreter, arguments);
+	Literal rowLiteral = popArgument(interpreter, arguments);
+	Matrix* matrix = popMatrix(interpreter, arguments, "_element");
+
+	int row = 0;
+	int col = 0;
+	bool valid = matrix != NULL && readIndex(interpreter, rowLiteral, matrix->rows, &row, "_element") && readIndex(interpreter, colLiteral, matrix->cols, &col, "_element");
+
+	freeLiteral(rowLiteral);
+	freeLiteral(colLiteral);
+
+	if (!valid) {
+		return -1;
+	}
+
+	Literal result = TO_FLOAT_LITERAL(matrix->elements[row * matrix->cols + col]);
+	pushLiteralArray(&interpreter->stack, result);
+
+	return 1;
+}
+
+static int nativeSetElement(Interpreter* interpreter, LiteralArray* arguments) {
+	if (arguments->count != 4) {
+		interpreter->errorOutput("Incorrect number of arguments to _setElement\n");
+		return -1;
+	}
+
+	Literal value = popArgument(interpreter, arguments);
+	Literal colLiteral = popArgument(interpreter, arguments);
+	Literal rowLiteral = popArgument(interpreter, arguments);
+	Matrix* matrix = popMatrix(interpreter, arguments, "_setElement");
+
+	int row = 0;
+	int col = 0;
+	bool valid = matrix != NULL && readIndex(interpreter, rowLiteral, matrix->rows, &row, "_setElement") && readIndex(interpreter, colLiteral, matrix->cols, &col, "_setElement");
+
+	if (valid && !IS_INTEGER(value) && !IS_FLOAT(value)) {
+		interpreter->errorOutput("Incorrect argument type passed to _setElement\n");
+		valid = false;
+	}
+
+	freeLiteral(rowLiteral);
+	freeLiteral(colLiteral);
+
+	if (valid) {
+		matrix->elements[row * matrix->cols + col] = IS_FLOAT(value) ? AS_FLOAT(value) : (float)AS_INTEGER(value);
+	}
+
+	freeLiteral(value);
+
+	return valid ? 0 : -1;
+}
+
+static int nativeMultiply(Interpreter* interpreter, LiteralArray* arguments) {
+	if (arguments->count != 2) {
+		interpreter->errorOutput("Incorrect number of arguments to _multiply\n");
+		return -1;
+	}
+
+	Matrix* rhs = popMatrix(interpreter, arguments, "_multiply");
+	Matrix* lhs = rhs != NULL ? popMatrix(interpreter, arguments, "_multiply") : NULL;
+
+	if (lhs == NULL) {
+		return -1;
+	}
+
+	if (lhs->cols != rhs->rows) {
+		interpreter->errorOutput("Mismatched dimensions passed to _multiply\n");
+		return -1;
+	}
+
+	const VectorKernels* kernels = selectVectorKernels();
+	Matrix* result = createMatrix(lhs->rows, rhs->cols);
+
+	int n = lhs->rows;
+	int inner = lhs->cols;
+	int m = rhs->cols;
+
+	//each row of the result gathers scaled rows of rhs, a block at a time - the innermost step is one axpy over contiguous memory
+	for (int ii = 0; ii < n; ii += MATRIX_BLOCK) {
+		for (int kk = 0; kk < inner; kk += MATRIX_BLOCK) {
+			for (int jj = 0; jj < m; jj += MATRIX_BLOCK) {
+				int width = m - jj < MATRIX_BLOCK ? m - jj : MATRIX_BLOCK;
+
+				for (int i = ii; i < n && i < ii + MATRIX_BLOCK; i++) {
+					float* out = result->elements + i * m + jj;
+
+					for (int k = kk; k < inner && k < kk + MATRIX_BLOCK; k++) {
+						kernels->axpyFloat(out, lhs->elements[i * inner + k], rhs->elements + k * m + jj, out, width);
+					}
+				}
+			}
+		}
+	}
+
+	pushMatrix(interpreter, result);
+
+	return 1;
+}
+
+static int nativeTranspose(Interpreter* interpreter, LiteralArray* arguments) {
+	if (arguments->count != 1) {
+		interpreter->errorOutput("Incorrect number of arguments to _transpose\n");
+		return -1;
+	}
+
+	Matrix* matrix = popMatrix(interpreter, arguments, "_transpose");
+
+	if (matrix == NULL) {
+		return -1;
+	}
+
+	Matrix* result = createMatrix(matrix->cols, matrix->rows);
+
+	//blocked, so neither the reads nor the writes stride across the whole buffer
+	for (int ii = 0; ii < matrix->rows; ii += MATRIX_BLOCK) {
+		for (int jj = 0; jj < matrix->cols; jj += MATRIX_BLOCK) {
+			for (int i = ii; i < matrix->rows && i < ii + MATRIX_BLOCK; i++) {
+				for (int j = jj; j < matrix->cols && j < jj + MATRIX_BLOCK; j++) {
+					result->elements[j * matrix->rows + i] = matrix->elements[i * matrix->cols + j];
+				}
+			}
+		}
+	}
+
+	pushMatrix(interpreter, result);
+
+	return 1;
+}
+
+static int elementwise(Interpreter* interpreter, LiteralArray* arguments, VectorOp op, char* name) {
+	if (arguments->count != 2) {
+		argumentError(interpreter, "Incorrect number of arguments to ", name);
+		return -1;
+	}
+
+	Matrix* rhs = popMatrix(interpreter, arguments, name);
+	Matrix* lhs = rhs != NULL ? popMatrix(interpreter, arguments, name) : NULL;
+
+	if (lhs == NULL) {
+		return -1;
+	}
+
+	if (lhs->rows != rhs->rows || lhs->cols != rhs->cols) {
+		argumentError(interpreter, "Mismatched dimensions passed to ", name);
+		return -1;
+	}
+
+	Matrix* result = createMatrix(lhs->rows, lhs->cols);
+	selectVectorKernels()->binaryFloat(result->elements, lhs->elements, rhs->elements, lhs->rows * lhs->cols, op);
+	pushMatrix(interpreter, result);
+
+	return 1;
+}
+
+static int nativeAddElements(Interpreter* interpreter, LiteralArray* arguments) {
+	return elementwise(interpreter, arguments, VECTOR_ADD, "_addElements");
+}
+
+static int nativeSubElements(Interpreter* interpreter, LiteralArray* arguments) {
+	return elementwise(interpreter, arguments, VECTOR_SUB, "_subElements");
+}
+
+static int nativeMulElements(Interpreter* interpreter, LiteralArray* arguments) {
+	return elementwise(interpreter, arguments, VECTOR_MUL, "_mulElements");
+}
+
+static int nativeScaleElements(Interpreter* interpreter, LiteralArray* arguments) {
+	if (arguments->count != 2) {
+		interpreter->errorOutput("Incorrect number of arguments to _scaleElements\n");
+		return -1;
+	}
+
+	Literal factor = popArgument(interpreter, arguments);
+
+	if (!IS_INTEGER(factor) && !IS_FLOAT(factor)) {
+		interpreter->errorOutput("Incorrect argument type passed to _scaleElements\n");
+		freeLiteral(factor);
+		return -1;
+	}
+
+	Matrix* matrix = popMatrix(interpreter, arguments, "_scaleElements");
+
+	if (matrix == NULL) {
+		return -1;
+	}
+
+	Matrix* result = createMatrix(matrix->rows, matrix->cols);
+	selectVectorKernels()->axpyFloat(result->elements, IS_FLOAT(factor) ? AS_FLOAT(factor) : (float)AS_INTEGER(factor), matrix->elements, NULL, matrix->rows * matrix->cols);
+	pushMatrix(interpreter, result);
+
+	return 1;
+}
+
+//the only way back to Toy values - each row becomes an array of floats
+static int nativeToArray(Interpreter* interpreter, LiteralArray* arguments) {
+	if (arguments->count != 1) {
+		interpreter->errorOutput("Incorrect number of arguments to _toArray\n");
+		return -1;
+	}
+
+	Matrix* matrix = popMatrix(interpreter, arguments, "_toArray");
+
+	if (matrix == NULL) {
+		return -1;
+	}
+
+	LiteralArray* rows = ALLOCATE(LiteralArray, 1);
+	initLiteralArray(rows);
+
+	for (int i = 0; i < matrix->rows; i++) {
+		PackedArray* row = createPackedArray(LITERAL_FLOAT);
+		resizePackedArray(row, matrix->cols);
+
+		if (matrix->cols > 0) {
+			memcpy(row->as.floats, matrix->elements + i * matrix->cols, sizeof(float) * matrix->cols);
+		}
+
+		Literal rowLiteral = TO_PACKED_ARRAY_LITERAL(row);
+		pushLiteralArray(rows, rowLiteral);
+		freeLiteral(rowLiteral);
+	}
+
+	Literal result = TO_ARRAY_LITERAL(rows);
+	pushLiteralArray(&interpreter->stack, result);
+	freeLiteral(result);
+
+	return 1;
+}
+
+//call the hook
+typedef struct Natives {
+	char* name;
+	NativeFn fn;
+} Natives;
+
+int hookMatrix(Interpreter* interpreter, Literal identifier, Literal alias) {
+	//build the natives list
+	Natives natives[] = {
+		{"createMatrix", nativeCreateMatrix},
+		{"_destroyMatrix", nativeDestroyMatrix},
+		{"_rows", nativeRows},
+		{"_cols", nativeCols},
+		{"_element", nativeElement},
+		{"_setElement", nativeSetElement},
+		{"_multiply", nativeMultiply},
+		{"_transpose", nativeTranspose},
+		{"_addElements", nativeAddElements},
+		{"_subElements", nativeSubElements},
+		{"_mulElements", nativeMulElements},
+		{"_scaleElements", nativeScaleElements},
+		{"_toArray", nativeToArray},
+		{NULL, NULL}
+	};
+
+	//store the library in an aliased dictionary
+	if (!IS_NULL(alias)) {
+		//make sure the name isn't taken
+		if (isDelcaredScopeVariable(interpreter->scope, alias)) {
+			interpreter->errorOutput("Can't override an existing variable\n");
+			freeLiteral(alias);
+			return false;
+		}
+
+		//create the dictionary to load up with functions
+		LiteralDictionary* dictionary = ALLOCATE(LiteralDictionary, 1);
+		initLiteralDictionary(dictionary);
+
+		//load the dict with functions
+		for (int i = 0; natives[i].name; i++) {
+			Literal name = TO_STRING_LITERAL(createRefString(natives[i].name));
+			Literal func = TO_FUNCTION_LITERAL((void*)natives[i].fn, 0);
+			func.type = LITERAL_FUNCTION_NATIVE;
+
+			setLiteralDictionary(dictionary, name, func);
+
+			freeLiteral(name);
+			freeLiteral(func);
+		}
+
+		//build the type
+		Literal type = TO_TYPE_LITERAL(LITERAL_DICTIONARY, true);
+		Literal strType = TO_TYPE_LITERAL(LITERAL_STRING, true);
+		Literal fnType = TO_TYPE_LITERAL(LITERAL_FUNCTION_NATIVE, true);
+		TYPE_PUSH_SUBTYPE(&type, strType);
+		TYPE_PUSH_SUBTYPE(&type, fnType);
+
+		//set scope
+		Literal dict = TO_DICTIONARY_LITERAL(dictionary);
+		declareScopeVariable(interpreter->scope, alias, type);
+		setScopeVariable(interpreter->scope, alias, dict, false);
+
+		//cleanup
+		freeLiteral(dict);
+		freeLiteral(type);
+		return 0;
+	}
+
+	//default
+	for (int i = 0; natives[i].name; i++) {
+		injectNativeFn(interpreter, natives[i].name, natives[i].fn);
+	}
+
+	return 0;
+}
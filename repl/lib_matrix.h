@@ -0,0 +1,6 @@
+#pragma once
+
+#include "interpreter.h"
+
+int hookMatrix(Interpreter* interpreter, Literal identifier, Literal alias);
+
@@ -12,8 +12,17 @@ static int nativeClock(Interpreter* interpreter, LiteralArray* arguments) {
 
 	//get the time from C (what a pain)
 	time_t rawtime = time(NULL);
-	struct tm* timeinfo = localtime( &rawtime );
-	char* timestr = asctime(timeinfo);
+	struct tm timeinfo;
+	char timestr[32]; //asctime needs 26
+
+	//BUGFIX: the reentrant versions, since interpreters can run on several threads
+#if defined(_WIN32) || defined(WIN32)
+	localtime_s(&timeinfo, &rawtime);
+	asctime_s(timestr, sizeof(timestr), &timeinfo);
+#else
+	localtime_r(&rawtime, &timeinfo);
+	asctime_r(&timeinfo, timestr);
+#endif
 
 	//push to the stack
 	int len = strlen(timestr) - 1; //-1 for the newline
@@ -2,8 +2,10 @@
 
 #include "toy_common.h"
 #include "memory.h"
+#include "event_loop.h"
 
 #include <stdio.h>
+#include <time.h>
 
 //GOD DAMN IT: https://stackoverflow.com/questions/15846762/timeval-subtract-explanation
 int timeval_subtract(struct timeval *result, struct timeval *x, struct timeval *y) {
@@ -339,6 +341,54 @@ static int nativeDestroyTimer(Interpreter* interpreter, LiteralArray* arguments)
 	return 0;
 }
 
+//wakes the sleeping script
+static void finishSleep(EventLoop* loop, bool ok, void* userdata) {
+	completeAsync((AsyncToken*)userdata, TO_NULL_LITERAL);
+}
+
+static int nativeSleep(Interpreter* interpreter, LiteralArray* arguments) {
+	if (arguments->count != 1) {
+		interpreter->errorOutput("Incorrect number of arguments to sleep\n");
+		return -1;
+	}
+
+	Literal millisecondLiteral = popLiteralArray(arguments);
+
+	Literal millisecondLiteralIdn = millisecondLiteral;
+	if (IS_IDENTIFIER(millisecondLiteral) && parseIdentifierToValue(interpreter, &millisecondLiteral)) {
+		freeLiteral(millisecondLiteralIdn);
+	}
+
+	if (!IS_INTEGER(millisecondLiteral) || AS_INTEGER(millisecondLiteral) < 0) {
+		interpreter->errorOutput("Incorrect argument type passed to sleep\n");
+		freeLiteral(millisecondLiteral);
+		return -1;
+	}
+
+	int milliseconds = AS_INTEGER(millisecondLiteral);
+	freeLiteral(millisecondLiteral);
+
+	//on an event loop, only this script waits
+	EventLoop* loop = getCurrentEventLoop();
+	AsyncToken* token = loop != NULL ? beginAsync(interpreter) : NULL;
+
+	if (token != NULL) {
+		if (!startEventTimer(loop, milliseconds, finishSleep, token)) {
+			completeAsync(token, TO_NULL_LITERAL);
+		}
+
+		return NATIVE_PENDING;
+	}
+
+	//otherwise, block the whole thread
+	struct timespec duration;
+	duration.tv_sec = milliseconds / 1000;
+	duration.tv_nsec = (long)(milliseconds % 1000) * 1000000L;
+	nanosleep(&duration, NULL);
+
+	return 0;
+}
+
 //call the hook
 typedef struct Natives {
 	char* name;
@@ -356,6 +406,7 @@ int hookTimer(Interpreter* interpreter, Literal identifier, Literal alias) {
 		{"_compareTimer", nativeCompareTimer},
 		{"_timerToString", nativeTimerToString},
 		{"_destroyTimer", nativeDestroyTimer},
+		{"sleep", nativeSleep},
 		{NULL, NULL}
 	};
 
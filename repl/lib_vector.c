@@ -0,0 +1,907 @@
+#include "lib_vector.h"
+
+#include "toy_common.h"
+#include "memory.h"
+#include "packed_array.h"
+
+#include <string.h>
+
+//NOTE: the x86 kernels carry their own target attributes, so nothing else needs -mavx2 - define TOY_VECTOR_SCALAR to leave them out
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && !defined(TOY_VECTOR_SCALAR)
+#define TOY_VECTOR_X86
+#include <immintrin.h>
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+//scalar kernels, for any cpu and for the tails of the others
+static float pickFloat(float current, float candidate, bool max) {
+	return (max ? candidate > current : candidate < current) ? candidate : current;
+}
+
+static int pickInt(int current, int candidate, bool max) {
+	return (max ? candidate > current : candidate < current) ? candidate : current;
+}
+
+static float sumFloatScalar(const float* v, int count) {
+	float result = 0;
+	for (int i = 0; i < count; i++) {
+		result += v[i];
+	}
+	return result;
+}
+
+static int sumIntScalar(const int* v, int count) {
+	unsigned int result = 0;
+	for (int i = 0; i < count; i++) {
+		result += (unsigned int)v[i];
+	}
+	return (int)result;
+}
+
+static float dotFloatScalar(const float* a, const float* b, int count) {
+	float result = 0;
+	for (int i = 0; i < count; i++) {
+		result += a[i] * b[i];
+	}
+	return result;
+}
+
+static int dotIntScalar(const int* a, const int* b, int count) {
+	unsigned int result = 0;
+	for (int i = 0; i < count; i++) {
+		result += (unsigned int)a[i] * (unsigned int)b[i];
+	}
+	return (int)result;
+}
+
+static void binaryFloatScalar(float* out, const float* a, const float* b, int count, VectorOp op) {
+	for (int i = 0; i < count; i++) {
+		out[i] = op == VECTOR_ADD ? a[i] + b[i] : op == VECTOR_SUB ? a[i] - b[i] : a[i] * b[i];
+	}
+}
+
+static void binaryIntScalar(int* out, const int* a, const int* b, int count, VectorOp op) {
+	for (int i = 0; i < count; i++) {
+		unsigned int x = (unsigned int)a[i];
+		unsigned int y = (unsigned int)b[i];
+		out[i] = (int)(op == VECTOR_ADD ? x + y : op == VECTOR_SUB ? x - y : x * y);
+	}
+}
+
+static void axpyFloatScalar(float* out, float alpha, const float* x, const float* y, int count) {
+	for (int i = 0; i < count; i++) {
+		out[i] = y != NULL ? alpha * x[i] + y[i] : alpha * x[i];
+	}
+}
+
+static void axpyIntScalar(int* out, int alpha, const int* x, const int* y, int count) {
+	for (int i = 0; i < count; i++) {
+		unsigned int product = (unsigned int)alpha * (unsigned int)x[i];
+		out[i] = (int)(y != NULL ? product + (unsigned int)y[i] : product);
+	}
+}
+
+static float extremeFloatScalar(const float* v, int count, bool max) {
+	float result = v[0];
+	for (int i = 1; i < count; i++) {
+		result = pickFloat(result, v[i], max);
+	}
+	return result;
+}
+
+static int extremeIntScalar(const int* v, int count, bool max) {
+	int result = v[0];
+	for (int i = 1; i < count; i++) {
+		result = pickInt(result, v[i], max);
+	}
+	return result;
+}
+
+static void prefixFloatScalar(float* out, const float* v, int count) {
+	float result = 0;
+	for (int i = 0; i < count; i++) {
+		out[i] = result += v[i];
+	}
+}
+
+static void prefixIntScalar(int* out, const int* v, int count) {
+	unsigned int result = 0;
+	for (int i = 0; i < count; i++) {
+		result += (unsigned int)v[i];
+		out[i] = (int)result;
+	}
+}
+
+static const VectorKernels scalarKernels = {
+	.sumFloat = sumFloatScalar,
+	.sumInt = sumIntScalar,
+	.dotFloat = dotFloatScalar,
+	.dotInt = dotIntScalar,
+	.binaryFloat = binaryFloatScalar,
+	.binaryInt = binaryIntScalar,
+	.axpyFloat = axpyFloatScalar,
+	.axpyInt = axpyIntScalar,
+	.extremeFloat = extremeFloatScalar,
+	.extremeInt = extremeIntScalar,
+	.prefixFloat = prefixFloatScalar,
+	.prefixInt = prefixIntScalar,
+};
+
+#ifdef TOY_VECTOR_X86
+//SSE2 kernels, four lanes - it has no 32-bit integer multiply, min or max, so those stay scalar
+TARGET_SSE2 static float sumFloatSSE2(const float* v, int count) {
+	__m128 acc = _mm_setzero_ps();
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		acc = _mm_add_ps(acc, _mm_loadu_ps(v + i));
+	}
+
+	float lanes[4];
+	_mm_storeu_ps(lanes, acc);
+	return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]) + sumFloatScalar(v + i, count - i);
+}
+
+TARGET_SSE2 static int sumIntSSE2(const int* v, int count) {
+	__m128i acc = _mm_setzero_si128();
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		acc = _mm_add_epi32(acc, _mm_loadu_si128((const __m128i*)(v + i)));
+	}
+
+	int lanes[4];
+	_mm_storeu_si128((__m128i*)lanes, acc);
+	return (int)((unsigned int)sumIntScalar(lanes, 4) + (unsigned int)sumIntScalar(v + i, count - i));
+}
+
+TARGET_SSE2 static float dotFloatSSE2(const float* a, const float* b, int count) {
+	__m128 acc = _mm_setzero_ps();
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+	}
+
+	float lanes[4];
+	_mm_storeu_ps(lanes, acc);
+	return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]) + dotFloatScalar(a + i, b + i, count - i);
+}
+
+TARGET_SSE2 static void binaryFloatSSE2(float* out, const float* a, const float* b, int count, VectorOp op) {
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128 x = _mm_loadu_ps(a + i);
+		__m128 y = _mm_loadu_ps(b + i);
+		_mm_storeu_ps(out + i, op == VECTOR_ADD ? _mm_add_ps(x, y) : op == VECTOR_SUB ? _mm_sub_ps(x, y) : _mm_mul_ps(x, y));
+	}
+	binaryFloatScalar(out + i, a + i, b + i, count - i, op);
+}
+
+TARGET_SSE2 static void binaryIntSSE2(int* out, const int* a, const int* b, int count, VectorOp op) {
+	int i = 0;
+	for (; op != VECTOR_MUL && i + 4 <= count; i += 4) {
+		__m128i x = _mm_loadu_si128((const __m128i*)(a + i));
+		__m128i y = _mm_loadu_si128((const __m128i*)(b + i));
+		_mm_storeu_si128((__m128i*)(out + i), op == VECTOR_ADD ? _mm_add_epi32(x, y) : _mm_sub_epi32(x, y));
+	}
+	binaryIntScalar(out + i, a + i, b + i, count - i, op);
+}
+
+TARGET_SSE2 static void axpyFloatSSE2(float* out, float alpha, const float* x, const float* y, int count) {
+	__m128 a = _mm_set1_ps(alpha);
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128 product = _mm_mul_ps(a, _mm_loadu_ps(x + i));
+		_mm_storeu_ps(out + i, y != NULL ? _mm_add_ps(product, _mm_loadu_ps(y + i)) : product);
+	}
+	axpyFloatScalar(out + i, alpha, x + i, y != NULL ? y + i : NULL, count - i);
+}
+
+TARGET_SSE2 static float extremeFloatSSE2(const float* v, int count, bool max) {
+	__m128 acc = _mm_set1_ps(v[0]);
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128 x = _mm_loadu_ps(v + i);
+		acc = max ? _mm_max_ps(acc, x) : _mm_min_ps(acc, x);
+	}
+
+	float lanes[4];
+	_mm_storeu_ps(lanes, acc);
+	float result = extremeFloatScalar(lanes, 4, max);
+	return i < count ? pickFloat(result, extremeFloatScalar(v + i, count - i, max), max) : result;
+}
+
+//each block is summed in the register by shifting it onto itself, then the last lane carries into the next block
+TARGET_SSE2 static void prefixFloatSSE2(float* out, const float* v, int count) {
+	__m128 carry = _mm_setzero_ps();
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128 x = _mm_loadu_ps(v + i);
+		x = _mm_add_ps(x, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(x), 4)));
+		x = _mm_add_ps(x, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(x), 8)));
+		x = _mm_add_ps(x, carry);
+		_mm_storeu_ps(out + i, x);
+		carry = _mm_shuffle_ps(x, x, _MM_SHUFFLE(3, 3, 3, 3));
+	}
+
+	float result = i > 0 ? out[i - 1] : 0;
+	for (; i < count; i++) {
+		out[i] = result += v[i];
+	}
+}
+
+TARGET_SSE2 static void prefixIntSSE2(int* out, const int* v, int count) {
+	__m128i carry = _mm_setzero_si128();
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128i x = _mm_loadu_si128((const __m128i*)(v + i));
+		x = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+		x = _mm_add_epi32(x, _mm_slli_si128(x, 8));
+		x = _mm_add_epi32(x, carry);
+		_mm_storeu_si128((__m128i*)(out + i), x);
+		carry = _mm_shuffle_epi32(x, _MM_SHUFFLE(3, 3, 3, 3));
+	}
+
+	unsigned int result = i > 0 ? (unsigned int)out[i - 1] : 0;
+	for (; i < count; i++) {
+		result += (unsigned int)v[i];
+		out[i] = (int)result;
+	}
+}
+
+static const VectorKernels sse2Kernels = {
+	.sumFloat = sumFloatSSE2,
+	.sumInt = sumIntSSE2,
+	.dotFloat = dotFloatSSE2,
+	.dotInt = dotIntScalar,
+	.binaryFloat = binaryFloatSSE2,
+	.binaryInt = binaryIntSSE2,
+	.axpyFloat = axpyFloatSSE2,
+	.axpyInt = axpyIntScalar,
+	.extremeFloat = extremeFloatSSE2,
+	.extremeInt = extremeIntScalar,
+	.prefixFloat = prefixFloatSSE2,
+	.prefixInt = prefixIntSSE2,
+};
+
+//AVX2 kernels, eight lanes - prefix sums gain nothing from the wider registers, so they share the SSE2 ones
+TARGET_AVX2 static float sumFloatAVX2(const float* v, int count) {
+	__m256 acc = _mm256_setzero_ps();
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		acc = _mm256_add_ps(acc, _mm256_loadu_ps(v + i));
+	}
+
+	float lanes[8];
+	_mm256_storeu_ps(lanes, acc);
+	return sumFloatScalar(lanes, 8) + sumFloatScalar(v + i, count - i);
+}
+
+TARGET_AVX2 static int sumIntAVX2(const int* v, int count) {
+	__m256i acc = _mm256_setzero_si256();
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		acc = _mm256_add_epi32(acc, _mm256_loadu_si256((const __m256i*)(v + i)));
+	}
+
+	int lanes[8];
+	_mm256_storeu_si256((__m256i*)lanes, acc);
+	return (int)((unsigned int)sumIntScalar(lanes, 8) + (unsigned int)sumIntScalar(v + i, count - i));
+}
+
+TARGET_AVX2 static float dotFloatAVX2(const float* a, const float* b, int count) {
+	__m256 acc = _mm256_setzero_ps();
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+	}
+
+	float lanes[8];
+	_mm256_storeu_ps(lanes, acc);
+	return sumFloatScalar(lanes, 8) + dotFloatScalar(a + i, b + i, count - i);
+}
+
+TARGET_AVX2 static int dotIntAVX2(const int* a, const int* b, int count) {
+	__m256i acc = _mm256_setzero_si256();
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256i x = _mm256_loadu_si256((const __m256i*)(a + i));
+		__m256i y = _mm256_loadu_si256((const __m256i*)(b + i));
+		acc = _mm256_add_epi32(acc, _mm256_mullo_epi32(x, y));
+	}
+
+	int lanes[8];
+	_mm256_storeu_si256((__m256i*)lanes, acc);
+	return (int)((unsigned int)sumIntScalar(lanes, 8) + (unsigned int)dotIntScalar(a + i, b + i, count - i));
+}
+
+TARGET_AVX2 static void binaryFloatAVX2(float* out, const float* a, const float* b, int count, VectorOp op) {
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256 x = _mm256_loadu_ps(a + i);
+		__m256 y = _mm256_loadu_ps(b + i);
+		_mm256_storeu_ps(out + i, op == VECTOR_ADD ? _mm256_add_ps(x, y) : op == VECTOR_SUB ? _mm256_sub_ps(x, y) : _mm256_mul_ps(x, y));
+	}
+	binaryFloatScalar(out + i, a + i, b + i, count - i, op);
+}
+
+TARGET_AVX2 static void binaryIntAVX2(int* out, const int* a, const int* b, int count, VectorOp op) {
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256i x = _mm256_loadu_si256((const __m256i*)(a + i));
+		__m256i y = _mm256_loadu_si256((const __m256i*)(b + i));
+		_mm256_storeu_si256((__m256i*)(out + i), op == VECTOR_ADD ? _mm256_add_epi32(x, y) : op == VECTOR_SUB ? _mm256_sub_epi32(x, y) : _mm256_mullo_epi32(x, y));
+	}
+	binaryIntScalar(out + i, a + i, b + i, count - i, op);
+}
+
+TARGET_AVX2 static void axpyFloatAVX2(float* out, float alpha, const float* x, const float* y, int count) {
+	__m256 a = _mm256_set1_ps(alpha);
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256 product = _mm256_mul_ps(a, _mm256_loadu_ps(x + i));
+		_mm256_storeu_ps(out + i, y != NULL ? _mm256_add_ps(product, _mm256_loadu_ps(y + i)) : product);
+	}
+	axpyFloatScalar(out + i, alpha, x + i, y != NULL ? y + i : NULL, count - i);
+}
+
+TARGET_AVX2 static void axpyIntAVX2(int* out, int alpha, const int* x, const int* y, int count) {
+	__m256i a = _mm256_set1_epi32(alpha);
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256i product = _mm256_mullo_epi32(a, _mm256_loadu_si256((const __m256i*)(x + i)));
+		_mm256_storeu_si256((__m256i*)(out + i), y != NULL ? _mm256_add_epi32(product, _mm256_loadu_si256((const __m256i*)(y + i))) : product);
+	}
+	axpyIntScalar(out + i, alpha, x + i, y != NULL ? y + i : NULL, count - i);
+}
+
+TARGET_AVX2 static float extremeFloatAVX2(const float* v, int count, bool max) {
+	__m256 acc = _mm256_set1_ps(v[0]);
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256 x = _mm256_loadu_ps(v + i);
+		acc = max ? _mm256_max_ps(acc, x) : _mm256_min_ps(acc, x);
+	}
+
+	float lanes[8];
+	_mm256_storeu_ps(lanes, acc);
+	float result = extremeFloatScalar(lanes, 8, max);
+	return i < count ? pickFloat(result, extremeFloatScalar(v + i, count - i, max), max) : result;
+}
+
+TARGET_AVX2 static int extremeIntAVX2(const int* v, int count, bool max) {
+	__m256i acc = _mm256_set1_epi32(v[0]);
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256i x = _mm256_loadu_si256((const __m256i*)(v + i));
+		acc = max ? _mm256_max_epi32(acc, x) : _mm256_min_epi32(acc, x);
+	}
+
+	int lanes[8];
+	_mm256_storeu_si256((__m256i*)lanes, acc);
+	int result = extremeIntScalar(lanes, 8, max);
+	return i < count ? pickInt(result, extremeIntScalar(v + i, count - i, max), max) : result;
+}
+
+static const VectorKernels avx2Kernels = {
+	.sumFloat = sumFloatAVX2,
+	.sumInt = sumIntAVX2,
+	.dotFloat = dotFloatAVX2,
+	.dotInt = dotIntAVX2,
+	.binaryFloat = binaryFloatAVX2,
+	.binaryInt = binaryIntAVX2,
+	.axpyFloat = axpyFloatAVX2,
+	.axpyInt = axpyIntAVX2,
+	.extremeFloat = extremeFloatAVX2,
+	.extremeInt = extremeIntAVX2,
+	.prefixFloat = prefixFloatSSE2,
+	.prefixInt = prefixIntSSE2,
+};
+#endif
+
+//asks cpuid every time - it's only a load, and leaves nothing for threads to race on
+const VectorKernels* selectVectorKernels(void) {
+#ifdef TOY_VECTOR_X86
+	if (__builtin_cpu_supports("avx2")) {
+		return &avx2Kernels;
+	}
+
+	if (__builtin_cpu_supports("sse2")) {
+		return &sse2Kernels;
+	}
+#endif
+
+	return &scalarKernels;
+}
+
+//the elements of a numeric array, unboxed - packed arrays lend their buffer, plain arrays are copied out
+typedef struct Vector {
+	LiteralType type; //LITERAL_INTEGER or LITERAL_FLOAT
+	int count;
+	union {
+		int* integers;
+		float* floats;
+	} as;
+	bool owned;
+} Vector;
+
+static bool readVector(Literal literal, Vector* vector) {
+	if (IS_PACKED_ARRAY(literal)) {
+		vector->type = AS_PACKED_ARRAY(literal)->elementType;
+		vector->count = AS_PACKED_ARRAY(literal)->count;
+		vector->as.integers = AS_PACKED_ARRAY(literal)->as.integers;
+		vector->owned = false;
+		return true;
+	}
+
+	if (!IS_ARRAY(literal)) {
+		return false;
+	}
+
+	//any float makes the whole array float
+	LiteralArray* array = AS_ARRAY(literal);
+	vector->type = LITERAL_INTEGER;
+
+	for (int i = 0; i < array->count; i++) {
+		if (IS_FLOAT(array->literals[i])) {
+			vector->type = LITERAL_FLOAT;
+		}
+		else if (!IS_INTEGER(array->literals[i])) {
+			return false;
+		}
+	}
+
+	vector->count = array->count;
+	vector->as.integers = ALLOCATE(int, array->count);
+	vector->owned = true;
+
+	for (int i = 0; i < array->count; i++) {
+		if (vector->type == LITERAL_INTEGER) {
+			vector->as.integers[i] = AS_INTEGER(array->literals[i]);
+		}
+		else {
+			vector->as.floats[i] = IS_FLOAT(array->literals[i]) ? AS_FLOAT(array->literals[i]) : (float)AS_INTEGER(array->literals[i]);
+		}
+	}
+
+	return true;
+}
+
+static void freeVector(Vector* vector) {
+	if (vector->owned) {
+		FREE_ARRAY(int, vector->as.integers, vector->count);
+	}
+}
+
+static void promoteVector(Vector* vector) {
+	if (vector->type == LITERAL_FLOAT) {
+		return;
+	}
+
+	float* floats = ALLOCATE(float, vector->count);
+	for (int i = 0; i < vector->count; i++) {
+		floats[i] = (float)vector->as.integers[i];
+	}
+
+	freeVector(vector);
+	vector->type = LITERAL_FLOAT;
+	vector->as.floats = floats;
+	vector->owned = true;
+}
+
+//pops an argument, reading through any identifier
+static Literal popArgument(Interpreter* interpreter, LiteralArray* arguments) {
+	Literal literal = popLiteralArray(arguments);
+
+	Literal idn = literal;
+	if (IS_IDENTIFIER(literal) && parseIdentifierToValue(interpreter, &literal)) {
+		freeLiteral(idn);
+	}
+
+	return literal;
+}
+
+static void argumentError(Interpreter* interpreter, char* message, char* name) {
+	interpreter->errorOutput(message);
+	interpreter->errorOutput(name);
+	interpreter->errorOutput("\n");
+}
+
+//reads an array argument, freeing the literal on failure
+static bool popVector(Interpreter* interpreter, LiteralArray* arguments, Literal* literal, Vector* vector, char* name) {
+	*literal = popArgument(interpreter, arguments);
+
+	if (!readVector(*literal, vector)) {
+		freeLiteral(*literal);
+		argumentError(interpreter, "Incorrect argument type passed to ", name);
+		return false;
+	}
+
+	return true;
+}
+
+//results are packed, and unpacked by whatever variable doesn't want them that way
+static PackedArray* createResult(LiteralType type, int count) {
+	PackedArray* result = createPackedArray(type);
+	resizePackedArray(result, count);
+	return result;
+}
+
+static void pushResult(Interpreter* interpreter, PackedArray* result) {
+	Literal literal = TO_PACKED_ARRAY_LITERAL(result);
+	pushLiteralArray(&interpreter->stack, literal);
+	freeLiteral(literal);
+}
+
+//callbacks
+static int nativeSum(Interpreter* interpreter, LiteralArray* arguments) {
+	if (arguments->count != 1) {
+		interpreter->errorOutput("Incorrect number of arguments to sum\n");
+		return -1;
+	}
+
+	Literal literal;
+	Vector vector;
+	if (!popVector(interpreter, arguments, &literal, &vector, "sum")) {
+		return -1;
+	}
+
+	const VectorKernels* kernels = selectVectorKernels();
+	Literal result = vector.type == LITERAL_INTEGER ? TO_INTEGER_LITERAL(kernels->sumInt(vector.as.integers, vector.count)) : TO_FLOAT_LITERAL(kernels->sumFloat(vector.as.floats, vector.count));
+	pushLiteralArray(&interpreter->stack, result);
+
+	freeVector(&vector);
+	freeLiteral(literal);
+
+	return 1;
+}
+
+static int nativeDot(Interpreter* interpreter, LiteralArray* arguments) {
+	if (arguments->count != 2) {
+		interpreter->errorOutput("Incorrect number of arguments to dot\n");
+		return -1;
+	}
+
+	Literal rhsLiteral, lhsLiteral;
+	Vector rhs, lhs;
+	if (!popVector(interpreter, arguments, &rhsLiteral, &rhs, "dot")) {
+		return -1;
+	}
+
+	if (!popVector(interpreter, arguments, &lhsLiteral, &lhs, "dot")) {
+		freeVector(&rhs);
+		freeLiteral(rhsLiteral);
+		return -1;
+	}
+
+	int result = lhs.count == rhs.count ? 1 : -1;
+
+	if (result == -1) {
+		argumentError(interpreter, "Mismatched lengths passed to ", "dot");
+	}
+	else {
+		const VectorKernels* kernels = selectVectorKernels();
+
+		if (lhs.type != rhs.type) {
+			promoteVector(&lhs);
+			promoteVector(&rhs);
+		}
+
+		Literal literal = lhs.type == LITERAL_INTEGER ? TO_INTEGER_LITERAL(kernels->dotInt(lhs.as.integers, rhs.as.integers, lhs.count)) : TO_FLOAT_LITERAL(kernels->dotFloat(lhs.as.floats, rhs.as.floats, lhs.count));
+		pushLiteralArray(&interpreter->stack, literal);
+	}
+
+	freeVector(&lhs);
+	freeVector(&rhs);
+	freeLiteral(lhsLiteral);
+	freeLiteral(rhsLiteral);
+
+	return result;
+}
+
+static int elementwise(Interpreter* interpreter, LiteralArray* arguments, VectorOp op, char* name) {
+	if (arguments->count != 2) {
+		argumentError(interpreter, "Incorrect number of arguments to ", name);
+		return -1;
+	}
+
+	Literal rhsLiteral, lhsLiteral;
+	Vector rhs, lhs;
+	if (!popVector(interpreter, arguments, &rhsLiteral, &rhs, name)) {
+		return -1;
+	}
+
+	if (!popVector(interpreter, arguments, &lhsLiteral, &lhs, name)) {
+		freeVector(&rhs);
+		freeLiteral(rhsLiteral);
+		return -1;
+	}
+
+	int result = lhs.count == rhs.count ? 1 : -1;
+
+	if (result == -1) {
+		argumentError(interpreter, "Mismatched lengths passed to ", name);
+	}
+	else {
+		const VectorKernels* kernels = selectVectorKernels();
+
+		if (lhs.type != rhs.type) {
+			promoteVector(&lhs);
+			promoteVector(&rhs);
+		}
+
+		PackedArray* out = createResult(lhs.type, lhs.count);
+
+		if (lhs.type == LITERAL_INTEGER) {
+			kernels->binaryInt(out->as.integers, lhs.as.integers, rhs.as.integers, lhs.count, op);
+		}
+		else {
+			kernels->binaryFloat(out->as.floats, lhs.as.floats, rhs.as.floats, lhs.count, op);
+		}
+
+		pushResult(interpreter, out);
+	}
+
+	freeVector(&lhs);
+	freeVector(&rhs);
+	freeLiteral(lhsLiteral);
+	freeLiteral(rhsLiteral);
+
+	return result;
+}
+
+static int nativeAdd(Interpreter* interpreter, LiteralArray* arguments) {
+	return elementwise(interpreter, arguments, VECTOR_ADD, "add");
+}
+
+static int nativeSub(Interpreter* interpreter, LiteralArray* arguments) {
+	return elementwise(interpreter, arguments, VECTOR_SUB, "sub");
+}
+
+static int nativeMul(Interpreter* interpreter, LiteralArray* arguments) {
+	return elementwise(interpreter, arguments, VECTOR_MUL, "mul");
+}
+
+//x * alpha + y, or only x * alpha when there's no y
+static int scaleAndAdd(Interpreter* interpreter, LiteralArray* arguments, bool hasY, char* name) {
+	if (arguments->count != (hasY ? 3 : 2)) {
+		argumentError(interpreter, "Incorrect number of arguments to ", name);
+		return -1;
+	}
+
+	Literal yLiteral = TO_NULL_LITERAL;
+	Vector y = { .type = LITERAL_INTEGER, .count = 0, .as.integers = NULL, .owned = false };
+	if (hasY && !popVector(interpreter, arguments, &yLiteral, &y, name)) {
+		return -1;
+	}
+
+	Literal alpha = popArgument(interpreter, arguments);
+
+	if (!IS_INTEGER(alpha) && !IS_FLOAT(alpha)) {
+		argumentError(interpreter, "Incorrect argument type passed to ", name);
+		freeVector(&y);
+		freeLiteral(yLiteral);
+		freeLiteral(alpha);
+		return -1;
+	}
+
+	Literal xLiteral;
+	Vector x;
+	if (!popVector(interpreter, arguments, &xLiteral, &x, name)) {
+		freeVector(&y);
+		freeLiteral(yLiteral);
+		return -1;
+	}
+
+	int result = !hasY || x.count == y.count ? 1 : -1;
+
+	if (result == -1) {
+		argumentError(interpreter, "Mismatched lengths passed to ", name);
+	}
+	else {
+		const VectorKernels* kernels = selectVectorKernels();
+
+		//integers stay integers only when everything is
+		if (IS_FLOAT(alpha) || x.type == LITERAL_FLOAT || (hasY && y.type == LITERAL_FLOAT)) {
+			promoteVector(&x);
+			if (hasY) {
+				promoteVector(&y);
+			}
+
+			float a = IS_FLOAT(alpha) ? AS_FLOAT(alpha) : (float)AS_INTEGER(alpha);
+			PackedArray* out = createResult(LITERAL_FLOAT, x.count);
+			kernels->axpyFloat(out->as.floats, a, x.as.floats, hasY ? y.as.floats : NULL, x.count);
+			pushResult(interpreter, out);
+		}
+		else {
+			PackedArray* out = createResult(LITERAL_INTEGER, x.count);
+			kernels->axpyInt(out->as.integers, AS_INTEGER(alpha), x.as.integers, hasY ? y.as.integers : NULL, x.count);
+			pushResult(interpreter, out);
+		}
+	}
+
+	freeVector(&x);
+	freeVector(&y);
+	freeLiteral(xLiteral);
+	freeLiteral(yLiteral);
+
+	return result;
+}
+
+static int nativeScale(Interpreter* interpreter, LiteralArray* arguments) {
+	return scaleAndAdd(interpreter, arguments, false, "scale");
+}
+
+static int nativeAxpy(Interpreter* interpreter, LiteralArray* arguments) {
+	return scaleAndAdd(interpreter, arguments, true, "axpy");
+}
+
+//the smallest or largest element, or its first index - null for empty arrays
+static int extreme(Interpreter* interpreter, LiteralArray* arguments, bool max, bool index, char* name) {
+	if (arguments->count != 1) {
+		argumentError(interpreter, "Incorrect number of arguments to ", name);
+		return -1;
+	}
+
+	Literal literal;
+	Vector vector;
+	if (!popVector(interpreter, arguments, &literal, &vector, name)) {
+		return -1;
+	}
+
+	Literal result = TO_NULL_LITERAL;
+
+	if (vector.count > 0) {
+		const VectorKernels* kernels = selectVectorKernels();
+
+		//the index is found with a second pass, which is cheaper than tracking it in the lanes
+		int found = 0;
+
+		if (vector.type == LITERAL_INTEGER) {
+			int value = kernels->extremeInt(vector.as.integers, vector.count, max);
+
+			while (index && vector.as.integers[found] != value) {
+				found++;
+			}
+
+			result = index ? TO_INTEGER_LITERAL(found) : TO_INTEGER_LITERAL(value);
+		}
+		else {
+			float value = kernels->extremeFloat(vector.as.floats, vector.count, max);
+
+			while (index && found < vector.count && vector.as.floats[found] != value) {
+				found++;
+			}
+
+			//only NaNs can miss, and then the first element will do
+			result = index ? TO_INTEGER_LITERAL(found < vector.count ? found : 0) : TO_FLOAT_LITERAL(value);
+		}
+	}
+
+	pushLiteralArray(&interpreter->stack, result);
+
+	freeVector(&vector);
+	freeLiteral(literal);
+
+	return 1;
+}
+
+static int nativeMin(Interpreter* interpreter, LiteralArray* arguments) {
+	return extreme(interpreter, arguments, false, false, "min");
+}
+
+static int nativeMax(Interpreter* interpreter, LiteralArray* arguments) {
+	return extreme(interpreter, arguments, true, false, "max");
+}
+
+static int nativeArgmin(Interpreter* interpreter, LiteralArray* arguments) {
+	return extreme(interpreter, arguments, false, true, "argmin");
+}
+
+static int nativeArgmax(Interpreter* interpreter, LiteralArray* arguments) {
+	return extreme(interpreter, arguments, true, true, "argmax");
+}
+
+static int nativePrefixSum(Interpreter* interpreter, LiteralArray* arguments) {
+	if (arguments->count != 1) {
+		interpreter->errorOutput("Incorrect number of arguments to prefixSum\n");
+		return -1;
+	}
+
+	Literal literal;
+	Vector vector;
+	if (!popVector(interpreter, arguments, &literal, &vector, "prefixSum")) {
+		return -1;
+	}
+
+	const VectorKernels* kernels = selectVectorKernels();
+	PackedArray* out = createResult(vector.type, vector.count);
+
+	if (vector.type == LITERAL_INTEGER) {
+		kernels->prefixInt(out->as.integers, vector.as.integers, vector.count);
+	}
+	else {
+		kernels->prefixFloat(out->as.floats, vector.as.floats, vector.count);
+	}
+
+	pushResult(interpreter, out);
+
+	freeVector(&vector);
+	freeLiteral(literal);
+
+	return 1;
+}
+
+//call the hook
+typedef struct Natives {
+	char* name;
+	NativeFn fn;
+} Natives;
+
+int hookVector(Interpreter* interpreter, Literal identifier, Literal alias) {
+	//build the natives list - the underscores allow the dot notation, like "a.dot(b)"
+	Natives natives[] = {
+		{"_sum", nativeSum},
+		{"_dot", nativeDot},
+		{"_add", nativeAdd},
+		{"_sub", nativeSub},
+		{"_mul", nativeMul},
+		{"_scale", nativeScale},
+		{"_axpy", nativeAxpy},
+		{"_min", nativeMin},
+		{"_max", nativeMax},
+		{"_argmin", nativeArgmin},
+		{"_argmax", nativeArgmax},
+		{"_prefixSum", nativePrefixSum},
+		{NULL, NULL}
+	};
+
+	//store the library in an aliased dictionary
+	if (!IS_NULL(alias)) {
+		//make sure the name isn't taken
+		if (isDelcaredScopeVariable(interpreter->scope, alias)) {
+			interpreter->errorOutput("Can't override an existing variable\n");
+			freeLiteral(alias);
+			return false;
+		}
+
+		//create the dictionary to load up with functions
+		LiteralDictionary* dictionary = ALLOCATE(LiteralDictionary, 1);
+		initLiteralDictionary(dictionary);
+
+		//load the dict with functions
+		for (int i = 0; natives[i].name; i++) {
+			Literal name = TO_STRING_LITERAL(createRefString(natives[i].name));
+			Literal func = TO_FUNCTION_LITERAL((void*)natives[i].fn, 0);
+			func.type = LITERAL_FUNCTION_NATIVE;
+
+			setLiteralDictionary(dictionary, name, func);
+
+			freeLiteral(name);
+			freeLiteral(func);
+		}
+
+		//build the type
+		Literal type = TO_TYPE_LITERAL(LITERAL_DICTIONARY, true);
+		Literal strType = TO_TYPE_LITERAL(LITERAL_STRING, true);
+		Literal fnType = TO_TYPE_LITERAL(LITERAL_FUNCTION_NATIVE, true);
+		TYPE_PUSH_SUBTYPE(&type, strType);
+		TYPE_PUSH_SUBTYPE(&type, fnType);
+
+		//set scope
+		Literal dict = TO_DICTIONARY_LITERAL(dictionary);
+		declareScopeVariable(interpreter->scope, alias, type);
+		setScopeVariable(interpreter->scope, alias, dict, false);
+
+		//cleanup
+		freeLiteral(dict);
+		freeLiteral(type);
+		return 0;
+	}
+
+	//default
+	for (int i = 0; natives[i].name; i++) {
+		injectNativeFn(interpreter, natives[i].name, natives[i].fn);
+	}
+
+	return 0;
+}
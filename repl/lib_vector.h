@@ -0,0 +1,31 @@
+#pragma once
+
+#include "interpreter.h"
+
+int hookVector(Interpreter* interpreter, Literal identifier, Literal alias);
+
+typedef enum VectorOp {
+	VECTOR_ADD,
+	VECTOR_SUB,
+	VECTOR_MUL,
+} VectorOp;
+
+//the kernels for one instruction set - integers wrap on overflow, as they do in the registers
+typedef struct VectorKernels {
+	float (*sumFloat)(const float* v, int count);
+	int (*sumInt)(const int* v, int count);
+	float (*dotFloat)(const float* a, const float* b, int count);
+	int (*dotInt)(const int* a, const int* b, int count);
+	void (*binaryFloat)(float* out, const float* a, const float* b, int count, VectorOp op);
+	void (*binaryInt)(int* out, const int* a, const int* b, int count, VectorOp op);
+	void (*axpyFloat)(float* out, float alpha, const float* x, const float* y, int count); //y is NULL to only scale, and may be out
+	void (*axpyInt)(int* out, int alpha, const int* x, const int* y, int count);
+	float (*extremeFloat)(const float* v, int count, bool max); //count must be positive
+	int (*extremeInt)(const int* v, int count, bool max);
+	void (*prefixFloat)(float* out, const float* v, int count);
+	void (*prefixInt)(int* out, const int* v, int count);
+} VectorKernels;
+
+//the best kernels this cpu supports, for other native libraries
+const VectorKernels* selectVectorKernels(void);
+
@@ -1,6 +1,9 @@
 #include "repl_tools.h"
 #include "lib_standard.h"
 #include "lib_timer.h"
+#include "lib_channel.h"
+#include "lib_vector.h"
+#include "lib_matrix.h"
 
 #include "console_colors.h"
 
@@ -27,6 +30,9 @@ void repl() {
 	//inject the libs
 	injectNativeHook(&interpreter, "standard", hookStandard);
 	injectNativeHook(&interpreter, "timer", hookTimer);
+	injectNativeHook(&interpreter, "channel", hookChannel);
+	injectNativeHook(&interpreter, "vector", hookVector);
+	injectNativeHook(&interpreter, "matrix", hookMatrix);
 
 	for(;;) {
 		printf("> ");
@@ -53,12 +59,10 @@ void repl() {
 			if (node->type == AST_NODE_ERROR) {
 				printf(ERROR "error node detected\n" RESET);
 				error = true;
-				freeASTNode(node);
 				break;
 			}
 
 			writeCompiler(&compiler, node);
-			freeASTNode(node);
 			node = scanParser(&parser);
 		}
 
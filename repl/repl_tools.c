@@ -1,6 +1,9 @@
 #include "repl_tools.h"
 #include "lib_standard.h"
 #include "lib_timer.h"
+#include "lib_channel.h"
+#include "lib_vector.h"
+#include "lib_matrix.h"
 
 #include "console_colors.h"
 
@@ -8,9 +11,20 @@
 #include "parser.h"
 #include "compiler.h"
 #include "interpreter.h"
+#include "compile_cache.h"
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32) || defined(WIN32)
+#include <process.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 //IO functions
 char* readFile(char* path, size_t* fileSize) {
@@ -64,6 +78,47 @@ void writeFile(char* path, unsigned char* bytes, size_t size) {
 	fclose(file);
 }
 
+//map a file read-only, so large binaries are paged in rather than copied
+unsigned char* mapFile(char* path, size_t* fileSize) {
+#if defined(_WIN32) || defined(WIN32)
+	return (unsigned char*)readFile(path, fileSize);
+#else
+	int fd = open(path, O_RDONLY);
+
+	if (fd < 0) {
+		fprintf(stderr, ERROR "Could not open file \"%s\"\n" RESET, path);
+		return NULL;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		fprintf(stderr, ERROR "Could not read file \"%s\"\n" RESET, path);
+		close(fd);
+		return NULL;
+	}
+
+	void* bytes = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd); //the mapping holds its own reference
+
+	if (bytes == MAP_FAILED) {
+		fprintf(stderr, ERROR "Could not map file \"%s\"\n" RESET, path);
+		return NULL;
+	}
+
+	*fileSize = st.st_size;
+
+	return (unsigned char*)bytes;
+#endif
+}
+
+void unmapFile(unsigned char* bytes, size_t size) {
+#if defined(_WIN32) || defined(WIN32)
+	free((void*)bytes);
+#else
+	munmap(bytes, size);
+#endif
+}
+
 //repl functions
 unsigned char* compileString(char* source, size_t* size) {
 	Lexer lexer;
@@ -80,14 +135,12 @@ unsigned char* compileString(char* source, size_t* size) {
 		//pack up and leave
 		if (node->type == AST_NODE_ERROR) {
 			printf(ERROR "error node detected\n" RESET);
-			freeASTNode(node);
 			freeCompiler(&compiler);
 			freeParser(&parser);
 			return NULL;
 		}
 
 		writeCompiler(&compiler, node);
-		freeASTNode(node);
 		node = scanParser(&parser);
 	}
 
@@ -110,24 +163,164 @@ void runBinary(unsigned char* tb, size_t size) {
 	//inject the libs
 	injectNativeHook(&interpreter, "standard", hookStandard);
 	injectNativeHook(&interpreter, "timer", hookTimer);
+	injectNativeHook(&interpreter, "channel", hookChannel);
+	injectNativeHook(&interpreter, "vector", hookVector);
+	injectNativeHook(&interpreter, "matrix", hookMatrix);
 
 	runInterpreter(&interpreter, tb, size);
 	freeInterpreter(&interpreter);
 }
 
 void runBinaryFile(char* fname) {
-	size_t size = 0; //not used
-	unsigned char* tb = (unsigned char*)readFile(fname, &size);
+	size_t size = 0;
+	unsigned char* tb = mapFile(fname, &size);
 	if (!tb) {
 		return;
 	}
-	runBinary(tb, size);
-	//interpreter takes ownership of the binary data
+
+	Interpreter interpreter;
+	initInterpreter(&interpreter);
+
+	//inject the libs
+	injectNativeHook(&interpreter, "standard", hookStandard);
+	injectNativeHook(&interpreter, "timer", hookTimer);
+	injectNativeHook(&interpreter, "channel", hookChannel);
+	injectNativeHook(&interpreter, "vector", hookVector);
+	injectNativeHook(&interpreter, "matrix", hookMatrix);
+
+	//the interpreter only borrows the mapped image
+	runInterpreterBorrowed(&interpreter, tb, size);
+	unmapFile(tb, size);
+
+	freeInterpreter(&interpreter);
+}
+
+//cache entries lead with the bytecode's length and checksum, so a torn or truncated file is never run
+//the source follows, since two sources can share a file name's hash
+#define CACHE_HEADER_SIZE (sizeof(unsigned long long) * 3)
+
+//unlike readFile(), a missing or unreadable entry is just a cache miss
+static unsigned char* readCacheFile(char* path, size_t* fileSize) {
+	FILE* file = fopen(path, "rb");
+
+	if (file == NULL) {
+		return NULL;
+	}
+
+	fseek(file, 0L, SEEK_END);
+	long end = ftell(file);
+	rewind(file);
+
+	unsigned char* buffer = end > 0 ? (unsigned char*)malloc(end) : NULL;
+
+	if (buffer == NULL || fread(buffer, sizeof(unsigned char), end, file) < (size_t)end) {
+		free(buffer);
+		fclose(file);
+		return NULL;
+	}
+
+	fclose(file);
+
+	*fileSize = end;
+	return buffer;
+}
+
+static unsigned char* readCacheEntry(char* path, char* source, size_t sourceLength, size_t* size) {
+	size_t fileSize = 0;
+	unsigned char* entry = readCacheFile(path, &fileSize);
+	if (!entry) {
+		return NULL;
+	}
+
+	unsigned long long length = 0;
+	unsigned long long checksum = 0;
+	unsigned long long storedSourceLength = 0;
+
+	if (fileSize >= CACHE_HEADER_SIZE) {
+		memcpy(&length, entry, sizeof(unsigned long long));
+		memcpy(&checksum, entry + sizeof(unsigned long long), sizeof(unsigned long long));
+		memcpy(&storedSourceLength, entry + sizeof(unsigned long long) * 2, sizeof(unsigned long long));
+	}
+
+	unsigned char* storedSource = entry + CACHE_HEADER_SIZE;
+	unsigned char* tb = storedSource + sourceLength;
+
+	if (fileSize < CACHE_HEADER_SIZE + sourceLength || storedSourceLength != sourceLength || length != fileSize - CACHE_HEADER_SIZE - sourceLength || length <= 3 || memcmp(storedSource, source, sourceLength) != 0 || checksum != hashCompileCacheKey((char*)tb, length) || tb[0] != TOY_VERSION_MAJOR || tb[1] != TOY_VERSION_MINOR || tb[2] != TOY_VERSION_PATCH) {
+		free((void*)entry); //stale, damaged or another source's, so recompile
+		return NULL;
+	}
+
+	memmove(entry, tb, length);
+	*size = length;
+	return entry;
+}
+
+static void writeCacheEntry(char* path, char* source, size_t sourceLength, unsigned char* tb, size_t size) {
+	//write aside to a name no other process shares, then rename, so readers never see a partial file
+	char tmp[1040];
+
+#if defined(_WIN32) || defined(WIN32)
+	static int counter = 0;
+	snprintf(tmp, 1040, "%s.%d.%d.tmp", path, _getpid(), counter++);
+	FILE* file = fopen(tmp, "wb");
+#else
+	snprintf(tmp, 1040, "%s.XXXXXX", path);
+	int fd = mkstemp(tmp);
+	if (fd >= 0) {
+		fchmod(fd, 0644);
+	}
+	FILE* file = fd >= 0 ? fdopen(fd, "wb") : NULL;
+#endif
+
+	if (!file) {
+		if (command.verbose) {
+			fprintf(stderr, WARN "Could not write to the compile cache \"%s\"\n" RESET, command.cachedir);
+		}
+		return;
+	}
+
+	unsigned long long length = size;
+	unsigned long long checksum = hashCompileCacheKey((char*)tb, size);
+	unsigned long long storedSourceLength = sourceLength;
+
+	bool written = fwrite(&length, sizeof(unsigned long long), 1, file) == 1 && fwrite(&checksum, sizeof(unsigned long long), 1, file) == 1 && fwrite(&storedSourceLength, sizeof(unsigned long long), 1, file) == 1;
+	written = written && (sourceLength == 0 || fwrite(source, sourceLength, 1, file) == 1) && fwrite(tb, size, 1, file) == 1;
+	written = fclose(file) == 0 && written;
+
+	if (!written || rename(tmp, path) != 0) {
+		remove(tmp);
+	}
+}
+
+//reuse bytecode from the on-disk cache, if there is one
+static unsigned char* compileStringCached(char* source, size_t* size) {
+	if (!command.cachedir) {
+		return compileString(source, size);
+	}
+
+	size_t sourceLength = strlen(source);
+
+	char path[1024];
+	snprintf(path, 1024, "%s/%016llx.tb", command.cachedir, hashCompileCacheKey(source, sourceLength));
+
+	unsigned char* tb = readCacheEntry(path, source, sourceLength, size);
+	if (tb) {
+		return tb;
+	}
+
+	tb = compileString(source, size);
+	if (!tb) {
+		return NULL;
+	}
+
+	writeCacheEntry(path, source, sourceLength, tb, *size);
+
+	return tb;
 }
 
 void runSource(char* source) {
 	size_t size = 0;
-	unsigned char* tb = compileString(source, &size);
+	unsigned char* tb = compileStringCached(source, &size);
 	if (!tb) {
 		return;
 	}
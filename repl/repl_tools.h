@@ -4,6 +4,8 @@
 
 char* readFile(char* path, size_t* fileSize);
 void writeFile(char* path, unsigned char* bytes, size_t size);
+unsigned char* mapFile(char* path, size_t* fileSize);
+void unmapFile(unsigned char* bytes, size_t size);
 
 unsigned char* compileString(char* source, size_t* size);
 
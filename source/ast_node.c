@@ -2,8 +2,46 @@
 
 #include "memory.h"
 
+#include "console_colors.h"
+
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+//arena chunks are chained together, so they can be released in one pass
+typedef struct ASTArenaChunk {
+	struct ASTArenaChunk* next;
+	ASTNode nodes[]; //keeps the nodes aligned
+} ASTArenaChunk;
+
+//the arena currently handing out nodes on this thread
+static TOY_THREAD_LOCAL ASTArena* currentArena = NULL;
+
+static ASTNode* allocateArenaNodes(ASTArena* arena, int count) {
+	size_t size = sizeof(ASTNode) * count;
+
+	if (arena->bump == NULL || arena->bump + size > arena->bumpEnd) {
+		//oversized arrays get a chunk of their own
+		size_t chunkSize = sizeof(ASTArenaChunk) + size > AST_ARENA_CHUNK_SIZE ? sizeof(ASTArenaChunk) + size : AST_ARENA_CHUNK_SIZE;
+		ASTArenaChunk* chunk = malloc(chunkSize);
+
+		if (chunk == NULL) {
+			fprintf(stderr, ERROR "[internal] AST arena error (couldn't allocate a new chunk)\n" RESET);
+			exit(-1);
+		}
+
+		chunk->next = arena->chunks;
+		arena->chunks = chunk;
+		arena->chunkCount++;
+
+		arena->bump = (unsigned char*)chunk->nodes;
+		arena->bumpEnd = (unsigned char*)chunk + chunkSize;
+	}
+
+	ASTNode* nodes = (ASTNode*)arena->bump;
+	arena->bump += size;
+	return nodes;
+}
 
 void freeASTNodeCustom(ASTNode* node, bool freeSelf) {
 	//don't free a NULL node
@@ -37,14 +75,14 @@ void freeASTNodeCustom(ASTNode* node, bool freeSelf) {
 			for (int i = 0; i < node->block.count; i++) {
 				freeASTNodeCustom(node->block.nodes + i, false);
 			}
-			FREE_ARRAY(ASTNode, node->block.nodes, node->block.capacity);
+			FREE_AST_NODES(node->block.nodes, node->block.capacity);
 		break;
 
 		case AST_NODE_COMPOUND:
 			for (int i = 0; i < node->compound.count; i++) {
 				freeASTNodeCustom(node->compound.nodes + i, false);
 			}
-			FREE_ARRAY(ASTNode, node->compound.nodes, node->compound.capacity);
+			FREE_AST_NODES(node->compound.nodes, node->compound.capacity);
 		break;
 
 		case AST_NODE_PAIR:
@@ -68,7 +106,7 @@ void freeASTNodeCustom(ASTNode* node, bool freeSelf) {
 			for (int i = 0; i < node->fnCollection.count; i++) {
 				freeASTNodeCustom(node->fnCollection.nodes + i, false);
 			}
-			FREE_ARRAY(ASTNode, node->fnCollection.nodes, node->fnCollection.capacity);
+			FREE_AST_NODES(node->fnCollection.nodes, node->fnCollection.capacity);
 		break;
 
 		case AST_NODE_FN_DECL:
@@ -104,6 +142,13 @@ void freeASTNodeCustom(ASTNode* node, bool freeSelf) {
 			freeASTNode(node->pathFor.thenPath);
 		break;
 
+		case AST_NODE_FOR_IN:
+			freeLiteral(node->pathForIn.first);
+			freeLiteral(node->pathForIn.second);
+			freeASTNode(node->pathForIn.collection);
+			freeASTNode(node->pathForIn.thenPath);
+		break;
+
 		case AST_NODE_BREAK:
 			//NO-OP
 		break;
@@ -134,21 +179,96 @@ void freeASTNodeCustom(ASTNode* node, bool freeSelf) {
 			freeLiteral(node->export.identifier);
 			freeLiteral(node->export.alias);
 		break;
+
+		case AST_NODE_FIELD:
+			freeLiteral(node->field.name);
+		break;
+
+		case AST_NODE_SWITCH:
+			freeASTNode(node->pathSwitch.value);
+			for (int i = 0; i < node->pathSwitch.count; i++) {
+				freeASTNodeCustom(node->pathSwitch.cases + i, false);
+			}
+			FREE_AST_NODES(node->pathSwitch.cases, node->pathSwitch.capacity);
+		break;
 	}
 
 	if (freeSelf) {
-		FREE(ASTNode, node);
+		FREE_AST_NODE(node);
 	}
 }
 
 void freeASTNode(ASTNode* node) {
+	//an embedder freeing a parser's node would release its literals twice
+	if (node != NULL && node->arenaOwned && currentArena == NULL) {
+		return;
+	}
+
 	freeASTNodeCustom(node, true);
 }
 
+//arenas
+void initASTArena(ASTArena* arena) {
+	arena->chunks = NULL;
+	arena->bump = NULL;
+	arena->bumpEnd = NULL;
+	arena->chunkCount = 0;
+}
+
+void freeASTArena(ASTArena* arena) {
+	while (arena->chunks != NULL) {
+		ASTArenaChunk* next = arena->chunks->next;
+		free(arena->chunks);
+		arena->chunks = next;
+	}
+
+	initASTArena(arena);
+}
+
+ASTArena* setASTArena(ASTArena* arena) {
+	ASTArena* previous = currentArena;
+	currentArena = arena;
+	return previous;
+}
+
+ASTNode* reallocateASTNodes(ASTNode* nodes, int oldCount, int count) {
+	if (currentArena == NULL) {
+		ASTNode* mem = (ASTNode*)reallocate(nodes, sizeof(ASTNode) * oldCount, sizeof(ASTNode) * count);
+
+		for (int i = oldCount; i < count; i++) {
+			mem[i].arenaOwned = false;
+		}
+
+		return mem;
+	}
+
+	//the arena releases everything at once
+	if (count == 0) {
+		return NULL;
+	}
+
+	if (count <= oldCount) {
+		return nodes;
+	}
+
+	//grow by moving, abandoning the old array
+	ASTNode* mem = allocateArenaNodes(currentArena, count);
+
+	if (nodes != NULL) {
+		memcpy(mem, nodes, sizeof(ASTNode) * oldCount);
+	}
+
+	for (int i = 0; i < count; i++) {
+		mem[i].arenaOwned = true;
+	}
+
+	return mem;
+}
+
 //various emitters
 void emitASTNodeLiteral(ASTNode** nodeHandle, Literal literal) {
 	//allocate a new node
-	*nodeHandle = ALLOCATE(ASTNode, 1);
+	*nodeHandle = ALLOCATE_AST_NODE();
 
 	(*nodeHandle)->type = AST_NODE_LITERAL;
 	(*nodeHandle)->atomic.literal = copyLiteral(literal);
@@ -156,7 +276,7 @@ void emitASTNodeLiteral(ASTNode** nodeHandle, Literal literal) {
 
 void emitASTNodeUnary(ASTNode** nodeHandle, Opcode opcode, ASTNode* child) {
 	//allocate a new node
-	*nodeHandle = ALLOCATE(ASTNode, 1);
+	*nodeHandle = ALLOCATE_AST_NODE();
 
 	(*nodeHandle)->type = AST_NODE_UNARY;
 	(*nodeHandle)->unary.opcode = opcode;
@@ -164,7 +284,7 @@ void emitASTNodeUnary(ASTNode** nodeHandle, Opcode opcode, ASTNode* child) {
 }
 
 void emitASTNodeBinary(ASTNode** nodeHandle, ASTNode* rhs, Opcode opcode) {
-	ASTNode* tmp = ALLOCATE(ASTNode, 1);
+	ASTNode* tmp = ALLOCATE_AST_NODE();
 
 	tmp->type = AST_NODE_BINARY;
 	tmp->binary.opcode = opcode;
@@ -175,7 +295,7 @@ void emitASTNodeBinary(ASTNode** nodeHandle, ASTNode* rhs, Opcode opcode) {
 }
 
 void emitASTNodeGrouping(ASTNode** nodeHandle) {
-	ASTNode* tmp = ALLOCATE(ASTNode, 1);
+	ASTNode* tmp = ALLOCATE_AST_NODE();
 
 	tmp->type = AST_NODE_GROUPING;
 	tmp->grouping.child = *nodeHandle;
@@ -184,7 +304,7 @@ void emitASTNodeGrouping(ASTNode** nodeHandle) {
 }
 
 void emitASTNodeBlock(ASTNode** nodeHandle) {
-	ASTNode* tmp = ALLOCATE(ASTNode, 1);
+	ASTNode* tmp = ALLOCATE_AST_NODE();
 
 	tmp->type = AST_NODE_BLOCK;
 	tmp->block.nodes = NULL; //NOTE: appended by the parser
@@ -195,7 +315,7 @@ void emitASTNodeBlock(ASTNode** nodeHandle) {
 }
 
 void emitASTNodeCompound(ASTNode** nodeHandle, LiteralType literalType) {
-	ASTNode* tmp = ALLOCATE(ASTNode, 1);
+	ASTNode* tmp = ALLOCATE_AST_NODE();
 
 	tmp->type = AST_NODE_COMPOUND;
 	tmp->compound.literalType = literalType;
@@ -214,7 +334,7 @@ void setASTNodePair(ASTNode* node, ASTNode* left, ASTNode* right) {
 }
 
 void emitASTNodeIndex(ASTNode** nodeHandle, ASTNode* first, ASTNode* second, ASTNode* third) {
-	ASTNode* tmp = ALLOCATE(ASTNode, 1);
+	ASTNode* tmp = ALLOCATE_AST_NODE();
 
 	tmp->type = AST_NODE_INDEX;
 	tmp->index.first = first;
@@ -225,7 +345,7 @@ void emitASTNodeIndex(ASTNode** nodeHandle, ASTNode* first, ASTNode* second, AST
 }
 
 void emitASTNodeVarDecl(ASTNode** nodeHandle, Literal identifier, Literal typeLiteral, ASTNode* expression) {
-	ASTNode* tmp = ALLOCATE(ASTNode, 1);
+	ASTNode* tmp = ALLOCATE_AST_NODE();
 
 	tmp->type = AST_NODE_VAR_DECL;
 	tmp->varDecl.identifier = identifier;
@@ -236,7 +356,7 @@ void emitASTNodeVarDecl(ASTNode** nodeHandle, Literal identifier, Literal typeLi
 }
 
 void emitASTNodeFnCollection(ASTNode** nodeHandle) { //a collection of nodes, intended for use with functions
-	ASTNode* tmp = ALLOCATE(ASTNode, 1);
+	ASTNode* tmp = ALLOCATE_AST_NODE();
 
 	tmp->type = AST_NODE_FN_COLLECTION;
 	tmp->fnCollection.nodes = NULL;
@@ -247,7 +367,7 @@ void emitASTNodeFnCollection(ASTNode** nodeHandle) { //a collection of nodes, in
 }
 
 void emitASTNodeFnDecl(ASTNode** nodeHandle, Literal identifier, ASTNode* arguments, ASTNode* returns, ASTNode* block) {
-	ASTNode* tmp = ALLOCATE(ASTNode, 1);
+	ASTNode* tmp = ALLOCATE_AST_NODE();
 
 	tmp->type = AST_NODE_FN_DECL;
 	tmp->fnDecl.identifier = identifier;
@@ -259,7 +379,7 @@ void emitASTNodeFnDecl(ASTNode** nodeHandle, Literal identifier, ASTNode* argume
 }
 
 void emitASTNodeFnCall(ASTNode** nodeHandle, ASTNode* arguments) {
-	ASTNode* tmp = ALLOCATE(ASTNode, 1);
+	ASTNode* tmp = ALLOCATE_AST_NODE();
 
 	tmp->type = AST_NODE_FN_CALL;
 	tmp->fnCall.arguments = arguments;
@@ -269,7 +389,7 @@ void emitASTNodeFnCall(ASTNode** nodeHandle, ASTNode* arguments) {
 }
 
 void emitASTNodeFnReturn(ASTNode** nodeHandle, ASTNode* returns) {
-	ASTNode* tmp = ALLOCATE(ASTNode, 1);
+	ASTNode* tmp = ALLOCATE_AST_NODE();
 
 	tmp->type = AST_NODE_FN_RETURN;
 	tmp->returns.returns = returns;
@@ -278,7 +398,7 @@ void emitASTNodeFnReturn(ASTNode** nodeHandle, ASTNode* returns) {
 }
 
 void emitASTNodeIf(ASTNode** nodeHandle, ASTNode* condition, ASTNode* thenPath, ASTNode* elsePath) {
-	ASTNode* tmp = ALLOCATE(ASTNode, 1);
+	ASTNode* tmp = ALLOCATE_AST_NODE();
 
 	tmp->type = AST_NODE_IF;
 	tmp->pathIf.condition = condition;
@@ -289,7 +409,7 @@ void emitASTNodeIf(ASTNode** nodeHandle, ASTNode* condition, ASTNode* thenPath,
 }
 
 void emitASTNodeWhile(ASTNode** nodeHandle, ASTNode* condition, ASTNode* thenPath) {
-	ASTNode* tmp = ALLOCATE(ASTNode, 1);
+	ASTNode* tmp = ALLOCATE_AST_NODE();
 
 	tmp->type = AST_NODE_WHILE;
 	tmp->pathWhile.condition = condition;
@@ -299,7 +419,7 @@ void emitASTNodeWhile(ASTNode** nodeHandle, ASTNode* condition, ASTNode* thenPat
 }
 
 void emitASTNodeFor(ASTNode** nodeHandle, ASTNode* preClause, ASTNode* condition, ASTNode* postClause, ASTNode* thenPath) {
-	ASTNode* tmp = ALLOCATE(ASTNode, 1);
+	ASTNode* tmp = ALLOCATE_AST_NODE();
 
 	tmp->type = AST_NODE_FOR;
 	tmp->pathFor.preClause = preClause;
@@ -310,8 +430,20 @@ void emitASTNodeFor(ASTNode** nodeHandle, ASTNode* preClause, ASTNode* condition
 	*nodeHandle = tmp;
 }
 
+void emitASTNodeForIn(ASTNode** nodeHandle, Literal first, Literal second, ASTNode* collection, ASTNode* thenPath) {
+	ASTNode* tmp = ALLOCATE_AST_NODE();
+
+	tmp->type = AST_NODE_FOR_IN;
+	tmp->pathForIn.first = copyLiteral(first);
+	tmp->pathForIn.second = copyLiteral(second);
+	tmp->pathForIn.collection = collection;
+	tmp->pathForIn.thenPath = thenPath;
+
+	*nodeHandle = tmp;
+}
+
 void emitASTNodeBreak(ASTNode** nodeHandle) {
-	ASTNode* tmp = ALLOCATE(ASTNode, 1);
+	ASTNode* tmp = ALLOCATE_AST_NODE();
 
 	tmp->type = AST_NODE_BREAK;
 
@@ -319,7 +451,7 @@ void emitASTNodeBreak(ASTNode** nodeHandle) {
 }
 
 void emitASTNodeContinue(ASTNode** nodeHandle) {
-	ASTNode* tmp = ALLOCATE(ASTNode, 1);
+	ASTNode* tmp = ALLOCATE_AST_NODE();
 
 	tmp->type = AST_NODE_CONTINUE;
 
@@ -327,7 +459,7 @@ void emitASTNodeContinue(ASTNode** nodeHandle) {
 }
 
 void emitASTNodePrefixIncrement(ASTNode** nodeHandle, Literal identifier) {
-	ASTNode* tmp = ALLOCATE(ASTNode, 1);
+	ASTNode* tmp = ALLOCATE_AST_NODE();
 
 	tmp->type = AST_NODE_PREFIX_INCREMENT;
 	tmp->prefixIncrement.identifier = copyLiteral(identifier);
@@ -336,7 +468,7 @@ void emitASTNodePrefixIncrement(ASTNode** nodeHandle, Literal identifier) {
 }
 
 void emitASTNodePrefixDecrement(ASTNode** nodeHandle, Literal identifier) {
-	ASTNode* tmp = ALLOCATE(ASTNode, 1);
+	ASTNode* tmp = ALLOCATE_AST_NODE();
 
 	tmp->type = AST_NODE_PREFIX_DECREMENT;
 	tmp->prefixDecrement.identifier = copyLiteral(identifier);
@@ -345,7 +477,7 @@ void emitASTNodePrefixDecrement(ASTNode** nodeHandle, Literal identifier) {
 }
 
 void emitASTNodePostfixIncrement(ASTNode** nodeHandle, Literal identifier) {
-	ASTNode* tmp = ALLOCATE(ASTNode, 1);
+	ASTNode* tmp = ALLOCATE_AST_NODE();
 
 	tmp->type = AST_NODE_POSTFIX_INCREMENT;
 	tmp->postfixIncrement.identifier = copyLiteral(identifier);
@@ -354,7 +486,7 @@ void emitASTNodePostfixIncrement(ASTNode** nodeHandle, Literal identifier) {
 }
 
 void emitASTNodePostfixDecrement(ASTNode** nodeHandle, Literal identifier) {
-	ASTNode* tmp = ALLOCATE(ASTNode, 1);
+	ASTNode* tmp = ALLOCATE_AST_NODE();
 
 	tmp->type = AST_NODE_POSTFIX_DECREMENT;
 	tmp->postfixDecrement.identifier = copyLiteral(identifier);
@@ -363,7 +495,7 @@ void emitASTNodePostfixDecrement(ASTNode** nodeHandle, Literal identifier) {
 }
 
 void emitASTNodeImport(ASTNode** nodeHandle, Literal identifier, Literal alias) {
-	ASTNode* tmp = ALLOCATE(ASTNode, 1);
+	ASTNode* tmp = ALLOCATE_AST_NODE();
 
 	tmp->type = AST_NODE_IMPORT;
 	tmp->import.identifier = copyLiteral(identifier);
@@ -373,7 +505,7 @@ void emitASTNodeImport(ASTNode** nodeHandle, Literal identifier, Literal alias)
 }
 
 void emitASTNodeExport(ASTNode** nodeHandle, Literal identifier, Literal alias) {
-	ASTNode* tmp = ALLOCATE(ASTNode, 1);
+	ASTNode* tmp = ALLOCATE_AST_NODE();
 
 	tmp->type = AST_NODE_EXPORT;
 	tmp->export.identifier = copyLiteral(identifier);
@@ -381,3 +513,25 @@ void emitASTNodeExport(ASTNode** nodeHandle, Literal identifier, Literal alias)
 
 	*nodeHandle = tmp;
 }
+
+void emitASTNodeField(ASTNode** nodeHandle, Literal name, int slot) {
+	ASTNode* tmp = ALLOCATE_AST_NODE();
+
+	tmp->type = AST_NODE_FIELD;
+	tmp->field.name = copyLiteral(name);
+	tmp->field.slot = slot;
+
+	*nodeHandle = tmp;
+}
+
+void emitASTNodeSwitch(ASTNode** nodeHandle, ASTNode* value) {
+	ASTNode* tmp = ALLOCATE_AST_NODE();
+
+	tmp->type = AST_NODE_SWITCH;
+	tmp->pathSwitch.value = value;
+	tmp->pathSwitch.cases = NULL;
+	tmp->pathSwitch.capacity = 0;
+	tmp->pathSwitch.count = 0;
+
+	*nodeHandle = tmp;
+}
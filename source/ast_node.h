@@ -6,7 +6,7 @@
 #include "token_types.h"
 
 //nodes are the intermediaries between parsers and compilers
-typedef union _node ASTNode;
+typedef struct _node ASTNode;
 
 typedef enum ASTNodeType {
 	AST_NODE_ERROR,
@@ -26,6 +26,7 @@ typedef enum ASTNodeType {
 	AST_NODE_IF, //for control flow
 	AST_NODE_WHILE, //for control flow
 	AST_NODE_FOR, //for control flow
+	AST_NODE_FOR_IN, //for control flow, over the elements of a collection
 	AST_NODE_BREAK, //for control flow
 	AST_NODE_CONTINUE, //for control flow
 	AST_NODE_PREFIX_INCREMENT, //increment a variable
@@ -34,6 +35,8 @@ typedef enum ASTNodeType {
 	AST_NODE_POSTFIX_DECREMENT, //decrement a variable
 	AST_NODE_IMPORT, //import a variable
 	AST_NODE_EXPORT, //export a variable
+	AST_NODE_FIELD, //the right side of a record field access
+	AST_NODE_SWITCH, //for control flow, with a value and a case array
 } ASTNodeType;
 
 //literals
@@ -161,6 +164,7 @@ typedef struct NodeFnReturn {
 void emitASTNodeIf(ASTNode** nodeHandle, ASTNode* condition, ASTNode* thenPath, ASTNode* elsePath);
 void emitASTNodeWhile(ASTNode** nodeHandle, ASTNode* condition, ASTNode* thenPath);
 void emitASTNodeFor(ASTNode** nodeHandle, ASTNode* preClause, ASTNode* condition, ASTNode* postClause, ASTNode* thenPath);
+void emitASTNodeForIn(ASTNode** nodeHandle, Literal first, Literal second, ASTNode* collection, ASTNode* thenPath);
 void emitASTNodeBreak(ASTNode** nodeHandle);
 void emitASTNodeContinue(ASTNode** nodeHandle);
 
@@ -185,6 +189,14 @@ typedef struct NodeFor {
 	ASTNode* thenPath;
 } NodeFor;
 
+typedef struct NodeForIn {
+	ASTNodeType type;
+	Literal first; //the element, or the index/key when there's a second
+	Literal second; //the element, or null
+	ASTNode* collection;
+	ASTNode* thenPath;
+} NodeForIn;
+
 typedef struct NodeBreak {
 	ASTNodeType type;
 } NodeBreak;
@@ -235,32 +247,81 @@ typedef struct NodeExport {
 	Literal alias;
 } NodeExport;
 
-union _node {
+//record field access - the left side of the binary node is the record
+void emitASTNodeField(ASTNode** nodeHandle, Literal name, int slot);
+
+typedef struct NodeField {
+	ASTNodeType type;
+	Literal name;
+	int slot; //where the parser expects the field to be, or -1
+} NodeField;
+
+//switch statement - each case is a pair of a compound holding its constants (empty for the default), and a block
+void emitASTNodeSwitch(ASTNode** nodeHandle, ASTNode* value);
+
+typedef struct NodeSwitch {
 	ASTNodeType type;
-	NodeLiteral atomic;
-	NodeUnary unary;
-	NodeBinary binary;
-	NodeGrouping grouping;
-	NodeBlock block;
-	NodeCompound compound;
-	NodePair pair;
-	NodeIndex index;
-	NodeVarDecl varDecl;
-	NodeFnCollection fnCollection;
-	NodeFnDecl fnDecl;
-	NodeFnCall fnCall;
-	NodeFnReturn returns;
-	NodeIf pathIf; //TODO: rename these to ifStmt?
-	NodeWhile pathWhile;
-	NodeFor pathFor;
-	NodeBreak pathBreak;
-	NodeContinue pathContinue;
-	NodePrefixIncrement prefixIncrement;
-	NodePrefixDecrement prefixDecrement;
-	NodePostfixIncrement postfixIncrement;
-	NodePostfixDecrement postfixDecrement;
-	NodeImport import;
-	NodeExport export;
+	ASTNode* value;
+	ASTNode* cases; //NOTE: appended by the parser
+	int capacity;
+	int count;
+} NodeSwitch;
+
+struct _node {
+	union {
+		ASTNodeType type;
+		NodeLiteral atomic;
+		NodeUnary unary;
+		NodeBinary binary;
+		NodeGrouping grouping;
+		NodeBlock block;
+		NodeCompound compound;
+		NodePair pair;
+		NodeIndex index;
+		NodeVarDecl varDecl;
+		NodeFnCollection fnCollection;
+		NodeFnDecl fnDecl;
+		NodeFnCall fnCall;
+		NodeFnReturn returns;
+		NodeIf pathIf; //TODO: rename these to ifStmt?
+		NodeWhile pathWhile;
+		NodeFor pathFor;
+		NodeForIn pathForIn;
+		NodeBreak pathBreak;
+		NodeContinue pathContinue;
+		NodePrefixIncrement prefixIncrement;
+		NodePrefixDecrement prefixDecrement;
+		NodePostfixIncrement postfixIncrement;
+		NodePostfixDecrement postfixDecrement;
+		NodeImport import;
+		NodeExport export;
+		NodeField field;
+		NodeSwitch pathSwitch;
+	};
+
+	bool arenaOwned; //came from an arena, so freeASTNode() leaves it to the arena's owner
 };
 
-TOY_API void freeASTNode(ASTNode* node);
+TOY_API void freeASTNode(ASTNode* node); //a no-op on arena nodes while no arena is set, since their owner releases them
+
+//DOCS: nodes can be bump-allocated from an arena, and released all at once rather than one by one
+#define AST_ARENA_CHUNK_SIZE (64 * 1024)
+
+typedef struct ASTArena {
+	struct ASTArenaChunk* chunks;
+	unsigned char* bump;
+	unsigned char* bumpEnd;
+	int chunkCount;
+} ASTArena;
+
+TOY_API void initASTArena(ASTArena* arena);
+TOY_API void freeASTArena(ASTArena* arena); //releases the node memory only, not the literals held within
+TOY_API ASTArena* setASTArena(ASTArena* arena); //returns the previous arena, NULL allocates nodes individually
+
+//NOTE: while an arena is set, nodes come from it, and freeing a node only releases its literals
+ASTNode* reallocateASTNodes(ASTNode* nodes, int oldCount, int count);
+
+#define ALLOCATE_AST_NODE() reallocateASTNodes(NULL, 0, 1)
+#define GROW_AST_NODES(nodes, oldCount, count) reallocateASTNodes(nodes, oldCount, count)
+#define FREE_AST_NODE(node) reallocateASTNodes(node, 1, 0)
+#define FREE_AST_NODES(nodes, oldCount) reallocateASTNodes(nodes, oldCount, 0)
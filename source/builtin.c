@@ -2,6 +2,7 @@
 
 #include "memory.h"
 #include "literal.h"
+#include "packed_array.h"
 
 #include <stdio.h>
 
@@ -249,6 +250,33 @@ static Literal modulo(Interpreter* interpreter, Literal lhs, Literal rhs) {
 	return TO_NULL_LITERAL;
 }
 
+//frozen compounds are shared, so writes go to a private copy
+static void ownCompound(Literal* compound) {
+	if (IS_ARRAY(*compound) && AS_ARRAY(*compound)->frozen) {
+		LiteralArray* array = ALLOCATE(LiteralArray, 1);
+		initLiteralArray(array);
+
+		for (int i = 0; i < AS_ARRAY(*compound)->count; i++) {
+			pushLiteralArray(array, AS_ARRAY(*compound)->literals[i]);
+		}
+
+		*compound = TO_ARRAY_LITERAL(array);
+	}
+
+	if (IS_DICTIONARY(*compound) && AS_DICTIONARY(*compound)->frozen) {
+		LiteralDictionary* dictionary = ALLOCATE(LiteralDictionary, 1);
+		initLiteralDictionary(dictionary);
+
+		for (int i = 0; i < AS_DICTIONARY(*compound)->capacity; i++) {
+			if (!IS_NULL(AS_DICTIONARY(*compound)->entries[i].key)) {
+				setLiteralDictionary(dictionary, AS_DICTIONARY(*compound)->entries[i].key, AS_DICTIONARY(*compound)->entries[i].value);
+			}
+		}
+
+		*compound = TO_DICTIONARY_LITERAL(dictionary);
+	}
+}
+
 int _index(Interpreter* interpreter, LiteralArray* arguments) {
 	//_index(compound, first, second, third, assignValue, op)
 	Literal op = popLiteralArray(arguments);
@@ -260,6 +288,10 @@ int _index(Interpreter* interpreter, LiteralArray* arguments) {
 
 	Literal value = TO_NULL_LITERAL;
 
+	if (!IS_NULL(op)) {
+		ownCompound(&compound);
+	}
+
 	//dictionary - no slicing
 	if (IS_DICTIONARY(compound)) {
 		if (IS_IDENTIFIER(first)) {
@@ -934,6 +966,30 @@ int _index(Interpreter* interpreter, LiteralArray* arguments) {
 	return 1;
 }
 
+//arrays typed [int] or [float] are modified in place, rather than copied out and back - constants take the long way, to fail there
+static PackedArray* findPackedVariable(Interpreter* interpreter, Literal idn) {
+	Literal* ref = getScopeVariableWriteRef(interpreter->scope, idn);
+
+	if (ref == NULL || !IS_PACKED_ARRAY(*ref)) {
+		return NULL;
+	}
+
+	Literal type = getScopeType(interpreter->scope, idn);
+	bool constant = AS_TYPE(type).constant;
+	freeLiteral(type);
+
+	return constant ? NULL : AS_PACKED_ARRAY(*ref);
+}
+
+//the long way only knows plain arrays, and the write back packs them again
+static void unpackObject(Literal* obj) {
+	if (IS_PACKED_ARRAY(*obj)) {
+		Literal unpacked = unpackLiteralArray(AS_PACKED_ARRAY(*obj));
+		freeLiteral(*obj);
+		*obj = unpacked;
+	}
+}
+
 int _set(Interpreter* interpreter, LiteralArray* arguments) {
 	//if wrong number of arguments, fail
 	if (arguments->count != 3) {
@@ -951,8 +1007,6 @@ int _set(Interpreter* interpreter, LiteralArray* arguments) {
 		return -1;
 	}
 
-	parseIdentifierToValue(interpreter, &obj);
-
 	bool freeKey = false;
 	if (IS_IDENTIFIER(key)) {
 		parseIdentifierToValue(interpreter, &key);
@@ -965,6 +1019,41 @@ int _set(Interpreter* interpreter, LiteralArray* arguments) {
 		freeVal = true;
 	}
 
+	PackedArray* packed = findPackedVariable(interpreter, idn);
+
+	if (packed != NULL) {
+		if (!IS_INTEGER(key)) {
+			interpreter->errorOutput("Expected integer index in _set\n");
+			return -1;
+		}
+
+		if (packed->count <= AS_INTEGER(key) || AS_INTEGER(key) < 0) {
+			interpreter->errorOutput("Index out of bounds in _set\n");
+			return -1;
+		}
+
+		if (!setPackedArray(packed, AS_INTEGER(key), val)) {
+			interpreter->errorOutput("Incorrect type assigned to array in _set: \"");
+			printLiteralCustom(val, interpreter->errorOutput);
+			interpreter->errorOutput("\"\n");
+			return -1;
+		}
+
+		if (freeKey) {
+			freeLiteral(key);
+		}
+
+		if (freeVal) {
+			freeLiteral(val);
+		}
+
+		return 0;
+	}
+
+	parseIdentifierToValue(interpreter, &obj);
+	ownCompound(&obj);
+	unpackObject(&obj);
+
 	switch(obj.type) {
 		case LITERAL_ARRAY: {
 			Literal typeLiteral = getScopeType(interpreter->scope, key);
@@ -1064,8 +1153,16 @@ int _get(Interpreter* interpreter, LiteralArray* arguments) {
 
 	bool freeObj = false;
 	if (IS_IDENTIFIER(obj)) {
-		parseIdentifierToValue(interpreter, &obj);
-		freeObj = true;
+		//packed arrays are read in place
+		Literal* ref = getScopeVariableRef(interpreter->scope, obj);
+
+		if (ref != NULL && IS_PACKED_ARRAY(*ref)) {
+			obj = *ref;
+		}
+		else {
+			parseIdentifierToValue(interpreter, &obj);
+			freeObj = true;
+		}
 	}
 
 	bool freeKey = false;
@@ -1075,6 +1172,30 @@ int _get(Interpreter* interpreter, LiteralArray* arguments) {
 	}
 
 	switch(obj.type) {
+		case LITERAL_PACKED_ARRAY: {
+			if (!IS_INTEGER(key)) {
+				interpreter->errorOutput("Expected integer index in _get\n");
+				return -1;
+			}
+
+			if (AS_PACKED_ARRAY(obj)->count <= AS_INTEGER(key) || AS_INTEGER(key) < 0) {
+				interpreter->errorOutput("Index out of bounds in _get\n");
+				return -1;
+			}
+
+			pushLiteralArray(&interpreter->stack, getPackedArray(AS_PACKED_ARRAY(obj), AS_INTEGER(key)));
+
+			if (freeObj) {
+				freeLiteral(obj);
+			}
+
+			if (freeKey) {
+				freeLiteral(key);
+			}
+
+			return 1;
+		}
+
 		case LITERAL_ARRAY: {
 			if (!IS_INTEGER(key)) {
 				interpreter->errorOutput("Expected integer index in _get\n");
@@ -1139,14 +1260,33 @@ int _push(Interpreter* interpreter, LiteralArray* arguments) {
 		return -1;
 	}
 
-	parseIdentifierToValue(interpreter, &obj);
-
 	bool freeVal = false;
 	if (IS_IDENTIFIER(val)) {
 		parseIdentifierToValue(interpreter, &val);
 		freeVal = true;
 	}
 
+	PackedArray* packed = findPackedVariable(interpreter, idn);
+
+	if (packed != NULL) {
+		if (!pushPackedArray(packed, val)) {
+			interpreter->errorOutput("Incorrect type assigned to array in _push: \"");
+			printLiteralCustom(val, interpreter->errorOutput);
+			interpreter->errorOutput("\"\n");
+			return -1;
+		}
+
+		if (freeVal) {
+			freeLiteral(val);
+		}
+
+		return 0;
+	}
+
+	parseIdentifierToValue(interpreter, &obj);
+	ownCompound(&obj);
+	unpackObject(&obj);
+
 	switch(obj.type) {
 		case LITERAL_ARRAY: {
 			Literal typeLiteral = getScopeType(interpreter->scope, val);
@@ -1201,7 +1341,16 @@ int _pop(Interpreter* interpreter, LiteralArray* arguments) {
 		return -1;
 	}
 
+	PackedArray* packed = findPackedVariable(interpreter, idn);
+
+	if (packed != NULL) {
+		pushLiteralArray(&interpreter->stack, popPackedArray(packed));
+		return 1;
+	}
+
 	parseIdentifierToValue(interpreter, &obj);
+	ownCompound(&obj);
+	unpackObject(&obj);
 
 	switch(obj.type) {
 		case LITERAL_ARRAY: {
@@ -1240,11 +1389,26 @@ int _length(Interpreter* interpreter, LiteralArray* arguments) {
 
 	bool freeObj = false;
 	if (IS_IDENTIFIER(obj)) {
-		parseIdentifierToValue(interpreter, &obj);
-		freeObj = true;
+		//packed arrays are read in place
+		Literal* ref = getScopeVariableRef(interpreter->scope, obj);
+
+		if (ref != NULL && IS_PACKED_ARRAY(*ref)) {
+			obj = *ref;
+		}
+		else {
+			parseIdentifierToValue(interpreter, &obj);
+			freeObj = true;
+		}
 	}
 
 	switch(obj.type) {
+		case LITERAL_PACKED_ARRAY: {
+			Literal lit = TO_INTEGER_LITERAL( AS_PACKED_ARRAY(obj)->count );
+			pushLiteralArray(&interpreter->stack, lit);
+			freeLiteral(lit);
+			break;
+		}
+
 		case LITERAL_ARRAY: {
 			Literal lit = TO_INTEGER_LITERAL( AS_ARRAY(obj)->count );
 			pushLiteralArray(&interpreter->stack, lit);
@@ -1300,6 +1464,7 @@ int _clear(Interpreter* interpreter, LiteralArray* arguments) {
 	//NOTE: just pass in new compounds
 
 	switch(obj.type) {
+		case LITERAL_PACKED_ARRAY:
 		case LITERAL_ARRAY: {
 			LiteralArray* array = ALLOCATE(LiteralArray, 1);
 			initLiteralArray(array);
@@ -0,0 +1,141 @@
+#include "compile_cache.h"
+#include "memory.h"
+
+#include <string.h>
+
+unsigned long long hashCompileCacheKey(char* source, size_t length) {
+	//FNV-1a, 64-bit
+	unsigned long long hash = 14695981039346656037ULL;
+
+	unsigned char version[3] = { TOY_VERSION_MAJOR, TOY_VERSION_MINOR, TOY_VERSION_PATCH };
+	for (int i = 0; i < 3; i++) {
+		hash ^= version[i];
+		hash *= 1099511628211ULL;
+	}
+
+	for (size_t i = 0; i < length; i++) {
+		hash ^= (unsigned char)source[i];
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+static void unlinkEntry(CompileCache* cache, CompileCacheEntry* entry) {
+	if (entry->prev) {
+		entry->prev->next = entry->next;
+	}
+	else {
+		cache->head = entry->next;
+	}
+
+	if (entry->next) {
+		entry->next->prev = entry->prev;
+	}
+	else {
+		cache->tail = entry->prev;
+	}
+
+	entry->prev = NULL;
+	entry->next = NULL;
+}
+
+static void pushFrontEntry(CompileCache* cache, CompileCacheEntry* entry) {
+	entry->prev = NULL;
+	entry->next = cache->head;
+
+	if (cache->head) {
+		cache->head->prev = entry;
+	}
+	cache->head = entry;
+
+	if (!cache->tail) {
+		cache->tail = entry;
+	}
+}
+
+static void freeEntry(CompileCacheEntry* entry) {
+	FREE_ARRAY(char, entry->source, entry->sourceLength + 1);
+	FREE_ARRAY(unsigned char, entry->bytecode, entry->size);
+	FREE(CompileCacheEntry, entry);
+}
+
+static CompileCacheEntry* findEntry(CompileCache* cache, char* source, size_t length) {
+	unsigned long long hash = hashCompileCacheKey(source, length);
+
+	for (CompileCacheEntry* entry = cache->head; entry != NULL; entry = entry->next) {
+		if (entry->hash == hash && entry->sourceLength == length && memcmp(entry->source, source, length) == 0) {
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+void initCompileCache(CompileCache* cache, int capacity) {
+	cache->head = NULL;
+	cache->tail = NULL;
+	cache->count = 0;
+	cache->capacity = capacity;
+}
+
+void freeCompileCache(CompileCache* cache) {
+	while (cache->head) {
+		CompileCacheEntry* entry = cache->head;
+		unlinkEntry(cache, entry);
+		freeEntry(entry);
+	}
+
+	cache->count = 0;
+}
+
+unsigned char* lookupCompileCache(CompileCache* cache, char* source, size_t* size) {
+	CompileCacheEntry* entry = findEntry(cache, source, strlen(source));
+
+	if (!entry) {
+		return NULL;
+	}
+
+	//mark as recently used
+	unlinkEntry(cache, entry);
+	pushFrontEntry(cache, entry);
+
+	*size = entry->size;
+	return entry->bytecode;
+}
+
+void insertCompileCache(CompileCache* cache, char* source, unsigned char* bytecode, size_t size) {
+	if (cache->capacity <= 0) {
+		return;
+	}
+
+	size_t length = strlen(source);
+
+	//replace an existing entry
+	CompileCacheEntry* entry = findEntry(cache, source, length);
+	if (entry) {
+		unlinkEntry(cache, entry);
+		freeEntry(entry);
+		cache->count--;
+	}
+
+	//evict the least recently used
+	while (cache->count >= cache->capacity) {
+		CompileCacheEntry* last = cache->tail;
+		unlinkEntry(cache, last);
+		freeEntry(last);
+		cache->count--;
+	}
+
+	entry = ALLOCATE(CompileCacheEntry, 1);
+	entry->hash = hashCompileCacheKey(source, length);
+	entry->source = ALLOCATE(char, length + 1);
+	memcpy(entry->source, source, length + 1);
+	entry->sourceLength = length;
+	entry->bytecode = ALLOCATE(unsigned char, size);
+	memcpy(entry->bytecode, bytecode, size);
+	entry->size = size;
+
+	pushFrontEntry(cache, entry);
+	cache->count++;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "toy_common.h"
+
+//compiled bytecode, keyed by the source it came from
+typedef struct CompileCacheEntry {
+	struct CompileCacheEntry* prev; //towards the most recently used
+	struct CompileCacheEntry* next;
+	unsigned long long hash;
+	char* source; //kept to rule out hash collisions
+	size_t sourceLength;
+	unsigned char* bytecode;
+	size_t size;
+} CompileCacheEntry;
+
+typedef struct CompileCache {
+	CompileCacheEntry* head; //most recently used
+	CompileCacheEntry* tail; //evicted first
+	int count;
+	int capacity;
+} CompileCache;
+
+//the key mixes in the compiler version, so stale bytecode never matches
+TOY_API unsigned long long hashCompileCacheKey(char* source, size_t length);
+
+TOY_API void initCompileCache(CompileCache* cache, int capacity);
+TOY_API void freeCompileCache(CompileCache* cache);
+
+//NOTE: the returned bytecode belongs to the cache - run it with runInterpreterBorrowed(), or copy it, and don't hold it across the next insert
+TOY_API unsigned char* lookupCompileCache(CompileCache* cache, char* source, size_t* size);
+TOY_API void insertCompileCache(CompileCache* cache, char* source, unsigned char* bytecode, size_t size); //copies both
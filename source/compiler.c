@@ -9,16 +9,147 @@
 #include "console_colors.h"
 
 #include <stdio.h>
+#include <stdlib.h>
+
+//the hidden variable holding a for-in loop's state
+#define FOR_IN_ITERATOR "@iterator"
+
+//integer cases get a jump table while it has at most this many slots per case, otherwise a binary search
+#define SWITCH_TABLE_DENSITY 2
+
+//the constant index is open addressed, with -1 marking an empty slot
+typedef struct ConstantEntry {
+	unsigned int hash;
+	int index;
+} ConstantEntry;
 
 void initCompiler(Compiler* compiler) {
 	initLiteralArray(&compiler->literalCache);
 	compiler->bytecode = NULL;
 	compiler->capacity = 0;
 	compiler->count = 0;
+	compiler->constants = NULL;
+	compiler->constantCapacity = 0;
+	compiler->constantCount = 0;
+}
+
+//structural, so compounds and types stored as arrays can be deduplicated too
+static unsigned int hashConstant(Literal literal) {
+	unsigned int hash = (2166136261u ^ (unsigned int)literal.type) * 16777619u;
+
+	switch(literal.type) {
+		case LITERAL_ARRAY:
+		case LITERAL_DICTIONARY_INTERMEDIATE:
+		case LITERAL_TYPE_INTERMEDIATE:
+			for (int i = 0; i < AS_ARRAY(literal)->count; i++) {
+				hash = (hash ^ hashConstant(AS_ARRAY(literal)->literals[i])) * 16777619u;
+			}
+			return hash;
+
+		case LITERAL_TYPE:
+			hash = (hash ^ (unsigned int)AS_TYPE(literal).typeOf) * 16777619u;
+			hash = (hash ^ (unsigned int)AS_TYPE(literal).constant) * 16777619u;
+			for (int i = 0; i < AS_TYPE(literal).count; i++) {
+				hash = (hash ^ hashConstant(((Literal*)(AS_TYPE(literal).subtypes))[i])) * 16777619u;
+			}
+			return hash;
+
+		default:
+			return (hash ^ (unsigned int)hashLiteral(literal)) * 16777619u;
+	}
+}
+
+//functions are never equal, so they're never indexed
+static bool isIndexableConstant(Literal literal) {
+	return !(IS_FUNCTION(literal) || IS_FUNCTION_NATIVE(literal) || literal.type == LITERAL_FUNCTION_INTERMEDIATE || IS_OPAQUE(literal));
+}
+
+static void insertConstantEntry(ConstantEntry* entries, int capacity, unsigned int hash, int index) {
+	unsigned int slot = hash & (capacity - 1);
+
+	while (entries[slot].index != -1) {
+		slot = (slot + 1) & (capacity - 1);
+	}
+
+	entries[slot].hash = hash;
+	entries[slot].index = index;
+}
+
+static void growConstantIndex(Compiler* compiler) {
+	int oldCapacity = compiler->constantCapacity;
+	int capacity = oldCapacity == 0 ? 64 : oldCapacity * 2; //power of two
+
+	ConstantEntry* entries = ALLOCATE(ConstantEntry, capacity);
+	for (int i = 0; i < capacity; i++) {
+		entries[i].index = -1;
+	}
+
+	for (int i = 0; i < oldCapacity; i++) {
+		if (compiler->constants[i].index != -1) {
+			insertConstantEntry(entries, capacity, compiler->constants[i].hash, compiler->constants[i].index);
+		}
+	}
+
+	FREE_ARRAY(ConstantEntry, compiler->constants, oldCapacity);
+	compiler->constants = entries;
+	compiler->constantCapacity = capacity;
+}
+
+//returns -1 if not found
+static int findConstant(Compiler* compiler, Literal literal) {
+	if (compiler->constantCount == 0 || !isIndexableConstant(literal)) {
+		return -1;
+	}
+
+	unsigned int hash = hashConstant(literal);
+	unsigned int slot = hash & (compiler->constantCapacity - 1);
+
+	while (compiler->constants[slot].index != -1) {
+		ConstantEntry* entry = &compiler->constants[slot];
+		Literal candidate = compiler->literalCache.literals[entry->index];
+
+		//ints and floats are equal in literalsAreEqual(), but not here
+		if (entry->hash == hash && candidate.type == literal.type && literalsAreEqual(candidate, literal)) {
+			return entry->index;
+		}
+
+		slot = (slot + 1) & (compiler->constantCapacity - 1);
+	}
+
+	return -1;
+}
+
+//push without deduplication, but still index the result
+static int pushConstant(Compiler* compiler, Literal literal) {
+	int index = pushLiteralArray(&compiler->literalCache, literal);
+
+	if (!isIndexableConstant(literal)) {
+		return index;
+	}
+
+	//keep the load below one half
+	if ((compiler->constantCount + 1) * 2 > compiler->constantCapacity) {
+		growConstantIndex(compiler);
+	}
+
+	insertConstantEntry(compiler->constants, compiler->constantCapacity, hashConstant(literal), index);
+	compiler->constantCount++;
+
+	return index;
+}
+
+static int findOrPushConstant(Compiler* compiler, Literal literal) {
+	int index = findConstant(compiler, literal);
+
+	if (index < 0) {
+		index = pushConstant(compiler, literal);
+	}
+
+	return index;
 }
 
 //separated out, so it can be recursive
-static int writeLiteralTypeToCache(LiteralArray* literalCache, Literal literal) {
+static int writeLiteralTypeToCache(Compiler* compiler, Literal literal) {
 	bool shouldFree = false;
 
 	//if it's a compound type, recurse and store the results
@@ -32,7 +163,7 @@ static int writeLiteralTypeToCache(LiteralArray* literalCache, Literal literal)
 
 		for (int i = 0; i < AS_TYPE(literal).count; i++) {
 			//write the values to the cache, and the indexes to the store
-			int subIndex = writeLiteralTypeToCache(literalCache, ((Literal*)(AS_TYPE(literal).subtypes))[i]);
+			int subIndex = writeLiteralTypeToCache(compiler, ((Literal*)(AS_TYPE(literal).subtypes))[i]);
 
 			Literal lit = TO_INTEGER_LITERAL(subIndex);
 			pushLiteralArray(store, lit);
@@ -46,10 +177,7 @@ static int writeLiteralTypeToCache(LiteralArray* literalCache, Literal literal)
 	}
 
 	//optimisation: check if exactly this literal array exists
-	int index = findLiteralIndex(literalCache, literal);
-	if (index < 0) {
-		index = pushLiteralArray(literalCache, literal);
-	}
+	int index = findOrPushConstant(compiler, literal);
 
 	if (shouldFree) {
 		freeLiteral(literal);
@@ -72,10 +200,7 @@ static int writeNodeCompoundToCache(Compiler* compiler, ASTNode* node) {
 			switch(node->compound.nodes[i].pair.left->type) {
 				case AST_NODE_LITERAL: {
 					//keys are literals
-					int key = findLiteralIndex(&compiler->literalCache, node->compound.nodes[i].pair.left->atomic.literal);
-					if (key < 0) {
-						key = pushLiteralArray(&compiler->literalCache, node->compound.nodes[i].pair.left->atomic.literal);
-					}
+					int key = findOrPushConstant(compiler, node->compound.nodes[i].pair.left->atomic.literal);
 
 					Literal literal =  TO_INTEGER_LITERAL(key);
 					pushLiteralArray(store, literal);
@@ -101,10 +226,7 @@ static int writeNodeCompoundToCache(Compiler* compiler, ASTNode* node) {
 			switch(node->compound.nodes[i].pair.right->type) {
 				case AST_NODE_LITERAL: {
 					//values are literals
-					int val = findLiteralIndex(&compiler->literalCache, node->compound.nodes[i].pair.right->atomic.literal);
-					if (val < 0) {
-						val = pushLiteralArray(&compiler->literalCache, node->compound.nodes[i].pair.right->atomic.literal);
-					}
+					int val = findOrPushConstant(compiler, node->compound.nodes[i].pair.right->atomic.literal);
 
 					Literal literal = TO_INTEGER_LITERAL(val);
 					pushLiteralArray(store, literal);
@@ -130,7 +252,7 @@ static int writeNodeCompoundToCache(Compiler* compiler, ASTNode* node) {
 		//push the store to the cache, with instructions about how pack it
 		Literal literal = TO_DICTIONARY_LITERAL(store);
 		literal.type = LITERAL_DICTIONARY_INTERMEDIATE; //god damn it
-		index = pushLiteralArray(&compiler->literalCache, literal);
+		index = findOrPushConstant(compiler, literal);
 		freeLiteral(literal);
 	}
 	else if (node->compound.literalType == LITERAL_ARRAY) {
@@ -139,10 +261,7 @@ static int writeNodeCompoundToCache(Compiler* compiler, ASTNode* node) {
 			switch(node->compound.nodes[i].type) {
 				case AST_NODE_LITERAL: {
 					//values
-					int val = findLiteralIndex(&compiler->literalCache, node->compound.nodes[i].atomic.literal);
-					if (val < 0) {
-						val = pushLiteralArray(&compiler->literalCache, node->compound.nodes[i].atomic.literal);
-					}
+					int val = findOrPushConstant(compiler, node->compound.nodes[i].atomic.literal);
 
 					Literal literal = TO_INTEGER_LITERAL(val);
 					pushLiteralArray(store, literal);
@@ -167,7 +286,7 @@ static int writeNodeCompoundToCache(Compiler* compiler, ASTNode* node) {
 
 		//push the store to the cache, with instructions about how pack it
 		Literal literal = TO_ARRAY_LITERAL(store);
-		index = pushLiteralArray(&compiler->literalCache, literal);
+		index = findOrPushConstant(compiler, literal);
 		freeLiteral(literal);
 	}
 	else {
@@ -186,8 +305,8 @@ static int writeNodeCollectionToCache(Compiler* compiler, ASTNode* node) {
 		switch(node->fnCollection.nodes[i].type) {
 			case AST_NODE_VAR_DECL: {
 				//write each piece of the declaration to the cache
-				int identifierIndex = pushLiteralArray(&compiler->literalCache, node->fnCollection.nodes[i].varDecl.identifier); //store without duplication optimisation
-				int typeIndex = writeLiteralTypeToCache(&compiler->literalCache, node->fnCollection.nodes[i].varDecl.typeLiteral);
+				int identifierIndex = pushConstant(compiler, node->fnCollection.nodes[i].varDecl.identifier); //store without duplication optimisation
+				int typeIndex = writeLiteralTypeToCache(compiler, node->fnCollection.nodes[i].varDecl.typeLiteral);
 
 				Literal identifierLiteral =  TO_INTEGER_LITERAL(identifierIndex);
 				pushLiteralArray(store, identifierLiteral);
@@ -201,7 +320,7 @@ static int writeNodeCollectionToCache(Compiler* compiler, ASTNode* node) {
 
 			case AST_NODE_LITERAL: {
 				//write each piece of the declaration to the cache
-				int typeIndex = writeLiteralTypeToCache(&compiler->literalCache, node->fnCollection.nodes[i].atomic.literal);
+				int typeIndex = writeLiteralTypeToCache(compiler, node->fnCollection.nodes[i].atomic.literal);
 
 				Literal typeLiteral = TO_INTEGER_LITERAL(typeIndex);
 				pushLiteralArray(store, typeLiteral);
@@ -217,53 +336,396 @@ static int writeNodeCollectionToCache(Compiler* compiler, ASTNode* node) {
 
 	//store the store
 	Literal literal = TO_ARRAY_LITERAL(store);
-	int storeIndex = pushLiteralArray(&compiler->literalCache, literal);
+	int storeIndex = pushConstant(compiler, literal);
 	freeLiteral(literal);
 
 	return storeIndex;
 }
 
-static int writeLiteralToCompiler(Compiler* compiler, Literal literal) {
-	//get the index
-	int index = findLiteralIndex(&compiler->literalCache, literal);
+static void growCompilerBytecode(Compiler* compiler, int bytes) {
+	if (compiler->count + bytes > compiler->capacity) {
+		int oldCapacity = compiler->capacity;
 
-	if (index < 0) {
-		if (IS_TYPE(literal)) {
-			//check for the type literal as value
-			index = writeLiteralTypeToCache(&compiler->literalCache, literal);
-		}
-		else {
-			index = pushLiteralArray(&compiler->literalCache, literal);
+		compiler->capacity = GROW_CAPACITY_FAST(oldCapacity);
+		if (compiler->capacity < compiler->count + bytes) {
+			compiler->capacity = compiler->count + bytes;
 		}
+		compiler->bytecode = GROW_ARRAY(unsigned char, compiler->bytecode, oldCapacity, compiler->capacity);
 	}
+}
+
+//indexes and counts are stored as LEB128: 7 bits per byte, low bits first, high bit set while more bytes follow
+static void writeVarintToCompiler(Compiler* compiler, unsigned int value) {
+	growCompilerBytecode(compiler, TOY_VARINT_MAX);
+
+	do {
+		unsigned char byte = value & 0x7F;
+		value >>= 7;
+		if (value) {
+			byte |= 0x80;
+		}
+		compiler->bytecode[compiler->count++] = byte; //1-5 bytes
+	} while (value);
+}
 
+//jump targets are fixed-width, so they can be patched once the destination is known
+static void writeJumpTargetToCompiler(Compiler* compiler, int point, int target) {
+	AS_UINT(compiler->bytecode[point]) = (unsigned int)target; //4 bytes
+}
+
+static void writeLiteralIndexToCompiler(Compiler* compiler, int index) {
 	//push the literal to the bytecode
 	if (index >= 256) {
 		//push a "long" index
 		compiler->bytecode[compiler->count++] = OP_LITERAL_LONG; //1 byte
-		*((unsigned short*)(compiler->bytecode + compiler->count)) = (unsigned short)index; //2 bytes
-
-		compiler->count += sizeof(unsigned short);
+		writeVarintToCompiler(compiler, index);
 	}
 	else {
 		//push the index
+		growCompilerBytecode(compiler, 2);
 		compiler->bytecode[compiler->count++] = OP_LITERAL; //1 byte
 		compiler->bytecode[compiler->count++] = (unsigned char)index; //1 byte
 	}
+}
+
+static int writeLiteralToCompiler(Compiler* compiler, Literal literal) {
+	//get the index
+	int index = findConstant(compiler, literal);
+
+	if (index < 0) {
+		if (IS_TYPE(literal)) {
+			//check for the type literal as value
+			index = writeLiteralTypeToCache(compiler, literal);
+		}
+		else {
+			index = pushConstant(compiler, literal);
+		}
+	}
+
+	writeLiteralIndexToCompiler(compiler, index);
 
 	return index;
 }
 
+//blocks that declare nothing don't need a scope of their own
+static bool nodeDeclaresVariables(ASTNode* node) {
+	if (node == NULL) {
+		return false;
+	}
+
+	switch(node->type) {
+		case AST_NODE_VAR_DECL:
+		case AST_NODE_FN_DECL:
+		case AST_NODE_IMPORT:
+			return true;
+
+		//unbraced bodies declare into the enclosing scope
+		case AST_NODE_IF:
+			return nodeDeclaresVariables(node->pathIf.thenPath) || nodeDeclaresVariables(node->pathIf.elsePath);
+
+		case AST_NODE_WHILE:
+			return nodeDeclaresVariables(node->pathWhile.thenPath);
+
+		default:
+			return false; //blocks and for loops handle their own scopes
+	}
+}
+
+static bool blockDeclaresVariables(ASTNode* node) {
+	for (int i = 0; i < node->block.count; i++) {
+		if (nodeDeclaresVariables(&(node->block.nodes[i]))) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static Opcode writeCompilerWithJumps(Compiler* compiler, ASTNode* node, void* breakAddressesPtr, void* continueAddressesPtr, int jumpOffsets, ASTNode* rootNode);
+
+//record fields
+static bool isFieldAccess(ASTNode* node) {
+	return node->type == AST_NODE_BINARY && node->binary.opcode == OP_FIELD_GET;
+}
+
+static void writeFieldStepToCompiler(Compiler* compiler, ASTNode* field) {
+	writeVarintToCompiler(compiler, findOrPushConstant(compiler, field->field.name));
+	writeVarintToCompiler(compiler, field->field.slot + 1); //-1 for unknown
+}
+
+//the steps from the variable outwards
+static int writeFieldPathToCompiler(Compiler* compiler, ASTNode* node) {
+	if (!isFieldAccess(node)) {
+		return 0;
+	}
+
+	int count = writeFieldPathToCompiler(compiler, node->binary.left);
+	writeFieldStepToCompiler(compiler, node->binary.right);
+	return count + 1;
+}
+
+static int countFieldPath(ASTNode* node, ASTNode** root) {
+	int count = 0;
+
+	while (isFieldAccess(node)) {
+		node = node->binary.left;
+		count++;
+	}
+
+	*root = node;
+	return count;
+}
+
+//var.a.b = value becomes: var, value, OP_FIELD_SET, assignment opcode, count, steps
+static void writeFieldAssignToCompiler(Compiler* compiler, ASTNode* node, void* breakAddressesPtr, void* continueAddressesPtr, int jumpOffsets, ASTNode* rootNode) {
+	ASTNode* root = NULL;
+	int count = countFieldPath(node->binary.left, &root);
+
+	if (root->type != AST_NODE_LITERAL || !IS_IDENTIFIER(root->atomic.literal)) {
+		fprintf(stderr, ERROR "[internal] Bad field assignment target in writeCompilerWithJumps()\n" RESET); //caught by the parser
+		compiler->bytecode[compiler->count++] = OP_EOF; //1 byte
+		return;
+	}
+
+	writeLiteralToCompiler(compiler, root->atomic.literal);
+
+	Opcode override = writeCompilerWithJumps(compiler, node->binary.right, breakAddressesPtr, continueAddressesPtr, jumpOffsets, rootNode);
+	if (override != OP_EOF) {//compensate for indexing & dot notation being screwy
+		compiler->bytecode[compiler->count++] = (unsigned char)override; //1 byte
+	}
+
+	growCompilerBytecode(compiler, 2);
+	compiler->bytecode[compiler->count++] = (unsigned char)OP_FIELD_SET; //1 byte
+	compiler->bytecode[compiler->count++] = (unsigned char)node->binary.opcode; //1 byte
+	writeVarintToCompiler(compiler, count);
+	writeFieldPathToCompiler(compiler, node->binary.left);
+}
+
+//switch statements
+typedef struct SwitchLabel {
+	int value;
+	int body;
+} SwitchLabel;
+
+static int compareSwitchLabels(const void* lhs, const void* rhs) {
+	int l = ((const SwitchLabel*)lhs)->value;
+	int r = ((const SwitchLabel*)rhs)->value;
+	return (l > r) - (l < r);
+}
+
+//leaves space for a jump target, filled in once the body's address is known
+static void reserveSwitchTarget(Compiler* compiler, LiteralArray* patches, int body) {
+	growCompilerBytecode(compiler, sizeof(unsigned int));
+
+	Literal point = TO_INTEGER_LITERAL(compiler->count);
+	Literal target = TO_INTEGER_LITERAL(body);
+	pushLiteralArray(patches, point);
+	pushLiteralArray(patches, target);
+	freeLiteral(point);
+	freeLiteral(target);
+
+	compiler->count += sizeof(unsigned int); //4 bytes
+}
+
+static void writeIntToCompiler(Compiler* compiler, int value) {
+	growCompilerBytecode(compiler, sizeof(int));
+	AS_UINT(compiler->bytecode[compiler->count]) = (unsigned int)value;
+	compiler->count += sizeof(int); //4 bytes
+}
+
+//dense integers index a table, sparse ones are searched, and anything else is hashed
+static void writeSwitchDispatchToCompiler(Compiler* compiler, ASTNode* node, LiteralArray* patches, int defaultBody) {
+	int labelCount = 0;
+	bool integral = true;
+
+	for (int i = 0; i < node->pathSwitch.count; i++) {
+		ASTNode* labels = node->pathSwitch.cases[i].pair.left;
+
+		for (int j = 0; j < labels->compound.count; j++) {
+			integral = integral && IS_INTEGER(labels->compound.nodes[j].atomic.literal);
+			labelCount++;
+		}
+	}
+
+	if (!integral) {
+		//the dictionary maps each constant to its case, so the targets stay in the bytecode
+		LiteralArray* store = ALLOCATE(LiteralArray, 1);
+		initLiteralArray(store);
+
+		for (int i = 0; i < node->pathSwitch.count; i++) {
+			ASTNode* labels = node->pathSwitch.cases[i].pair.left;
+
+			for (int j = 0; j < labels->compound.count; j++) {
+				Literal key = TO_INTEGER_LITERAL(findOrPushConstant(compiler, labels->compound.nodes[j].atomic.literal));
+				Literal val = TO_INTEGER_LITERAL(findOrPushConstant(compiler, TO_INTEGER_LITERAL(i)));
+				pushLiteralArray(store, key);
+				pushLiteralArray(store, val);
+				freeLiteral(key);
+				freeLiteral(val);
+			}
+		}
+
+		Literal literal = TO_DICTIONARY_LITERAL(store);
+		literal.type = LITERAL_DICTIONARY_INTERMEDIATE;
+		int index = findOrPushConstant(compiler, literal);
+		freeLiteral(literal);
+
+		growCompilerBytecode(compiler, 1);
+		compiler->bytecode[compiler->count++] = OP_SWITCH_HASH; //1 byte
+		writeVarintToCompiler(compiler, index);
+		reserveSwitchTarget(compiler, patches, defaultBody);
+		writeVarintToCompiler(compiler, node->pathSwitch.count);
+
+		for (int i = 0; i < node->pathSwitch.count; i++) {
+			reserveSwitchTarget(compiler, patches, i);
+		}
+
+		return;
+	}
+
+	SwitchLabel* sorted = ALLOCATE(SwitchLabel, labelCount);
+	int count = 0;
+
+	for (int i = 0; i < node->pathSwitch.count; i++) {
+		ASTNode* labels = node->pathSwitch.cases[i].pair.left;
+
+		for (int j = 0; j < labels->compound.count; j++) {
+			sorted[count].value = AS_INTEGER(labels->compound.nodes[j].atomic.literal);
+			sorted[count].body = i;
+			count++;
+		}
+	}
+
+	if (labelCount > 0) {
+		qsort(sorted, labelCount, sizeof(SwitchLabel), compareSwitchLabels);
+	}
+
+	long long range = labelCount > 0 ? (long long)sorted[labelCount - 1].value - sorted[0].value + 1 : 0;
+
+	if (labelCount > 0 && range <= (long long)labelCount * SWITCH_TABLE_DENSITY) {
+		growCompilerBytecode(compiler, 1);
+		compiler->bytecode[compiler->count++] = OP_SWITCH_TABLE; //1 byte
+		writeIntToCompiler(compiler, sorted[0].value);
+		writeVarintToCompiler(compiler, (unsigned int)range);
+		reserveSwitchTarget(compiler, patches, defaultBody);
+
+		//the gaps lead to the default
+		for (int slot = 0, next = 0; slot < range; slot++) {
+			if (sorted[next].value == sorted[0].value + slot) {
+				reserveSwitchTarget(compiler, patches, sorted[next++].body);
+			}
+			else {
+				reserveSwitchTarget(compiler, patches, defaultBody);
+			}
+		}
+	}
+	else {
+		growCompilerBytecode(compiler, 1);
+		compiler->bytecode[compiler->count++] = OP_SWITCH_SEARCH; //1 byte
+		writeVarintToCompiler(compiler, labelCount);
+		reserveSwitchTarget(compiler, patches, defaultBody);
+
+		for (int i = 0; i < labelCount; i++) {
+			writeIntToCompiler(compiler, sorted[i].value);
+			reserveSwitchTarget(compiler, patches, sorted[i].body);
+		}
+	}
+
+	FREE_ARRAY(SwitchLabel, sorted, labelCount);
+}
+
+static void writeSwitchToCompiler(Compiler* compiler, ASTNode* node, void* continueAddressesPtr, int jumpOffsets) {
+	//breaks leave the switch, while continues belong to the enclosing loop
+	LiteralArray breakAddresses;
+	LiteralArray patches; //pairs of a reserved jump target, and the body it leads to
+
+	initLiteralArray(&breakAddresses);
+	initLiteralArray(&patches);
+
+	int bodyCount = node->pathSwitch.count;
+	int defaultBody = bodyCount; //the end, unless there's a default
+	bool scoped = false;
+
+	for (int i = 0; i < bodyCount; i++) {
+		if (node->pathSwitch.cases[i].pair.left->compound.count == 0) {
+			defaultBody = i;
+		}
+
+		scoped = scoped || blockDeclaresVariables(node->pathSwitch.cases[i].pair.right);
+	}
+
+	//only one case runs each time, so they can share a scope
+	if (scoped) {
+		growCompilerBytecode(compiler, 1);
+		compiler->bytecode[compiler->count++] = OP_SCOPE_BEGIN; //1 byte
+	}
+
+	Opcode override = writeCompilerWithJumps(compiler, node->pathSwitch.value, &breakAddresses, continueAddressesPtr, jumpOffsets, node->pathSwitch.value);
+	if (override != OP_EOF) {//compensate for indexing & dot notation being screwy
+		growCompilerBytecode(compiler, 1);
+		compiler->bytecode[compiler->count++] = (unsigned char)override; //1 byte
+	}
+
+	writeSwitchDispatchToCompiler(compiler, node, &patches, defaultBody);
+
+	//write the bodies, in order
+	int* starts = ALLOCATE(int, bodyCount + 1);
+
+	for (int i = 0; i < bodyCount; i++) {
+		ASTNode* body = node->pathSwitch.cases[i].pair.right;
+		starts[i] = compiler->count;
+
+		for (int j = 0; j < body->block.count; j++) {
+			override = writeCompilerWithJumps(compiler, &(body->block.nodes[j]), &breakAddresses, continueAddressesPtr, jumpOffsets, &(body->block.nodes[j]));
+			if (override != OP_EOF) {//compensate for indexing & dot notation being screwy
+				growCompilerBytecode(compiler, 1);
+				compiler->bytecode[compiler->count++] = (unsigned char)override; //1 byte
+			}
+		}
+
+		//cases don't fall through
+		if (i < bodyCount - 1) {
+			growCompilerBytecode(compiler, 5);
+			compiler->bytecode[compiler->count++] = OP_JUMP; //1 byte
+
+			Literal literal = TO_INTEGER_LITERAL(compiler->count);
+			pushLiteralArray(&breakAddresses, literal);
+			freeLiteral(literal);
+
+			compiler->count += sizeof(unsigned int); //4 bytes
+		}
+	}
+
+	int end = compiler->count;
+	starts[bodyCount] = end;
+
+	for (int i = 0; i < patches.count; i += 2) {
+		int point = AS_INTEGER(patches.literals[i]);
+		int body = AS_INTEGER(patches.literals[i + 1]);
+		writeJumpTargetToCompiler(compiler, point, starts[body] + jumpOffsets);
+	}
+
+	for (int i = 0; i < breakAddresses.count; i++) {
+		int point = AS_INTEGER(breakAddresses.literals[i]);
+		writeJumpTargetToCompiler(compiler, point, end + jumpOffsets);
+	}
+
+	if (scoped) {
+		growCompilerBytecode(compiler, 1);
+		compiler->bytecode[compiler->count++] = OP_SCOPE_END; //1 byte
+	}
+
+	//cleanup
+	FREE_ARRAY(int, starts, bodyCount + 1);
+	freeLiteralArray(&breakAddresses);
+	freeLiteralArray(&patches);
+}
+
 //NOTE: jumpOfsets are included, because function arg and return indexes are embedded in the code body i.e. need to include their sizes in the jump
 //NOTE: rootNode should NOT include groupings and blocks
 static Opcode writeCompilerWithJumps(Compiler* compiler, ASTNode* node, void* breakAddressesPtr, void* continueAddressesPtr, int jumpOffsets, ASTNode* rootNode) {
 	//grow if the bytecode space is too small
-	if (compiler->count + 32 > compiler->capacity) {
-		int oldCapacity = compiler->capacity;
-
-		compiler->capacity = GROW_CAPACITY_FAST(oldCapacity);
-		compiler->bytecode = GROW_ARRAY(unsigned char, compiler->bytecode, oldCapacity, compiler->capacity);
-	}
+	growCompilerBytecode(compiler, 32);
 
 	//determine node type
 	switch(node->type) {
@@ -292,6 +754,24 @@ static Opcode writeCompilerWithJumps(Compiler* compiler, ASTNode* node, void* br
 
 		//all infixes come here
 		case AST_NODE_BINARY: {
+			//record fields carry their own operands
+			if (node->binary.opcode == OP_FIELD_GET) {
+				Opcode override = writeCompilerWithJumps(compiler, node->binary.left, breakAddressesPtr, continueAddressesPtr, jumpOffsets, rootNode);
+				if (override != OP_EOF) {//compensate for indexing & dot notation being screwy
+					compiler->bytecode[compiler->count++] = (unsigned char)override; //1 byte
+				}
+
+				growCompilerBytecode(compiler, 1);
+				compiler->bytecode[compiler->count++] = (unsigned char)OP_FIELD_GET; //1 byte
+				writeFieldStepToCompiler(compiler, node->binary.right);
+				return OP_EOF;
+			}
+
+			if (node->binary.opcode >= OP_VAR_ASSIGN && node->binary.opcode <= OP_VAR_MODULO_ASSIGN && isFieldAccess(node->binary.left)) {
+				writeFieldAssignToCompiler(compiler, node, breakAddressesPtr, continueAddressesPtr, jumpOffsets, rootNode);
+				return OP_EOF;
+			}
+
 			//pass to the child nodes, then embed the binary command (math, etc.)
 			Opcode override = writeCompilerWithJumps(compiler, node->binary.left, breakAddressesPtr, continueAddressesPtr, jumpOffsets, rootNode);
 
@@ -342,7 +822,11 @@ static Opcode writeCompilerWithJumps(Compiler* compiler, ASTNode* node, void* br
 		break;
 
 		case AST_NODE_BLOCK: {
-			compiler->bytecode[compiler->count++] = (unsigned char)OP_SCOPE_BEGIN; //1 byte
+			bool scoped = blockDeclaresVariables(node);
+
+			if (scoped) {
+				compiler->bytecode[compiler->count++] = (unsigned char)OP_SCOPE_BEGIN; //1 byte
+			}
 
 			for (int i = 0; i < node->block.count; i++) {
 				Opcode override = writeCompilerWithJumps(compiler, &(node->block.nodes[i]), breakAddressesPtr, continueAddressesPtr, jumpOffsets, &(node->block.nodes[i]));
@@ -351,7 +835,9 @@ static Opcode writeCompilerWithJumps(Compiler* compiler, ASTNode* node, void* br
 				}
 			}
 
-			compiler->bytecode[compiler->count++] = (unsigned char)OP_SCOPE_END; //1 byte
+			if (scoped) {
+				compiler->bytecode[compiler->count++] = (unsigned char)OP_SCOPE_END; //1 byte
+			}
 		}
 		break;
 
@@ -359,18 +845,7 @@ static Opcode writeCompilerWithJumps(Compiler* compiler, ASTNode* node, void* br
 			int index = writeNodeCompoundToCache(compiler, node);
 
 			//push the node opcode to the bytecode
-			if (index >= 256) {
-				//push a "long" index
-				compiler->bytecode[compiler->count++] = OP_LITERAL_LONG; //1 byte
-				*((unsigned short*)(compiler->bytecode + compiler->count)) = (unsigned short)index; //2 bytes
-
-				compiler->count += sizeof(unsigned short);
-			}
-			else {
-				//push the index
-				compiler->bytecode[compiler->count++] = OP_LITERAL; //1 byte
-				compiler->bytecode[compiler->count++] = (unsigned char)index; //1 byte
-			}
+			writeLiteralIndexToCompiler(compiler, index);
 		}
 		break;
 
@@ -379,6 +854,15 @@ static Opcode writeCompilerWithJumps(Compiler* compiler, ASTNode* node, void* br
 			compiler->bytecode[compiler->count++] = OP_EOF; //1 byte
 		break;
 
+		case AST_NODE_SWITCH:
+			writeSwitchToCompiler(compiler, node, continueAddressesPtr, jumpOffsets);
+		break;
+
+		case AST_NODE_FIELD:
+			fprintf(stderr, ERROR "[internal] AST_NODE_FIELD encountered in writeCompilerWithJumps()\n" RESET);
+			compiler->bytecode[compiler->count++] = OP_EOF; //1 byte
+		break;
+
 		case AST_NODE_VAR_DECL: {
 			//first, embed the expression (leaves it on the stack)
 			Opcode override = writeCompilerWithJumps(compiler, node->varDecl.expression, breakAddressesPtr, continueAddressesPtr, jumpOffsets, rootNode);
@@ -387,23 +871,17 @@ static Opcode writeCompilerWithJumps(Compiler* compiler, ASTNode* node, void* br
 			}
 
 			//write each piece of the declaration to the bytecode
-			int identifierIndex = findLiteralIndex(&compiler->literalCache, node->varDecl.identifier);
-			if (identifierIndex < 0) {
-				identifierIndex = pushLiteralArray(&compiler->literalCache, node->varDecl.identifier);
-			}
+			int identifierIndex = findOrPushConstant(compiler, node->varDecl.identifier);
 
-			int typeIndex = writeLiteralTypeToCache(&compiler->literalCache, node->varDecl.typeLiteral);
+			int typeIndex = writeLiteralTypeToCache(compiler, node->varDecl.typeLiteral);
 
 			//embed the info into the bytecode
 			if (identifierIndex >= 256 || typeIndex >= 256) {
 				//push a "long" declaration
 				compiler->bytecode[compiler->count++] = OP_VAR_DECL_LONG; //1 byte
 
-				*((unsigned short*)(compiler->bytecode + compiler->count)) = (unsigned short)identifierIndex; //2 bytes
-				compiler->count += sizeof(unsigned short);
-
-				*((unsigned short*)(compiler->bytecode + compiler->count)) = (unsigned short)typeIndex; //2 bytes
-				compiler->count += sizeof(unsigned short);
+				writeVarintToCompiler(compiler, identifierIndex);
+				writeVarintToCompiler(compiler, typeIndex);
 			}
 			else {
 				//push a declaration
@@ -420,7 +898,7 @@ static Opcode writeCompilerWithJumps(Compiler* compiler, ASTNode* node, void* br
 			initCompiler(fnCompiler);
 			writeCompiler(fnCompiler, node->fnDecl.arguments); //can be empty, but not NULL
 			writeCompiler(fnCompiler, node->fnDecl.returns); //can be empty, but not NULL
-			Opcode override = writeCompilerWithJumps(fnCompiler, node->fnDecl.block, NULL, NULL, -4, rootNode); //can be empty, but not NULL
+			Opcode override = writeCompilerWithJumps(fnCompiler, node->fnDecl.block, NULL, NULL, -fnCompiler->count, rootNode); //can be empty, but not NULL; the varint header isn't part of the jump space
 			if (override != OP_EOF) {//compensate for indexing & dot notation being screwy
 				compiler->bytecode[compiler->count++] = (unsigned char)override; //1 byte
 			}
@@ -430,24 +908,18 @@ static Opcode writeCompilerWithJumps(Compiler* compiler, ASTNode* node, void* br
 			fnLiteral.type = LITERAL_FUNCTION_INTERMEDIATE; //NOTE: changing type
 
 			//push the name
-			int identifierIndex = findLiteralIndex(&compiler->literalCache, node->fnDecl.identifier);
-			if (identifierIndex < 0) {
-				identifierIndex = pushLiteralArray(&compiler->literalCache, node->fnDecl.identifier);
-			}
+			int identifierIndex = findOrPushConstant(compiler, node->fnDecl.identifier);
 
 			//push to function (functions are never equal)
-			int fnIndex = pushLiteralArray(&compiler->literalCache, fnLiteral);
+			int fnIndex = pushConstant(compiler, fnLiteral);
 
 			//embed the info into the bytecode
 			if (identifierIndex >= 256 || fnIndex >= 256) {
 				//push a "long" declaration
 				compiler->bytecode[compiler->count++] = OP_FN_DECL_LONG; //1 byte
 
-				*((unsigned short*)(compiler->bytecode + compiler->count)) = (unsigned short)identifierIndex; //2 bytes
-				compiler->count += sizeof(unsigned short);
-
-				*((unsigned short*)(compiler->bytecode + compiler->count)) = (unsigned short)fnIndex; //2 bytes
-				compiler->count += sizeof(unsigned short);
+				writeVarintToCompiler(compiler, identifierIndex);
+				writeVarintToCompiler(compiler, fnIndex);
 			}
 			else {
 				//push a declaration
@@ -462,8 +934,7 @@ static Opcode writeCompilerWithJumps(Compiler* compiler, ASTNode* node, void* br
 			//embed these in the bytecode...
 			int index = writeNodeCollectionToCache(compiler, node);
 
-			AS_USHORT(compiler->bytecode[compiler->count]) = (unsigned short)index; //2 bytes
-			compiler->count += sizeof(unsigned short);
+			writeVarintToCompiler(compiler, index);
 		}
 		break;
 
@@ -481,46 +952,18 @@ static Opcode writeCompilerWithJumps(Compiler* compiler, ASTNode* node, void* br
 				}
 
 				//write each argument to the bytecode
-				int argumentsIndex = findLiteralIndex(&compiler->literalCache, node->fnCall.arguments->fnCollection.nodes[i].atomic.literal);
-				if (argumentsIndex < 0) {
-					argumentsIndex = pushLiteralArray(&compiler->literalCache, node->fnCall.arguments->fnCollection.nodes[i].atomic.literal);
-				}
+				int argumentsIndex = findOrPushConstant(compiler, node->fnCall.arguments->fnCollection.nodes[i].atomic.literal);
 
 				//push the node opcode to the bytecode
-				if (argumentsIndex >= 256) {
-					//push a "long" index
-					compiler->bytecode[compiler->count++] = OP_LITERAL_LONG; //1 byte
-
-					*((unsigned short*)(compiler->bytecode + compiler->count)) = (unsigned short)argumentsIndex; //2 bytes
-					compiler->count += sizeof(unsigned short);
-				}
-				else {
-					//push the index
-					compiler->bytecode[compiler->count++] = OP_LITERAL; //1 byte
-					compiler->bytecode[compiler->count++] = (unsigned char)argumentsIndex; //1 byte
-				}
+				writeLiteralIndexToCompiler(compiler, argumentsIndex);
 			}
 
 			//push the argument COUNT to the top of the stack
 			Literal argumentsCountLiteral =  TO_INTEGER_LITERAL(node->fnCall.argumentCount); //argumentCount is set elsewhere to support dot operator
-			int argumentsCountIndex = findLiteralIndex(&compiler->literalCache, argumentsCountLiteral);
-			if (argumentsCountIndex < 0) {
-				argumentsCountIndex = pushLiteralArray(&compiler->literalCache, argumentsCountLiteral);
-			}
+			int argumentsCountIndex = findOrPushConstant(compiler, argumentsCountLiteral);
 			freeLiteral(argumentsCountLiteral);
 
-			if (argumentsCountIndex >= 256) {
-				//push a "long" index
-				compiler->bytecode[compiler->count++] = OP_LITERAL_LONG; //1 byte
-
-				*((unsigned short*)(compiler->bytecode + compiler->count)) = (unsigned short)argumentsCountIndex; //2 bytes
-				compiler->count += sizeof(unsigned short);
-			}
-			else {
-				//push the index
-				compiler->bytecode[compiler->count++] = OP_LITERAL; //1 byte
-				compiler->bytecode[compiler->count++] = (unsigned char)argumentsCountIndex; //1 byte
-			}
+			writeLiteralIndexToCompiler(compiler, argumentsCountIndex);
 
 			//call the function
 			//DO NOT call the collection, this is done in binary
@@ -537,7 +980,7 @@ static Opcode writeCompilerWithJumps(Compiler* compiler, ASTNode* node, void* br
 			//cache the point to insert the jump distance at
 			compiler->bytecode[compiler->count++] = OP_IF_FALSE_JUMP; //1 byte
 			int jumpToElse = compiler->count;
-			compiler->count += sizeof(unsigned short); //2 bytes
+			compiler->count += sizeof(unsigned int); //4 bytes
 
 			//write the then path
 			override = writeCompilerWithJumps(compiler, node->pathIf.thenPath, breakAddressesPtr, continueAddressesPtr, jumpOffsets, rootNode);
@@ -551,11 +994,11 @@ static Opcode writeCompilerWithJumps(Compiler* compiler, ASTNode* node, void* br
 				//insert jump to end
 				compiler->bytecode[compiler->count++] = OP_JUMP; //1 byte
 				jumpToEnd = compiler->count;
-				compiler->count += sizeof(unsigned short); //2 bytes
+				compiler->count += sizeof(unsigned int); //4 bytes
 			}
 
 			//update the jumpToElse to point here
-			AS_USHORT(compiler->bytecode[jumpToElse]) = compiler->count + jumpOffsets; //2 bytes
+			writeJumpTargetToCompiler(compiler, jumpToElse, compiler->count + jumpOffsets);
 
 			if (node->pathIf.elsePath) {
 				//if there's an else path, write it and 
@@ -565,7 +1008,7 @@ static Opcode writeCompilerWithJumps(Compiler* compiler, ASTNode* node, void* br
 				}
 
 				//update the jumpToEnd to point here
-				AS_USHORT(compiler->bytecode[jumpToEnd]) = compiler->count + jumpOffsets; //2 bytes
+				writeJumpTargetToCompiler(compiler, jumpToEnd, compiler->count + jumpOffsets);
 			}
 		}
 		break;
@@ -579,7 +1022,7 @@ static Opcode writeCompilerWithJumps(Compiler* compiler, ASTNode* node, void* br
 			initLiteralArray(&continueAddresses);
 
 			//cache the jump point
-			unsigned short jumpToStart = compiler->count;
+			int jumpToStart = compiler->count;
 
 			//process the condition
 			Opcode override = writeCompilerWithJumps(compiler, node->pathWhile.condition, &breakAddresses, &continueAddresses, jumpOffsets, rootNode);
@@ -589,8 +1032,8 @@ static Opcode writeCompilerWithJumps(Compiler* compiler, ASTNode* node, void* br
 
 			//if false, jump to end
 			compiler->bytecode[compiler->count++] = OP_IF_FALSE_JUMP; //1 byte
-			unsigned short jumpToEnd = compiler->count;
-			compiler->count += sizeof(unsigned short); //2 bytes
+			int jumpToEnd = compiler->count;
+			compiler->count += sizeof(unsigned int); //4 bytes
 
 			//write the body
 			override = writeCompilerWithJumps(compiler, node->pathWhile.thenPath, &breakAddresses, &continueAddresses, jumpOffsets, rootNode);
@@ -600,21 +1043,21 @@ static Opcode writeCompilerWithJumps(Compiler* compiler, ASTNode* node, void* br
 
 			//jump to condition
 			compiler->bytecode[compiler->count++] = OP_JUMP; //1 byte
-			AS_USHORT(compiler->bytecode[compiler->count]) = jumpToStart + jumpOffsets;
-			compiler->count += sizeof(unsigned short); //2 bytes
+			writeJumpTargetToCompiler(compiler, compiler->count, jumpToStart + jumpOffsets);
+			compiler->count += sizeof(unsigned int); //4 bytes
 
 			//jump from condition
-			AS_USHORT(compiler->bytecode[jumpToEnd]) = (unsigned short)compiler->count + jumpOffsets;
+			writeJumpTargetToCompiler(compiler, jumpToEnd, compiler->count + jumpOffsets);
 
 			//set the breaks and continues
 			for (int i = 0; i < breakAddresses.count; i++) {
 				int point = AS_INTEGER(breakAddresses.literals[i]);
-				AS_USHORT(compiler->bytecode[point]) = (unsigned short)compiler->count + jumpOffsets;
+				writeJumpTargetToCompiler(compiler, point, compiler->count + jumpOffsets);
 			}
 
 			for (int i = 0; i < continueAddresses.count; i++) {
 				int point = AS_INTEGER(continueAddresses.literals[i]);
-				AS_USHORT(compiler->bytecode[point]) = jumpToStart + jumpOffsets;
+				writeJumpTargetToCompiler(compiler, point, jumpToStart + jumpOffsets);
 			}
 
 			//clear the stack after use
@@ -634,7 +1077,12 @@ static Opcode writeCompilerWithJumps(Compiler* compiler, ASTNode* node, void* br
 			initLiteralArray(&breakAddresses);
 			initLiteralArray(&continueAddresses);
 
-			compiler->bytecode[compiler->count++] = OP_SCOPE_BEGIN; //1 byte
+			bool outerScoped = nodeDeclaresVariables(node->pathFor.preClause);
+			bool innerScoped = nodeDeclaresVariables(node->pathFor.thenPath);
+
+			if (outerScoped) {
+				compiler->bytecode[compiler->count++] = OP_SCOPE_BEGIN; //1 byte
+			}
 
 			//initial setup
 			Opcode override = writeCompilerWithJumps(compiler, node->pathFor.preClause, &breakAddresses, &continueAddresses, jumpOffsets, rootNode);
@@ -643,7 +1091,7 @@ static Opcode writeCompilerWithJumps(Compiler* compiler, ASTNode* node, void* br
 			}
 
 			//conditional
-			unsigned short jumpToStart = compiler->count;
+			int jumpToStart = compiler->count;
 			override = writeCompilerWithJumps(compiler, node->pathFor.condition, &breakAddresses, &continueAddresses, jumpOffsets, rootNode);
 			if (override != OP_EOF) {//compensate for indexing & dot notation being screwy
 				compiler->bytecode[compiler->count++] = (unsigned char)override; //1 byte
@@ -651,16 +1099,20 @@ static Opcode writeCompilerWithJumps(Compiler* compiler, ASTNode* node, void* br
 
 			//if false jump to end
 			compiler->bytecode[compiler->count++] = OP_IF_FALSE_JUMP; //1 byte
-			unsigned short jumpToEnd = compiler->count;
-			compiler->count += sizeof(unsigned short); //2 bytes
+			int jumpToEnd = compiler->count;
+			compiler->count += sizeof(unsigned int); //4 bytes
 
 			//write the body
-			compiler->bytecode[compiler->count++] = OP_SCOPE_BEGIN; //1 byte
+			if (innerScoped) {
+				compiler->bytecode[compiler->count++] = OP_SCOPE_BEGIN; //1 byte
+			}
 			override = writeCompilerWithJumps(compiler, node->pathFor.thenPath, &breakAddresses, &continueAddresses, jumpOffsets, rootNode);
 			if (override != OP_EOF) {//compensate for indexing & dot notation being screwy
 				compiler->bytecode[compiler->count++] = (unsigned char)override; //1 byte
 			}
-			compiler->bytecode[compiler->count++] = OP_SCOPE_END; //1 byte
+			if (innerScoped) {
+				compiler->bytecode[compiler->count++] = OP_SCOPE_END; //1 byte
+			}
 
 			//for-breaks actually jump to the bottom
 			int jumpToIncrement = compiler->count;
@@ -672,22 +1124,112 @@ static Opcode writeCompilerWithJumps(Compiler* compiler, ASTNode* node, void* br
 			}
 
 			compiler->bytecode[compiler->count++] = OP_JUMP; //1 byte
-			AS_USHORT(compiler->bytecode[compiler->count]) = jumpToStart + jumpOffsets;
-			compiler->count += sizeof(unsigned short); //2 bytes
+			writeJumpTargetToCompiler(compiler, compiler->count, jumpToStart + jumpOffsets);
+			compiler->count += sizeof(unsigned int); //4 bytes
+
+			writeJumpTargetToCompiler(compiler, jumpToEnd, compiler->count + jumpOffsets);
 
-			AS_USHORT(compiler->bytecode[jumpToEnd]) = compiler->count + jumpOffsets;
+			if (outerScoped) {
+				compiler->bytecode[compiler->count++] = OP_SCOPE_END; //1 byte
+			}
+
+			//set the breaks and continues
+			for (int i = 0; i < breakAddresses.count; i++) {
+				int point = AS_INTEGER(breakAddresses.literals[i]);
+				writeJumpTargetToCompiler(compiler, point, compiler->count + jumpOffsets);
+			}
+
+			for (int i = 0; i < continueAddresses.count; i++) {
+				int point = AS_INTEGER(continueAddresses.literals[i]);
+				writeJumpTargetToCompiler(compiler, point, jumpToIncrement + jumpOffsets);
+			}
 
+			//clear the stack after use
+			compiler->bytecode[compiler->count++] = OP_POP_STACK; //1 byte
+
+			//cleanup
+			freeLiteralArray(&breakAddresses);
+			freeLiteralArray(&continueAddresses);
+		}
+		break;
+
+		case AST_NODE_FOR_IN: {
+			//for breaks and continues
+			LiteralArray breakAddresses;
+			LiteralArray continueAddresses;
+
+			initLiteralArray(&breakAddresses);
+			initLiteralArray(&continueAddresses);
+
+			//the iterator and the loop variables live in a scope of their own
+			compiler->bytecode[compiler->count++] = OP_SCOPE_BEGIN; //1 byte
+
+			Opcode override = writeCompilerWithJumps(compiler, node->pathForIn.collection, &breakAddresses, &continueAddresses, jumpOffsets, rootNode);
+			if (override != OP_EOF) {//compensate for indexing & dot notation being screwy
+				growCompilerBytecode(compiler, 1);
+				compiler->bytecode[compiler->count++] = (unsigned char)override; //1 byte
+			}
+
+			//the iterator's name can't be written in a script, so it never clashes
+			Literal iterator = TO_IDENTIFIER_LITERAL(createRefString(FOR_IN_ITERATOR));
+			int iteratorIndex = findOrPushConstant(compiler, iterator);
+			freeLiteral(iterator);
+
+			growCompilerBytecode(compiler, 1);
+			compiler->bytecode[compiler->count++] = OP_ITER_BEGIN; //1 byte
+			writeVarintToCompiler(compiler, iteratorIndex);
+			writeVarintToCompiler(compiler, findOrPushConstant(compiler, node->pathForIn.first));
+			writeVarintToCompiler(compiler, findOrPushConstant(compiler, node->pathForIn.second)); //null for a single variable
+
+			//bind the next element, or leave
+			int jumpToStart = compiler->count;
+			growCompilerBytecode(compiler, 1);
+			compiler->bytecode[compiler->count++] = OP_ITER_NEXT; //1 byte
+			writeVarintToCompiler(compiler, iteratorIndex);
+
+			growCompilerBytecode(compiler, 5);
+			compiler->bytecode[compiler->count++] = OP_IF_FALSE_JUMP; //1 byte
+			int jumpToEnd = compiler->count;
+			compiler->count += sizeof(unsigned int); //4 bytes
+
+			//write the body
+			bool innerScoped = nodeDeclaresVariables(node->pathForIn.thenPath);
+			if (innerScoped) {
+				growCompilerBytecode(compiler, 1);
+				compiler->bytecode[compiler->count++] = OP_SCOPE_BEGIN; //1 byte
+			}
+			override = writeCompilerWithJumps(compiler, node->pathForIn.thenPath, &breakAddresses, &continueAddresses, jumpOffsets, rootNode);
+			growCompilerBytecode(compiler, 8);
+			if (override != OP_EOF) {//compensate for indexing & dot notation being screwy
+				compiler->bytecode[compiler->count++] = (unsigned char)override; //1 byte
+			}
+			if (innerScoped) {
+				compiler->bytecode[compiler->count++] = OP_SCOPE_END; //1 byte
+			}
+
+			compiler->bytecode[compiler->count++] = OP_JUMP; //1 byte
+			writeJumpTargetToCompiler(compiler, compiler->count, jumpToStart + jumpOffsets);
+			compiler->count += sizeof(unsigned int); //4 bytes
+
+			//breaks land here too, possibly from inside the body's scopes
+			int end = compiler->count;
+			writeJumpTargetToCompiler(compiler, jumpToEnd, end + jumpOffsets);
+
+			compiler->bytecode[compiler->count++] = OP_ITER_END; //1 byte
+			writeVarintToCompiler(compiler, iteratorIndex);
+
+			growCompilerBytecode(compiler, 2);
 			compiler->bytecode[compiler->count++] = OP_SCOPE_END; //1 byte
 
 			//set the breaks and continues
 			for (int i = 0; i < breakAddresses.count; i++) {
 				int point = AS_INTEGER(breakAddresses.literals[i]);
-				AS_USHORT(compiler->bytecode[point]) = compiler->count + jumpOffsets;
+				writeJumpTargetToCompiler(compiler, point, end + jumpOffsets);
 			}
 
 			for (int i = 0; i < continueAddresses.count; i++) {
 				int point = AS_INTEGER(continueAddresses.literals[i]);
-				AS_USHORT(compiler->bytecode[point]) = jumpToIncrement + jumpOffsets;
+				writeJumpTargetToCompiler(compiler, point, jumpToStart + jumpOffsets);
 			}
 
 			//clear the stack after use
@@ -713,7 +1255,7 @@ static Opcode writeCompilerWithJumps(Compiler* compiler, ASTNode* node, void* br
 			pushLiteralArray((LiteralArray*)breakAddressesPtr, literal);
 			freeLiteral(literal);
 
-			compiler->count += sizeof(unsigned short); //2 bytes
+			compiler->count += sizeof(unsigned int); //4 bytes
 		}
 		break;
 
@@ -731,7 +1273,7 @@ static Opcode writeCompilerWithJumps(Compiler* compiler, ASTNode* node, void* br
 			pushLiteralArray((LiteralArray*)continueAddressesPtr, literal);
 			freeLiteral(literal);
 
-			compiler->count += sizeof(unsigned short); //2 bytes
+			compiler->count += sizeof(unsigned int); //4 bytes
 		}
 		break;
 
@@ -747,8 +1289,7 @@ static Opcode writeCompilerWithJumps(Compiler* compiler, ASTNode* node, void* br
 			//push the return, with the number of literals
 			compiler->bytecode[compiler->count++] = OP_FN_RETURN; //1 byte
 
-			*((unsigned short*)(compiler->bytecode + compiler->count)) = (unsigned short)(node->returns.returns->fnCollection.count); //2 bytes
-			compiler->count += sizeof(unsigned short);
+			writeVarintToCompiler(compiler, node->returns.returns->fnCollection.count);
 		}
 		break;
 
@@ -912,6 +1453,10 @@ void writeCompiler(Compiler* compiler, ASTNode* node) {
 
 void freeCompiler(Compiler* compiler) {
 	freeLiteralArray(&compiler->literalCache);
+	FREE_ARRAY(ConstantEntry, compiler->constants, compiler->constantCapacity);
+	compiler->constants = NULL;
+	compiler->constantCapacity = 0;
+	compiler->constantCount = 0;
 	FREE_ARRAY(unsigned char, compiler->bytecode, compiler->capacity);
 	compiler->bytecode = NULL;
 	compiler->capacity = 0;
@@ -930,12 +1475,15 @@ static void emitByte(unsigned char** collationPtr, int* capacityPtr, int* countP
 	(*collationPtr)[(*countPtr)++] = byte;
 }
 
-static void emitShort(unsigned char** collationPtr, int* capacityPtr, int* countPtr, unsigned short bytes) {
-	char* ptr = (char*)&bytes;
-
-	emitByte(collationPtr, capacityPtr, countPtr, *ptr);
-	ptr++;
-	emitByte(collationPtr, capacityPtr, countPtr, *ptr);
+static void emitVarint(unsigned char** collationPtr, int* capacityPtr, int* countPtr, unsigned int value) {
+	do {
+		unsigned char byte = value & 0x7F;
+		value >>= 7;
+		if (value) {
+			byte |= 0x80;
+		}
+		emitByte(collationPtr, capacityPtr, countPtr, byte);
+	} while (value);
 }
 
 static void emitInt(unsigned char** collationPtr, int* capacityPtr, int* countPtr, int bytes) {
@@ -973,6 +1521,8 @@ static unsigned char* collateCompilerHeaderOpt(Compiler* compiler, int* size, bo
 	int fnCapacity = GROW_CAPACITY(0);
 	int fnCount = 0;
 	unsigned char* fnCollation = ALLOCATE(unsigned char, fnCapacity);
+	int fnOffsetCapacity = 0;
+	int* fnOffsets = NULL; //where each fn starts within the fn collation
 
 	if (embedHeader) {
 		//embed the header with version information
@@ -980,22 +1530,14 @@ static unsigned char* collateCompilerHeaderOpt(Compiler* compiler, int* size, bo
 		emitByte(&collation, &capacity, &count, TOY_VERSION_MINOR);
 		emitByte(&collation, &capacity, &count, TOY_VERSION_PATCH);
 
-		//embed the build info
-		if ((int)strlen(TOY_VERSION_BUILD) + count + 1 > capacity) {
-			int oldCapacity = capacity;
-			capacity = strlen(TOY_VERSION_BUILD) + count + 1; //full header size
-			collation = GROW_ARRAY(unsigned char, collation, oldCapacity, capacity);
-		}
-
-		memcpy(&collation[count], TOY_VERSION_BUILD, strlen(TOY_VERSION_BUILD));
-		count += strlen(TOY_VERSION_BUILD);
-		collation[count++] = '\0'; //terminate the build string
+		//NOTE: the build info is left empty, so the same source always compiles to the same bytes
+		emitByte(&collation, &capacity, &count, '\0'); //terminate the build string
 
 		emitByte(&collation, &capacity, &count, OP_SECTION_END); //terminate header
 	}
 
-	//embed the data section (first short is the number of literals)
-	emitShort(&collation, &capacity, &count, compiler->literalCache.count);
+	//embed the data section (first varint is the number of literals)
+	emitVarint(&collation, &capacity, &count, compiler->literalCache.count);
 
 	//emit each literal by type
 	for (int i = 0; i < compiler->literalCache.count; i++) {
@@ -1042,12 +1584,12 @@ static unsigned char* collateCompilerHeaderOpt(Compiler* compiler, int* size, bo
 
 				LiteralArray* ptr = AS_ARRAY(compiler->literalCache.literals[i]);
 
-				//length of the array, as a short
-				emitShort(&collation, &capacity, &count, ptr->count);
+				//length of the array, as a varint
+				emitVarint(&collation, &capacity, &count, ptr->count);
 
 				//each element of the array
 				for (int i = 0; i < ptr->count; i++) {
-					emitShort(&collation, &capacity, &count, (unsigned short)AS_INTEGER(ptr->literals[i])); //shorts representing the indexes of the values
+					emitVarint(&collation, &capacity, &count, AS_INTEGER(ptr->literals[i])); //varints representing the indexes of the values
 				}
 			}
 			break;
@@ -1057,12 +1599,12 @@ static unsigned char* collateCompilerHeaderOpt(Compiler* compiler, int* size, bo
 
 				LiteralArray* ptr = AS_ARRAY(compiler->literalCache.literals[i]); //used an array for storage above
 
-				//length of the array, as a short
-				emitShort(&collation, &capacity, &count, ptr->count); //count is the array size, NOT the dictionary size
+				//length of the array, as a varint
+				emitVarint(&collation, &capacity, &count, ptr->count); //count is the array size, NOT the dictionary size
 
 				//each element of the array
 				for (int i = 0; i < ptr->count; i++) {
-					emitShort(&collation, &capacity, &count, (unsigned short)AS_INTEGER(ptr->literals[i])); //shorts representing the indexes of the values
+					emitVarint(&collation, &capacity, &count, AS_INTEGER(ptr->literals[i])); //varints representing the indexes of the values
 				}
 			}
 			break;
@@ -1076,8 +1618,13 @@ static unsigned char* collateCompilerHeaderOpt(Compiler* compiler, int* size, bo
 				int size = 0;
 				unsigned char* bytes = collateCompilerHeaderOpt((Compiler*)fnCompiler, &size, false);
 
-				//emit how long this section is, +1 for ending mark
-				emitShort(&fnCollation, &fnCapacity, &fnCount, (unsigned short)size + 1);
+				//record where this function starts, for the offset table
+				if (fnIndex + 1 > fnOffsetCapacity) {
+					int oldCapacity = fnOffsetCapacity;
+					fnOffsetCapacity = GROW_CAPACITY(oldCapacity);
+					fnOffsets = GROW_ARRAY(int, fnOffsets, oldCapacity, fnOffsetCapacity);
+				}
+				fnOffsets[fnIndex] = fnCount;
 
 				//write the fn to the fn collation
 				for (int i = 0; i < size; i++) {
@@ -1088,10 +1635,10 @@ static unsigned char* collateCompilerHeaderOpt(Compiler* compiler, int* size, bo
 
 				//embed the reference to the function implementation into the current collation (to be extracted later)
 				emitByte(&collation, &capacity, &count, LITERAL_FUNCTION);
-				emitShort(&collation, &capacity, &count, (unsigned short)(fnIndex++));
+				emitVarint(&collation, &capacity, &count, fnIndex++);
 
 				freeCompiler((Compiler*)fnCompiler);
-				FREE(compiler, fnCompiler);
+				FREE(Compiler, fnCompiler);
 				FREE_ARRAY(unsigned char, bytes, size);
 			}
 			break;
@@ -1137,7 +1684,7 @@ static unsigned char* collateCompilerHeaderOpt(Compiler* compiler, int* size, bo
 				if (AS_TYPE(typeLiteral).typeOf == LITERAL_ARRAY || AS_TYPE(typeLiteral).typeOf == LITERAL_DICTIONARY) {
 					//the type will represent how many to expect in the array
 					for (int i = 1; i < ptr->count; i++) {
-						emitShort(&collation, &capacity, &count, (unsigned short)AS_INTEGER(ptr->literals[i])); //shorts representing the indexes of the types
+						emitVarint(&collation, &capacity, &count, AS_INTEGER(ptr->literals[i])); //varints representing the indexes of the types
 					}
 				}
 
@@ -1153,9 +1700,13 @@ static unsigned char* collateCompilerHeaderOpt(Compiler* compiler, int* size, bo
 
 	emitByte(&collation, &capacity, &count, OP_SECTION_END); //terminate data
 
-	//embed the function section (beginning with function count, size)
-	emitShort(&collation, &capacity, &count, fnIndex);
-	emitShort(&collation, &capacity, &count, fnCount);
+	//embed the function section (beginning with function count, then a fixed-width offset table so bodies can be found without decoding the others)
+	emitVarint(&collation, &capacity, &count, fnIndex);
+
+	for (int i = 0; i < fnIndex; i++) {
+		emitInt(&collation, &capacity, &count, fnOffsets[i]);
+	}
+	emitInt(&collation, &capacity, &count, fnCount); //the end of the last function
 
 	for (int i = 0; i < fnCount; i++) {
 		emitByte(&collation, &capacity, &count, fnCollation[i]);
@@ -1164,6 +1715,7 @@ static unsigned char* collateCompilerHeaderOpt(Compiler* compiler, int* size, bo
 	emitByte(&collation, &capacity, &count, OP_SECTION_END); //terminate function section
 
 	FREE_ARRAY(unsigned char, fnCollation, fnCapacity); //clear the function stuff
+	FREE_ARRAY(int, fnOffsets, fnOffsetCapacity);
 
 	//code section
 	for (int i = 0; i < compiler->count; i++) {
@@ -11,6 +11,11 @@ typedef struct Compiler {
 	unsigned char* bytecode;
 	int capacity;
 	int count;
+
+	//hash index into the literal cache, for deduplicating constants
+	struct ConstantEntry* constants;
+	int constantCapacity;
+	int constantCount;
 } Compiler;
 
 TOY_API void initCompiler(Compiler* compiler);
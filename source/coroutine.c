@@ -0,0 +1,306 @@
+#include "coroutine.h"
+
+#include "fiber.h"
+#include "memory.h"
+
+//utils
+static void runCoroutine(void* userdata) {
+	Coroutine* coroutine = (Coroutine*)userdata;
+
+	LiteralArray returns;
+	initLiteralArray(&returns);
+
+	if (!callLiteralFn(&coroutine->parent, coroutine->func, &coroutine->arguments, &returns)) {
+		coroutine->parent.panic = true;
+	}
+
+	//the return value is handed out by the last resume
+	if (returns.count > 0) {
+		freeLiteral(coroutine->yielded);
+		coroutine->yielded = popLiteralArray(&returns);
+	}
+
+	freeLiteralArray(&returns);
+}
+
+//release everything the call was holding
+static void finishCoroutine(Coroutine* coroutine) {
+	if (coroutine->fiber != NULL) {
+		freeFiber(coroutine->fiber);
+		coroutine->fiber = NULL;
+	}
+
+	freeLiteral(coroutine->func);
+	coroutine->func = TO_NULL_LITERAL;
+	freeLiteralArray(&coroutine->arguments);
+
+	coroutine->finished = true;
+}
+
+//a suspended call is run to its end through the panic path, so its scopes and values are released as usual
+static void unwindCoroutine(Coroutine* coroutine) {
+	if (coroutine->finished) {
+		return;
+	}
+
+	if (coroutine->fiber != NULL) {
+		coroutine->cancelled = true;
+		resumeFiber(coroutine->fiber);
+	}
+
+	freeLiteral(coroutine->yielded);
+	coroutine->yielded = TO_NULL_LITERAL;
+
+	finishCoroutine(coroutine);
+}
+
+//exposed functions
+Literal createCoroutine(Interpreter* interpreter, Literal func, LiteralArray* arguments) {
+	if (!IS_FUNCTION(func)) {
+		interpreter->errorOutput("Function required in createCoroutine()\n");
+		return TO_NULL_LITERAL;
+	}
+
+	Coroutine* coroutine = ALLOCATE(Coroutine, 1);
+
+	//only the shared parts of the interpreter are used - scopes come from the function itself
+	coroutine->parent = *interpreter;
+	coroutine->parent.bytecode = NULL;
+	coroutine->parent.length = 0;
+	coroutine->parent.count = 0;
+	coroutine->parent.codeStart = -1;
+	initLiteralArray(&coroutine->parent.literalCache);
+	coroutine->parent.scope = NULL;
+	initLiteralArray(&coroutine->parent.stack);
+	coroutine->parent.panic = false;
+	coroutine->parent.coroutine = coroutine;
+
+	coroutine->func = copyLiteral(func);
+	initLiteralArray(&coroutine->arguments);
+	for (int i = arguments->count - 1; i >= 0; i--) {
+		pushLiteralArray(&coroutine->arguments, arguments->literals[i]);
+	}
+
+	coroutine->yielded = TO_NULL_LITERAL;
+	coroutine->fiber = NULL; //created on the first resume
+	coroutine->refCount = 1;
+	coroutine->running = false;
+	coroutine->cancelled = false;
+	coroutine->finished = false;
+
+	return TO_COROUTINE_LITERAL(coroutine);
+}
+
+bool resumeCoroutine(Interpreter* interpreter, Literal literal, Literal* result) {
+	*result = TO_NULL_LITERAL;
+
+	if (!IS_COROUTINE(literal)) {
+		interpreter->errorOutput("Coroutine required in resumeCoroutine()\n");
+		return false;
+	}
+
+	Coroutine* coroutine = AS_COROUTINE(literal);
+
+	//finished coroutines keep producing null
+	if (coroutine->finished) {
+		return true;
+	}
+
+	if (coroutine->running) {
+		interpreter->errorOutput("Can't resume a coroutine that is already running\n");
+		return false;
+	}
+
+	if (coroutine->fiber == NULL) {
+		coroutine->fiber = createFiber(runCoroutine, coroutine, FIBER_STACK_SIZE);
+	}
+
+	coroutine->running = true;
+	bool alive = resumeFiber(coroutine->fiber);
+	coroutine->running = false;
+
+	*result = coroutine->yielded;
+	coroutine->yielded = TO_NULL_LITERAL;
+
+	if (!alive) {
+		finishCoroutine(coroutine);
+	}
+
+	//errors in the body are errors in the caller
+	if (coroutine->parent.panic) {
+		coroutine->parent.panic = false;
+		interpreter->panic = true;
+		return false;
+	}
+
+	return true;
+}
+
+bool isCoroutineFinished(Literal literal) {
+	return IS_COROUTINE(literal) && AS_COROUTINE(literal)->finished;
+}
+
+bool yieldCoroutine(Interpreter* interpreter, Literal value) {
+	Coroutine* coroutine = interpreter->coroutine;
+
+	if (coroutine->cancelled) {
+		freeLiteral(value);
+		return false;
+	}
+
+	freeLiteral(coroutine->yielded);
+	coroutine->yielded = value;
+
+	yieldFiber(coroutine->fiber);
+
+	return !coroutine->cancelled;
+}
+
+void retainCoroutine(Coroutine* coroutine) {
+	coroutine->refCount++;
+}
+
+void releaseCoroutine(Coroutine* coroutine) {
+	if (--coroutine->refCount > 0) {
+		return;
+	}
+
+	//hold it while unwinding, in case the body lets go of its own copies
+	coroutine->refCount = 1;
+	unwindCoroutine(coroutine);
+
+	freeLiteral(coroutine->yielded);
+	FREE(Coroutine, coroutine);
+}
+
+void detachCoroutineScope(Coroutine* coroutine, Scope* scope) {
+	if (coroutine->finished || coroutine->running || !IS_FUNCTION(coroutine->func)) {
+		return;
+	}
+
+	for (Scope* ptr = AS_FUNCTION(coroutine->func).scope; ptr != NULL; ptr = ptr->ancestor) {
+		if (ptr == scope) {
+			//the scope is going away, and the coroutine would keep it alive forever
+			coroutine->refCount++;
+			unwindCoroutine(coroutine);
+			coroutine->refCount--;
+			return;
+		}
+	}
+}
+
+//the natives
+int _coroutine(Interpreter* interpreter, LiteralArray* arguments) {
+	if (arguments->count < 1) {
+		interpreter->errorOutput("Incorrect number of arguments to _coroutine\n");
+		return -1;
+	}
+
+	//resolve everything first
+	LiteralArray values;
+	initLiteralArray(&values);
+
+	for (int i = 0; i < arguments->count; i++) {
+		Literal value = arguments->literals[i];
+
+		if (IS_IDENTIFIER(value)) {
+			parseIdentifierToValue(interpreter, &value);
+			pushLiteralArray(&values, value);
+			freeLiteral(value);
+		}
+		else {
+			pushLiteralArray(&values, value);
+		}
+	}
+
+	Literal func = values.literals[0];
+
+	if (!IS_FUNCTION(func)) {
+		interpreter->errorOutput("Incorrect argument type passed to _coroutine (expected a function)\n");
+		freeLiteralArray(&values);
+		return -1;
+	}
+
+	//everything after the function is passed to it
+	LiteralArray rest;
+	rest.literals = values.literals + 1;
+	rest.count = values.count - 1;
+	rest.capacity = values.capacity - 1;
+
+	Literal coroutine = createCoroutine(interpreter, func, &rest);
+	pushLiteralArray(&interpreter->stack, coroutine);
+	freeLiteral(coroutine);
+
+	freeLiteralArray(&values);
+
+	return 1;
+}
+
+int _resume(Interpreter* interpreter, LiteralArray* arguments) {
+	if (arguments->count != 1) {
+		interpreter->errorOutput("Incorrect number of arguments to _resume\n");
+		return -1;
+	}
+
+	Literal obj = arguments->literals[0];
+
+	bool freeObj = false;
+	if (IS_IDENTIFIER(obj)) {
+		parseIdentifierToValue(interpreter, &obj);
+		freeObj = true;
+	}
+
+	if (!IS_COROUTINE(obj)) {
+		interpreter->errorOutput("Incorrect argument type passed to _resume (expected a coroutine)\n");
+
+		if (freeObj) {
+			freeLiteral(obj);
+		}
+		return -1;
+	}
+
+	Literal result = TO_NULL_LITERAL;
+	bool ok = resumeCoroutine(interpreter, obj, &result);
+
+	pushLiteralArray(&interpreter->stack, result);
+	freeLiteral(result);
+
+	if (freeObj) {
+		freeLiteral(obj);
+	}
+
+	return ok ? 1 : -1;
+}
+
+int _done(Interpreter* interpreter, LiteralArray* arguments) {
+	if (arguments->count != 1) {
+		interpreter->errorOutput("Incorrect number of arguments to _done\n");
+		return -1;
+	}
+
+	Literal obj = arguments->literals[0];
+
+	bool freeObj = false;
+	if (IS_IDENTIFIER(obj)) {
+		parseIdentifierToValue(interpreter, &obj);
+		freeObj = true;
+	}
+
+	if (!IS_COROUTINE(obj)) {
+		interpreter->errorOutput("Incorrect argument type passed to _done (expected a coroutine)\n");
+
+		if (freeObj) {
+			freeLiteral(obj);
+		}
+		return -1;
+	}
+
+	Literal lit = TO_BOOLEAN_LITERAL(isCoroutineFinished(obj));
+	pushLiteralArray(&interpreter->stack, lit);
+
+	if (freeObj) {
+		freeLiteral(obj);
+	}
+
+	return 1;
+}
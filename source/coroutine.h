@@ -0,0 +1,34 @@
+#pragma once
+
+#include "toy_common.h"
+#include "interpreter.h"
+
+//a function call that can stop part way through with yield, and pick up from there when resumed
+typedef struct Coroutine {
+	Interpreter parent; //stands in for the interpreter that made it
+	Literal func; //released once the call is over
+	LiteralArray arguments; //in the reverse order, as callLiteralFn() expects
+	Literal yielded;
+	struct Fiber* fiber;
+	int refCount;
+	bool running;
+	bool cancelled;
+	bool finished;
+} Coroutine;
+
+//from the host - the arguments are given in call order
+//NOTE: a coroutine must not outlive the interpreter that made it, and must be resumed on the same thread
+TOY_API Literal createCoroutine(Interpreter* interpreter, Literal func, LiteralArray* arguments);
+TOY_API bool resumeCoroutine(Interpreter* interpreter, Literal coroutine, Literal* result); //result gets the next yielded value, or the return value - false on error
+TOY_API bool isCoroutineFinished(Literal coroutine);
+
+//for the interpreter
+bool yieldCoroutine(Interpreter* interpreter, Literal value); //takes the value - false if the coroutine is being destroyed
+void retainCoroutine(Coroutine* coroutine);
+void releaseCoroutine(Coroutine* coroutine); //a suspended call is unwound once nothing else holds it
+void detachCoroutineScope(Coroutine* coroutine, Scope* scope); //breaks the cycle formed when a coroutine is stored in a scope its function closes over
+
+//the natives, available everywhere
+int _coroutine(Interpreter* interpreter, LiteralArray* arguments);
+int _resume(Interpreter* interpreter, LiteralArray* arguments);
+int _done(Interpreter* interpreter, LiteralArray* arguments);
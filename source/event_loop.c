@@ -0,0 +1,309 @@
+#include "event_loop.h"
+
+#include "memory.h"
+
+#include "console_colors.h"
+
+#include <stdio.h>
+
+//a completion handed over from another thread
+typedef struct EventPost {
+	AsyncToken* token;
+	Literal result;
+	struct EventPost* next;
+} EventPost;
+
+//a one-shot watch on a file descriptor
+typedef struct EventWatch {
+	int fd;
+	bool timer; //the fd belongs to the loop
+	EventFn callback;
+	void* userdata;
+	struct EventWatch* next;
+} EventWatch;
+
+#if defined(__linux__)
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <stdint.h>
+
+#define EVENT_BATCH 16
+
+static TOY_THREAD_LOCAL EventLoop* currentLoop = NULL;
+
+//utils
+static bool addWatch(EventLoop* loop, int fd, bool timer, uint32_t events, EventFn callback, void* userdata) {
+	EventWatch* watch = ALLOCATE(EventWatch, 1);
+
+	watch->fd = fd;
+	watch->timer = timer;
+	watch->callback = callback;
+	watch->userdata = userdata;
+
+	struct epoll_event event;
+	event.events = events;
+	event.data.ptr = watch;
+
+	if (epoll_ctl(loop->epollFd, EPOLL_CTL_ADD, fd, &event) != 0) {
+		FREE(EventWatch, watch);
+		return false;
+	}
+
+	watch->next = loop->watches;
+	loop->watches = watch;
+	loop->watchCount++;
+
+	return true;
+}
+
+//the watch is gone before its callback runs, so the callback can start new ones
+static void removeWatch(EventLoop* loop, EventWatch* watch) {
+	for (EventWatch** it = &loop->watches; *it != NULL; it = &(*it)->next) {
+		if (*it == watch) {
+			*it = watch->next;
+			break;
+		}
+	}
+
+	epoll_ctl(loop->epollFd, EPOLL_CTL_DEL, watch->fd, NULL);
+	loop->watchCount--;
+
+	if (watch->timer) {
+		close(watch->fd);
+	}
+}
+
+static void fireWatch(EventLoop* loop, EventWatch* watch, bool ok) {
+	removeWatch(loop, watch);
+
+	watch->callback(loop, ok, watch->userdata);
+
+	FREE(EventWatch, watch);
+}
+
+//completes everything posted so far, in the order it was posted
+static void drainPosts(EventLoop* loop) {
+	lockMutex(loop->lock);
+	EventPost* posts = loop->posted;
+	loop->posted = NULL;
+	unlockMutex(loop->lock);
+
+	EventPost* ordered = NULL;
+	while (posts != NULL) {
+		EventPost* next = posts->next;
+		posts->next = ordered;
+		ordered = posts;
+		posts = next;
+	}
+
+	while (ordered != NULL) {
+		EventPost* next = ordered->next;
+
+		completeAsync(ordered->token, ordered->result);
+		freeLiteral(ordered->result);
+		FREE(EventPost, ordered);
+
+		ordered = next;
+	}
+}
+
+//exposed functions
+bool initEventLoop(EventLoop* loop, int timeSlice, InterpreterSetupFn setup) {
+	loop->epollFd = epoll_create1(EPOLL_CLOEXEC);
+	loop->wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+	if (loop->epollFd < 0 || loop->wakeFd < 0) {
+		fprintf(stderr, ERROR "ERROR: Failed to create the event loop's file descriptors\n" RESET);
+
+		if (loop->epollFd >= 0) {
+			close(loop->epollFd);
+		}
+		if (loop->wakeFd >= 0) {
+			close(loop->wakeFd);
+		}
+		return false;
+	}
+
+	//the wake fd is told apart from the watches by its NULL pointer
+	struct epoll_event event;
+	event.events = EPOLLIN;
+	event.data.ptr = NULL;
+	epoll_ctl(loop->epollFd, EPOLL_CTL_ADD, loop->wakeFd, &event);
+
+	initScheduler(&loop->scheduler, timeSlice, setup);
+	loop->lock = createMutex();
+	loop->posted = NULL;
+	loop->watches = NULL;
+	loop->watchCount = 0;
+	loop->events = 0;
+
+	return true;
+}
+
+void freeEventLoop(EventLoop* loop) {
+	EventLoop* previous = currentLoop;
+	currentLoop = loop;
+
+	//orphans the tokens of any waiting tasks
+	freeScheduler(&loop->scheduler);
+
+	//the callbacks still run, so whatever they hold can be released
+	while (loop->watches != NULL) {
+		fireWatch(loop, loop->watches, false);
+	}
+
+	drainPosts(loop);
+
+	currentLoop = previous;
+
+	freeMutex(loop->lock);
+	close(loop->wakeFd);
+	close(loop->epollFd);
+}
+
+bool watchEventFd(EventLoop* loop, int fd, EventInterest interest, EventFn callback, void* userdata) {
+	return addWatch(loop, fd, false, interest == EVENT_READABLE ? EPOLLIN : EPOLLOUT, callback, userdata);
+}
+
+bool startEventTimer(EventLoop* loop, int milliseconds, EventFn callback, void* userdata) {
+	int fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+
+	if (fd < 0) {
+		return false;
+	}
+
+	//a zero value would disarm the timer, so round up to a nanosecond
+	struct itimerspec spec = { 0 };
+	if (milliseconds > 0) {
+		spec.it_value.tv_sec = milliseconds / 1000;
+		spec.it_value.tv_nsec = (long)(milliseconds % 1000) * 1000000L;
+	}
+	else {
+		spec.it_value.tv_nsec = 1;
+	}
+
+	if (timerfd_settime(fd, 0, &spec, NULL) != 0 || !addWatch(loop, fd, true, EPOLLIN, callback, userdata)) {
+		close(fd);
+		return false;
+	}
+
+	return true;
+}
+
+void postAsyncCompletion(EventLoop* loop, AsyncToken* token, Literal result) {
+	EventPost* post = ALLOCATE(EventPost, 1);
+	post->token = token;
+	post->result = result;
+
+	lockMutex(loop->lock);
+	post->next = loop->posted;
+	loop->posted = post;
+	unlockMutex(loop->lock);
+
+	uint64_t one = 1;
+	if (write(loop->wakeFd, &one, sizeof(one)) < 0) {
+		//the counter is saturated, so the loop is already awake
+	}
+}
+
+bool stepEventLoop(EventLoop* loop, int timeout) {
+	EventLoop* previous = currentLoop;
+	currentLoop = loop;
+
+	//a turn for each task that's ready right now - ones woken along the way go next time
+	int ready = loop->scheduler.live - loop->scheduler.waiting;
+	for (int i = 0; i < ready && stepScheduler(&loop->scheduler); i++) {
+		//NO OP
+	}
+
+	if (loop->scheduler.live == 0 && loop->watchCount == 0) {
+		currentLoop = previous;
+		return false;
+	}
+
+	//don't sleep while there's work to do
+	if (loop->scheduler.live > loop->scheduler.waiting) {
+		timeout = 0;
+	}
+
+	struct epoll_event events[EVENT_BATCH];
+	int count = epoll_wait(loop->epollFd, events, EVENT_BATCH, timeout);
+
+	for (int i = 0; i < count; i++) {
+		EventWatch* watch = (EventWatch*)events[i].data.ptr;
+
+		if (watch == NULL) {
+			uint64_t value;
+			if (read(loop->wakeFd, &value, sizeof(value)) < 0) {
+				//spurious wakeup
+			}
+
+			drainPosts(loop);
+			continue;
+		}
+
+		if (watch->timer) {
+			uint64_t expirations;
+			if (read(watch->fd, &expirations, sizeof(expirations)) < 0) {
+				//already read
+			}
+		}
+
+		loop->events++;
+		fireWatch(loop, watch, true);
+	}
+
+	currentLoop = previous;
+	return true;
+}
+
+void runEventLoop(EventLoop* loop) {
+	while (stepEventLoop(loop, -1)) {
+		//NO OP
+	}
+}
+
+EventLoop* getCurrentEventLoop() {
+	return currentLoop;
+}
+
+#else
+
+//the event loop is built on epoll, timerfd and eventfd
+bool initEventLoop(EventLoop* loop, int timeSlice, InterpreterSetupFn setup) {
+	fprintf(stderr, ERROR "ERROR: The event loop isn't supported on this platform\n" RESET);
+	return false;
+}
+
+void freeEventLoop(EventLoop* loop) {
+	//NO OP
+}
+
+bool watchEventFd(EventLoop* loop, int fd, EventInterest interest, EventFn callback, void* userdata) {
+	return false;
+}
+
+bool startEventTimer(EventLoop* loop, int milliseconds, EventFn callback, void* userdata) {
+	return false;
+}
+
+void postAsyncCompletion(EventLoop* loop, AsyncToken* token, Literal result) {
+	//NO OP
+}
+
+bool stepEventLoop(EventLoop* loop, int timeout) {
+	return false;
+}
+
+void runEventLoop(EventLoop* loop) {
+	//NO OP
+}
+
+EventLoop* getCurrentEventLoop() {
+	return NULL;
+}
+
+#endif
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "toy_common.h"
+#include "interpreter.h"
+#include "scheduler.h"
+#include "thread.h"
+
+//what a watched file descriptor is waiting for
+typedef enum EventInterest {
+	EVENT_READABLE,
+	EVENT_WRITABLE,
+} EventInterest;
+
+typedef struct EventLoop EventLoop;
+
+//runs on the loop's thread - ok is false when the loop is freed before the event happens, so tokens can still be completed
+typedef void (*EventFn)(EventLoop* loop, bool ok, void* userdata);
+
+//a single-threaded reactor, which runs scripts on its scheduler and wakes the ones waiting on async natives
+struct EventLoop {
+	Scheduler scheduler; //spawn tasks on this
+	int epollFd;
+	int wakeFd; //an eventfd, written when completions are posted from other threads
+	Mutex* lock; //guards the posted completions
+	struct EventPost* posted;
+	struct EventWatch* watches; //one-shot fds and timers
+
+	//stats
+	int watchCount;
+	int events; //dispatched so far
+};
+
+TOY_API bool initEventLoop(EventLoop* loop, int timeSlice, InterpreterSetupFn setup); //false if the platform isn't supported (i.e. not linux)
+TOY_API void freeEventLoop(EventLoop* loop); //cancels the tasks still alive, then drops the remaining watches - tasks without a callback still need releasing
+
+//one-shot - the callback runs once, then the watch is gone
+TOY_API bool watchEventFd(EventLoop* loop, int fd, EventInterest interest, EventFn callback, void* userdata);
+TOY_API bool startEventTimer(EventLoop* loop, int milliseconds, EventFn callback, void* userdata);
+
+//thread-safe - takes the result, and completes the token on the loop's thread
+//NOTE: only hand over values that no other thread is touching (i.e. plain data, or freshly made strings)
+TOY_API void postAsyncCompletion(EventLoop* loop, AsyncToken* token, Literal result);
+
+TOY_API bool stepEventLoop(EventLoop* loop, int timeout); //a turn for each ready task, then waits up to timeout ms (-1 forever) for events - false once there's nothing left to do
+TOY_API void runEventLoop(EventLoop* loop); //until every task is over, and every watch has fired
+
+//for async natives - the loop running on this thread, or NULL
+TOY_API EventLoop* getCurrentEventLoop();
@@ -0,0 +1,274 @@
+#include "executor.h"
+
+#include "memory.h"
+
+#include "console_colors.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+//utils
+static void detachDictionary(LiteralDictionary* dest, LiteralDictionary* source) {
+	for (int i = 0; i < source->capacity; i++) {
+		Literal key = source->entries[i].key;
+		Literal value = source->entries[i].value;
+
+		//only plain data can leave the interpreter
+		if (IS_NULL(key) || IS_FUNCTION(value) || IS_FUNCTION_NATIVE(value)) {
+			continue;
+		}
+
+		key = detachLiteral(key);
+		value = detachLiteral(value);
+		setLiteralDictionary(dest, key, value);
+		freeLiteral(key);
+		freeLiteral(value);
+	}
+}
+
+static void freeJob(Job* job) {
+	freeLiteralDictionary(&job->inputs);
+	freeMutex(job->lock);
+	freeCondition(job->finished);
+	FREE(Job, job);
+}
+
+//the queue - every job comes from submitJob(), so the owner and thieves alike take the oldest first
+static void pushWorkerJob(ExecutorWorker* worker, Job* job) {
+	lockMutex(worker->lock);
+
+	if (worker->count + 1 > worker->capacity) {
+		int oldCapacity = worker->capacity;
+		Job** jobs = ALLOCATE(Job*, GROW_CAPACITY(oldCapacity));
+
+		//unwrap the ring
+		for (int i = 0; i < worker->count; i++) {
+			jobs[i] = worker->jobs[(worker->head + i) % oldCapacity];
+		}
+
+		FREE_ARRAY(Job*, worker->jobs, oldCapacity);
+		worker->jobs = jobs;
+		worker->capacity = GROW_CAPACITY(oldCapacity);
+		worker->head = 0;
+	}
+
+	worker->jobs[(worker->head + worker->count) % worker->capacity] = job;
+	worker->count++;
+
+	unlockMutex(worker->lock);
+}
+
+static Job* popWorkerJob(ExecutorWorker* worker) {
+	Job* job = NULL;
+
+	lockMutex(worker->lock);
+	if (worker->count > 0) {
+		job = worker->jobs[worker->head];
+		worker->head = (worker->head + 1) % worker->capacity;
+		worker->count--;
+	}
+	unlockMutex(worker->lock);
+
+	return job;
+}
+
+static Job* takeJob(ExecutorWorker* worker) {
+	Executor* executor = worker->executor;
+	Job* job = popWorkerJob(worker);
+
+	//look through the other queues, starting with the neighbour
+	int self = (int)(worker - executor->workers);
+	for (int i = 1; job == NULL && i < executor->workerCount; i++) {
+		job = popWorkerJob(&executor->workers[(self + i) % executor->workerCount]);
+
+		if (job != NULL) {
+			worker->stolen++;
+		}
+	}
+
+	if (job != NULL) {
+		lockMutex(executor->lock);
+		executor->pending--;
+		unlockMutex(executor->lock);
+	}
+
+	return job;
+}
+
+static void runJob(ExecutorWorker* worker, Job* job) {
+	Interpreter* interpreter = checkoutInterpreter(&worker->pool);
+
+	//expose the inputs to import
+	Literal any = TO_TYPE_LITERAL(LITERAL_ANY, false);
+	for (int i = 0; i < job->inputs.capacity; i++) {
+		if (!IS_NULL(job->inputs.entries[i].key)) {
+			setLiteralDictionary(interpreter->exports, job->inputs.entries[i].key, job->inputs.entries[i].value);
+			setLiteralDictionary(interpreter->exportTypes, job->inputs.entries[i].key, any);
+		}
+	}
+
+	runProgram(interpreter, job->program);
+	job->ok = !interpreter->panic;
+
+	if (job->callback) {
+		job->callback(interpreter, job->ok, job->userdata);
+		returnInterpreter(&worker->pool, interpreter);
+		freeLiteralDictionary(&job->results);
+		freeJob(job);
+		worker->executed++;
+		return;
+	}
+
+	detachDictionary(&job->results, interpreter->exports);
+	returnInterpreter(&worker->pool, interpreter);
+
+	worker->executed++;
+
+	//hand the job back
+	lockMutex(job->lock);
+	job->done = true;
+	signalCondition(job->finished);
+	unlockMutex(job->lock);
+}
+
+static void runWorker(void* arg) {
+	ExecutorWorker* worker = (ExecutorWorker*)arg;
+	Executor* executor = worker->executor;
+
+	initInterpreterPool(&worker->pool, executor->setup);
+
+	for (;;) {
+		Job* job = takeJob(worker);
+
+		if (job != NULL) {
+			runJob(worker, job);
+			continue;
+		}
+
+		//sleep until there's something to do
+		lockMutex(executor->lock);
+		while (executor->pending == 0 && !executor->stopping) {
+			waitCondition(executor->wake, executor->lock);
+		}
+
+		bool finished = executor->pending == 0 && executor->stopping;
+		unlockMutex(executor->lock);
+
+		if (finished) {
+			break;
+		}
+	}
+
+	//the interpreters were made on this thread, so they're released here too
+	freeInterpreterPool(&worker->pool);
+}
+
+//exposed API
+void initExecutor(Executor* executor, int workerCount, InterpreterSetupFn setup) {
+	if (workerCount < 1) {
+		workerCount = 1;
+	}
+
+	executor->workers = ALLOCATE(ExecutorWorker, workerCount);
+	executor->workerCount = workerCount;
+	executor->setup = setup;
+	executor->pending = 0;
+	executor->next = 0;
+	executor->stopping = false;
+	executor->lock = createMutex();
+	executor->wake = createCondition();
+
+	//the queues must exist before any worker can steal from them
+	for (int i = 0; i < workerCount; i++) {
+		ExecutorWorker* worker = &executor->workers[i];
+		worker->executor = executor;
+		worker->lock = createMutex();
+		worker->jobs = NULL;
+		worker->capacity = 0;
+		worker->head = 0;
+		worker->count = 0;
+		worker->executed = 0;
+		worker->stolen = 0;
+	}
+
+	for (int i = 0; i < workerCount; i++) {
+		executor->workers[i].thread = startThread(runWorker, &executor->workers[i]);
+
+		if (executor->workers[i].thread == NULL) {
+			fprintf(stderr, ERROR "[internal] Executor error (couldn't start a worker thread)\n" RESET);
+			exit(-1);
+		}
+	}
+}
+
+void freeExecutor(Executor* executor) {
+	lockMutex(executor->lock);
+	executor->stopping = true;
+	broadcastCondition(executor->wake);
+	unlockMutex(executor->lock);
+
+	for (int i = 0; i < executor->workerCount; i++) {
+		joinThread(executor->workers[i].thread);
+	}
+
+	for (int i = 0; i < executor->workerCount; i++) {
+		FREE_ARRAY(Job*, executor->workers[i].jobs, executor->workers[i].capacity);
+		freeMutex(executor->workers[i].lock);
+	}
+
+	FREE_ARRAY(ExecutorWorker, executor->workers, executor->workerCount);
+	executor->workers = NULL;
+	executor->workerCount = 0;
+
+	freeMutex(executor->lock);
+	freeCondition(executor->wake);
+}
+
+Job* submitJob(Executor* executor, Program* program, LiteralDictionary* inputs, JobCallback callback, void* userdata) {
+	Job* job = ALLOCATE(Job, 1);
+
+	job->program = program;
+	initLiteralDictionary(&job->inputs);
+	initLiteralDictionary(&job->results);
+	job->callback = callback;
+	job->userdata = userdata;
+	job->ok = false;
+	job->done = false;
+	job->lock = createMutex();
+	job->finished = createCondition();
+
+	//the caller's strings stay with the caller
+	if (inputs != NULL) {
+		detachDictionary(&job->inputs, inputs);
+	}
+
+	lockMutex(executor->lock);
+	pushWorkerJob(&executor->workers[executor->next], job);
+	executor->next = (executor->next + 1) % executor->workerCount;
+	executor->pending++;
+	signalCondition(executor->wake);
+	unlockMutex(executor->lock);
+
+	return callback ? NULL : job;
+}
+
+bool waitJob(Job* job, LiteralDictionary* results) {
+	lockMutex(job->lock);
+	while (!job->done) {
+		waitCondition(job->finished, job->lock);
+	}
+	unlockMutex(job->lock);
+
+	bool ok = job->ok;
+
+	if (results != NULL) {
+		*results = job->results;
+	}
+	else {
+		freeLiteralDictionary(&job->results);
+	}
+
+	freeJob(job);
+
+	return ok;
+}
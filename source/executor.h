@@ -0,0 +1,57 @@
+#pragma once
+
+#include "toy_common.h"
+#include "interpreter.h"
+#include "interpreter_pool.h"
+#include "thread.h"
+
+//runs on the worker, while the interpreter still holds the job's state
+typedef void (*JobCallback)(Interpreter* interpreter, bool ok, void* userdata);
+
+//a program to run, and where its results go
+typedef struct Job {
+	Program* program; //read-only - shared with other jobs
+	LiteralDictionary inputs; //available to the script through import
+	LiteralDictionary results; //the script's exports
+	JobCallback callback;
+	void* userdata;
+	bool ok;
+	bool done;
+	Mutex* lock;
+	Condition* finished;
+} Job;
+
+//each worker owns a queue of jobs, and an interpreter that is reused between them
+typedef struct ExecutorWorker {
+	struct Executor* executor;
+	Thread* thread;
+	Mutex* lock; //guards the queue
+	Job** jobs; //ring buffer
+	int capacity;
+	int head;
+	int count;
+	InterpreterPool pool;
+
+	//stats
+	int executed;
+	int stolen;
+} ExecutorWorker;
+
+typedef struct Executor {
+	ExecutorWorker* workers;
+	int workerCount;
+	InterpreterSetupFn setup;
+	Mutex* lock; //guards the fields below, taken before any queue
+	Condition* wake;
+	int pending; //jobs sitting in a queue
+	int next; //round-robin submission
+	bool stopping;
+} Executor;
+
+TOY_API void initExecutor(Executor* executor, int workerCount, InterpreterSetupFn setup); //setup runs once per worker, on that worker
+TOY_API void freeExecutor(Executor* executor); //finishes every queued job first
+
+//inputs are copied, and the program must outlive the job
+//jobs with a callback are released once it returns, the rest must be collected by waitJob()
+TOY_API Job* submitJob(Executor* executor, Program* program, LiteralDictionary* inputs, JobCallback callback, void* userdata);
+TOY_API bool waitJob(Job* job, LiteralDictionary* results); //blocks, then releases the job - results can be NULL, or an uninitialized dictionary to fill
@@ -0,0 +1,172 @@
+#include "fiber.h"
+
+#include "memory.h"
+
+#include "console_colors.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(_WIN32) || defined(WIN32)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+#endif
+
+struct Fiber {
+	FiberFn fn;
+	void* userdata;
+	bool started;
+	bool finished;
+
+#if defined(_WIN32) || defined(WIN32)
+	LPVOID handle;
+	LPVOID caller;
+#else
+	ucontext_t context;
+	ucontext_t caller;
+	unsigned char* stack;
+	size_t stackSize;
+#endif
+};
+
+#if defined(_WIN32) || defined(WIN32)
+
+static VOID CALLBACK fiberEntry(LPVOID arg) {
+	Fiber* fiber = (Fiber*)arg;
+
+	fiber->fn(fiber->userdata);
+	fiber->finished = true;
+
+	//a windows fiber must never return
+	SwitchToFiber(fiber->caller);
+}
+
+Fiber* createFiber(FiberFn fn, void* userdata, size_t stackSize) {
+	Fiber* fiber = ALLOCATE(Fiber, 1);
+
+	fiber->fn = fn;
+	fiber->userdata = userdata;
+	fiber->started = false;
+	fiber->finished = false;
+	fiber->caller = NULL;
+	fiber->handle = CreateFiberEx(0, stackSize, 0, fiberEntry, fiber); //reserve the whole stack, but commit the default
+
+	if (fiber->handle == NULL) {
+		fprintf(stderr, ERROR "[internal] Fiber error (couldn't create a fiber)\n" RESET);
+		exit(-1);
+	}
+
+	return fiber;
+}
+
+void freeFiber(Fiber* fiber) {
+	DeleteFiber(fiber->handle);
+	FREE(Fiber, fiber);
+}
+
+bool resumeFiber(Fiber* fiber) {
+	if (fiber->finished) {
+		return false;
+	}
+
+	//the resuming thread has to be a fiber too
+	LPVOID caller = GetCurrentFiber();
+	bool converted = false;
+	if (caller == NULL || caller == (LPVOID)0x1E00) {
+		caller = ConvertThreadToFiber(NULL);
+		converted = true;
+	}
+
+	fiber->caller = caller;
+	fiber->started = true;
+	SwitchToFiber(fiber->handle);
+
+	if (converted) {
+		ConvertFiberToThread();
+	}
+
+	return !fiber->finished;
+}
+
+void yieldFiber(Fiber* fiber) {
+	SwitchToFiber(fiber->caller);
+}
+
+#else
+
+//makecontext() can only pass ints, so the fiber being started is handed over here
+static TOY_THREAD_LOCAL Fiber* startingFiber = NULL;
+
+static void fiberEntry(void) {
+	Fiber* fiber = startingFiber;
+	startingFiber = NULL;
+
+	fiber->fn(fiber->userdata);
+	fiber->finished = true;
+
+	swapcontext(&fiber->context, &fiber->caller);
+}
+
+Fiber* createFiber(FiberFn fn, void* userdata, size_t stackSize) {
+	Fiber* fiber = ALLOCATE(Fiber, 1);
+
+	fiber->fn = fn;
+	fiber->userdata = userdata;
+	fiber->started = false;
+	fiber->finished = false;
+
+	//the lowest page is a guard, so an overflow faults instead of running into the heap
+	size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+	fiber->stackSize = (stackSize + pageSize - 1) / pageSize * pageSize + pageSize;
+	fiber->stack = mmap(NULL, fiber->stackSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	if (fiber->stack == MAP_FAILED || mprotect(fiber->stack, pageSize, PROT_NONE) != 0) {
+		fprintf(stderr, ERROR "[internal] Fiber error (couldn't map a stack of %d bytes)\n" RESET, (int)fiber->stackSize);
+		exit(-1);
+	}
+
+	if (getcontext(&fiber->context) != 0) {
+		fprintf(stderr, ERROR "[internal] Fiber error (couldn't create a fiber)\n" RESET);
+		exit(-1);
+	}
+
+	fiber->context.uc_stack.ss_sp = fiber->stack + pageSize;
+	fiber->context.uc_stack.ss_size = fiber->stackSize - pageSize;
+	fiber->context.uc_link = NULL;
+	makecontext(&fiber->context, fiberEntry, 0);
+
+	return fiber;
+}
+
+void freeFiber(Fiber* fiber) {
+	munmap(fiber->stack, fiber->stackSize);
+	FREE(Fiber, fiber);
+}
+
+bool resumeFiber(Fiber* fiber) {
+	if (fiber->finished) {
+		return false;
+	}
+
+	if (!fiber->started) {
+		fiber->started = true;
+		startingFiber = fiber;
+	}
+
+	swapcontext(&fiber->caller, &fiber->context);
+
+	return !fiber->finished;
+}
+
+void yieldFiber(Fiber* fiber) {
+	swapcontext(&fiber->context, &fiber->caller);
+}
+
+#endif
+
+bool isFiberFinished(Fiber* fiber) {
+	return fiber->finished;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "toy_common.h"
+
+//a function running on its own stack, which can hand control back to whoever resumed it
+typedef struct Fiber Fiber;
+
+typedef void (*FiberFn)(void* userdata);
+
+//NOTE: the stack is only reserved up front, and pages are committed as they're touched - so this is sized for the deepest run, below a guard page
+#define FIBER_STACK_SIZE (8 * 1024 * 1024)
+
+TOY_API Fiber* createFiber(FiberFn fn, void* userdata, size_t stackSize); //doesn't start running until resumed
+TOY_API void freeFiber(Fiber* fiber); //NOTE: a fiber that hasn't finished is dropped as-is, so unwind it first
+TOY_API bool resumeFiber(Fiber* fiber); //runs until the fiber yields or returns - true while it can still be resumed
+TOY_API void yieldFiber(Fiber* fiber); //only from inside the fiber itself
+TOY_API bool isFiberFinished(Fiber* fiber);
+
+//WARNING: a fiber must be resumed on the thread that created it, since the runtime's state is per-thread
@@ -7,9 +7,14 @@
 #include "opcodes.h"
 
 #include "builtin.h"
+#include "fiber.h"
+#include "coroutine.h"
+#include "record.h"
+#include "packed_array.h"
 
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 
 static void printWrapper(const char* output) {
 	printf("%s", output);
@@ -179,9 +184,20 @@ static unsigned char readByte(unsigned char* tb, int* count) {
 	return ret;
 }
 
-static unsigned short readShort(unsigned char* tb, int* count) {
-	unsigned short ret = *(unsigned short*)(tb + *count);
-	*count += 2;
+//LEB128: 7 bits per byte, low bits first, high bit set while more bytes follow
+static unsigned int readVarint(unsigned char* tb, int* count) {
+	unsigned int ret = 0;
+	int shift = 0;
+	unsigned char byte;
+
+	do {
+		byte = tb[(*count)++];
+		if (shift < 32) {
+			ret |= (unsigned int)(byte & 0x7F) << shift;
+		}
+		shift += 7;
+	} while (byte & 0x80);
+
 	return ret;
 }
 
@@ -221,6 +237,24 @@ static void consumeShort(Interpreter* interpreter, unsigned short bytes, unsigne
 	*count += 2;
 }
 
+//function bodies sit after the function section's offset table
+static int readFunctionOffset(Interpreter* interpreter, int index) {
+	int count = interpreter->functionTable + sizeof(int) * index;
+	return readInt(interpreter->bytecode, &count);
+}
+
+static Literal readFunctionBody(Interpreter* interpreter, int index) {
+	int start = readFunctionOffset(interpreter, index);
+	int end = readFunctionOffset(interpreter, index + 1);
+	int bodies = interpreter->functionTable + sizeof(int) * (interpreter->functionCount + 1);
+
+	//NOTE: the literal points into the bytecode, and must be copied before it's kept
+	Literal literal = TO_FUNCTION_LITERAL(interpreter->bytecode + bodies + start, end - start);
+	AS_FUNCTION(literal).scope = NULL;
+
+	return literal;
+}
+
 //each available statement
 static bool execAssert(Interpreter* interpreter) {
 	Literal rhs = popLiteralArray(&interpreter->stack);
@@ -266,12 +300,39 @@ static bool execPrint(Interpreter* interpreter) {
 	return true;
 }
 
+static bool execYield(Interpreter* interpreter) {
+	//hand what is on top of the stack to whoever resumed the coroutine
+	Literal lit = popLiteralArray(&interpreter->stack);
+
+	if (IS_IDENTIFIER(lit)) {
+		Literal idn = lit;
+		if (!parseIdentifierToValue(interpreter, &lit)) {
+			return false;
+		}
+		freeLiteral(idn);
+	}
+
+	if (interpreter->coroutine == NULL) {
+		interpreter->errorOutput("Can't yield outside of a coroutine\n");
+		freeLiteral(lit);
+		return false;
+	}
+
+	//the coroutine is being destroyed, so unwind
+	if (!yieldCoroutine(interpreter, lit)) {
+		interpreter->panic = true;
+		return false;
+	}
+
+	return true;
+}
+
 static bool execPushLiteral(Interpreter* interpreter, bool lng) {
 	//read the index in the cache
 	int index = 0;
 
 	if (lng) {
-		index = (int)readShort(interpreter->bytecode, &interpreter->count);
+		index = (int)readVarint(interpreter->bytecode, &interpreter->count);
 	}
 	else {
 		index = (int)readByte(interpreter->bytecode, &interpreter->count);
@@ -509,12 +570,20 @@ static bool execArithmetic(Interpreter* interpreter, Opcode opcode) {
 	return false;
 }
 
-static Literal parseTypeToValue(Interpreter* interpreter, Literal type) {
+Literal parseTypeToValue(Interpreter* interpreter, Literal type) {
 	//if an identifier is embedded in the type, figure out what it iss
 	if (IS_IDENTIFIER(type)) {
 		Literal idn = type;
-		parseIdentifierToValue(interpreter, &type);
-		freeLiteral(idn);
+		if (parseIdentifierToValue(interpreter, &type)) {
+			freeLiteral(idn);
+		}
+	}
+
+	//a declared struct stands for its own record type
+	if (IS_RECORD(type)) {
+		Literal record = type;
+		type = toRecordType(AS_RECORD(record)->layout);
+		freeLiteral(record);
 	}
 
 	//if this is an array or dictionary, continue to the subtypes
@@ -533,8 +602,8 @@ static bool execVarDecl(Interpreter* interpreter, bool lng) {
 	int typeIndex = 0;
 
 	if (lng) {
-		identifierIndex = (int)readShort(interpreter->bytecode, &interpreter->count);
-		typeIndex = (int)readShort(interpreter->bytecode, &interpreter->count);
+		identifierIndex = (int)readVarint(interpreter->bytecode, &interpreter->count);
+		typeIndex = (int)readVarint(interpreter->bytecode, &interpreter->count);
 	}
 	else {
 		identifierIndex = (int)readByte(interpreter->bytecode, &interpreter->count);
@@ -602,8 +671,8 @@ static bool execFnDecl(Interpreter* interpreter, bool lng) {
 	int functionIndex = 0;
 
 	if (lng) {
-		identifierIndex = (int)readShort(interpreter->bytecode, &interpreter->count);
-		functionIndex = (int)readShort(interpreter->bytecode, &interpreter->count);
+		identifierIndex = (int)readVarint(interpreter->bytecode, &interpreter->count);
+		functionIndex = (int)readVarint(interpreter->bytecode, &interpreter->count);
 	}
 	else {
 		identifierIndex = (int)readByte(interpreter->bytecode, &interpreter->count);
@@ -613,6 +682,17 @@ static bool execFnDecl(Interpreter* interpreter, bool lng) {
 	Literal identifier = interpreter->literalCache.literals[identifierIndex];
 	Literal function = interpreter->literalCache.literals[functionIndex];
 
+	//locate the body only now - setScopeVariable() copies it out of the bytecode
+	if (function.type == LITERAL_FUNCTION_INTERMEDIATE) {
+		function = readFunctionBody(interpreter, AS_INTEGER(function));
+
+		//assert that the last memory slot is function end
+		if (AS_FUNCTION(function).length < 1 || ((unsigned char*)AS_FUNCTION(function).bytecode)[AS_FUNCTION(function).length - 1] != OP_FN_END) {
+			interpreter->errorOutput("[internal] Failed to find function end\n");
+			return false;
+		}
+	}
+
 	AS_FUNCTION(function).scope = pushScope(interpreter->scope); //hacked in (needed for closure persistance)
 
 	Literal type = TO_TYPE_LITERAL(LITERAL_FUNCTION, true);
@@ -830,7 +910,7 @@ static bool execTypeOf(Interpreter* interpreter) {
 		type = getScopeType(interpreter->scope, rhs);
 	}
 	else {
-		type = TO_TYPE_LITERAL(rhs.type, false);
+		type = TO_TYPE_LITERAL(IS_PACKED_ARRAY(rhs) ? LITERAL_ARRAY : rhs.type, false); //packing is invisible to scripts
 	}
 
 	pushLiteralArray(&interpreter->stack, type);
@@ -1055,9 +1135,9 @@ static bool execOr(Interpreter* interpreter) {
 }
 
 static bool execJump(Interpreter* interpreter) {
-	int target = (int)readShort(interpreter->bytecode, &interpreter->count);
+	int target = readInt(interpreter->bytecode, &interpreter->count);
 
-	if (target + interpreter->codeStart > interpreter->length) {
+	if (target < 0 || target + interpreter->codeStart > interpreter->length) {
 		interpreter->errorOutput("[internal] Jump out of range\n");
 		return false;
 	}
@@ -1069,9 +1149,9 @@ static bool execJump(Interpreter* interpreter) {
 }
 
 static bool execFalseJump(Interpreter* interpreter) {
-	int target = (int)readShort(interpreter->bytecode, &interpreter->count);
+	int target = readInt(interpreter->bytecode, &interpreter->count);
 
-	if (target + interpreter->codeStart > interpreter->length) {
+	if (target < 0 || target + interpreter->codeStart > interpreter->length) {
 		interpreter->errorOutput("[internal] Jump out of range (false jump)\n");
 		return false;
 	}
@@ -1107,6 +1187,35 @@ static bool execFalseJump(Interpreter* interpreter) {
 static void execInterpreter(Interpreter*);
 static void readInterpreterSections(Interpreter* interpreter);
 
+//the run sits still until the native's token is completed, or the run is cancelled
+static bool waitForAsync(Interpreter* interpreter) {
+	Budget* budget = interpreter->budget;
+
+	if (budget == NULL || !budget->running) {
+		interpreter->errorOutput("Async native returned pending in a run that can't wait\n");
+		return false;
+	}
+
+	//a native can complete its own token before returning, in which case there is nothing to wait for
+	if (budget->token != NULL) {
+		budget->waiting = true;
+		budget->suspended = true;
+		yieldFiber(budget->fiber);
+		budget->suspended = false;
+	}
+
+	if (budget->cancelled) {
+		interpreter->panic = true;
+		return false;
+	}
+
+	pushLiteralArray(&interpreter->stack, budget->result);
+	freeLiteral(budget->result);
+	budget->result = TO_NULL_LITERAL;
+
+	return true;
+}
+
 static bool execFnCall(Interpreter* interpreter, bool looseFirstArgument) {
 	//BUGFIX: depth check - don't drown!
 	if (interpreter->depth >= 200) {
@@ -1176,14 +1285,20 @@ static bool execFnCall(Interpreter* interpreter, bool looseFirstArgument) {
 		freeLiteralArray(&arguments);
 
 		//call the native function
-		((NativeFn) AS_FUNCTION(func).bytecode )(interpreter, &correct);
+		int result = ((NativeFn) AS_FUNCTION(func).bytecode )(interpreter, &correct);
 
 		freeLiteralArray(&correct);
 		freeLiteral(identifier);
+
+		//the native's result arrives later
+		if (result == NATIVE_PENDING) {
+			return waitForAsync(interpreter);
+		}
+
 		return true;
 	}
 
-	if (!IS_FUNCTION(func)) {
+	if (!IS_FUNCTION(func) && !IS_COROUTINE(func) && !IS_RECORD(func)) {
 		interpreter->errorOutput("Function not found: ");
 		printLiteralCustom(identifier, interpreter->errorOutput);
 		interpreter->errorOutput("\n");
@@ -1209,6 +1324,26 @@ static bool execFnCall(Interpreter* interpreter, bool looseFirstArgument) {
 }
 
 bool callLiteralFn(Interpreter* interpreter, Literal func, LiteralArray* arguments, LiteralArray* returns) {
+	//calling a coroutine resumes it
+	if (IS_COROUTINE(func)) {
+		if (arguments->count > 0) {
+			interpreter->errorOutput("Coroutines can't be resumed with arguments\n");
+			return false;
+		}
+
+		Literal result = TO_NULL_LITERAL;
+		bool ok = resumeCoroutine(interpreter, func, &result);
+		pushLiteralArray(returns, result);
+		freeLiteral(result);
+
+		return ok;
+	}
+
+	//calling a record builds another of the same layout
+	if (IS_RECORD(func)) {
+		return constructRecord(interpreter, func, arguments, returns);
+	}
+
 	if (!IS_FUNCTION(func)) {
 		interpreter->errorOutput("Function required in callLiteralFn()\n");
 		return false;
@@ -1219,13 +1354,17 @@ bool callLiteralFn(Interpreter* interpreter, Literal func, LiteralArray* argumen
 
 	//init the inner interpreter manually
 	initLiteralArray(&inner.literalCache);
-	inner.scope = pushScope(func.as.function.scope);
+	inner.scopePool = interpreter->scopePool;
+	inner.scope = pushScopeFromPool(inner.scopePool, func.as.function.scope);
 	inner.bytecode = AS_FUNCTION(func).bytecode;
 	inner.length = AS_FUNCTION(func).length;
 	inner.count = 0;
 	inner.codeStart = -1;
 	inner.depth = interpreter->depth + 1;
 	inner.panic = false;
+	inner.budget = interpreter->budget;
+	inner.coroutine = interpreter->coroutine;
+	inner.verbose = interpreter->verbose;
 	initLiteralArray(&inner.stack);
 	inner.exports = interpreter->exports;
 	inner.exportTypes = interpreter->exportTypes;
@@ -1238,8 +1377,8 @@ bool callLiteralFn(Interpreter* interpreter, Literal func, LiteralArray* argumen
 	readInterpreterSections(&inner);
 
 	//prep the arguments
-	LiteralArray* paramArray = AS_ARRAY(inner.literalCache.literals[ readShort(inner.bytecode, &inner.count) ]);
-	LiteralArray* returnArray = AS_ARRAY(inner.literalCache.literals[ readShort(inner.bytecode, &inner.count) ]);
+	LiteralArray* paramArray = AS_ARRAY(inner.literalCache.literals[ readVarint(inner.bytecode, &inner.count) ]);
+	LiteralArray* returnArray = AS_ARRAY(inner.literalCache.literals[ readVarint(inner.bytecode, &inner.count) ]);
 
 	//get the rest param, if it exists
 	Literal restParam = TO_NULL_LITERAL;
@@ -1262,8 +1401,21 @@ bool callLiteralFn(Interpreter* interpreter, Literal func, LiteralArray* argumen
 
 	//contents is the indexes of identifier & type
 	for (int i = 0; i < paramArray->count - (IS_NULL(restParam) ? 0 : 2); i += 2) { //don't count the rest parameter, if present
+		//BUGFIX: names embedded in the type (i.e. structs) are resolved where the function was declared
+		Literal paramType = paramArray->literals[i + 1];
+		bool named = !IS_TYPE(paramType) || AS_TYPE(paramType).count > 0;
+		if (named) {
+			paramType = parseTypeToValue(&inner, copyLiteral(paramType));
+		}
+
+		bool declared = IS_TYPE(paramType) && declareScopeVariable(inner.scope, paramArray->literals[i], paramType);
+
+		if (named) {
+			freeLiteral(paramType);
+		}
+
 		//declare and define each entry in the scope
-		if (!declareScopeVariable(inner.scope, paramArray->literals[i], paramArray->literals[i + 1])) {
+		if (!declared) {
 			interpreter->errorOutput("[internal] Could not re-declare parameter\n");
 
 			//free, and skip out
@@ -1568,6 +1720,45 @@ static bool execExport(Interpreter* interpreter) {
 	return true;
 }
 
+//finds the packed array and the in-range element a single index refers to, without copying the buffer - NULL to use _index instead
+static PackedArray* findPackedElement(Interpreter* interpreter, Literal compound, Literal first, Literal second, Literal third, int* index, bool write) {
+	if (!IS_NULL(second) || !IS_NULL(third)) {
+		return NULL;
+	}
+
+	Literal* ref = !IS_IDENTIFIER(compound) ? &compound : write ? getScopeVariableWriteRef(interpreter->scope, compound) : getScopeVariableRef(interpreter->scope, compound);
+
+	if (ref == NULL || !IS_PACKED_ARRAY(*ref)) {
+		return NULL;
+	}
+
+	if (IS_IDENTIFIER(first)) {
+		Literal* firstRef = getScopeVariableRef(interpreter->scope, first);
+
+		if (firstRef == NULL) {
+			return NULL;
+		}
+
+		first = *firstRef;
+	}
+
+	if (!IS_INTEGER(first) || AS_INTEGER(first) < 0 || AS_INTEGER(first) >= AS_PACKED_ARRAY(*ref)->count) {
+		return NULL;
+	}
+
+	*index = AS_INTEGER(first);
+	return AS_PACKED_ARRAY(*ref);
+}
+
+//the generic indexing only knows plain arrays
+static void unpackCompound(Literal* compound) {
+	if (IS_PACKED_ARRAY(*compound)) {
+		Literal unpacked = unpackLiteralArray(AS_PACKED_ARRAY(*compound));
+		freeLiteral(*compound);
+		*compound = unpacked;
+	}
+}
+
 static bool execIndex(Interpreter* interpreter, bool assignIntermediate) {
 	//assume -> compound, first, second, third are all on the stack
 
@@ -1576,6 +1767,20 @@ static bool execIndex(Interpreter* interpreter, bool assignIntermediate) {
 	Literal first = popLiteralArray(&interpreter->stack);
 	Literal compound = popLiteralArray(&interpreter->stack);
 
+	//read a packed element in place
+	int index = 0;
+	PackedArray* packed = assignIntermediate ? NULL : findPackedElement(interpreter, compound, first, second, third, &index, false);
+
+	if (packed != NULL) {
+		pushLiteralArray(&interpreter->stack, getPackedArray(packed, index));
+
+		freeLiteral(third);
+		freeLiteral(second);
+		freeLiteral(first);
+		freeLiteral(compound);
+		return true;
+	}
+
 	Literal idn = compound;
 	bool freeIdn = false;
 
@@ -1591,6 +1796,8 @@ static bool execIndex(Interpreter* interpreter, bool assignIntermediate) {
 		}
 	}
 
+	unpackCompound(&compound);
+
 	if (!IS_ARRAY(compound) && !IS_DICTIONARY(compound) && !IS_STRING(compound)) {
 		interpreter->errorOutput("Unknown compound found in indexing notation: ");
 		printLiteralCustom(compound, interpreter->errorOutput);
@@ -1665,6 +1872,43 @@ static bool execIndex(Interpreter* interpreter, bool assignIntermediate) {
 	return true;
 }
 
+//takes ownership of value
+static bool execPackedAssign(Interpreter* interpreter, Literal idn, PackedArray* packed, int index, Opcode opcode, Literal value) {
+	if (IS_IDENTIFIER(value)) {
+		Literal valueIdn = value;
+		parseIdentifierToValue(interpreter, &value);
+		freeLiteral(valueIdn);
+	}
+
+	Literal type = getScopeType(interpreter->scope, idn);
+	bool constant = AS_TYPE(type).constant;
+	freeLiteral(type);
+
+	//compound assignment uses the usual arithmetic
+	if (!constant && opcode != OP_VAR_ASSIGN) {
+		pushLiteralArray(&interpreter->stack, getPackedArray(packed, index));
+		pushLiteralArray(&interpreter->stack, value);
+		freeLiteral(value);
+
+		if (!execArithmetic(interpreter, opcode)) {
+			return false;
+		}
+
+		value = popLiteralArray(&interpreter->stack);
+	}
+
+	if (constant || !setPackedArray(packed, index, value)) {
+		interpreter->errorOutput("Incorrect type assigned to compound member ");
+		printLiteralCustom(idn, interpreter->errorOutput);
+		interpreter->errorOutput("\n");
+		freeLiteral(value);
+		return false;
+	}
+
+	freeLiteral(value);
+	return true;
+}
+
 static bool execIndexAssign(Interpreter* interpreter) {
 	//assume -> compound, first, second, third, assign are all on the stack
 
@@ -1674,6 +1918,21 @@ static bool execIndexAssign(Interpreter* interpreter) {
 	Literal first = popLiteralArray(&interpreter->stack);
 	Literal compound = popLiteralArray(&interpreter->stack);
 
+	//write a packed element in place
+	int index = 0;
+	PackedArray* packed = IS_IDENTIFIER(compound) ? findPackedElement(interpreter, compound, first, second, third, &index, true) : NULL;
+
+	if (packed != NULL) {
+		Opcode opcode = (Opcode)readByte(interpreter->bytecode, &interpreter->count);
+		bool result = execPackedAssign(interpreter, compound, packed, index, opcode, assign);
+
+		freeLiteral(third);
+		freeLiteral(second);
+		freeLiteral(first);
+		freeLiteral(compound);
+		return result;
+	}
+
 	Literal idn = compound;
 	bool freeIdn = false;
 
@@ -1690,6 +1949,13 @@ static bool execIndexAssign(Interpreter* interpreter) {
 		}
 	}
 
+	unpackCompound(&compound);
+	unpackCompound(&assign);
+
+	if (!freeIdn) {
+		idn = compound; //nested compounds are assigned back through idn
+	}
+
 	if (!IS_ARRAY(compound) && !IS_DICTIONARY(compound) && !IS_STRING(compound)) {
 		interpreter->errorOutput("Unknown compound found in index assigning notation\n");
 		freeLiteral(assign);
@@ -1879,128 +2145,654 @@ static bool execIndexAssign(Interpreter* interpreter) {
 	return true;
 }
 
-//the heart of toy
-static void execInterpreter(Interpreter* interpreter) {
-	//set the starting point for the interpreter
-	if (interpreter->codeStart == -1) {
-		interpreter->codeStart = interpreter->count;
+//for-in loops
+//NOTE: the loop walks the collection as it was when the loop began - changes made by the body don't affect the iteration, since writes replace the variable's value
+static bool execIterBegin(Interpreter* interpreter) {
+	Literal iterator = interpreter->literalCache.literals[ readVarint(interpreter->bytecode, &interpreter->count) ];
+	Literal first = interpreter->literalCache.literals[ readVarint(interpreter->bytecode, &interpreter->count) ];
+	Literal second = interpreter->literalCache.literals[ readVarint(interpreter->bytecode, &interpreter->count) ];
+
+	Literal collection = popLiteralArray(&interpreter->stack);
+
+	Literal collectionIdn = collection;
+	if (IS_IDENTIFIER(collection) && parseIdentifierToValue(interpreter, &collection)) {
+		freeLiteral(collectionIdn);
+	}
+	else if (IS_ARRAY(collection) || IS_DICTIONARY(collection)) {
+		parseCompoundToPureValues(interpreter, &collection);
 	}
 
-	unsigned char opcode = readByte(interpreter->bytecode, &interpreter->count);
+	if (!IS_ARRAY(collection) && !IS_DICTIONARY(collection) && !IS_PACKED_ARRAY(collection)) {
+		interpreter->errorOutput("Can only iterate over arrays and dictionaries, found: ");
+		printLiteralCustom(collection, interpreter->errorOutput);
+		interpreter->errorOutput("\n");
+		freeLiteral(collection);
+		return false;
+	}
 
-	while(opcode != OP_EOF && opcode != OP_SECTION_END && !interpreter->panic) {
-		switch(opcode) {
-			case OP_ASSERT:
-				if (!execAssert(interpreter)) {
-					return;
-				}
-			break;
+	//the loop variables
+	Literal type = TO_TYPE_LITERAL(LITERAL_ANY, false);
 
-			case OP_PRINT:
-				if (!execPrint(interpreter)) {
-					return;
-				}
-			break;
+	if (!declareScopeVariable(interpreter->scope, first, type) || (!IS_NULL(second) && !declareScopeVariable(interpreter->scope, second, type))) {
+		interpreter->errorOutput("Can't redefine the variable \"");
+		printLiteralCustom(IS_NULL(second) ? first : second, interpreter->errorOutput);
+		interpreter->errorOutput("\" in a for-in loop\n");
+		freeLiteral(collection);
+		return false;
+	}
 
-			case OP_LITERAL:
-			case OP_LITERAL_LONG:
-				if (!execPushLiteral(interpreter, opcode == OP_LITERAL_LONG)) {
-					return;
-				}
-			break;
+	//the state is [collection, position, first, second]
+	LiteralArray* state = ALLOCATE(LiteralArray, 1);
+	initLiteralArray(state);
 
-			case OP_LITERAL_RAW:
-				if (!rawLiteral(interpreter)) {
-					return;
-				}
-			break;
+	pushLiteralArray(state, TO_NULL_LITERAL);
+	pushLiteralArray(state, TO_INTEGER_LITERAL(0));
+	pushLiteralArray(state, first);
+	pushLiteralArray(state, second);
 
-			case OP_NEGATE:
-				if (!execNegate(interpreter)) {
-					return;
-				}
-			break;
+	state->literals[0] = collection; //moved in, not copied
 
-			case OP_ADDITION:
-			case OP_SUBTRACTION:
-			case OP_MULTIPLICATION:
-			case OP_DIVISION:
-			case OP_MODULO:
-				if (!execArithmetic(interpreter, opcode)) {
-					return;
-				}
-			break;
+	declareScopeVariable(interpreter->scope, iterator, type);
+	*getLiteralDictionaryRef(&interpreter->scope->variables, iterator) = TO_ARRAY_LITERAL(state);
 
-			case OP_VAR_ADDITION_ASSIGN:
-			case OP_VAR_SUBTRACTION_ASSIGN:
-			case OP_VAR_MULTIPLICATION_ASSIGN:
-			case OP_VAR_DIVISION_ASSIGN:
-			case OP_VAR_MODULO_ASSIGN:
-				execVarArithmeticAssign(interpreter);
-				if (!execArithmetic(interpreter, opcode)) {
-					freeLiteral(popLiteralArray(&interpreter->stack));
-					return;
-				}
-				if (!execVarAssign(interpreter)) {
-					return;
-				}
-			break;
+	return true;
+}
 
-			case OP_GROUPING_BEGIN:
-				execInterpreter(interpreter);
-			break;
+//breaks and continues can leave the body's scopes behind, so drop back to the loop's own scope
+static LiteralArray* unwindToIterator(Interpreter* interpreter, Literal iterator) {
+	while (interpreter->scope != NULL) {
+		Literal* statePtr = getLiteralDictionaryRef(&interpreter->scope->variables, iterator);
 
-			case OP_GROUPING_END:
-				return;
+		if (statePtr != NULL) {
+			return AS_ARRAY(*statePtr);
+		}
 
-			//scope
-			case OP_SCOPE_BEGIN:
-				interpreter->scope = pushScope(interpreter->scope);
-			break;
+		interpreter->scope = popScope(interpreter->scope);
+	}
 
-			case OP_SCOPE_END:
-				interpreter->scope = popScope(interpreter->scope);
-			break;
+	interpreter->errorOutput("[internal] Lost track of a for-in loop\n");
+	return NULL;
+}
 
-			//TODO: custom type declarations?
+//the element is handed over without copying
+static void bindIteratorVariable(Interpreter* interpreter, Literal identifier, Literal value) {
+	Literal* slot = getLiteralDictionaryRef(&interpreter->scope->variables, identifier);
 
-			case OP_VAR_DECL:
-			case OP_VAR_DECL_LONG:
-				if (!execVarDecl(interpreter, opcode == OP_VAR_DECL_LONG)) {
-					return;
-				}
-			break;
+	freeLiteral(*slot);
+	*slot = value;
+}
 
-			case OP_FN_DECL:
-			case OP_FN_DECL_LONG:
-				if (!execFnDecl(interpreter, opcode == OP_FN_DECL_LONG)) {
-					return;
-				}
-			break;
+static bool execIterNext(Interpreter* interpreter) {
+	Literal iterator = interpreter->literalCache.literals[ readVarint(interpreter->bytecode, &interpreter->count) ];
 
-			case OP_VAR_ASSIGN:
-				if (!execVarAssign(interpreter)) {
-					return;
-				}
-			break;
+	LiteralArray* state = unwindToIterator(interpreter, iterator);
 
-			case OP_TYPE_CAST:
-				if (!execValCast(interpreter)) {
-					return;
-				}
-			break;
+	if (state == NULL) {
+		return false;
+	}
 
-			case OP_TYPE_OF:
-				if (!execTypeOf(interpreter)) {
-					return;
-				}
-			break;
+	Literal collection = state->literals[0];
+	int position = AS_INTEGER(state->literals[1]);
+	Literal first = state->literals[2];
+	Literal second = state->literals[3];
 
-			case OP_COMPARE_EQUAL:
-				if (!execCompareEqual(interpreter, false)) {
-					return;
-				}
-			break;
+	if (IS_ARRAY(collection)) {
+		LiteralArray* array = AS_ARRAY(collection);
+
+		if (position >= array->count) {
+			pushLiteralArray(&interpreter->stack, TO_BOOLEAN_LITERAL(false));
+			return true;
+		}
+
+		//the collection belongs to the loop, so each element can be moved out - unless it's shared
+		Literal element = array->literals[position];
+		if (array->frozen) {
+			element = copyLiteral(element);
+		}
+		else {
+			array->literals[position] = TO_NULL_LITERAL;
+		}
+
+		if (IS_NULL(second)) {
+			bindIteratorVariable(interpreter, first, element);
+		}
+		else {
+			bindIteratorVariable(interpreter, first, TO_INTEGER_LITERAL(position));
+			bindIteratorVariable(interpreter, second, element);
+		}
+
+		position++;
+	}
+	else if (IS_PACKED_ARRAY(collection)) {
+		PackedArray* array = AS_PACKED_ARRAY(collection);
+
+		if (position >= array->count) {
+			pushLiteralArray(&interpreter->stack, TO_BOOLEAN_LITERAL(false));
+			return true;
+		}
+
+		//boxed as it's bound
+		if (IS_NULL(second)) {
+			bindIteratorVariable(interpreter, first, getPackedArray(array, position));
+		}
+		else {
+			bindIteratorVariable(interpreter, first, TO_INTEGER_LITERAL(position));
+			bindIteratorVariable(interpreter, second, getPackedArray(array, position));
+		}
+
+		position++;
+	}
+	else {
+		LiteralDictionary* dictionary = AS_DICTIONARY(collection);
+
+		//skip the empty slots and tombstones
+		while (position < dictionary->capacity && IS_NULL(dictionary->entries[position].key)) {
+			position++;
+		}
+
+		if (position >= dictionary->capacity) {
+			state->literals[1] = TO_INTEGER_LITERAL(position);
+			pushLiteralArray(&interpreter->stack, TO_BOOLEAN_LITERAL(false));
+			return true;
+		}
+
+		Literal key = dictionary->entries[position].key;
+		Literal value = dictionary->entries[position].value;
+		if (dictionary->frozen) {
+			key = copyLiteral(key);
+			value = copyLiteral(value);
+		}
+		else {
+			dictionary->entries[position].key = TO_NULL_LITERAL;
+			dictionary->entries[position].value = TO_NULL_LITERAL;
+		}
+
+		bindIteratorVariable(interpreter, first, key);
+
+		if (IS_NULL(second)) {
+			freeLiteral(value);
+		}
+		else {
+			bindIteratorVariable(interpreter, second, value);
+		}
+
+		position++;
+	}
+
+	state->literals[1] = TO_INTEGER_LITERAL(position);
+	pushLiteralArray(&interpreter->stack, TO_BOOLEAN_LITERAL(true));
+
+	return true;
+}
+
+static bool execIterEnd(Interpreter* interpreter) {
+	Literal iterator = interpreter->literalCache.literals[ readVarint(interpreter->bytecode, &interpreter->count) ];
+
+	//the loop's scope, and the state with it, is released by the following OP_SCOPE_END
+	return unwindToIterator(interpreter, iterator) != NULL;
+}
+
+//record fields
+static void fieldError(Interpreter* interpreter, const char* message, Literal name, Literal target) {
+	interpreter->errorOutput(message);
+	interpreter->errorOutput(" \"");
+	printLiteralCustom(name, interpreter->errorOutput);
+	interpreter->errorOutput("\" of ");
+
+	if (IS_RECORD(target)) {
+		interpreter->errorOutput("record \"");
+		printLiteralCustom(AS_RECORD(target)->layout->name, interpreter->errorOutput);
+		interpreter->errorOutput("\"\n");
+	}
+	else {
+		interpreter->errorOutput("a non-record: ");
+		printLiteralCustom(target, interpreter->errorOutput);
+		interpreter->errorOutput("\n");
+	}
+}
+
+//the step's slot is stored off by one, so unknown slots fit in a varint
+static Literal* readFieldStep(Interpreter* interpreter, Literal* target) {
+	Literal name = interpreter->literalCache.literals[ readVarint(interpreter->bytecode, &interpreter->count) ];
+	int slot = (int)readVarint(interpreter->bytecode, &interpreter->count) - 1;
+
+	int index = IS_RECORD(*target) ? findRecordField(AS_RECORD(*target)->layout, name, slot) : -1;
+
+	if (index < 0) {
+		fieldError(interpreter, IS_RECORD(*target) ? "Unknown field" : "Can't access the field", name, *target);
+		return NULL;
+	}
+
+	return &AS_RECORD(*target)->fields[index];
+}
+
+static bool execFieldGet(Interpreter* interpreter) {
+	Literal base = popLiteralArray(&interpreter->stack);
+
+	//read straight out of the variable, rather than copying the whole record first
+	Literal* target = &base;
+	if (IS_IDENTIFIER(base)) {
+		target = getScopeVariableRef(interpreter->scope, base);
+
+		if (target == NULL) {
+			interpreter->errorOutput("Undeclared variable ");
+			printLiteralCustom(base, interpreter->errorOutput);
+			interpreter->errorOutput("\n");
+			freeLiteral(base);
+			return false;
+		}
+	}
+
+	Literal* field = readFieldStep(interpreter, target);
+
+	if (field != NULL) {
+		pushLiteralArray(&interpreter->stack, *field);
+	}
+
+	freeLiteral(base);
+
+	return field != NULL;
+}
+
+//records are written in place, since nothing else can hold the same one
+static bool execFieldSet(Interpreter* interpreter) {
+	Opcode opcode = (Opcode)readByte(interpreter->bytecode, &interpreter->count);
+	int count = (int)readVarint(interpreter->bytecode, &interpreter->count);
+
+	Literal value = popLiteralArray(&interpreter->stack);
+	Literal idn = popLiteralArray(&interpreter->stack);
+
+	if (IS_IDENTIFIER(value)) {
+		Literal valueIdn = value;
+		parseIdentifierToValue(interpreter, &value);
+		freeLiteral(valueIdn);
+	}
+
+	if (IS_ARRAY(value) || IS_DICTIONARY(value)) {
+		parseCompoundToPureValues(interpreter, &value);
+	}
+
+	Literal* target = getScopeVariableWriteRef(interpreter->scope, idn);
+
+	if (target == NULL) {
+		interpreter->errorOutput("Undeclared variable \"");
+		printLiteralCustom(idn, interpreter->errorOutput);
+		interpreter->errorOutput("\"\n");
+		freeLiteral(value);
+		freeLiteral(idn);
+		return false;
+	}
+
+	//the variable's own constness covers its fields
+	Literal type = getScopeType(interpreter->scope, idn);
+	bool constant = AS_TYPE(type).constant;
+	freeLiteral(type);
+
+	if (constant) {
+		interpreter->errorOutput("Can't assign to a field of the constant \"");
+		printLiteralCustom(idn, interpreter->errorOutput);
+		interpreter->errorOutput("\"\n");
+		freeLiteral(value);
+		freeLiteral(idn);
+		return false;
+	}
+
+	Literal* owner = NULL;
+	for (int i = 0; i < count && target != NULL; i++) {
+		owner = target;
+		target = readFieldStep(interpreter, owner);
+	}
+
+	if (target == NULL) {
+		freeLiteral(value);
+		freeLiteral(idn);
+		return false;
+	}
+
+	//compound assignment uses the usual arithmetic
+	if (opcode != OP_VAR_ASSIGN) {
+		pushLiteralArray(&interpreter->stack, *target);
+		pushLiteralArray(&interpreter->stack, value);
+		freeLiteral(value);
+
+		if (!execArithmetic(interpreter, opcode)) {
+			freeLiteral(idn);
+			return false;
+		}
+
+		value = popLiteralArray(&interpreter->stack);
+	}
+
+	RecordLayout* layout = AS_RECORD(*owner)->layout;
+	Literal fieldType = layout->types[target - AS_RECORD(*owner)->fields];
+
+	//BUGFIX: allow easy coercion on assign
+	if (AS_TYPE(fieldType).typeOf == LITERAL_FLOAT && IS_INTEGER(value)) {
+		value = TO_FLOAT_LITERAL(AS_INTEGER(value));
+	}
+
+	if (!checkLiteralType(fieldType, *target, value, true)) {
+		fieldError(interpreter, "Incorrect type assigned to field", layout->names[target - AS_RECORD(*owner)->fields], *owner);
+		freeLiteral(value);
+		freeLiteral(idn);
+		return false;
+	}
+
+	freeLiteral(*target);
+	*target = value; //moved in
+
+	freeLiteral(idn);
+
+	return true;
+}
+
+//switch statements
+static Literal popSwitchValue(Interpreter* interpreter) {
+	Literal value = popLiteralArray(&interpreter->stack);
+
+	if (IS_IDENTIFIER(value)) {
+		Literal idn = value;
+		parseIdentifierToValue(interpreter, &value);
+		freeLiteral(idn);
+	}
+
+	return value;
+}
+
+static bool jumpToSwitchTarget(Interpreter* interpreter, int target) {
+	if (target < 0 || target + interpreter->codeStart > interpreter->length) {
+		interpreter->errorOutput("[internal] Jump out of range (switch)\n");
+		return false;
+	}
+
+	interpreter->count = target + interpreter->codeStart;
+
+	return true;
+}
+
+static bool execSwitchTable(Interpreter* interpreter) {
+	int low = readInt(interpreter->bytecode, &interpreter->count);
+	int length = (int)readVarint(interpreter->bytecode, &interpreter->count);
+	int targets = interpreter->count; //the default, then one for each slot
+
+	Literal value = popSwitchValue(interpreter);
+
+	int slot = 0; //the default
+	if (IS_INTEGER(value) && AS_INTEGER(value) >= low && (long long)AS_INTEGER(value) - low < length) {
+		slot = AS_INTEGER(value) - low + 1;
+	}
+
+	freeLiteral(value);
+
+	int count = targets + slot * sizeof(int);
+	return jumpToSwitchTarget(interpreter, readInt(interpreter->bytecode, &count));
+}
+
+static bool execSwitchSearch(Interpreter* interpreter) {
+	int length = (int)readVarint(interpreter->bytecode, &interpreter->count);
+	int target = readInt(interpreter->bytecode, &interpreter->count); //the default
+	int pairs = interpreter->count; //a key and a target each
+
+	Literal value = popSwitchValue(interpreter);
+
+	if (IS_INTEGER(value)) {
+		int key = AS_INTEGER(value);
+		int low = 0;
+		int high = length - 1;
+
+		while (low <= high) {
+			int mid = low + (high - low) / 2;
+			int count = pairs + mid * sizeof(int) * 2;
+			int candidate = readInt(interpreter->bytecode, &count);
+
+			if (candidate == key) {
+				target = readInt(interpreter->bytecode, &count);
+				break;
+			}
+			else if (candidate < key) {
+				low = mid + 1;
+			}
+			else {
+				high = mid - 1;
+			}
+		}
+	}
+
+	freeLiteral(value);
+
+	return jumpToSwitchTarget(interpreter, target);
+}
+
+static bool execSwitchHash(Interpreter* interpreter) {
+	Literal dictionary = interpreter->literalCache.literals[ readVarint(interpreter->bytecode, &interpreter->count) ];
+	int target = readInt(interpreter->bytecode, &interpreter->count); //the default
+	int length = (int)readVarint(interpreter->bytecode, &interpreter->count);
+	int targets = interpreter->count; //one for each case
+
+	Literal value = popSwitchValue(interpreter);
+
+	//only constants can match, so anything else skips the lookup
+	if (IS_BOOLEAN(value) || IS_INTEGER(value) || IS_FLOAT(value) || IS_STRING(value)) {
+		Literal* index = getLiteralDictionaryRef(AS_DICTIONARY(dictionary), value);
+
+		if (index != NULL && IS_INTEGER(*index) && AS_INTEGER(*index) < length) {
+			int count = targets + AS_INTEGER(*index) * sizeof(int);
+			target = readInt(interpreter->bytecode, &count);
+		}
+	}
+
+	freeLiteral(value);
+
+	return jumpToSwitchTarget(interpreter, target);
+}
+
+//out of fuel - hand control back to the host, until it resumes or cancels the run
+static void suspendInterpreter(Interpreter* interpreter) {
+	Budget* budget = interpreter->budget;
+
+	//only a run started with a budget has somewhere to return to (i.e. not callFn() from the host)
+	if (!budget->running) {
+		budget->fuel = 0;
+		return;
+	}
+
+	budget->suspended = true;
+	yieldFiber(budget->fiber);
+	budget->suspended = false;
+
+	//the instruction about to run counts against the new fuel
+	budget->fuel--;
+
+	if (budget->cancelled) {
+		interpreter->panic = true;
+	}
+}
+
+//the heart of toy
+static void execInterpreter(Interpreter* interpreter) {
+	//set the starting point for the interpreter
+	if (interpreter->codeStart == -1) {
+		interpreter->codeStart = interpreter->count;
+	}
+
+	unsigned char opcode = readByte(interpreter->bytecode, &interpreter->count);
+
+	while(opcode != OP_EOF && opcode != OP_SECTION_END && !interpreter->panic) {
+		//NOTE: checked between instructions, so a suspended run can pick up where it left off
+		if (interpreter->budget != NULL && interpreter->budget->fuel-- <= 0) {
+			suspendInterpreter(interpreter);
+
+			if (interpreter->panic) {
+				break;
+			}
+		}
+
+		switch(opcode) {
+			case OP_ASSERT:
+				if (!execAssert(interpreter)) {
+					return;
+				}
+			break;
+
+			case OP_PRINT:
+				if (!execPrint(interpreter)) {
+					return;
+				}
+			break;
+
+			case OP_YIELD:
+				if (!execYield(interpreter)) {
+					return;
+				}
+			break;
+
+			case OP_ITER_BEGIN:
+				if (!execIterBegin(interpreter)) {
+					return;
+				}
+			break;
+
+			case OP_ITER_NEXT:
+				if (!execIterNext(interpreter)) {
+					return;
+				}
+			break;
+
+			case OP_ITER_END:
+				if (!execIterEnd(interpreter)) {
+					return;
+				}
+			break;
+
+			case OP_FIELD_GET:
+				if (!execFieldGet(interpreter)) {
+					return;
+				}
+			break;
+
+			case OP_FIELD_SET:
+				if (!execFieldSet(interpreter)) {
+					return;
+				}
+			break;
+
+			case OP_SWITCH_TABLE:
+				if (!execSwitchTable(interpreter)) {
+					return;
+				}
+			break;
+
+			case OP_SWITCH_SEARCH:
+				if (!execSwitchSearch(interpreter)) {
+					return;
+				}
+			break;
+
+			case OP_SWITCH_HASH:
+				if (!execSwitchHash(interpreter)) {
+					return;
+				}
+			break;
+
+			case OP_LITERAL:
+			case OP_LITERAL_LONG:
+				if (!execPushLiteral(interpreter, opcode == OP_LITERAL_LONG)) {
+					return;
+				}
+			break;
+
+			case OP_LITERAL_RAW:
+				if (!rawLiteral(interpreter)) {
+					return;
+				}
+			break;
+
+			case OP_NEGATE:
+				if (!execNegate(interpreter)) {
+					return;
+				}
+			break;
+
+			case OP_ADDITION:
+			case OP_SUBTRACTION:
+			case OP_MULTIPLICATION:
+			case OP_DIVISION:
+			case OP_MODULO:
+				if (!execArithmetic(interpreter, opcode)) {
+					return;
+				}
+			break;
+
+			case OP_VAR_ADDITION_ASSIGN:
+			case OP_VAR_SUBTRACTION_ASSIGN:
+			case OP_VAR_MULTIPLICATION_ASSIGN:
+			case OP_VAR_DIVISION_ASSIGN:
+			case OP_VAR_MODULO_ASSIGN:
+				execVarArithmeticAssign(interpreter);
+				if (!execArithmetic(interpreter, opcode)) {
+					freeLiteral(popLiteralArray(&interpreter->stack));
+					return;
+				}
+				if (!execVarAssign(interpreter)) {
+					return;
+				}
+			break;
+
+			case OP_GROUPING_BEGIN:
+				execInterpreter(interpreter);
+			break;
+
+			case OP_GROUPING_END:
+				return;
+
+			//scope
+			case OP_SCOPE_BEGIN:
+				interpreter->scope = pushScopeFromPool(interpreter->scopePool, interpreter->scope);
+			break;
+
+			case OP_SCOPE_END:
+				interpreter->scope = popScope(interpreter->scope);
+			break;
+
+			//TODO: custom type declarations?
+
+			case OP_VAR_DECL:
+			case OP_VAR_DECL_LONG:
+				if (!execVarDecl(interpreter, opcode == OP_VAR_DECL_LONG)) {
+					return;
+				}
+			break;
+
+			case OP_FN_DECL:
+			case OP_FN_DECL_LONG:
+				if (!execFnDecl(interpreter, opcode == OP_FN_DECL_LONG)) {
+					return;
+				}
+			break;
+
+			case OP_VAR_ASSIGN:
+				if (!execVarAssign(interpreter)) {
+					return;
+				}
+			break;
+
+			case OP_TYPE_CAST:
+				if (!execValCast(interpreter)) {
+					return;
+				}
+			break;
+
+			case OP_TYPE_OF:
+				if (!execTypeOf(interpreter)) {
+					return;
+				}
+			break;
+
+			case OP_COMPARE_EQUAL:
+				if (!execCompareEqual(interpreter, false)) {
+					return;
+				}
+			break;
 
 			case OP_COMPARE_NOT_EQUAL:
 				if (!execCompareEqual(interpreter, true)) {
@@ -2128,10 +2920,10 @@ static void execInterpreter(Interpreter* interpreter) {
 
 static void readInterpreterSections(Interpreter* interpreter) {
 	//data section
-	const unsigned short literalCount = readShort(interpreter->bytecode, &interpreter->count);
+	const int literalCount = (int)readVarint(interpreter->bytecode, &interpreter->count);
 
 #ifndef TOY_EXPORT
-	if (command.verbose) {
+	if (interpreter->verbose) {
 		printf(NOTICE "Reading %d literals\n" RESET, literalCount);
 	}
 #endif
@@ -2145,7 +2937,7 @@ static void readInterpreterSections(Interpreter* interpreter) {
 				pushLiteralArray(&interpreter->literalCache, TO_NULL_LITERAL);
 
 #ifndef TOY_EXPORT
-				if (command.verbose) {
+				if (interpreter->verbose) {
 					printf("(null)\n");
 				}
 #endif
@@ -2159,7 +2951,7 @@ static void readInterpreterSections(Interpreter* interpreter) {
 				freeLiteral(literal);
 
 #ifndef TOY_EXPORT
-				if (command.verbose) {
+				if (interpreter->verbose) {
 					printf("(boolean %s)\n", b ? "true" : "false");
 				}
 #endif
@@ -2173,7 +2965,7 @@ static void readInterpreterSections(Interpreter* interpreter) {
 				freeLiteral(literal);
 
 #ifndef TOY_EXPORT
-				if (command.verbose) {
+				if (interpreter->verbose) {
 					printf("(integer %d)\n", d);
 				}
 #endif
@@ -2187,7 +2979,7 @@ static void readInterpreterSections(Interpreter* interpreter) {
 				freeLiteral(literal);
 
 #ifndef TOY_EXPORT
-				if (command.verbose) {
+				if (interpreter->verbose) {
 					printf("(float %f)\n", f);
 				}
 #endif
@@ -2202,7 +2994,7 @@ static void readInterpreterSections(Interpreter* interpreter) {
 				freeLiteral(literal);
 
 #ifndef TOY_EXPORT
-				if (command.verbose) {
+				if (interpreter->verbose) {
 					printf("(string \"%s\")\n", s);
 				}
 #endif
@@ -2213,16 +3005,16 @@ static void readInterpreterSections(Interpreter* interpreter) {
 				LiteralArray* array = ALLOCATE(LiteralArray, 1);
 				initLiteralArray(array);
 
-				unsigned short length = readShort(interpreter->bytecode, &interpreter->count);
+				int length = (int)readVarint(interpreter->bytecode, &interpreter->count);
 
 				//read each index, then unpack the value from the existing literal cache
 				for (int i = 0; i < length; i++) {
-					int index = readShort(interpreter->bytecode, &interpreter->count);
+					int index = (int)readVarint(interpreter->bytecode, &interpreter->count);
 					pushLiteralArray(array, interpreter->literalCache.literals[index]);
 				}
 
 #ifndef TOY_EXPORT
-				if (command.verbose) {
+				if (interpreter->verbose) {
 					printf("(array ");
 					Literal literal = TO_ARRAY_LITERAL(array);
 					printLiteral(literal);
@@ -2243,17 +3035,17 @@ static void readInterpreterSections(Interpreter* interpreter) {
 				LiteralDictionary* dictionary = ALLOCATE(LiteralDictionary, 1);
 				initLiteralDictionary(dictionary);
 
-				unsigned short length = readShort(interpreter->bytecode, &interpreter->count);
+				int length = (int)readVarint(interpreter->bytecode, &interpreter->count);
 
 				//read each index, then unpack the value from the existing literal cache
 				for (int i = 0; i < length / 2; i++) {
-					int key = readShort(interpreter->bytecode, &interpreter->count);
-					int val = readShort(interpreter->bytecode, &interpreter->count);
+					int key = (int)readVarint(interpreter->bytecode, &interpreter->count);
+					int val = (int)readVarint(interpreter->bytecode, &interpreter->count);
 					setLiteralDictionary(dictionary, interpreter->literalCache.literals[key], interpreter->literalCache.literals[val]);
 				}
 
 #ifndef TOY_EXPORT
-				if (command.verbose) {
+				if (interpreter->verbose) {
 					printf("(dictionary ");
 					Literal literal = TO_DICTIONARY_LITERAL(dictionary);
 					printLiteral(literal);
@@ -2272,7 +3064,7 @@ static void readInterpreterSections(Interpreter* interpreter) {
 
 			case LITERAL_FUNCTION: {
 				//read the index
-				unsigned short index = readShort(interpreter->bytecode, &interpreter->count);
+				int index = (int)readVarint(interpreter->bytecode, &interpreter->count);
 				Literal literal = TO_INTEGER_LITERAL(index);
 
 				//change the type, to read it PROPERLY below
@@ -2282,7 +3074,7 @@ static void readInterpreterSections(Interpreter* interpreter) {
 				pushLiteralArray(&interpreter->literalCache, literal);
 
 #ifndef TOY_EXPORT
-				if (command.verbose) {
+				if (interpreter->verbose) {
 					printf("(function)\n");
 				}
 #endif
@@ -2298,7 +3090,7 @@ static void readInterpreterSections(Interpreter* interpreter) {
 				pushLiteralArray(&interpreter->literalCache, identifier);
 
 #ifndef TOY_EXPORT
-				if (command.verbose) {
+				if (interpreter->verbose) {
 					printf("(identifier %s (hash: %x))\n", toCString(AS_IDENTIFIER(identifier)), identifier.as.identifier.hash);
 				}
 #endif
@@ -2318,7 +3110,7 @@ static void readInterpreterSections(Interpreter* interpreter) {
 				pushLiteralArray(&interpreter->literalCache, typeLiteral);
 
 #ifndef TOY_EXPORT
-				if (command.verbose) {
+				if (interpreter->verbose) {
 					printf("(type ");
 					printLiteral(typeLiteral);
 					printf(")\n");
@@ -2336,14 +3128,14 @@ static void readInterpreterSections(Interpreter* interpreter) {
 
 				//if it's an array type
 				if (AS_TYPE(typeLiteral).typeOf == LITERAL_ARRAY) {
-					unsigned short vt = readShort(interpreter->bytecode, &interpreter->count);
+					int vt = (int)readVarint(interpreter->bytecode, &interpreter->count);
 
 					TYPE_PUSH_SUBTYPE(&typeLiteral, copyLiteral(interpreter->literalCache.literals[vt]));
 				}
 
 				if (AS_TYPE(typeLiteral).typeOf == LITERAL_DICTIONARY) {
-					unsigned short kt = readShort(interpreter->bytecode, &interpreter->count);
-					unsigned short vt = readShort(interpreter->bytecode, &interpreter->count);
+					int kt = (int)readVarint(interpreter->bytecode, &interpreter->count);
+					int vt = (int)readVarint(interpreter->bytecode, &interpreter->count);
 
 					TYPE_PUSH_SUBTYPE(&typeLiteral, copyLiteral(interpreter->literalCache.literals[kt]));
 					TYPE_PUSH_SUBTYPE(&typeLiteral, copyLiteral(interpreter->literalCache.literals[vt]));
@@ -2353,7 +3145,7 @@ static void readInterpreterSections(Interpreter* interpreter) {
 				pushLiteralArray(&interpreter->literalCache, typeLiteral); //copied
 
 #ifndef TOY_EXPORT
-				if (command.verbose) {
+				if (interpreter->verbose) {
 					printf("(type ");
 					printLiteral(typeLiteral);
 					printf(")\n");
@@ -2368,35 +3160,40 @@ static void readInterpreterSections(Interpreter* interpreter) {
 
 	consumeByte(interpreter, OP_SECTION_END, interpreter->bytecode, &interpreter->count); //terminate the literal section
 
-	//read the function metadata
-	int functionCount = readShort(interpreter->bytecode, &interpreter->count);
-	int functionSize = readShort(interpreter->bytecode, &interpreter->count); //might not be needed
-
-	//read in the functions
-	for (int i = 0; i < interpreter->literalCache.count; i++) {
-		if (interpreter->literalCache.literals[i].type == LITERAL_FUNCTION_INTERMEDIATE) {
-			//get the size of the function
-			size_t size = (size_t)readShort(interpreter->bytecode, &interpreter->count);
-
-			//read the function code (literal cache and all)
-			unsigned char* bytes = ALLOCATE(unsigned char, size);
-			memcpy(bytes, interpreter->bytecode + interpreter->count, size); //TODO: -1 for the ending mark
-			interpreter->count += size;
-
-			//assert that the last memory slot is function end
-			if (bytes[size - 1] != OP_FN_END) {
-				interpreter->errorOutput("[internal] Failed to find function end");
-				FREE_ARRAY(unsigned char, bytes, size);
-				return;
-			}
+	//read the function metadata - the bodies are only located when they're declared
+	interpreter->functionCount = (int)readVarint(interpreter->bytecode, &interpreter->count);
+	interpreter->functionTable = interpreter->count;
+
+	//skip the offset table and the bodies
+	interpreter->count += sizeof(int) * (interpreter->functionCount + 1);
+	interpreter->count += readFunctionOffset(interpreter, interpreter->functionCount);
+
+	consumeByte(interpreter, OP_SECTION_END, interpreter->bytecode, &interpreter->count); //terminate the function section
+}
+
+static bool readInterpreterHeader(Interpreter* interpreter) {
+	const unsigned char major = readByte(interpreter->bytecode, &interpreter->count);
+	const unsigned char minor = readByte(interpreter->bytecode, &interpreter->count);
+	const unsigned char patch = readByte(interpreter->bytecode, &interpreter->count);
+
+	if (major != TOY_VERSION_MAJOR || minor != TOY_VERSION_MINOR || patch != TOY_VERSION_PATCH) {
+		interpreter->errorOutput("Interpreter/bytecode version mismatch\n");
+		return false;
+	}
 
-			//change the type to normal
-			interpreter->literalCache.literals[i] = TO_FUNCTION_LITERAL(bytes, size);
-			AS_FUNCTION(interpreter->literalCache.literals[i]).scope = NULL;
+	const char* build = readString(interpreter->bytecode, &interpreter->count);
+
+#ifndef TOY_EXPORT
+	if (interpreter->verbose) {
+		if (build[0] != '\0' && strncmp(build, TOY_VERSION_BUILD, strlen(TOY_VERSION_BUILD))) {
+			printf(WARN "Warning: interpreter/bytecode build mismatch\n" RESET);
 		}
 	}
+#endif
 
-	consumeByte(interpreter, OP_SECTION_END, interpreter->bytecode, &interpreter->count); //terminate the function section
+	consumeByte(interpreter, OP_SECTION_END, interpreter->bytecode, &interpreter->count);
+
+	return true;
 }
 
 //exposed functions
@@ -2414,11 +3211,99 @@ void initInterpreter(Interpreter* interpreter) {
 	setInterpreterAssert(interpreter, assertWrapper);
 	setInterpreterError(interpreter, errorWrapper);
 
+	//options are per-interpreter, so they can differ between threads
+#ifndef TOY_EXPORT
+	interpreter->verbose = command.verbose;
+#else
+	interpreter->verbose = false;
+#endif
+
+	interpreter->budget = NULL;
+	interpreter->coroutine = NULL;
+
+	interpreter->scopePool = createScopePool();
 	interpreter->scope = NULL;
 	resetInterpreter(interpreter);
 }
 
-void runInterpreter(Interpreter* interpreter, unsigned char* bytecode, int length) {
+//runs once the last instruction is done, whether or not the run was suspended along the way
+static void finishRun(Interpreter* interpreter, bool ownsBytecode, bool borrowsProgram) {
+	//BUGFIX: clear the stack (for repl - stack must be balanced)
+	while(interpreter->stack.count > 0) {
+		Literal lit = popLiteralArray(&interpreter->stack);
+		freeLiteral(lit);
+	}
+
+	freeLiteralArray(&interpreter->stack);
+
+	if (borrowsProgram) {
+		//hand back the borrowed cache
+		initLiteralArray(&interpreter->literalCache);
+		return;
+	}
+
+	//free the bytecode immediately after use TODO: because why?
+	if (ownsBytecode) {
+		FREE_ARRAY(unsigned char, interpreter->bytecode, interpreter->length);
+	}
+
+	//free the associated data
+	freeLiteralArray(&interpreter->literalCache);
+}
+
+static void runBudgetedFiber(void* userdata) {
+	execInterpreter((Interpreter*)userdata);
+}
+
+//returns true once the run is over
+static bool continueRun(Interpreter* interpreter) {
+	Budget* budget = interpreter->budget;
+
+	budget->running = true;
+	bool suspended = resumeFiber(budget->fiber);
+	budget->running = false;
+
+	if (suspended) {
+		return false;
+	}
+
+	freeFiber(budget->fiber);
+	budget->fiber = NULL;
+
+	finishRun(interpreter, budget->ownsBytecode, budget->borrowsProgram);
+
+	return true;
+}
+
+//with a budget, the run gets a stack of its own, so it can be suspended part way through
+static void startRun(Interpreter* interpreter, bool ownsBytecode, bool borrowsProgram) {
+	Budget* budget = interpreter->budget;
+
+	if (budget == NULL) {
+		execInterpreter(interpreter);
+		finishRun(interpreter, ownsBytecode, borrowsProgram);
+		return;
+	}
+
+	budget->fuel = budget->limit;
+	budget->suspended = false;
+	budget->cancelled = false;
+	budget->ownsBytecode = ownsBytecode;
+	budget->borrowsProgram = borrowsProgram;
+	budget->fiber = createFiber(runBudgetedFiber, interpreter, FIBER_STACK_SIZE);
+
+	continueRun(interpreter);
+}
+
+static void runInterpreterOpt(Interpreter* interpreter, unsigned char* bytecode, int length, bool owned) {
+#ifndef TOY_EXPORT
+	//for measuring the time to first instruction
+	clock_t startup = clock();
+#endif
+
+	//a suspended run is abandoned, since its state is about to be replaced
+	cancelInterpreter(interpreter);
+
 	//initialize here instead of initInterpreter()
 	initLiteralArray(&interpreter->literalCache);
 	interpreter->bytecode = NULL;
@@ -2447,62 +3332,123 @@ void runInterpreter(Interpreter* interpreter, unsigned char* bytecode, int lengt
 	}
 
 	//header section
-	const unsigned char major = readByte(interpreter->bytecode, &interpreter->count);
-	const unsigned char minor = readByte(interpreter->bytecode, &interpreter->count);
-	const unsigned char patch = readByte(interpreter->bytecode, &interpreter->count);
-
-	if (major != TOY_VERSION_MAJOR || minor != TOY_VERSION_MINOR || patch != TOY_VERSION_PATCH) {
-		interpreter->errorOutput("Interpreter/bytecode version mismatch\n");
+	if (!readInterpreterHeader(interpreter)) {
 		return;
 	}
 
-	const char* build = readString(interpreter->bytecode, &interpreter->count);
-
-#ifndef TOY_EXPORT
-	if (command.verbose) {
-		if (strncmp(build, TOY_VERSION_BUILD, strlen(TOY_VERSION_BUILD))) {
-			printf(WARN "Warning: interpreter/bytecode build mismatch\n" RESET);
-		}
-	}
-#endif
-
-	consumeByte(interpreter, OP_SECTION_END, interpreter->bytecode, &interpreter->count);
-
 	//read the sections of the bytecode
 	readInterpreterSections(interpreter);
 
 	//code section
 #ifndef TOY_EXPORT
-	if (command.verbose) {
-		printf(NOTICE "executing bytecode\n" RESET);
+	if (interpreter->verbose) {
+		printf(NOTICE "executing bytecode (time to first instruction: %.3fms)\n" RESET, (double)(clock() - startup) * 1000.0 / CLOCKS_PER_SEC);
 	}
 #endif
 
 	//execute the interpreter
-	execInterpreter(interpreter);
+	startRun(interpreter, owned, false);
+}
 
-	//BUGFIX: clear the stack (for repl - stack must be balanced)
-	while(interpreter->stack.count > 0) {
-		Literal lit = popLiteralArray(&interpreter->stack);
-		freeLiteral(lit);
+void runInterpreter(Interpreter* interpreter, unsigned char* bytecode, int length) {
+	runInterpreterOpt(interpreter, bytecode, length, true);
+}
+
+void runInterpreterBorrowed(Interpreter* interpreter, unsigned char* bytecode, int length) {
+	//NOTE: strings and function bodies are copied out of the image, so it can be released as soon as this returns
+	runInterpreterOpt(interpreter, bytecode, length, false);
+}
+
+bool initProgram(Program* program, unsigned char* bytecode, int length) {
+	//decode everything once, with an interpreter that is never run
+	Interpreter decoder;
+	decoder.bytecode = bytecode;
+	decoder.length = length;
+	decoder.count = 0;
+	decoder.codeStart = -1;
+	decoder.verbose = false;
+	decoder.budget = NULL;
+	decoder.coroutine = NULL;
+	initLiteralArray(&decoder.literalCache);
+	setInterpreterError(&decoder, errorWrapper);
+
+	program->bytecode = bytecode;
+	program->length = length;
+	initLiteralArray(&program->literalCache);
+
+	if (!bytecode) {
+		errorWrapper("No valid bytecode given\n");
+		return false;
 	}
 
-	//free the bytecode immediately after use TODO: because why?
-	FREE_ARRAY(unsigned char, interpreter->bytecode, interpreter->length);
+	if (!readInterpreterHeader(&decoder)) {
+		freeProgram(program);
+		return false;
+	}
 
-	//free the associated data
-	freeLiteralArray(&interpreter->literalCache);
-	freeLiteralArray(&interpreter->stack);
+	readInterpreterSections(&decoder);
+
+	program->codeOffset = decoder.count;
+	program->literalCache = decoder.literalCache;
+	program->functionTable = decoder.functionTable;
+	program->functionCount = decoder.functionCount;
+
+	//the refcounts of shared strings are never touched while running - compounds are left alone, since natives write to them in place
+	for (int i = 0; i < program->literalCache.count; i++) {
+		freezeLiteral(program->literalCache.literals[i], true, false);
+	}
+
+	return true;
+}
+
+void runProgram(Interpreter* interpreter, Program* program) {
+	cancelInterpreter(interpreter);
+
+	//borrow the decoded program - nothing below writes to it
+	interpreter->bytecode = program->bytecode;
+	interpreter->length = program->length;
+	interpreter->count = program->codeOffset;
+	interpreter->codeStart = -1;
+	interpreter->literalCache = program->literalCache;
+	interpreter->functionTable = program->functionTable;
+	interpreter->functionCount = program->functionCount;
+
+	initLiteralArray(&interpreter->stack);
+
+	interpreter->depth = 0;
+	interpreter->panic = false;
+
+	if (!interpreter->bytecode) {
+		interpreter->errorOutput("No valid bytecode given\n");
+		initLiteralArray(&interpreter->literalCache);
+		return;
+	}
+
+	startRun(interpreter, false, true);
+}
+
+void freeProgram(Program* program) {
+	for (int i = 0; i < program->literalCache.count; i++) {
+		freezeLiteral(program->literalCache.literals[i], false, false);
+	}
+
+	freeLiteralArray(&program->literalCache);
+	FREE_ARRAY(unsigned char, program->bytecode, program->length);
+	program->bytecode = NULL;
+	program->length = 0;
 }
 
 void resetInterpreter(Interpreter* interpreter) {
+	//a suspended run still uses the scopes
+	cancelInterpreter(interpreter);
+
 	//free the interpreter scope
 	while(interpreter->scope != NULL) {
 		interpreter->scope = popScope(interpreter->scope);
 	}
 
 	//prep the scope
-	interpreter->scope = pushScope(NULL);
+	interpreter->scope = pushScopeFromPool(interpreter->scopePool, NULL);
 
 	//globally available functions
 	injectNativeFn(interpreter, "_index", _index);
@@ -2512,9 +3458,15 @@ void resetInterpreter(Interpreter* interpreter) {
 	injectNativeFn(interpreter, "_pop", _pop);
 	injectNativeFn(interpreter, "_length", _length);
 	injectNativeFn(interpreter, "_clear", _clear);
+	injectNativeFn(interpreter, "_coroutine", _coroutine);
+	injectNativeFn(interpreter, "_resume", _resume);
+	injectNativeFn(interpreter, "_done", _done);
+	injectNativeFn(interpreter, "_record", _record);
 }
 
 void freeInterpreter(Interpreter* interpreter) {
+	setInterpreterFuel(interpreter, -1);
+
 	//free the interpreter scope
 	while(interpreter->scope != NULL) {
 		interpreter->scope = popScope(interpreter->scope);
@@ -2543,4 +3495,138 @@ void freeInterpreter(Interpreter* interpreter) {
 	freeLiteralDictionary(interpreter->hooks);
 	FREE(LiteralDictionary, interpreter->hooks);
 	interpreter->hooks = NULL;
+
+	//any scopes still alive (i.e. closures held by the host) keep the pool alive
+	releaseScopePool(interpreter->scopePool);
+	interpreter->scopePool = NULL;
+}
+
+void setInterpreterFuel(Interpreter* interpreter, int fuel) {
+	if (fuel < 0) {
+		//the suspended run can't go on without its budget
+		cancelInterpreter(interpreter);
+
+		if (interpreter->budget != NULL) {
+			FREE(Budget, interpreter->budget);
+			interpreter->budget = NULL;
+		}
+		return;
+	}
+
+	if (interpreter->budget == NULL) {
+		interpreter->budget = ALLOCATE(Budget, 1);
+		interpreter->budget->fuel = 0;
+		interpreter->budget->suspended = false;
+		interpreter->budget->running = false;
+		interpreter->budget->cancelled = false;
+		interpreter->budget->ownsBytecode = false;
+		interpreter->budget->borrowsProgram = false;
+		interpreter->budget->fiber = NULL;
+		interpreter->budget->waiting = false;
+		interpreter->budget->token = NULL;
+		interpreter->budget->result = TO_NULL_LITERAL;
+		interpreter->budget->wake = NULL;
+		interpreter->budget->wakeData = NULL;
+	}
+
+	//takes effect from the next run
+	interpreter->budget->limit = fuel;
+}
+
+bool isInterpreterSuspended(Interpreter* interpreter) {
+	return interpreter->budget != NULL && interpreter->budget->fiber != NULL;
+}
+
+bool resumeInterpreter(Interpreter* interpreter, int fuel) {
+	if (!isInterpreterSuspended(interpreter)) {
+		return true;
+	}
+
+	//nothing to do until the token is completed
+	if (interpreter->budget->waiting) {
+		return false;
+	}
+
+	interpreter->budget->fuel = fuel;
+
+	return continueRun(interpreter);
+}
+
+void cancelInterpreter(Interpreter* interpreter) {
+	if (!isInterpreterSuspended(interpreter)) {
+		return;
+	}
+
+	Budget* budget = interpreter->budget;
+
+	//whoever holds the token still completes it, but the result goes nowhere
+	if (budget->token != NULL) {
+		budget->token->budget = NULL;
+		budget->token = NULL;
+	}
+	budget->waiting = false;
+
+	//the run unwinds through the usual panic path, so nothing is leaked
+	budget->cancelled = true;
+	continueRun(interpreter);
+
+	freeLiteral(budget->result);
+	budget->result = TO_NULL_LITERAL;
+}
+
+AsyncToken* beginAsync(Interpreter* interpreter) {
+	Budget* budget = interpreter->budget;
+
+	//only a budgeted run has a stack of its own to wait on
+	if (budget == NULL || !budget->running || budget->token != NULL) {
+		return NULL;
+	}
+
+	AsyncToken* token = ALLOCATE(AsyncToken, 1);
+	token->budget = budget;
+
+	budget->token = token;
+
+	return token;
+}
+
+void completeAsync(AsyncToken* token, Literal result) {
+	Budget* budget = token->budget;
+
+	//an abandoned run has nothing to hand the result to
+	if (budget != NULL) {
+		budget->token = NULL;
+		freeLiteral(budget->result);
+		budget->result = copyLiteral(result);
+
+		if (budget->waiting) {
+			budget->waiting = false;
+
+			if (budget->wake != NULL) {
+				budget->wake(budget->wakeData);
+			}
+		}
+	}
+
+	FREE(AsyncToken, token);
+}
+
+bool isInterpreterWaiting(Interpreter* interpreter) {
+	return interpreter->budget != NULL && interpreter->budget->waiting;
+}
+
+void setInterpreterWake(Interpreter* interpreter, WakeFn wake, void* userdata) {
+	if (interpreter->budget == NULL) {
+		interpreter->errorOutput("Can't set a wake function without a budget\n");
+		return;
+	}
+
+	interpreter->budget->wake = wake;
+	interpreter->budget->wakeData = userdata;
+}
+
+void yieldInterpreter(Interpreter* interpreter) {
+	if (interpreter->budget != NULL) {
+		interpreter->budget->fuel = 0;
+	}
 }
@@ -7,6 +7,31 @@
 #include "scope.h"
 
 typedef void (*PrintFn)(const char*);
+typedef void (*WakeFn)(void* userdata);
+
+//an instruction budget - a run that uses it up is suspended, until the host resumes or cancels it
+typedef struct Budget {
+	int fuel; //instructions left before the next suspension
+	int limit; //given to each new run
+	bool suspended;
+	bool running; //on the run's own stack, where it can be suspended from
+	bool cancelled;
+	bool ownsBytecode; //what to release once the run is over
+	bool borrowsProgram;
+	struct Fiber* fiber; //the suspended run's stack
+
+	//async natives
+	bool waiting; //on a token, rather than for more fuel
+	struct AsyncToken* token; //not yet completed
+	Literal result; //handed to the script once the run picks up again
+	WakeFn wake; //called once a waiting run can be resumed
+	void* wakeData;
+} Budget;
+
+//handed out to an async native, and completed by the host once the result is ready
+typedef struct AsyncToken {
+	Budget* budget; //NULL once the run is abandoned
+} AsyncToken;
 
 //the interpreter acts depending on the bytecode instructions
 typedef struct Interpreter {
@@ -16,9 +41,12 @@ typedef struct Interpreter {
 	int count;
 	int codeStart; //BUGFIX: for jumps, must be initialized to -1
 	LiteralArray literalCache; //read-only - built from the bytecode, refreshed each time new bytecode is provided
+	int functionTable; //offset of the function section's offset table
+	int functionCount;
 
 	//operation
 	Scope* scope;
+	ScopePool* scopePool; //recycled scopes, shared with inner interpreters
 	LiteralArray stack;
 
 	LiteralDictionary* exports; //read-write - interface with Toy from C - this is a pointer, since it works at a script-level
@@ -32,9 +60,24 @@ typedef struct Interpreter {
 
 	int depth; //don't overflow
 	bool panic;
+	Budget* budget; //NULL for no limit - shared with inner interpreters
+	struct Coroutine* coroutine; //the coroutine this code runs in, if any
+	bool verbose; //defaults to the command line's setting
 } Interpreter;
 
-//native API
+//a decoded program, which can be run by any number of interpreters
+typedef struct Program {
+	unsigned char* bytecode;
+	int length;
+	int codeOffset; //where the code section begins
+	LiteralArray literalCache; //read-only - shared by every run
+	int functionTable;
+	int functionCount;
+} Program;
+
+//native API - natives return how many values they pushed, -1 on error, or NATIVE_PENDING
+#define NATIVE_PENDING -2
+
 typedef int (*NativeFn)(Interpreter* interpreter, LiteralArray* arguments);
 TOY_API bool injectNativeFn(Interpreter* interpreter, char* name, NativeFn func);
 
@@ -46,6 +89,7 @@ TOY_API bool callFn(Interpreter* interpreter, char* name, LiteralArray* argument
 
 //utilities for the host program
 TOY_API bool parseIdentifierToValue(Interpreter* interpreter, Literal* literalPtr);
+TOY_API Literal parseTypeToValue(Interpreter* interpreter, Literal type); //takes the type, and resolves the names embedded in it
 TOY_API void setInterpreterPrint(Interpreter* interpreter, PrintFn printOutput);
 TOY_API void setInterpreterAssert(Interpreter* interpreter, PrintFn assertOutput);
 TOY_API void setInterpreterError(Interpreter* interpreter, PrintFn errorOutput);
@@ -53,5 +97,27 @@ TOY_API void setInterpreterError(Interpreter* interpreter, PrintFn errorOutput);
 //main access
 TOY_API void initInterpreter(Interpreter* interpreter); //start of program
 TOY_API void runInterpreter(Interpreter* interpreter, unsigned char* bytecode, int length); //run the code
+TOY_API void runInterpreterBorrowed(Interpreter* interpreter, unsigned char* bytecode, int length); //run the code, without taking ownership of it (e.g. a mapped file)
 TOY_API void resetInterpreter(Interpreter* interpreter); //use this to reset the interpreter's environment between runs
 TOY_API void freeInterpreter(Interpreter* interpreter); //end of program
+
+//compile once, run many times
+TOY_API bool initProgram(Program* program, unsigned char* bytecode, int length); //takes ownership of the bytecode
+TOY_API void runProgram(Interpreter* interpreter, Program* program); //can run concurrently on separate interpreters
+TOY_API void freeProgram(Program* program); //NOTE: reset or free the interpreters first - values they hold may come from the program
+
+//preemption - a run that uses up its fuel stops at an instruction boundary, and runInterpreter()/runProgram() return early
+TOY_API void setInterpreterFuel(Interpreter* interpreter, int fuel); //instructions per run, or -1 for no limit
+TOY_API bool isInterpreterSuspended(Interpreter* interpreter);
+TOY_API bool resumeInterpreter(Interpreter* interpreter, int fuel); //true once the run has finished
+TOY_API void cancelInterpreter(Interpreter* interpreter); //unwinds the suspended run, as if it had failed
+TOY_API void yieldInterpreter(Interpreter* interpreter); //for natives - suspends once the current instruction is done
+
+//async natives - a native that can't finish right away takes a token, and returns NATIVE_PENDING
+//the run then waits (isInterpreterSuspended() stays true) until the token is completed, and is picked up again by resumeInterpreter()
+TOY_API AsyncToken* beginAsync(Interpreter* interpreter); //NULL if the run can't wait (e.g. no budget) - the native should block instead
+TOY_API void completeAsync(AsyncToken* token, Literal result); //the result is copied - every token must be completed exactly once, even if the run was cancelled
+TOY_API bool isInterpreterWaiting(Interpreter* interpreter);
+TOY_API void setInterpreterWake(Interpreter* interpreter, WakeFn wake, void* userdata); //needs a budget - called by completeAsync() when a waiting run can go on
+
+//WARNING: tokens must be completed on the interpreter's thread - see the event loop for completing them from elsewhere
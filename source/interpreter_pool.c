@@ -0,0 +1,127 @@
+#include "interpreter_pool.h"
+
+#include "memory.h"
+
+static PooledInterpreter* createPooledInterpreter(InterpreterPool* pool) {
+	PooledInterpreter* pooled = ALLOCATE(PooledInterpreter, 1);
+
+	initInterpreter(&pooled->interpreter);
+
+	if (pool->setup) {
+		pool->setup(&pooled->interpreter);
+	}
+
+	//everything above the template is thrown away on return
+	pooled->template = pooled->interpreter.scope;
+
+	//runs can't declare anything in the template, only assign to it, so logging the first assignments is enough to undo them
+	initLiteralDictionary(&pooled->writes);
+	pooled->template->log = &pooled->writes;
+
+	pooled->interpreter.scope = pushScope(pooled->template);
+
+	pool->created++;
+
+	return pooled;
+}
+
+static void freePooledInterpreter(PooledInterpreter* pooled) {
+	freeInterpreter(&pooled->interpreter);
+	freeLiteralDictionary(&pooled->writes);
+	FREE(PooledInterpreter, pooled);
+}
+
+//only rebuild the exports if something was exported
+static void clearDictionary(LiteralDictionary* dictionary) {
+	if (dictionary->count > 0) {
+		freeLiteralDictionary(dictionary);
+		initLiteralDictionary(dictionary);
+	}
+}
+
+void initInterpreterPool(InterpreterPool* pool, InterpreterSetupFn setup) {
+	pool->setup = setup;
+	pool->available = NULL;
+	pool->capacity = 0;
+	pool->count = 0;
+	pool->created = 0;
+	pool->inUse = 0;
+	pool->peakInUse = 0;
+	pool->checkouts = 0;
+}
+
+void freeInterpreterPool(InterpreterPool* pool) {
+	for (int i = 0; i < pool->count; i++) {
+		freePooledInterpreter(pool->available[i]);
+	}
+
+	FREE_ARRAY(PooledInterpreter*, pool->available, pool->capacity);
+	pool->available = NULL;
+	pool->capacity = 0;
+	pool->count = 0;
+}
+
+Interpreter* checkoutInterpreter(InterpreterPool* pool) {
+	PooledInterpreter* pooled = pool->count > 0 ? pool->available[--pool->count] : createPooledInterpreter(pool);
+
+	pool->checkouts++;
+	pool->inUse++;
+	if (pool->inUse > pool->peakInUse) {
+		pool->peakInUse = pool->inUse;
+	}
+
+	return &pooled->interpreter;
+}
+
+void returnInterpreter(InterpreterPool* pool, Interpreter* interpreter) {
+	PooledInterpreter* pooled = (PooledInterpreter*)interpreter;
+
+	//budgets don't outlive the checkout - this also abandons a suspended run
+	setInterpreterFuel(interpreter, -1);
+
+	//drop back to the template - the recycled scopes start with no tables, so nothing is allocated here
+	while (interpreter->scope != NULL && interpreter->scope != pooled->template) {
+		interpreter->scope = popScope(interpreter->scope);
+	}
+
+	if (interpreter->scope == NULL) {
+		//the host tore down the scopes, so this one can't be recycled
+		freePooledInterpreter(pooled);
+		pool->inUse--;
+		return;
+	}
+
+	//put back only what the run assigned
+	for (int i = 0; i < pooled->writes.capacity; i++) {
+		if (!IS_NULL(pooled->writes.entries[i].key)) {
+			setLiteralDictionary(&pooled->template->variables, pooled->writes.entries[i].key, pooled->writes.entries[i].value);
+		}
+	}
+
+	clearDictionary(&pooled->writes);
+
+	interpreter->scope = pushScope(pooled->template);
+
+	//exported functions hold scopes too
+	for (int i = 0; i < interpreter->exports->capacity; i++) {
+		if (IS_FUNCTION(interpreter->exports->entries[i].value)) {
+			popScope(AS_FUNCTION(interpreter->exports->entries[i].value).scope);
+			AS_FUNCTION(interpreter->exports->entries[i].value).scope = NULL;
+		}
+	}
+
+	clearDictionary(interpreter->exports);
+	clearDictionary(interpreter->exportTypes);
+
+	interpreter->panic = false;
+
+	//push onto the available stack
+	if (pool->count + 1 > pool->capacity) {
+		int oldCapacity = pool->capacity;
+		pool->capacity = GROW_CAPACITY(oldCapacity);
+		pool->available = GROW_ARRAY(PooledInterpreter*, pool->available, oldCapacity, pool->capacity);
+	}
+
+	pool->available[pool->count++] = pooled;
+	pool->inUse--;
+}
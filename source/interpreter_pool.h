@@ -0,0 +1,36 @@
+#pragma once
+
+#include "toy_common.h"
+#include "interpreter.h"
+
+//prepares each new interpreter: output functions, hooks, preloaded natives and so on
+typedef void (*InterpreterSetupFn)(Interpreter* interpreter);
+
+//each pooled interpreter runs in a scope above its template, which is the global scope as the setup left it
+typedef struct PooledInterpreter {
+	Interpreter interpreter; //NOTE: must be first, so handles can be mapped back
+	Scope* template;
+	LiteralDictionary writes; //the template's values from before a run first assigned them, so those assignments can be undone
+} PooledInterpreter;
+
+typedef struct InterpreterPool {
+	InterpreterSetupFn setup;
+	PooledInterpreter** available;
+	int capacity;
+
+	//stats
+	int count; //how many are available
+	int created;
+	int inUse;
+	int peakInUse;
+	int checkouts;
+} InterpreterPool;
+
+TOY_API void initInterpreterPool(InterpreterPool* pool, InterpreterSetupFn setup); //setup can be NULL
+TOY_API void freeInterpreterPool(InterpreterPool* pool); //NOTE: every interpreter must be returned first
+
+//NOTE: don't call resetInterpreter() on a pooled interpreter, it discards the template
+
+//returning drops everything the run declared and exported, and undoes its assignments to the template's variables, without rebuilding the template
+TOY_API Interpreter* checkoutInterpreter(InterpreterPool* pool);
+TOY_API void returnInterpreter(InterpreterPool* pool, Interpreter* interpreter);
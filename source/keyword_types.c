@@ -38,6 +38,11 @@ KeywordType keywordTypes[] = {
 	{TOKEN_TYPEOF,     "typeof"},
 	{TOKEN_VAR,        "var"},
 	{TOKEN_WHILE,      "while"},
+	{TOKEN_YIELD,      "yield"},
+	{TOKEN_STRUCT,     "struct"},
+	{TOKEN_SWITCH,     "switch"},
+	{TOKEN_CASE,       "case"},
+	{TOKEN_DEFAULT,    "default"},
 
 	//literal values
 	{TOKEN_LITERAL_TRUE,   "true"},
@@ -4,6 +4,9 @@
 #include "literal_array.h"
 #include "literal_dictionary.h"
 #include "scope.h"
+#include "coroutine.h"
+#include "record.h"
+#include "packed_array.h"
 
 #include "console_colors.h"
 
@@ -41,14 +44,22 @@ void freeLiteral(Literal literal) {
 		return;
 	}
 
-	//compounds
+	//compounds - frozen ones belong to whoever froze them
 	if (IS_ARRAY(literal) || literal.type == LITERAL_DICTIONARY_INTERMEDIATE || literal.type == LITERAL_TYPE_INTERMEDIATE) {
+		if (AS_ARRAY(literal)->frozen) {
+			return;
+		}
+
 		freeLiteralArray(AS_ARRAY(literal));
 		FREE(LiteralArray, AS_ARRAY(literal));
 		return;
 	}
 
 	if (IS_DICTIONARY(literal)) {
+		if (AS_DICTIONARY(literal)->frozen) {
+			return;
+		}
+
 		freeLiteralDictionary(AS_DICTIONARY(literal));
 		FREE(LiteralDictionary, AS_DICTIONARY(literal));
 		return;
@@ -68,6 +79,21 @@ void freeLiteral(Literal literal) {
 		FREE_ARRAY(Literal, AS_TYPE(literal).subtypes, AS_TYPE(literal).capacity);
 		return;
 	}
+
+	if (IS_COROUTINE(literal)) {
+		releaseCoroutine(AS_COROUTINE(literal));
+		return;
+	}
+
+	if (IS_RECORD(literal)) {
+		freeRecord(AS_RECORD(literal));
+		return;
+	}
+
+	if (IS_PACKED_ARRAY(literal)) {
+		freePackedArray(AS_PACKED_ARRAY(literal));
+		return;
+	}
 }
 
 bool _isTruthy(Literal x) {
@@ -119,6 +145,11 @@ Literal copyLiteral(Literal original) {
 		}
 
 		case LITERAL_ARRAY: {
+			//frozen compounds are shared, rather than copied
+			if (AS_ARRAY(original)->frozen) {
+				return original;
+			}
+
 			LiteralArray* array = ALLOCATE(LiteralArray, 1);
 			initLiteralArray(array);
 
@@ -131,6 +162,10 @@ Literal copyLiteral(Literal original) {
 		}
 
 		case LITERAL_DICTIONARY: {
+			if (AS_DICTIONARY(original)->frozen) {
+				return original;
+			}
+
 			LiteralDictionary* dictionary = ALLOCATE(LiteralDictionary, 1);
 			initLiteralDictionary(dictionary);
 
@@ -209,13 +244,132 @@ Literal copyLiteral(Literal original) {
 			//no copying possible
 			return original;
 
+		case LITERAL_COROUTINE:
+			//every copy resumes the same call
+			retainCoroutine(AS_COROUTINE(original));
+			return original;
+
+		case LITERAL_RECORD:
+			return copyRecord(original);
+
+		case LITERAL_PACKED_ARRAY:
+			return TO_PACKED_ARRAY_LITERAL(copyPackedArray(AS_PACKED_ARRAY(original)));
+
 		default:
 			fprintf(stderr, ERROR "ERROR: Can't copy that literal type: %d\n" RESET, original.type);
 			return TO_NULL_LITERAL;
 	}
 }
 
+Literal detachLiteral(Literal original) {
+	switch(original.type) {
+		case LITERAL_NULL:
+		case LITERAL_BOOLEAN:
+		case LITERAL_INTEGER:
+		case LITERAL_FLOAT:
+			return original;
+
+		//frozen values are copied too, since whoever froze them may free them before the copy is gone
+		case LITERAL_STRING:
+			return TO_STRING_LITERAL(deepCopyRefString(AS_STRING(original)));
+
+		case LITERAL_IDENTIFIER:
+			return TO_IDENTIFIER_LITERAL(deepCopyRefString(AS_IDENTIFIER(original)));
+
+		case LITERAL_ARRAY: {
+			LiteralArray* array = ALLOCATE(LiteralArray, 1);
+			initLiteralArray(array);
+
+			for (int i = 0; i < AS_ARRAY(original)->count; i++) {
+				Literal literal = detachLiteral(AS_ARRAY(original)->literals[i]);
+				pushLiteralArray(array, literal);
+				freeLiteral(literal);
+			}
+
+			return TO_ARRAY_LITERAL(array);
+		}
+
+		case LITERAL_DICTIONARY: {
+			LiteralDictionary* dictionary = ALLOCATE(LiteralDictionary, 1);
+			initLiteralDictionary(dictionary);
+
+			for (int i = 0; i < AS_DICTIONARY(original)->capacity; i++) {
+				if (!IS_NULL(AS_DICTIONARY(original)->entries[i].key)) {
+					Literal key = detachLiteral(AS_DICTIONARY(original)->entries[i].key);
+					Literal value = detachLiteral(AS_DICTIONARY(original)->entries[i].value);
+					setLiteralDictionary(dictionary, key, value);
+					freeLiteral(key);
+					freeLiteral(value);
+				}
+			}
+
+			return TO_DICTIONARY_LITERAL(dictionary);
+		}
+
+		case LITERAL_TYPE: {
+			Literal lit = TO_TYPE_LITERAL(AS_TYPE(original).typeOf, AS_TYPE(original).constant);
+
+			for (int i = 0; i < AS_TYPE(original).count; i++) {
+				TYPE_PUSH_SUBTYPE(&lit, detachLiteral( ((Literal*)(AS_TYPE(original).subtypes))[i] ));
+			}
+
+			return lit;
+		}
+
+		case LITERAL_OPAQUE:
+			return original; //the host decides what can be shared
+
+		case LITERAL_PACKED_ARRAY:
+			return TO_PACKED_ARRAY_LITERAL(copyPackedArray(AS_PACKED_ARRAY(original))); //plain data
+
+		default:
+			//functions are tied to their interpreter
+			return TO_NULL_LITERAL;
+	}
+}
+
+void freezeLiteral(Literal literal, bool frozen, bool compounds) {
+	if (IS_STRING(literal) || IS_IDENTIFIER(literal)) {
+		RefString* refString = IS_STRING(literal) ? AS_STRING(literal) : AS_IDENTIFIER(literal);
+
+		if (frozen) {
+			freezeRefString(refString);
+		}
+		else {
+			thawRefString(refString);
+		}
+	}
+
+	if (IS_ARRAY(literal)) {
+		if (compounds) {
+			AS_ARRAY(literal)->frozen = frozen;
+		}
+
+		for (int i = 0; i < AS_ARRAY(literal)->count; i++) {
+			freezeLiteral(AS_ARRAY(literal)->literals[i], frozen, compounds);
+		}
+	}
+
+	if (IS_DICTIONARY(literal)) {
+		if (compounds) {
+			AS_DICTIONARY(literal)->frozen = frozen;
+		}
+
+		for (int i = 0; i < AS_DICTIONARY(literal)->capacity; i++) {
+			if (!IS_NULL(AS_DICTIONARY(literal)->entries[i].key)) {
+				freezeLiteral(AS_DICTIONARY(literal)->entries[i].key, frozen, compounds);
+				freezeLiteral(AS_DICTIONARY(literal)->entries[i].value, frozen, compounds);
+			}
+		}
+	}
+}
+
 bool literalsAreEqual(Literal lhs, Literal rhs) {
+	//packed arrays match plain arrays with the same elements
+	if (IS_PACKED_ARRAY(lhs) || IS_PACKED_ARRAY(rhs)) {
+		return packedArraysAreEqual(lhs, rhs);
+	}
+
 	//utility for other things
 	if (lhs.type != rhs.type) {
 		// ints and floats are compatible
@@ -326,6 +480,22 @@ bool literalsAreEqual(Literal lhs, Literal rhs) {
 		case LITERAL_OPAQUE:
 			return false; //IDK what this is!
 
+		case LITERAL_COROUTINE:
+			return AS_COROUTINE(lhs) == AS_COROUTINE(rhs);
+
+		case LITERAL_RECORD:
+			if (!sameRecordLayout(AS_RECORD(lhs)->layout, AS_RECORD(rhs)->layout)) {
+				return false;
+			}
+
+			//mismatched fields (in order)
+			for (int i = 0; i < AS_RECORD(lhs)->layout->count; i++) {
+				if (!literalsAreEqual(AS_RECORD(lhs)->fields[i], AS_RECORD(rhs)->fields[i])) {
+					return false;
+				}
+			}
+			return true;
+
 		case LITERAL_ANY:
 			return true;
 
@@ -367,6 +537,15 @@ int hashLiteral(Literal lit) {
 			return hashUInt(res);
 		}
 
+		case LITERAL_PACKED_ARRAY: {
+			//the same as the plain array it's equal to
+			unsigned int res = 0;
+			for (int i = 0; i < AS_PACKED_ARRAY(lit)->count; i++) {
+				res += hashLiteral(getPackedArray(AS_PACKED_ARRAY(lit), i));
+			}
+			return hashUInt(res);
+		}
+
 		case LITERAL_DICTIONARY: {
 			unsigned int res = 0;
 			for (int i = 0; i < AS_DICTIONARY(lit)->capacity; i++) {
@@ -392,6 +571,17 @@ int hashLiteral(Literal lit) {
 		case LITERAL_ANY:
 			return -1;
 
+		case LITERAL_COROUTINE:
+			return hashUInt((unsigned int)(uintptr_t)AS_COROUTINE(lit));
+
+		case LITERAL_RECORD: {
+			unsigned int res = 0;
+			for (int i = 0; i < AS_RECORD(lit)->layout->count; i++) {
+				res += hashLiteral(AS_RECORD(lit)->fields[i]);
+			}
+			return hashUInt(res);
+		}
+
 		default:
 			//should never bee seen
 			fprintf(stderr, ERROR "[internal] Unrecognized literal type in hash: %d\n" RESET, lit.type);
@@ -404,13 +594,13 @@ static void stdoutWrapper(const char* output) {
 	printf("%s", output);
 }
 
-//buffer the prints
-static char* globalPrintBuffer = NULL;
-static size_t globalPrintCapacity = 0;
-static size_t globalPrintCount = 0;
+//buffer the prints, per-thread
+static TOY_THREAD_LOCAL char* globalPrintBuffer = NULL;
+static TOY_THREAD_LOCAL size_t globalPrintCapacity = 0;
+static TOY_THREAD_LOCAL size_t globalPrintCount = 0;
 
 //BUGFIX: string quotes shouldn't show when just printing strings, but should show when printing them as members of something else
-static char quotes = 0; //set to 0 to not show string quotes
+static TOY_THREAD_LOCAL char quotes = 0; //set to 0 to not show string quotes
 
 static void printToBuffer(const char* str) {
 	while (strlen(str) + globalPrintCount + 1 > globalPrintCapacity) {
@@ -465,8 +655,11 @@ void printLiteralCustom(Literal literal, void (printFn)(const char*)) {
 		}
 		break;
 
-		case LITERAL_ARRAY: {
-			LiteralArray* ptr = AS_ARRAY(literal);
+		case LITERAL_ARRAY:
+		case LITERAL_PACKED_ARRAY: {
+			//packed elements are boxed one at a time
+			LiteralArray* ptr = IS_ARRAY(literal) ? AS_ARRAY(literal) : NULL;
+			int count = ptr != NULL ? ptr->count : AS_PACKED_ARRAY(literal)->count;
 
 			//hold potential parent-call buffers on the C stack
 			char* cacheBuffer = globalPrintBuffer;
@@ -478,11 +671,11 @@ void printLiteralCustom(Literal literal, void (printFn)(const char*)) {
 
 			//print the contents to the global buffer
 			printToBuffer("[");
-			for (int i = 0; i < ptr->count; i++) {
+			for (int i = 0; i < count; i++) {
 				quotes = '"';
-				printLiteralCustom(ptr->literals[i], printToBuffer);
+				printLiteralCustom(ptr != NULL ? ptr->literals[i] : getPackedArray(AS_PACKED_ARRAY(literal), i), printToBuffer);
 
-				if (i + 1 < ptr->count) {
+				if (i + 1 < count) {
 					printToBuffer(",");
 				}
 			}
@@ -643,6 +836,20 @@ void printLiteralCustom(Literal literal, void (printFn)(const char*)) {
 					printToBuffer("opaque");
 				break;
 
+				case LITERAL_COROUTINE:
+					printToBuffer("coroutine");
+				break;
+
+				case LITERAL_RECORD:
+					//named record types carry a blank record
+					if (AS_TYPE(literal).count > 0) {
+						printLiteralCustom(AS_RECORD(((Literal*)(AS_TYPE(literal).subtypes))[0])->layout->name, printToBuffer);
+					}
+					else {
+						printToBuffer("record");
+					}
+				break;
+
 				case LITERAL_ANY:
 					printToBuffer("any");
 				break;
@@ -684,6 +891,52 @@ void printLiteralCustom(Literal literal, void (printFn)(const char*)) {
 			printFn("(opaque)");
 		break;
 
+		case LITERAL_COROUTINE:
+			printFn("(coroutine)");
+		break;
+
+		case LITERAL_RECORD: {
+			Record* ptr = AS_RECORD(literal);
+
+			//hold potential parent-call buffers on the C stack
+			char* cacheBuffer = globalPrintBuffer;
+			globalPrintBuffer = NULL;
+			int cacheCapacity = globalPrintCapacity;
+			globalPrintCapacity = 0;
+			int cacheCount = globalPrintCount;
+			globalPrintCount = 0;
+
+			//print the contents to the global buffer, as Name(field:value,...)
+			printLiteralCustom(ptr->layout->name, printToBuffer);
+			printToBuffer("(");
+			for (int i = 0; i < ptr->layout->count; i++) {
+				printLiteralCustom(ptr->layout->names[i], printToBuffer);
+				printToBuffer(":");
+				quotes = '"';
+				printLiteralCustom(ptr->fields[i], printToBuffer);
+
+				if (i + 1 < ptr->layout->count) {
+					printToBuffer(",");
+				}
+			}
+			printToBuffer(")");
+
+			//swap the parent-call buffer back into place
+			char* printBuffer = globalPrintBuffer;
+			int printCapacity = globalPrintCapacity;
+			int printCount = globalPrintCount;
+
+			globalPrintBuffer = cacheBuffer;
+			globalPrintCapacity = cacheCapacity;
+			globalPrintCount = cacheCount;
+
+			//finally, output and cleanup
+			printFn(printBuffer);
+			FREE_ARRAY(char, printBuffer, printCapacity);
+			quotes = 0;
+		}
+		break;
+
 		case LITERAL_ANY:
 			printFn("(any)");
 		break;
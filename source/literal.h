@@ -26,6 +26,10 @@ typedef enum {
 	LITERAL_FUNCTION_INTERMEDIATE, //used to process functions in the compiler only
 	LITERAL_FUNCTION_ARG_REST, //used to process function rest parameters only
 	LITERAL_FUNCTION_NATIVE, //for handling native functions only
+
+	LITERAL_COROUTINE, //shared, rather than copied - see coroutine.h
+	LITERAL_RECORD, //fixed-layout fields - see record.h
+	LITERAL_PACKED_ARRAY, //unboxed ints or floats - see packed_array.h
 } LiteralType;
 
 typedef struct {
@@ -65,6 +69,10 @@ typedef struct {
 			void* ptr;
 			int tag; //TODO: remove tags?
 		} opaque;
+
+		void* coroutine;
+		void* record;
+		void* packed;
 	} as;
 } Literal;
 
@@ -80,6 +88,9 @@ typedef struct {
 #define IS_IDENTIFIER(value)				((value).type == LITERAL_IDENTIFIER)
 #define IS_TYPE(value)						((value).type == LITERAL_TYPE)
 #define IS_OPAQUE(value)					((value).type == LITERAL_OPAQUE)
+#define IS_COROUTINE(value)					((value).type == LITERAL_COROUTINE)
+#define IS_RECORD(value)					((value).type == LITERAL_RECORD)
+#define IS_PACKED_ARRAY(value)				((value).type == LITERAL_PACKED_ARRAY)
 
 #define AS_BOOLEAN(value)					((value).as.boolean)
 #define AS_INTEGER(value)					((value).as.integer)
@@ -91,6 +102,9 @@ typedef struct {
 #define AS_IDENTIFIER(value)				((value).as.identifier.ptr)
 #define AS_TYPE(value)						((value).as.type)
 #define AS_OPAQUE(value)					((value).as.opaque.ptr)
+#define AS_COROUTINE(value)					((struct Coroutine*)((value).as.coroutine))
+#define AS_RECORD(value)					((struct Record*)((value).as.record))
+#define AS_PACKED_ARRAY(value)				((struct PackedArray*)((value).as.packed))
 
 #define TO_NULL_LITERAL						((Literal){LITERAL_NULL,		{ .integer = 0 }})
 #define TO_BOOLEAN_LITERAL(value)			((Literal){LITERAL_BOOLEAN,		{ .boolean = value }})
@@ -103,6 +117,9 @@ typedef struct {
 #define TO_IDENTIFIER_LITERAL(value)		_toIdentifierLiteral(value)
 #define TO_TYPE_LITERAL(value, c)			((Literal){ LITERAL_TYPE,		{ .type.typeOf = value, .type.constant = c, .type.subtypes = NULL, .type.capacity = 0, .type.count = 0 }})
 #define TO_OPAQUE_LITERAL(value, t)			((Literal){ LITERAL_OPAQUE,		{ .opaque.ptr = value, .opaque.tag = t }})
+#define TO_COROUTINE_LITERAL(value)			((Literal){ LITERAL_COROUTINE,	{ .coroutine = value }})
+#define TO_RECORD_LITERAL(value)			((Literal){ LITERAL_RECORD,		{ .record = value }})
+#define TO_PACKED_ARRAY_LITERAL(value)		((Literal){ LITERAL_PACKED_ARRAY,	{ .packed = value }})
 
 TOY_API void freeLiteral(Literal literal);
 
@@ -121,6 +138,8 @@ TOY_API Literal* _typePushSubtype(Literal* lit, Literal subtype);
 
 //utils
 TOY_API Literal copyLiteral(Literal original);
+TOY_API Literal detachLiteral(Literal original); //deep copy that shares no strings or compounds, even frozen ones, so it can move between threads and outlive its program - functions become null
+TOY_API void freezeLiteral(Literal literal, bool frozen, bool compounds); //freezes or thaws every string within, and the arrays and dictionaries too if compounds is set
 TOY_API bool literalsAreEqual(Literal lhs, Literal rhs);
 TOY_API int hashLiteral(Literal lit);
 
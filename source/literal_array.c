@@ -10,6 +10,7 @@ void initLiteralArray(LiteralArray* array) {
 	array->capacity = 0;
 	array->count = 0;
 	array->literals = NULL;
+	array->frozen = false;
 }
 
 void freeLiteralArray(LiteralArray* array) {
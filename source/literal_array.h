@@ -8,6 +8,7 @@ typedef struct LiteralArray {
 	Literal* literals;
 	int capacity;
 	int count;
+	bool frozen; //shared and read-only - copies and frees leave it alone
 } LiteralArray;
 
 TOY_API void initLiteralArray(LiteralArray* array);
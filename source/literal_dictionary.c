@@ -17,6 +17,11 @@ static void setEntryValues(_entry* entry, Literal key, Literal value) {
 }
 
 static _entry* getEntryArray(_entry* array, int capacity, Literal key, unsigned int hash, bool mustExist) {
+	//lazily allocated tables (i.e. scopes) can still be empty
+	if (capacity == 0) {
+		return NULL;
+	}
+
 	//find "key", starting at index
 	unsigned int index = hash % capacity;
 	unsigned int start = index;
@@ -125,6 +130,7 @@ void initLiteralDictionary(LiteralDictionary* dictionary) {
 	dictionary->capacity = GROW_CAPACITY(0);
 	dictionary->contains = 0;
 	dictionary->count = 0;
+	dictionary->frozen = false;
 	adjustEntryCapacity(&dictionary->entries, 0, dictionary->capacity);
 }
 
@@ -186,6 +192,12 @@ Literal getLiteralDictionary(LiteralDictionary* dictionary, Literal key) {
 	}
 }
 
+Literal* getLiteralDictionaryRef(LiteralDictionary* dictionary, Literal key) {
+	_entry* entry = getEntryArray(dictionary->entries, dictionary->capacity, key, hashLiteral(key), true);
+
+	return entry != NULL ? &entry->value : NULL;
+}
+
 void removeLiteralDictionary(LiteralDictionary* dictionary, Literal key) {
 	if (IS_NULL(key)) {
 		fprintf(stderr, ERROR "Dictionaries can't have null keys (remove)\n" RESET);
@@ -215,5 +227,5 @@ void removeLiteralDictionary(LiteralDictionary* dictionary, Literal key) {
 bool existsLiteralDictionary(LiteralDictionary* dictionary, Literal key) {
 	//null & not tombstoned
 	_entry* entry = getEntryArray(dictionary->entries, dictionary->capacity, key, hashLiteral(key), false);
-	return !(IS_NULL(entry->key) && IS_NULL(entry->value));
+	return entry != NULL && !(IS_NULL(entry->key) && IS_NULL(entry->value));
 }
@@ -17,6 +17,7 @@ typedef struct LiteralDictionary {
 	int capacity;
 	int count;
 	int contains; //count + tombstones, for internal use
+	bool frozen; //shared and read-only - copies and frees leave it alone
 } LiteralDictionary;
 
 TOY_API void initLiteralDictionary(LiteralDictionary* dictionary);
@@ -27,3 +28,6 @@ TOY_API Literal getLiteralDictionary(LiteralDictionary* dictionary, Literal key)
 TOY_API void removeLiteralDictionary(LiteralDictionary* dictionary, Literal key);
 
 TOY_API bool existsLiteralDictionary(LiteralDictionary* dictionary, Literal key);
+
+//borrowed - NULL if missing, and only valid until the next insertion
+Literal* getLiteralDictionaryRef(LiteralDictionary* dictionary, Literal key);
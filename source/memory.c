@@ -1,4 +1,5 @@
 #include "memory.h"
+#include "memory_pool.h"
 #include "refstring.h"
 
 #include "console_colors.h"
@@ -13,6 +14,12 @@ void* defaultMemoryAllocator(void* pointer, size_t oldSize, size_t newSize) {
 		return NULL;
 	}
 
+	//a block from a pool goes back to it, whichever thread lets go of it
+	void* moved = NULL;
+	if (reallocatePoolBlock(pointer, oldSize, newSize, &moved)) {
+		return moved;
+	}
+
 	if (newSize == 0) {
 		free(pointer);
 
@@ -30,15 +37,14 @@ void* defaultMemoryAllocator(void* pointer, size_t oldSize, size_t newSize) {
 }
 
 //static variables
-static MemoryAllocatorFn allocator;
-
-//preload
-static void __attribute__((constructor)) preloadMemoryAllocator() {
-	setMemoryAllocator(defaultMemoryAllocator);
-}
+static TOY_THREAD_LOCAL MemoryAllocatorFn allocator = NULL; //NULL for the default
 
 //exposed API
 void* reallocate(void* pointer, size_t oldSize, size_t newSize) {
+	if (allocator == NULL) {
+		return defaultMemoryAllocator(pointer, oldSize, newSize);
+	}
+
 	return allocator(pointer, oldSize, newSize);
 }
 
@@ -12,7 +12,9 @@
 
 //implementation details
 void* reallocate(void* pointer, size_t oldSize, size_t newSize);
+void* defaultMemoryAllocator(void* pointer, size_t oldSize, size_t newSize);
 
-//assign the memory allocator
+//assign the memory allocator for the calling thread - other threads keep their own
+//NOTE: memory must be freed by a thread using a compatible allocator - memory pools and the default allocator all are
 typedef void* (*MemoryAllocatorFn)(void* pointer, size_t oldSize, size_t newSize);
 TOY_API void setMemoryAllocator(MemoryAllocatorFn);
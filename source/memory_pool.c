@@ -0,0 +1,373 @@
+#include "memory_pool.h"
+#include "memory.h"
+#include "thread.h"
+
+#include "console_colors.h"
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32) || defined(WIN32)
+#include <malloc.h>
+#endif
+
+//chunks are chained together, so they can be released in one pass
+typedef struct MemoryChunk {
+	struct MemoryChunk* next;
+	unsigned char padding[MEMORY_POOL_GRANULARITY - sizeof(struct MemoryChunk*)]; //keep the blocks aligned
+} MemoryChunk;
+
+//the pool currently behind reallocate() on this thread
+static TOY_THREAD_LOCAL MemoryPool* activePool = NULL;
+
+//every pool holding chunks, so a block freed on another thread can find its way back
+static atomic_flag registryLock = ATOMIC_FLAG_INIT;
+static atomic_int livePoolCount = 0;
+static MemoryPool* livePools = NULL;
+
+static void lockRegistry() {
+	while (atomic_flag_test_and_set_explicit(&registryLock, memory_order_acquire)) {
+		yieldThread();
+	}
+}
+
+static void unlockRegistry() {
+	atomic_flag_clear_explicit(&registryLock, memory_order_release);
+}
+
+//chunks are aligned to their size, so masking a block's address finds its chunk
+static MemoryChunk* allocateChunk() {
+#if defined(_WIN32) || defined(WIN32)
+	return (MemoryChunk*)_aligned_malloc(MEMORY_POOL_CHUNK_SIZE, MEMORY_POOL_CHUNK_SIZE);
+#else
+	void* chunk = NULL;
+	return posix_memalign(&chunk, MEMORY_POOL_CHUNK_SIZE, MEMORY_POOL_CHUNK_SIZE) == 0 ? (MemoryChunk*)chunk : NULL;
+#endif
+}
+
+static void releaseChunk(MemoryChunk* chunk) {
+#if defined(_WIN32) || defined(WIN32)
+	_aligned_free(chunk);
+#else
+	free(chunk);
+#endif
+}
+
+static void* chunkOf(void* block) {
+	return (void*)((uintptr_t)block & ~(uintptr_t)(MEMORY_POOL_CHUNK_SIZE - 1));
+}
+
+//the chunk table is open addressed, and only grows until the pool is freed
+static size_t chunkSlot(void* chunk, int capacity) {
+	return (size_t)(((uintptr_t)chunk / MEMORY_POOL_CHUNK_SIZE) * 2654435761u) & (size_t)(capacity - 1);
+}
+
+static void insertChunk(void** table, int capacity, void* chunk) {
+	size_t slot = chunkSlot(chunk, capacity);
+
+	while (table[slot] != NULL) {
+		slot = (slot + 1) & (size_t)(capacity - 1);
+	}
+
+	table[slot] = chunk;
+}
+
+//NOTE: only the owner changes the table, so it can read it without the lock - everyone else takes it
+static bool ownsBlock(MemoryPool* pool, void* block) {
+	if (pool->chunkTable == NULL) {
+		return false;
+	}
+
+	void* chunk = chunkOf(block);
+
+	for (size_t slot = chunkSlot(chunk, pool->chunkTableCapacity); pool->chunkTable[slot] != NULL; slot = (slot + 1) & (size_t)(pool->chunkTableCapacity - 1)) {
+		if (pool->chunkTable[slot] == chunk) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+//the registry must be locked
+static void recordChunk(MemoryPool* pool, MemoryChunk* chunk) {
+	//keep the table at most half full
+	if ((pool->chunkCount + 1) * 2 > pool->chunkTableCapacity) {
+		int capacity = pool->chunkTableCapacity < 16 ? 16 : pool->chunkTableCapacity * 2;
+		void** table = calloc(capacity, sizeof(void*));
+
+		if (table == NULL) {
+			fprintf(stderr, ERROR "[internal] Memory pool error (couldn't grow the chunk table)\n" RESET);
+			exit(-1);
+		}
+
+		for (int i = 0; i < pool->chunkTableCapacity; i++) {
+			if (pool->chunkTable[i] != NULL) {
+				insertChunk(table, capacity, pool->chunkTable[i]);
+			}
+		}
+
+		free(pool->chunkTable);
+		pool->chunkTable = table;
+		pool->chunkTableCapacity = capacity;
+	}
+
+	insertChunk(pool->chunkTable, pool->chunkTableCapacity, chunk);
+
+	//the first chunk makes the pool findable
+	if (pool->chunkCount == 0) {
+		pool->nextLive = livePools;
+		livePools = pool;
+		atomic_fetch_add(&livePoolCount, 1);
+	}
+}
+
+//the registry must be locked
+static MemoryPool* findOwner(void* block) {
+	for (MemoryPool* pool = livePools; pool != NULL; pool = pool->nextLive) {
+		if (ownsBlock(pool, block)) {
+			return pool;
+		}
+	}
+
+	return NULL;
+}
+
+//false if no pool owns the block
+static bool releaseRemoteBlock(void* block, int sizeClass) {
+	if (atomic_load(&livePoolCount) == 0) {
+		return false;
+	}
+
+	lockRegistry();
+	MemoryPool* owner = findOwner(block);
+
+	if (owner != NULL) {
+		*(void**)block = owner->remoteFreeLists[sizeClass];
+		owner->remoteFreeLists[sizeClass] = block;
+	}
+
+	unlockRegistry();
+
+	return owner != NULL;
+}
+
+//true if anything came back
+static bool collectRemoteBlocks(MemoryPool* pool) {
+	bool collected = false;
+
+	lockRegistry();
+
+	for (int i = 0; i < MEMORY_POOL_CLASSES; i++) {
+		while (pool->remoteFreeLists[i] != NULL) {
+			void* block = pool->remoteFreeLists[i];
+			pool->remoteFreeLists[i] = *(void**)block;
+
+			*(void**)block = pool->freeLists[i];
+			pool->freeLists[i] = block;
+			collected = true;
+		}
+	}
+
+	unlockRegistry();
+
+	return collected;
+}
+
+//-1 for sizes the pool doesn't handle
+static int sizeClassOf(size_t size) {
+	if (size == 0 || size > MEMORY_POOL_GRANULARITY * MEMORY_POOL_CLASSES) {
+		return -1;
+	}
+
+	return (int)((size + MEMORY_POOL_GRANULARITY - 1) / MEMORY_POOL_GRANULARITY) - 1;
+}
+
+static void* allocateBlock(MemoryPool* pool, int sizeClass) {
+	//reuse a released block if possible
+	if (pool->freeLists[sizeClass] != NULL) {
+		void* block = pool->freeLists[sizeClass];
+		pool->freeLists[sizeClass] = *(void**)block;
+		return block;
+	}
+
+	size_t blockSize = (size_t)(sizeClass + 1) * MEMORY_POOL_GRANULARITY;
+
+	//start a new chunk, abandoning the tail of the old one
+	if (pool->bump == NULL || pool->bump + blockSize > pool->bumpEnd) {
+		//blocks freed on other threads are only collected here, to keep the lock off the common path
+		if (collectRemoteBlocks(pool) && pool->freeLists[sizeClass] != NULL) {
+			return allocateBlock(pool, sizeClass);
+		}
+
+		MemoryChunk* chunk = allocateChunk();
+
+		if (chunk == NULL) {
+			fprintf(stderr, ERROR "[internal] Memory pool error (couldn't allocate a new chunk)\n" RESET);
+			exit(-1);
+		}
+
+		lockRegistry();
+		recordChunk(pool, chunk);
+		unlockRegistry();
+
+		chunk->next = pool->chunks;
+		pool->chunks = chunk;
+		pool->chunkCount++;
+
+		pool->bump = (unsigned char*)(chunk + 1);
+		pool->bumpEnd = (unsigned char*)chunk + MEMORY_POOL_CHUNK_SIZE;
+	}
+
+	void* block = pool->bump;
+	pool->bump += blockSize;
+	return block;
+}
+
+static void releaseBlock(MemoryPool* pool, void* block, int sizeClass) {
+	//blocks from another pool go back to it, and any others came from the default allocator
+	if (!ownsBlock(pool, block)) {
+		if (!releaseRemoteBlock(block, sizeClass)) {
+			free(block);
+		}
+
+		return;
+	}
+
+	*(void**)block = pool->freeLists[sizeClass];
+	pool->freeLists[sizeClass] = block;
+}
+
+static void* poolMemoryAllocator(void* pointer, size_t oldSize, size_t newSize) {
+	MemoryPool* pool = activePool;
+
+	if (newSize == 0 && oldSize == 0) {
+		return NULL;
+	}
+
+	int oldClass = pointer != NULL ? sizeClassOf(oldSize) : -1;
+	int newClass = sizeClassOf(newSize);
+
+	//large blocks are left to the default allocator
+	if ((pointer == NULL || oldClass < 0) && newClass < 0) {
+		return defaultMemoryAllocator(pointer, oldSize, newSize);
+	}
+
+	//still fits
+	if (pointer != NULL && oldClass == newClass) {
+		return pointer;
+	}
+
+	//freeing
+	if (newSize == 0) {
+		releaseBlock(pool, pointer, oldClass);
+		return NULL;
+	}
+
+	//allocating or moving between classes
+	void* mem = newClass >= 0 ? allocateBlock(pool, newClass) : defaultMemoryAllocator(NULL, 0, newSize);
+
+	if (pointer != NULL) {
+		memcpy(mem, pointer, oldSize < newSize ? oldSize : newSize);
+
+		if (oldClass >= 0) {
+			releaseBlock(pool, pointer, oldClass);
+		}
+		else {
+			defaultMemoryAllocator(pointer, oldSize, 0);
+		}
+	}
+
+	return mem;
+}
+
+//exposed API
+void initMemoryPool(MemoryPool* pool) {
+	for (int i = 0; i < MEMORY_POOL_CLASSES; i++) {
+		pool->freeLists[i] = NULL;
+		pool->remoteFreeLists[i] = NULL;
+	}
+
+	pool->chunks = NULL;
+	pool->bump = NULL;
+	pool->bumpEnd = NULL;
+	pool->chunkCount = 0;
+
+	pool->chunkTable = NULL;
+	pool->chunkTableCapacity = 0;
+	pool->nextLive = NULL;
+}
+
+void freeMemoryPool(MemoryPool* pool) {
+	//stop other threads from finding this pool
+	if (pool->chunkCount > 0) {
+		lockRegistry();
+
+		for (MemoryPool** link = &livePools; *link != NULL; link = &(*link)->nextLive) {
+			if (*link == pool) {
+				*link = pool->nextLive;
+				atomic_fetch_sub(&livePoolCount, 1);
+				break;
+			}
+		}
+
+		unlockRegistry();
+	}
+
+	while (pool->chunks != NULL) {
+		MemoryChunk* next = pool->chunks->next;
+		releaseChunk(pool->chunks);
+		pool->chunks = next;
+	}
+
+	free(pool->chunkTable);
+
+	if (activePool == pool) {
+		setMemoryPool(NULL);
+	}
+
+	initMemoryPool(pool);
+}
+
+void setMemoryPool(MemoryPool* pool) {
+	activePool = pool;
+	setMemoryAllocator(pool != NULL ? poolMemoryAllocator : defaultMemoryAllocator);
+}
+
+bool reallocatePoolBlock(void* pointer, size_t oldSize, size_t newSize, void** result) {
+	int sizeClass = sizeClassOf(oldSize);
+
+	if (pointer == NULL || sizeClass < 0 || atomic_load(&livePoolCount) == 0) {
+		return false;
+	}
+
+	lockRegistry();
+	MemoryPool* owner = findOwner(pointer);
+	unlockRegistry();
+
+	if (owner == NULL) {
+		return false;
+	}
+
+	//move the contents out before the block is handed back
+	void* mem = NULL;
+
+	if (newSize > 0) {
+		mem = malloc(newSize);
+
+		if (mem == NULL) {
+			fprintf(stderr, ERROR "[internal] Memory allocation error (requested %d, moving out of a pool)\n" RESET, (int)newSize);
+			exit(-1);
+		}
+
+		memcpy(mem, pointer, oldSize < newSize ? oldSize : newSize);
+	}
+
+	releaseRemoteBlock(pointer, sizeClass);
+
+	*result = mem;
+	return true;
+}
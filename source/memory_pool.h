@@ -0,0 +1,34 @@
+#pragma once
+
+#include "toy_common.h"
+
+//small allocations are rounded up to a size class, and carved out of bump-allocated chunks
+#define MEMORY_POOL_GRANULARITY 16
+#define MEMORY_POOL_CLASSES 16 //up to 256 bytes, anything larger goes straight to the default allocator
+#define MEMORY_POOL_CHUNK_SIZE (64 * 1024)
+
+typedef struct MemoryPool {
+	void* freeLists[MEMORY_POOL_CLASSES]; //released blocks, chained through their first bytes
+	void* remoteFreeLists[MEMORY_POOL_CLASSES]; //blocks released by other threads, picked up when the pool needs a new chunk
+	struct MemoryChunk* chunks;
+	unsigned char* bump;
+	unsigned char* bumpEnd;
+	int chunkCount;
+
+	//the chunks' addresses, so a block can be traced back to its pool
+	void** chunkTable;
+	int chunkTableCapacity;
+	struct MemoryPool* nextLive;
+} MemoryPool;
+
+//NOTE: there are no headers - the oldSize passed to reallocate() picks the size class
+TOY_API void initMemoryPool(MemoryPool* pool);
+TOY_API void freeMemoryPool(MemoryPool* pool); //releases every small block at once, in O(chunks)
+
+//route all allocations through the pool (NULL restores the default allocator)
+//NOTE: blocks can be freed on any thread, and go back to the pool they came from
+//WARNING: keep the pool installed from initInterpreter() until after freeInterpreter(), and alive until every block from it is gone
+TOY_API void setMemoryPool(MemoryPool* pool);
+
+//for allocators that aren't a pool - true if the block belonged to a pool, and has been handed back or moved into *result
+bool reallocatePoolBlock(void* pointer, size_t oldSize, size_t newSize, void** result);
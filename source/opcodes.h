@@ -78,6 +78,24 @@ typedef enum Opcode {
 
 	//meta
 	OP_FN_END, //different from SECTION_END
+
+	//coroutines - NOTE: placed after the meta opcodes, so existing bytecode keeps its meaning
+	OP_YIELD,
+
+	//for-in loops - the iterator lives in the loop's scope
+	OP_ITER_BEGIN,
+	OP_ITER_NEXT, //binds the next element, leaving false once there are none
+	OP_ITER_END,
+
+	//record fields - each step names the field, and the slot the compiler expects it in
+	OP_FIELD_GET,
+	OP_FIELD_SET, //the assignment opcode, then the path from the variable
+
+	//switch statements - jumps like OP_JUMP, chosen by the popped value, with the default target first
+	OP_SWITCH_TABLE, //the lowest case, then a target for every integer up to the highest
+	OP_SWITCH_SEARCH, //sorted integer cases and their targets, for a binary search
+	OP_SWITCH_HASH, //a dictionary in the constant pool, from each case to the index of its target
+
 	OP_SECTION_END = 255,
 	//TODO: add more
 } Opcode;
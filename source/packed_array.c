@@ -0,0 +1,196 @@
+#include "packed_array.h"
+
+#include "memory.h"
+
+#include <string.h>
+
+//utils
+static bool unboxElement(LiteralType elementType, Literal value, int* integer, float* number) {
+	if (elementType == LITERAL_INTEGER && IS_INTEGER(value)) {
+		*integer = AS_INTEGER(value);
+		return true;
+	}
+
+	if (elementType == LITERAL_FLOAT && (IS_FLOAT(value) || IS_INTEGER(value))) {
+		*number = IS_FLOAT(value) ? AS_FLOAT(value) : (float)AS_INTEGER(value);
+		return true;
+	}
+
+	return false;
+}
+
+static Literal boxElement(PackedArray* array, int index) {
+	return array->elementType == LITERAL_INTEGER ? TO_INTEGER_LITERAL(array->as.integers[index]) : TO_FLOAT_LITERAL(array->as.floats[index]);
+}
+
+static void reservePackedArray(PackedArray* array, int capacity) {
+	if (array->capacity >= capacity) {
+		return;
+	}
+
+	//ints and floats are the same width, so either member can grow the buffer
+	int oldCapacity = array->capacity;
+	array->capacity = GROW_CAPACITY(oldCapacity) > capacity ? GROW_CAPACITY(oldCapacity) : capacity;
+	array->as.integers = GROW_ARRAY(int, array->as.integers, oldCapacity, array->capacity);
+}
+
+//exposed functions
+PackedArray* createPackedArray(LiteralType elementType) {
+	PackedArray* array = ALLOCATE(PackedArray, 1);
+
+	array->elementType = elementType;
+	array->capacity = 0;
+	array->count = 0;
+	array->as.integers = NULL;
+
+	return array;
+}
+
+void freePackedArray(PackedArray* array) {
+	FREE_ARRAY(int, array->as.integers, array->capacity);
+	FREE(PackedArray, array);
+}
+
+PackedArray* copyPackedArray(PackedArray* original) {
+	PackedArray* array = createPackedArray(original->elementType);
+
+	reservePackedArray(array, original->count);
+	if (original->count > 0) {
+		memcpy(array->as.integers, original->as.integers, sizeof(int) * original->count);
+	}
+	array->count = original->count;
+
+	return array;
+}
+
+bool pushPackedArray(PackedArray* array, Literal value) {
+	int integer = 0;
+	float number = 0;
+
+	if (!unboxElement(array->elementType, value, &integer, &number)) {
+		return false;
+	}
+
+	reservePackedArray(array, array->count + 1);
+
+	if (array->elementType == LITERAL_INTEGER) {
+		array->as.integers[array->count++] = integer;
+	}
+	else {
+		array->as.floats[array->count++] = number;
+	}
+
+	return true;
+}
+
+Literal popPackedArray(PackedArray* array) {
+	if (array->count <= 0) {
+		return TO_NULL_LITERAL;
+	}
+
+	array->count--;
+	return boxElement(array, array->count);
+}
+
+bool setPackedArray(PackedArray* array, int index, Literal value) {
+	int integer = 0;
+	float number = 0;
+
+	if (index < 0 || index >= array->count || !unboxElement(array->elementType, value, &integer, &number)) {
+		return false;
+	}
+
+	if (array->elementType == LITERAL_INTEGER) {
+		array->as.integers[index] = integer;
+	}
+	else {
+		array->as.floats[index] = number;
+	}
+
+	return true;
+}
+
+Literal getPackedArray(PackedArray* array, int index) {
+	if (index < 0 || index >= array->count) {
+		return TO_NULL_LITERAL;
+	}
+
+	return boxElement(array, index);
+}
+
+void resizePackedArray(PackedArray* array, int count) {
+	reservePackedArray(array, count);
+
+	if (count > array->count) {
+		memset(array->as.integers + array->count, 0, sizeof(int) * (count - array->count));
+	}
+
+	array->count = count;
+}
+
+LiteralType packedElementType(Literal type) {
+	if (!IS_TYPE(type) || AS_TYPE(type).typeOf != LITERAL_ARRAY || AS_TYPE(type).count != 1) {
+		return LITERAL_NULL;
+	}
+
+	Literal subtype = ((Literal*)(AS_TYPE(type).subtypes))[0];
+
+	if (!IS_TYPE(subtype) || (AS_TYPE(subtype).typeOf != LITERAL_INTEGER && AS_TYPE(subtype).typeOf != LITERAL_FLOAT)) {
+		return LITERAL_NULL;
+	}
+
+	return AS_TYPE(subtype).typeOf;
+}
+
+Literal packLiteralArray(LiteralArray* array, LiteralType elementType) {
+	PackedArray* packed = createPackedArray(elementType);
+	reservePackedArray(packed, array->count);
+
+	for (int i = 0; i < array->count; i++) {
+		if (!pushPackedArray(packed, array->literals[i])) {
+			freePackedArray(packed);
+			return TO_NULL_LITERAL;
+		}
+	}
+
+	return TO_PACKED_ARRAY_LITERAL(packed);
+}
+
+Literal unpackLiteralArray(PackedArray* array) {
+	LiteralArray* unpacked = ALLOCATE(LiteralArray, 1);
+	initLiteralArray(unpacked);
+
+	for (int i = 0; i < array->count; i++) {
+		pushLiteralArray(unpacked, boxElement(array, i));
+	}
+
+	return TO_ARRAY_LITERAL(unpacked);
+}
+
+bool packedArraysAreEqual(Literal lhs, Literal rhs) {
+	if ((!IS_PACKED_ARRAY(lhs) && !IS_ARRAY(lhs)) || (!IS_PACKED_ARRAY(rhs) && !IS_ARRAY(rhs))) {
+		return false;
+	}
+
+	int count = IS_PACKED_ARRAY(lhs) ? AS_PACKED_ARRAY(lhs)->count : AS_ARRAY(lhs)->count;
+
+	if (count != (IS_PACKED_ARRAY(rhs) ? AS_PACKED_ARRAY(rhs)->count : AS_ARRAY(rhs)->count)) {
+		return false;
+	}
+
+	//matching buffers can be compared wholesale, but float comparisons must see -0 and NaN
+	if (IS_PACKED_ARRAY(lhs) && IS_PACKED_ARRAY(rhs) && AS_PACKED_ARRAY(lhs)->elementType == LITERAL_INTEGER && AS_PACKED_ARRAY(rhs)->elementType == LITERAL_INTEGER) {
+		return count == 0 || memcmp(AS_PACKED_ARRAY(lhs)->as.integers, AS_PACKED_ARRAY(rhs)->as.integers, sizeof(int) * count) == 0;
+	}
+
+	for (int i = 0; i < count; i++) {
+		Literal l = IS_PACKED_ARRAY(lhs) ? boxElement(AS_PACKED_ARRAY(lhs), i) : AS_ARRAY(lhs)->literals[i];
+		Literal r = IS_PACKED_ARRAY(rhs) ? boxElement(AS_PACKED_ARRAY(rhs), i) : AS_ARRAY(rhs)->literals[i];
+
+		if (!literalsAreEqual(l, r)) {
+			return false;
+		}
+	}
+
+	return true;
+}
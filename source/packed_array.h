@@ -0,0 +1,33 @@
+#pragma once
+
+#include "toy_common.h"
+#include "literal.h"
+#include "literal_array.h"
+
+//the unboxed storage behind variables typed [int] or [float] - elements are boxed only as they're read
+typedef struct PackedArray {
+	LiteralType elementType; //LITERAL_INTEGER or LITERAL_FLOAT
+	int capacity;
+	int count;
+	union {
+		int* integers;
+		float* floats;
+	} as;
+} PackedArray;
+
+TOY_API PackedArray* createPackedArray(LiteralType elementType);
+TOY_API void freePackedArray(PackedArray* array);
+TOY_API PackedArray* copyPackedArray(PackedArray* original);
+
+TOY_API bool pushPackedArray(PackedArray* array, Literal value); //false if the value doesn't fit - integers are widened for float arrays
+TOY_API Literal popPackedArray(PackedArray* array);
+TOY_API bool setPackedArray(PackedArray* array, int index, Literal value); //false if out of range, or the value doesn't fit
+TOY_API Literal getPackedArray(PackedArray* array, int index); //null if out of range
+TOY_API void resizePackedArray(PackedArray* array, int count); //new elements are zeroed
+
+//conversions
+TOY_API LiteralType packedElementType(Literal type); //the element type of [int] or [float], otherwise LITERAL_NULL
+TOY_API Literal packLiteralArray(LiteralArray* array, LiteralType elementType); //null if any element doesn't fit
+TOY_API Literal unpackLiteralArray(PackedArray* array); //a plain array of the boxed elements
+
+bool packedArraysAreEqual(Literal lhs, Literal rhs); //either side may be a plain array
@@ -56,6 +56,13 @@ static void consume(Parser* parser, TokenType tokenType, const char* msg) {
 	advance(parser);
 }
 
+//looks one token past the current one, without consuming anything
+static Token peekNext(Parser* parser) {
+	//NOTE: in verbose mode, the token is echoed twice
+	Lexer lexer = *parser->lexer;
+	return scanLexer(&lexer);
+}
+
 static void synchronize(Parser* parser) {
 #ifndef TOY_EXPORT
 	if (command.verbose) {
@@ -80,6 +87,9 @@ static void synchronize(Parser* parser) {
 			case TOKEN_RETURN:
 			case TOKEN_VAR:
 			case TOKEN_WHILE:
+			case TOKEN_YIELD:
+			case TOKEN_STRUCT:
+			case TOKEN_SWITCH:
 				parser->panic = false;
 				return;
 
@@ -204,7 +214,7 @@ static Opcode compound(Parser* parser, ASTNode** nodeHandle) {
 				int oldCapacity = dictionary->compound.capacity;
 
 				dictionary->compound.capacity = GROW_CAPACITY(oldCapacity);
-				dictionary->compound.nodes = GROW_ARRAY(ASTNode, dictionary->compound.nodes, oldCapacity, dictionary->compound.capacity);
+				dictionary->compound.nodes = GROW_AST_NODES(dictionary->compound.nodes, oldCapacity, dictionary->compound.capacity);
 			}
 
 			//store the left and right in the node
@@ -229,12 +239,12 @@ static Opcode compound(Parser* parser, ASTNode** nodeHandle) {
 				int oldCapacity = array->compound.capacity;
 
 				array->compound.capacity = GROW_CAPACITY(oldCapacity);
-				array->compound.nodes = GROW_ARRAY(ASTNode, array->compound.nodes, oldCapacity, array->compound.capacity);
+				array->compound.nodes = GROW_AST_NODES(array->compound.nodes, oldCapacity, array->compound.capacity);
 			}
 
 			//copy into the array, and manually free the temp node
 			array->compound.nodes[array->compound.count++] = *left;
-			FREE(ASTNode, left);
+			FREE_AST_NODE(left);
 		}
 	}
 
@@ -689,13 +699,13 @@ static Opcode fnCall(Parser* parser, ASTNode** nodeHandle) {
 						int oldCapacity = arguments->fnCollection.capacity;
 
 						arguments->fnCollection.capacity = GROW_CAPACITY(oldCapacity);
-						arguments->fnCollection.nodes = GROW_ARRAY(ASTNode, arguments->fnCollection.nodes, oldCapacity, arguments->fnCollection.capacity);
+						arguments->fnCollection.nodes = GROW_AST_NODES(arguments->fnCollection.nodes, oldCapacity, arguments->fnCollection.capacity);
 					}
 
 					ASTNode* tmpNode = NULL;
 					parsePrecedence(parser, &tmpNode, PREC_TERNARY);
 					arguments->fnCollection.nodes[arguments->fnCollection.count++] = *tmpNode;
-					FREE(ASTNode, tmpNode); //simply free the tmpNode, so you don't free the children
+					FREE_AST_NODE(tmpNode); //simply free the tmpNode, so you don't free the children
 				} while(match(parser, TOKEN_COMMA));
 
 				consume(parser, TOKEN_PAREN_RIGHT, "Expected ')' at end of argument list");
@@ -778,9 +788,41 @@ static Opcode indexAccess(Parser* parser, ASTNode** nodeHandle) { //TODO: fix in
 	return OP_INDEX;
 }
 
+//a name after the dot that isn't called is a record field
+static Opcode field(Parser* parser, ASTNode** nodeHandle) {
+	advance(parser);
+
+	int length = parser->previous.length;
+
+	//for safety
+	if (length > 256) {
+		length = 256;
+		error(parser, parser->previous, "Identifiers can only be a maximum of 256 characters long");
+	}
+
+	Literal name = TO_IDENTIFIER_LITERAL(createRefStringLength(parser->previous.lexeme, length));
+
+	//the slot is only known if every struct so far agrees on it
+	int slot = -1;
+	if (existsLiteralDictionary(&parser->recordSlots, name)) {
+		Literal lit = getLiteralDictionary(&parser->recordSlots, name);
+		slot = AS_INTEGER(lit);
+	}
+
+	emitASTNodeField(nodeHandle, name, slot);
+
+	freeLiteral(name);
+
+	return OP_FIELD_GET;
+}
+
 static Opcode dot(Parser* parser, ASTNode** nodeHandle) {
 	advance(parser); //for the dot
 
+	if (parser->current.type == TOKEN_IDENTIFIER && peekNext(parser).type != TOKEN_PAREN_LEFT) {
+		return field(parser, nodeHandle);
+	}
+
 	ASTNode* tmpNode = NULL;
 	parsePrecedence(parser, &tmpNode, PREC_CALL);
 
@@ -829,6 +871,11 @@ ParseRule parseRules[] = { //must match the token types
 	{typeOf, NULL, PREC_CALL},// TOKEN_TYPEOF,
 	{NULL, NULL, PREC_NONE},// TOKEN_VAR,
 	{NULL, NULL, PREC_NONE},// TOKEN_WHILE,
+	{NULL, NULL, PREC_NONE},// TOKEN_YIELD,
+	{NULL, NULL, PREC_NONE},// TOKEN_STRUCT,
+	{NULL, NULL, PREC_NONE},// TOKEN_SWITCH,
+	{NULL, NULL, PREC_NONE},// TOKEN_CASE,
+	{NULL, NULL, PREC_NONE},// TOKEN_DEFAULT,
 
 	//literal values
 	{identifier, castingInfix, PREC_PRIMARY},// TOKEN_IDENTIFIER,
@@ -1122,6 +1169,18 @@ static void parsePrecedence(Parser* parser, ASTNode** nodeHandle, PrecedenceRule
 
 		emitASTNodeBinary(nodeHandle, rhsNode, opcode);
 
+		//fields can only be written through a variable
+		if (opcode >= OP_VAR_ASSIGN && opcode <= OP_VAR_MODULO_ASSIGN && (*nodeHandle)->binary.left->type == AST_NODE_BINARY && (*nodeHandle)->binary.left->binary.opcode == OP_FIELD_GET) {
+			ASTNode* root = (*nodeHandle)->binary.left;
+			while (root->type == AST_NODE_BINARY && root->binary.opcode == OP_FIELD_GET) {
+				root = root->binary.left;
+			}
+
+			if (root->type != AST_NODE_LITERAL || !IS_IDENTIFIER(root->atomic.literal)) {
+				error(parser, parser->previous, "Only the fields of a variable can be assigned to");
+			}
+		}
+
 		//optimise away the constants
 		if (!calcStaticBinaryArithmetic(parser, nodeHandle)) {
 			return;
@@ -1151,7 +1210,7 @@ static void blockStmt(Parser* parser, ASTNode** nodeHandle) {
 			int oldCapacity = (*nodeHandle)->block.capacity;
 
 			(*nodeHandle)->block.capacity = GROW_CAPACITY(oldCapacity);
-			(*nodeHandle)->block.nodes = GROW_ARRAY(ASTNode, (*nodeHandle)->block.nodes, oldCapacity, (*nodeHandle)->block.capacity);
+			(*nodeHandle)->block.nodes = GROW_AST_NODES((*nodeHandle)->block.nodes, oldCapacity, (*nodeHandle)->block.capacity);
 		}
 
 		ASTNode* tmpNode = NULL;
@@ -1166,7 +1225,7 @@ static void blockStmt(Parser* parser, ASTNode** nodeHandle) {
 
 		//BUGFIX: statements no longer require the existing node
 		((*nodeHandle)->block.nodes[(*nodeHandle)->block.count++]) = *tmpNode;
-		FREE(ASTNode, tmpNode); //simply free the tmpNode, so you don't free the children
+		FREE_AST_NODE(tmpNode); //simply free the tmpNode, so you don't free the children
 	}
 }
 
@@ -1179,9 +1238,25 @@ static void printStmt(Parser* parser, ASTNode** nodeHandle) {
 	consume(parser, TOKEN_SEMICOLON, "Expected ';' at end of print statement");
 }
 
+static void yieldStmt(Parser* parser, ASTNode** nodeHandle) {
+	ASTNode* node = NULL;
+
+	//a bare yield hands back null
+	if (match(parser, TOKEN_SEMICOLON)) {
+		emitASTNodeLiteral(&node, TO_NULL_LITERAL);
+		emitASTNodeUnary(nodeHandle, OP_YIELD, node);
+		return;
+	}
+
+	expression(parser, &node);
+	emitASTNodeUnary(nodeHandle, OP_YIELD, node);
+
+	consume(parser, TOKEN_SEMICOLON, "Expected ';' at end of yield statement");
+}
+
 static void assertStmt(Parser* parser, ASTNode** nodeHandle) {
 	//set the node info
-	(*nodeHandle) = ALLOCATE(ASTNode, 1); //special case, because I'm lazy
+	(*nodeHandle) = ALLOCATE_AST_NODE(); //special case, because I'm lazy
 	(*nodeHandle)->type = AST_NODE_BINARY;
 	(*nodeHandle)->binary.opcode = OP_ASSERT;
 
@@ -1228,6 +1303,46 @@ static void whileStmt(Parser* parser, ASTNode** nodeHandle) {
 	emitASTNodeWhile(nodeHandle, condition, thenPath);
 }
 
+static Literal readForInIdentifier(Parser* parser) {
+	consume(parser, TOKEN_IDENTIFIER, "Expected identifier in for-in clause");
+
+	int length = parser->previous.length;
+
+	//for safety
+	if (length > 256) {
+		length = 256;
+		error(parser, parser->previous, "Identifiers can only be a maximum of 256 characters long");
+	}
+
+	return TO_IDENTIFIER_LITERAL(createRefStringLength(parser->previous.lexeme, length));
+}
+
+//for (x in collection) or for (k, v in collection)
+static void forInStmt(Parser* parser, ASTNode** nodeHandle) {
+	ASTNode* collection = NULL;
+	ASTNode* thenPath = NULL;
+
+	Literal first = readForInIdentifier(parser);
+	Literal second = TO_NULL_LITERAL;
+
+	if (match(parser, TOKEN_COMMA)) {
+		second = readForInIdentifier(parser);
+	}
+
+	consume(parser, TOKEN_IN, "Expected 'in' in for-in clause");
+
+	expression(parser, &collection);
+	consume(parser, TOKEN_PAREN_RIGHT, "Expected ')' at end of for-in clause");
+
+	//read the path
+	declaration(parser, &thenPath);
+
+	emitASTNodeForIn(nodeHandle, first, second, collection, thenPath);
+
+	freeLiteral(first);
+	freeLiteral(second);
+}
+
 static void forStmt(Parser* parser, ASTNode** nodeHandle) {
 	ASTNode* preClause = NULL;
 	ASTNode* condition = NULL;
@@ -1237,6 +1352,16 @@ static void forStmt(Parser* parser, ASTNode** nodeHandle) {
 	//read the clauses
 	consume(parser, TOKEN_PAREN_LEFT, "Expected '(' at beginning of for clause");
 
+	//an identifier followed by "in" or "," can only be a for-in loop
+	if (parser->current.type == TOKEN_IDENTIFIER) {
+		TokenType next = peekNext(parser).type;
+
+		if (next == TOKEN_IN || next == TOKEN_COMMA) {
+			forInStmt(parser, nodeHandle);
+			return;
+		}
+	}
+
 	declaration(parser, &preClause); //allow defining variables in the pre-clause
 
 	parsePrecedence(parser, &condition, PREC_TERNARY);
@@ -1251,6 +1376,134 @@ static void forStmt(Parser* parser, ASTNode** nodeHandle) {
 	emitASTNodeFor(nodeHandle, preClause, condition, postClause, thenPath);
 }
 
+//case labels must be known at compile time, to build the dispatch tables
+static bool readCaseLabel(Parser* parser, ASTNode* switchNode, ASTNode* labels) {
+	ASTNode* node = NULL;
+	parsePrecedence(parser, &node, PREC_TERNARY);
+
+	if (parser->panic) {
+		freeASTNode(node);
+		return false;
+	}
+
+	if (node == NULL || node->type != AST_NODE_LITERAL || IS_NULL(node->atomic.literal) || IS_IDENTIFIER(node->atomic.literal)) {
+		error(parser, parser->previous, "Expected a constant boolean, number or string in case");
+		freeASTNode(node);
+		return false;
+	}
+
+	//the same value can't lead to two cases (the earlier ones, then this one)
+	for (int i = 0; i <= switchNode->pathSwitch.count; i++) {
+		ASTNode* others = i < switchNode->pathSwitch.count ? switchNode->pathSwitch.cases[i].pair.left : labels;
+
+		for (int j = 0; j < others->compound.count; j++) {
+			Literal other = others->compound.nodes[j].atomic.literal;
+
+			if (other.type == node->atomic.literal.type && literalsAreEqual(other, node->atomic.literal)) {
+				error(parser, parser->previous, "Duplicate case in switch statement");
+				freeASTNode(node);
+				return false;
+			}
+		}
+	}
+
+	if (labels->compound.capacity < labels->compound.count + 1) {
+		int oldCapacity = labels->compound.capacity;
+
+		labels->compound.capacity = GROW_CAPACITY(oldCapacity);
+		labels->compound.nodes = GROW_AST_NODES(labels->compound.nodes, oldCapacity, labels->compound.capacity);
+	}
+
+	labels->compound.nodes[labels->compound.count++] = *node;
+	FREE_AST_NODE(node); //free manually
+
+	return true;
+}
+
+//switch (value) { case 1, 2: ... default: ... } - cases don't fall through, and break leaves early
+static void switchStmt(Parser* parser, ASTNode** nodeHandle) {
+	ASTNode* value = NULL;
+
+	consume(parser, TOKEN_PAREN_LEFT, "Expected '(' at beginning of switch clause");
+	parsePrecedence(parser, &value, PREC_TERNARY);
+	consume(parser, TOKEN_PAREN_RIGHT, "Expected ')' at end of switch clause");
+
+	emitASTNodeSwitch(nodeHandle, value);
+	ASTNode* node = *nodeHandle;
+
+	consume(parser, TOKEN_BRACE_LEFT, "Expected '{' at beginning of switch body");
+
+	bool hasDefault = false;
+
+	while (!match(parser, TOKEN_BRACE_RIGHT)) {
+		ASTNode* labels = NULL;
+		emitASTNodeCompound(&labels, LITERAL_ARRAY);
+
+		if (match(parser, TOKEN_CASE)) {
+			do {
+				if (!readCaseLabel(parser, node, labels)) {
+					freeASTNode(labels);
+					return;
+				}
+			} while (match(parser, TOKEN_COMMA));
+		}
+		else if (match(parser, TOKEN_DEFAULT)) {
+			if (hasDefault) {
+				error(parser, parser->previous, "Only one default is allowed in a switch statement");
+				freeASTNode(labels);
+				return;
+			}
+			hasDefault = true;
+		}
+		else {
+			error(parser, parser->current, "Expected 'case' or 'default' in switch statement");
+			freeASTNode(labels);
+			return;
+		}
+
+		consume(parser, TOKEN_COLON, "Expected ':' after case");
+
+		if (parser->panic) {
+			freeASTNode(labels);
+			return;
+		}
+
+		//the case's statements run until the next case
+		ASTNode* body = NULL;
+		emitASTNodeBlock(&body);
+
+		while (parser->current.type != TOKEN_CASE && parser->current.type != TOKEN_DEFAULT && parser->current.type != TOKEN_BRACE_RIGHT && parser->current.type != TOKEN_EOF) {
+			if (body->block.capacity < body->block.count + 1) {
+				int oldCapacity = body->block.capacity;
+
+				body->block.capacity = GROW_CAPACITY(oldCapacity);
+				body->block.nodes = GROW_AST_NODES(body->block.nodes, oldCapacity, body->block.capacity);
+			}
+
+			ASTNode* tmpNode = NULL;
+			declaration(parser, &tmpNode);
+
+			if (parser->panic) {
+				freeASTNode(labels);
+				freeASTNode(body);
+				return;
+			}
+
+			body->block.nodes[body->block.count++] = *tmpNode;
+			FREE_AST_NODE(tmpNode); //simply free the tmpNode, so you don't free the children
+		}
+
+		if (node->pathSwitch.capacity < node->pathSwitch.count + 1) {
+			int oldCapacity = node->pathSwitch.capacity;
+
+			node->pathSwitch.capacity = GROW_CAPACITY(oldCapacity);
+			node->pathSwitch.cases = GROW_AST_NODES(node->pathSwitch.cases, oldCapacity, node->pathSwitch.capacity);
+		}
+
+		setASTNodePair(&node->pathSwitch.cases[node->pathSwitch.count++], labels, body);
+	}
+}
+
 static void breakStmt(Parser* parser, ASTNode** nodeHandle) {
 	emitASTNodeBreak(nodeHandle);
 
@@ -1274,14 +1527,14 @@ static void returnStmt(Parser* parser, ASTNode** nodeHandle) {
 				int oldCapacity = returnValues->fnCollection.capacity;
 
 				returnValues->fnCollection.capacity = GROW_CAPACITY(oldCapacity);
-				returnValues->fnCollection.nodes = GROW_ARRAY(ASTNode, returnValues->fnCollection.nodes, oldCapacity, returnValues->fnCollection.capacity);
+				returnValues->fnCollection.nodes = GROW_AST_NODES(returnValues->fnCollection.nodes, oldCapacity, returnValues->fnCollection.capacity);
 			}
 
 			ASTNode* node = NULL;
 			parsePrecedence(parser, &node, PREC_TERNARY);
 
 			returnValues->fnCollection.nodes[returnValues->fnCollection.count++] = *node;
-			FREE(ASTNode, node); //free manually
+			FREE_AST_NODE(node); //free manually
 		} while(match(parser, TOKEN_COMMA));
 
 		consume(parser, TOKEN_SEMICOLON, "Expected ';' at end of return statement");
@@ -1383,6 +1636,12 @@ static void statement(Parser* parser, ASTNode** nodeHandle) {
 		return;
 	}
 
+	//yield
+	if (match(parser, TOKEN_YIELD)) {
+		yieldStmt(parser, nodeHandle);
+		return;
+	}
+
 	//assert
 	if (match(parser, TOKEN_ASSERT)) {
 		assertStmt(parser, nodeHandle);
@@ -1407,6 +1666,12 @@ static void statement(Parser* parser, ASTNode** nodeHandle) {
 		return;
 	}
 
+	//switch-case-default
+	if (match(parser, TOKEN_SWITCH)) {
+		switchStmt(parser, nodeHandle);
+		return;
+	}
+
 	//break
 	if (match(parser, TOKEN_BREAK)) {
 		breakStmt(parser, nodeHandle);
@@ -1528,7 +1793,12 @@ static Literal readTypeToLiteral(Parser* parser) {
 
 	//const follows the type
 	if (match(parser, TOKEN_CONST)) {
-		AS_TYPE(literal).constant = true;
+		if (IS_TYPE(literal)) {
+			AS_TYPE(literal).constant = true;
+		}
+		else {
+			error(parser, parser->previous, "Named types can't be const");
+		}
 	}
 
 	return literal;
@@ -1626,7 +1896,7 @@ static void fnDecl(Parser* parser, ASTNode** nodeHandle) {
 					int oldCapacity = argumentNode->fnCollection.capacity;
 
 					argumentNode->fnCollection.capacity = GROW_CAPACITY(oldCapacity);
-					argumentNode->fnCollection.nodes = GROW_ARRAY(ASTNode, argumentNode->fnCollection.nodes, oldCapacity, argumentNode->fnCollection.capacity);
+					argumentNode->fnCollection.nodes = GROW_AST_NODES(argumentNode->fnCollection.nodes, oldCapacity, argumentNode->fnCollection.capacity);
 				}
 
 				//store the arg in the array
@@ -1634,7 +1904,7 @@ static void fnDecl(Parser* parser, ASTNode** nodeHandle) {
 				emitASTNodeVarDecl(&literalNode, argIdentifier, argTypeLiteral, NULL);
 
 				argumentNode->fnCollection.nodes[argumentNode->fnCollection.count++] = *literalNode;
-				FREE(ASTNode, literalNode);
+				FREE_AST_NODE(literalNode);
 
 				break;
 			}
@@ -1668,7 +1938,7 @@ static void fnDecl(Parser* parser, ASTNode** nodeHandle) {
 				int oldCapacity = argumentNode->fnCollection.capacity;
 
 				argumentNode->fnCollection.capacity = GROW_CAPACITY(oldCapacity);
-				argumentNode->fnCollection.nodes = GROW_ARRAY(ASTNode, argumentNode->fnCollection.nodes, oldCapacity, argumentNode->fnCollection.capacity);
+				argumentNode->fnCollection.nodes = GROW_AST_NODES(argumentNode->fnCollection.nodes, oldCapacity, argumentNode->fnCollection.capacity);
 			}
 
 			//store the arg in the array
@@ -1676,7 +1946,7 @@ static void fnDecl(Parser* parser, ASTNode** nodeHandle) {
 			emitASTNodeVarDecl(&literalNode, argIdentifier, argTypeLiteral, NULL);
 
 			argumentNode->fnCollection.nodes[argumentNode->fnCollection.count++] = *literalNode;
-			FREE(ASTNode, literalNode);
+			FREE_AST_NODE(literalNode);
 
 		} while (match(parser, TOKEN_COMMA)); //if comma is read, continue
 
@@ -1694,14 +1964,14 @@ static void fnDecl(Parser* parser, ASTNode** nodeHandle) {
 				int oldCapacity = returnNode->fnCollection.capacity;
 
 				returnNode->fnCollection.capacity = GROW_CAPACITY(oldCapacity);
-				returnNode->fnCollection.nodes = GROW_ARRAY(ASTNode, returnNode->fnCollection.nodes, oldCapacity, returnNode->fnCollection.capacity);
+				returnNode->fnCollection.nodes = GROW_AST_NODES(returnNode->fnCollection.nodes, oldCapacity, returnNode->fnCollection.capacity);
 			}
 
 			ASTNode* literalNode = NULL;
 			emitASTNodeLiteral(&literalNode, readTypeToLiteral(parser));
 
 			returnNode->fnCollection.nodes[returnNode->fnCollection.count++] = *literalNode;
-			FREE(ASTNode, literalNode);
+			FREE_AST_NODE(literalNode);
 		} while(match(parser, TOKEN_COMMA));
 	}
 
@@ -1715,6 +1985,118 @@ static void fnDecl(Parser* parser, ASTNode** nodeHandle) {
 	emitASTNodeFnDecl(nodeHandle, identifier, argumentNode, returnNode, blockNode);
 }
 
+//field accesses compiled from here on can use the slot - unless another struct puts the same name elsewhere
+static void declareRecordSlot(Parser* parser, Literal name, int slot) {
+	if (existsLiteralDictionary(&parser->recordSlots, name)) {
+		Literal known = getLiteralDictionary(&parser->recordSlots, name);
+
+		if (AS_INTEGER(known) != slot) {
+			setLiteralDictionary(&parser->recordSlots, name, TO_INTEGER_LITERAL(-1));
+		}
+		return;
+	}
+
+	setLiteralDictionary(&parser->recordSlots, name, TO_INTEGER_LITERAL(slot));
+}
+
+static void pushArgumentNode(ASTNode* arguments, Literal literal) {
+	if (arguments->fnCollection.capacity < arguments->fnCollection.count + 1) {
+		int oldCapacity = arguments->fnCollection.capacity;
+
+		arguments->fnCollection.capacity = GROW_CAPACITY(oldCapacity);
+		arguments->fnCollection.nodes = GROW_AST_NODES(arguments->fnCollection.nodes, oldCapacity, arguments->fnCollection.capacity);
+	}
+
+	ASTNode* literalNode = NULL;
+	emitASTNodeLiteral(&literalNode, literal);
+
+	arguments->fnCollection.nodes[arguments->fnCollection.count++] = *literalNode;
+	FREE_AST_NODE(literalNode);
+}
+
+//struct Name { field: type, ... } declares a constant holding a blank record, via _record("Name", "field", type, ...)
+static void structDecl(Parser* parser, ASTNode** nodeHandle) {
+	//read the identifier
+	consume(parser, TOKEN_IDENTIFIER, "Expected identifier after struct keyword");
+	Token identifierToken = parser->previous;
+
+	int length = identifierToken.length;
+
+	//for safety
+	if (length > 256) {
+		length = 256;
+		error(parser, parser->previous, "Identifiers can only be a maximum of 256 characters long");
+	}
+
+	Literal identifier = TO_IDENTIFIER_LITERAL(createRefStringLength(identifierToken.lexeme, length));
+
+	consume(parser, TOKEN_BRACE_LEFT, "Expected '{' after struct identifier");
+
+	ASTNode* arguments = NULL;
+	emitASTNodeFnCollection(&arguments);
+
+	Literal name = TO_STRING_LITERAL(createRefStringLength(identifierToken.lexeme, length));
+	pushArgumentNode(arguments, name);
+	freeLiteral(name);
+
+	//read each field, with an optional trailing comma
+	int slot = 0;
+	while (!match(parser, TOKEN_BRACE_RIGHT)) {
+		consume(parser, TOKEN_IDENTIFIER, "Expected field identifier in struct definition");
+
+		if (parser->panic) {
+			break;
+		}
+
+		int fieldLength = parser->previous.length;
+
+		//for safety
+		if (fieldLength > 256) {
+			fieldLength = 256;
+			error(parser, parser->previous, "Identifiers can only be a maximum of 256 characters long");
+		}
+
+		Literal fieldName = TO_STRING_LITERAL(createRefStringLength(parser->previous.lexeme, fieldLength));
+		Literal fieldIdentifier = TO_IDENTIFIER_LITERAL(createRefStringLength(parser->previous.lexeme, fieldLength));
+
+		//read the type, if present
+		Literal typeLiteral;
+		if (match(parser, TOKEN_COLON)) {
+			typeLiteral = readTypeToLiteral(parser);
+		}
+		else {
+			//default to non-const any
+			typeLiteral = TO_TYPE_LITERAL(LITERAL_ANY, false);
+		}
+
+		pushArgumentNode(arguments, fieldName);
+		pushArgumentNode(arguments, typeLiteral);
+		declareRecordSlot(parser, fieldIdentifier, slot++);
+
+		freeLiteral(fieldName);
+		freeLiteral(fieldIdentifier);
+		freeLiteral(typeLiteral);
+
+		if (!match(parser, TOKEN_COMMA)) {
+			consume(parser, TOKEN_BRACE_RIGHT, "Expected '}' at end of struct definition");
+			break;
+		}
+	}
+
+	//the call to the native
+	ASTNode* callNode = NULL;
+	emitASTNodeFnCall(&callNode, arguments);
+
+	Literal native = TO_IDENTIFIER_LITERAL(createRefString("_record"));
+	ASTNode* expressionNode = NULL;
+	emitASTNodeLiteral(&expressionNode, native);
+	emitASTNodeBinary(&expressionNode, callNode, OP_FN_CALL);
+	freeLiteral(native);
+
+	//declare it
+	emitASTNodeVarDecl(nodeHandle, identifier, TO_TYPE_LITERAL(LITERAL_ANY, true), expressionNode);
+}
+
 static void declaration(Parser* parser, ASTNode** nodeHandle) { //assume nodeHandle holds a blank node
 	//variable declarations
 	if (match(parser, TOKEN_VAR)) {
@@ -1723,6 +2105,9 @@ static void declaration(Parser* parser, ASTNode** nodeHandle) { //assume nodeHan
 	else if (match(parser, TOKEN_FUNCTION)) {
 		fnDecl(parser, nodeHandle);
 	}
+	else if (match(parser, TOKEN_STRUCT)) {
+		structDecl(parser, nodeHandle);
+	}
 	else {
 		statement(parser, nodeHandle);
 	}
@@ -1736,10 +2121,36 @@ void initParser(Parser* parser, Lexer* lexer) {
 
 	parser->previous.type = TOKEN_NULL;
 	parser->current.type = TOKEN_NULL;
+
+	initASTArena(&parser->arena);
+	parser->roots = NULL;
+	parser->rootCapacity = 0;
+	parser->rootCount = 0;
+
+	initLiteralDictionary(&parser->recordSlots);
+
 	advance(parser);
 }
 
 void freeParser(Parser* parser) {
+	//release the literals held by each tree, then the nodes themselves all at once
+	ASTArena* previousArena = setASTArena(&parser->arena);
+
+	for (int i = 0; i < parser->rootCount; i++) {
+		freeASTNode(parser->roots[i]);
+	}
+
+	setASTArena(previousArena);
+
+	FREE_ARRAY(ASTNode*, parser->roots, parser->rootCapacity);
+	parser->roots = NULL;
+	parser->rootCapacity = 0;
+	parser->rootCount = 0;
+
+	freeASTArena(&parser->arena);
+
+	freeLiteralDictionary(&parser->recordSlots);
+
 	parser->lexer = NULL;
 	parser->error = false;
 	parser->panic = false;
@@ -1754,7 +2165,8 @@ ASTNode* scanParser(Parser* parser) {
 		return NULL;
 	}
 
-	//returns nodes on the heap
+	//returns nodes from the parser's arena
+	ASTArena* previousArena = setASTArena(&parser->arena);
 	ASTNode* node = NULL;
 
 	//process the grammar rule for this line
@@ -1764,10 +2176,22 @@ ASTNode* scanParser(Parser* parser) {
 		synchronize(parser);
 		//return an error node for this iteration
 		freeASTNode(node);
-		node = ALLOCATE(ASTNode, 1);
+		node = ALLOCATE_AST_NODE();
 		node->type = AST_NODE_ERROR;
 	}
 
+	setASTArena(previousArena);
+
+	//remember the tree, so its literals can be released later
+	if (parser->rootCapacity < parser->rootCount + 1) {
+		int oldCapacity = parser->rootCapacity;
+
+		parser->rootCapacity = GROW_CAPACITY(oldCapacity);
+		parser->roots = GROW_ARRAY(ASTNode*, parser->roots, oldCapacity, parser->rootCapacity);
+	}
+
+	parser->roots[parser->rootCount++] = node;
+
 	return node;
 }
 
@@ -3,6 +3,7 @@
 #include "toy_common.h"
 #include "lexer.h"
 #include "ast_node.h"
+#include "literal_dictionary.h"
 
 //DOCS: parsers are bound to a lexer, and turn the outputted tokens into AST nodes
 typedef struct {
@@ -13,8 +14,19 @@ typedef struct {
 	//track the last two outputs from the lexer
 	Token current;
 	Token previous;
+
+	//every node for this compilation unit lives here
+	ASTArena arena;
+	ASTNode** roots;
+	int rootCapacity;
+	int rootCount;
+
+	//the slot of each field name declared by a struct, or -1 when structs disagree
+	LiteralDictionary recordSlots;
 } Parser;
 
+//NOTE: nodes returned by scanParser() are owned by the parser, and released by freeParser() - freeASTNode() ignores them
+
 TOY_API void initParser(Parser* parser, Lexer* lexer);
 TOY_API void freeParser(Parser* parser);
 TOY_API ASTNode* scanParser(Parser* parser);
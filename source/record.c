@@ -0,0 +1,221 @@
+#include "record.h"
+
+#include "memory.h"
+#include "scope.h"
+
+#define RECORD_SIZE(count) (sizeof(Record) + sizeof(Literal) * (count))
+
+//utils
+static void recordError(Interpreter* interpreter, const char* message, Literal field, RecordLayout* layout) {
+	interpreter->errorOutput(message);
+	interpreter->errorOutput(" \"");
+	printLiteralCustom(field, interpreter->errorOutput);
+	interpreter->errorOutput("\" of record \"");
+	printLiteralCustom(layout->name, interpreter->errorOutput);
+	interpreter->errorOutput("\"\n");
+}
+
+//exposed functions
+Literal createRecord(RecordLayout* layout) {
+	Record* record = (Record*)ALLOCATE(unsigned char, RECORD_SIZE(layout->count));
+
+	record->layout = layout;
+	retainRecordLayout(layout);
+
+	for (int i = 0; i < layout->count; i++) {
+		record->fields[i] = TO_NULL_LITERAL;
+	}
+
+	return TO_RECORD_LITERAL(record);
+}
+
+int findRecordField(RecordLayout* layout, Literal name, int slot) {
+	//the compiler's guess holds unless two structs put the field in different slots
+	if (slot >= 0 && slot < layout->count && literalsAreEqual(layout->names[slot], name)) {
+		return slot;
+	}
+
+	for (int i = 0; i < layout->count; i++) {
+		if (literalsAreEqual(layout->names[i], name)) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+RecordLayout* createRecordLayout(Literal name, int count) {
+	RecordLayout* layout = ALLOCATE(RecordLayout, 1);
+
+	layout->name = copyLiteral(name);
+	layout->names = ALLOCATE(Literal, count);
+	layout->types = ALLOCATE(Literal, count);
+	layout->count = count;
+	layout->refCount = 1;
+
+	for (int i = 0; i < count; i++) {
+		layout->names[i] = TO_NULL_LITERAL;
+		layout->types[i] = TO_NULL_LITERAL;
+	}
+
+	return layout;
+}
+
+void retainRecordLayout(RecordLayout* layout) {
+	layout->refCount++;
+}
+
+void releaseRecordLayout(RecordLayout* layout) {
+	if (--layout->refCount > 0) {
+		return;
+	}
+
+	for (int i = 0; i < layout->count; i++) {
+		freeLiteral(layout->names[i]);
+		freeLiteral(layout->types[i]);
+	}
+
+	FREE_ARRAY(Literal, layout->names, layout->count);
+	FREE_ARRAY(Literal, layout->types, layout->count);
+	freeLiteral(layout->name);
+	FREE(RecordLayout, layout);
+}
+
+bool sameRecordLayout(RecordLayout* lhs, RecordLayout* rhs) {
+	if (lhs == rhs) {
+		return true;
+	}
+
+	//i.e. a struct declared inside a function, which was called twice
+	if (lhs->count != rhs->count || !literalsAreEqual(lhs->name, rhs->name)) {
+		return false;
+	}
+
+	for (int i = 0; i < lhs->count; i++) {
+		if (!literalsAreEqual(lhs->names[i], rhs->names[i])) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+Literal copyRecord(Literal original) {
+	Literal literal = createRecord(AS_RECORD(original)->layout);
+
+	for (int i = 0; i < AS_RECORD(original)->layout->count; i++) {
+		AS_RECORD(literal)->fields[i] = copyLiteral(AS_RECORD(original)->fields[i]);
+	}
+
+	return literal;
+}
+
+void freeRecord(Record* record) {
+	RecordLayout* layout = record->layout;
+	int count = layout->count;
+
+	for (int i = 0; i < count; i++) {
+		freeLiteral(record->fields[i]);
+	}
+
+	FREE_ARRAY(unsigned char, record, RECORD_SIZE(count));
+	releaseRecordLayout(layout);
+}
+
+Literal toRecordType(RecordLayout* layout) {
+	Literal type = TO_TYPE_LITERAL(LITERAL_RECORD, false);
+	TYPE_PUSH_SUBTYPE(&type, createRecord(layout));
+	return type;
+}
+
+bool constructRecord(Interpreter* interpreter, Literal prototype, LiteralArray* arguments, LiteralArray* returns) {
+	RecordLayout* layout = AS_RECORD(prototype)->layout;
+
+	//missing fields are left as null
+	if (arguments->count > layout->count) {
+		interpreter->errorOutput("Too many arguments passed to record \"");
+		printLiteralCustom(layout->name, interpreter->errorOutput);
+		interpreter->errorOutput("\"\n");
+		return false;
+	}
+
+	Literal literal = createRecord(layout);
+
+	for (int i = 0; arguments->count > 0; i++) {
+		Literal arg = popLiteralArray(arguments);
+
+		if (IS_IDENTIFIER(arg)) {
+			Literal idn = arg;
+			parseIdentifierToValue(interpreter, &arg);
+			freeLiteral(idn);
+		}
+
+		//BUGFIX: allow easy coercion on construction
+		if (AS_TYPE(layout->types[i]).typeOf == LITERAL_FLOAT && IS_INTEGER(arg)) {
+			arg = TO_FLOAT_LITERAL(AS_INTEGER(arg));
+		}
+
+		if (!checkLiteralType(layout->types[i], TO_NULL_LITERAL, arg, false)) {
+			recordError(interpreter, "Incorrect type passed to field", layout->names[i], layout);
+			freeLiteral(arg);
+			freeLiteral(literal);
+			return false;
+		}
+
+		AS_RECORD(literal)->fields[i] = arg; //moved in
+	}
+
+	pushLiteralArray(returns, literal);
+	freeLiteral(literal);
+
+	return true;
+}
+
+//the natives
+int _record(Interpreter* interpreter, LiteralArray* arguments) {
+	//name, then a name and type for each field
+	if (arguments->count < 1 || arguments->count % 2 != 1 || !IS_STRING(arguments->literals[0])) {
+		interpreter->errorOutput("Incorrect arguments passed to _record\n");
+		return -1;
+	}
+
+	Literal name = TO_IDENTIFIER_LITERAL(copyRefString(AS_STRING(arguments->literals[0])));
+	RecordLayout* layout = createRecordLayout(name, arguments->count / 2);
+	freeLiteral(name);
+
+	for (int i = 0; i < layout->count; i++) {
+		Literal field = arguments->literals[i * 2 + 1];
+
+		if (!IS_STRING(field)) {
+			interpreter->errorOutput("Incorrect argument type passed to _record (expected a field name)\n");
+			releaseRecordLayout(layout);
+			return -1;
+		}
+
+		layout->names[i] = TO_IDENTIFIER_LITERAL(copyRefString(AS_STRING(field)));
+
+		if (findRecordField(layout, layout->names[i], -1) != i) {
+			recordError(interpreter, "Duplicate field", layout->names[i], layout);
+			releaseRecordLayout(layout);
+			return -1;
+		}
+
+		//named types are resolved once, here
+		layout->types[i] = parseTypeToValue(interpreter, copyLiteral(arguments->literals[i * 2 + 2]));
+
+		if (!IS_TYPE(layout->types[i])) {
+			recordError(interpreter, "Unknown type given to field", layout->names[i], layout);
+			releaseRecordLayout(layout);
+			return -1;
+		}
+	}
+
+	//the struct's name holds a blank record, which builds the others
+	Literal prototype = createRecord(layout);
+	releaseRecordLayout(layout);
+
+	pushLiteralArray(&interpreter->stack, prototype);
+	freeLiteral(prototype);
+
+	return 1;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "toy_common.h"
+#include "interpreter.h"
+
+//the shape of a declared struct - every record made from it shares this
+typedef struct RecordLayout {
+	Literal name; //identifier
+	Literal* names; //identifiers, in declaration order
+	Literal* types; //resolved when the struct is declared
+	int count;
+	int refCount;
+} RecordLayout;
+
+//a flat vector of fields, copied like any other value
+//NOTE: records are tied to the thread that made them - detachLiteral() turns them into null
+typedef struct Record {
+	RecordLayout* layout;
+	Literal fields[]; //indexed by slot
+} Record;
+
+//from the host
+TOY_API Literal createRecord(RecordLayout* layout); //every field starts as null
+TOY_API int findRecordField(RecordLayout* layout, Literal name, int slot); //slot is a guess, checked before searching - -1 if there's no such field
+
+//for the interpreter
+RecordLayout* createRecordLayout(Literal name, int count); //the names and types start as null, for the _record native to fill in
+void retainRecordLayout(RecordLayout* layout);
+void releaseRecordLayout(RecordLayout* layout);
+bool sameRecordLayout(RecordLayout* lhs, RecordLayout* rhs); //separate declarations of the same struct are interchangeable
+
+Literal copyRecord(Literal original);
+void freeRecord(Record* record);
+
+Literal toRecordType(RecordLayout* layout); //the type of a declared struct, holding a blank record for its layout
+bool constructRecord(Interpreter* interpreter, Literal prototype, LiteralArray* arguments, LiteralArray* returns); //the arguments are in reverse order, as callLiteralFn() expects
+
+//the natives, available everywhere
+int _record(Interpreter* interpreter, LiteralArray* arguments);
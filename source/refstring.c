@@ -1,5 +1,8 @@
 #include "refstring.h"
 
+#include "toy_common.h"
+
+#include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 
@@ -11,10 +14,23 @@ STATIC_ASSERT(sizeof(int) == 4);
 STATIC_ASSERT(sizeof(char) == 1);
 
 //memory allocation
-static RefStringAllocatorFn allocate;
+static void* defaultAllocate(void* pointer, size_t oldSize, size_t newSize) {
+	if (newSize == 0) {
+		free(pointer);
+		return NULL;
+	}
+
+	return realloc(pointer, newSize);
+}
 
-void setRefStringAllocatorFn(RefStringAllocatorFn allocator) {
-	allocate = allocator;
+static TOY_THREAD_LOCAL RefStringAllocatorFn allocator = NULL; //per-thread, NULL for the default
+
+static void* allocate(void* pointer, size_t oldSize, size_t newSize) {
+	return (allocator != NULL ? allocator : defaultAllocate)(pointer, oldSize, newSize);
+}
+
+void setRefStringAllocatorFn(RefStringAllocatorFn fn) {
+	allocator = fn;
 }
 
 //API
@@ -39,6 +55,7 @@ RefString* createRefStringLength(char* cstring, int length) {
 }
 
 void deleteRefString(RefString* refString) {
+	//NOTE: frozen strings have a negative refcount, and are left alone
 	if (refString->refcount > 0) {
 		//decrement, then check
 		refString->refcount--;
@@ -58,10 +75,25 @@ int lengthRefString(RefString* refString) {
 
 RefString* copyRefString(RefString* refString) {
 	//Cheaty McCheater Face
-	refString->refcount++;
+	if (refString->refcount > 0) {
+		refString->refcount++;
+	}
 	return refString;
 }
 
+void freezeRefString(RefString* refString) {
+	//stash the count, so it can be restored
+	if (refString->refcount > 0) {
+		refString->refcount = -refString->refcount;
+	}
+}
+
+void thawRefString(RefString* refString) {
+	if (refString->refcount < 0) {
+		refString->refcount = -refString->refcount;
+	}
+}
+
 RefString* deepCopyRefString(RefString* refString) {
 	//create a new string, with a new refcount
 	return createRefStringLength(refString->data, refString->length);
@@ -21,6 +21,8 @@ void deleteRefString(RefString* refString);
 int countRefString(RefString* refString);
 int lengthRefString(RefString* refString);
 RefString* copyRefString(RefString* refString);
+void freezeRefString(RefString* refString); //frozen strings can be shared between threads, copies and deletions don't touch them
+void thawRefString(RefString* refString);
 RefString* deepCopyRefString(RefString* refString);
 char* toCString(RefString* refString);
 bool equalsRefString(RefString* lhs, RefString* rhs);
@@ -0,0 +1,258 @@
+#include "scheduler.h"
+
+#include "memory.h"
+
+#include <time.h>
+
+#if defined(_WIN32) || defined(WIN32)
+#include <windows.h>
+#endif
+
+//seconds of CPU time used by this thread alone - clock() would count every thread in the process
+static double threadCpuTime() {
+#if defined(_WIN32) || defined(WIN32)
+	FILETIME creation, exited, kernel, user;
+	GetThreadTimes(GetCurrentThread(), &creation, &exited, &kernel, &user);
+
+	//in units of 100ns
+	unsigned long long total = ((unsigned long long)kernel.dwHighDateTime << 32 | kernel.dwLowDateTime) + ((unsigned long long)user.dwHighDateTime << 32 | user.dwLowDateTime);
+	return total / 10000000.0;
+#elif defined(CLOCK_THREAD_CPUTIME_ID)
+	struct timespec now;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+	return now.tv_sec + now.tv_nsec / 1000000000.0;
+#else
+	return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+//the ready queues
+static void pushReadyTask(Scheduler* scheduler, Task* task) {
+	task->next = NULL;
+
+	if (scheduler->readyTails[task->priority] != NULL) {
+		scheduler->readyTails[task->priority]->next = task;
+	}
+	else {
+		scheduler->readyHeads[task->priority] = task;
+	}
+
+	scheduler->readyTails[task->priority] = task;
+}
+
+static Task* popReadyTask(Scheduler* scheduler) {
+	for (int i = SCHEDULER_PRIORITIES - 1; i >= 0; i--) {
+		Task* task = scheduler->readyHeads[i];
+
+		if (task != NULL) {
+			scheduler->readyHeads[i] = task->next;
+			if (scheduler->readyHeads[i] == NULL) {
+				scheduler->readyTails[i] = NULL;
+			}
+
+			task->next = NULL;
+			return task;
+		}
+	}
+
+	return NULL;
+}
+
+static void removeReadyTask(Scheduler* scheduler, Task* task) {
+	Task* previous = NULL;
+
+	for (Task* it = scheduler->readyHeads[task->priority]; it != NULL; previous = it, it = it->next) {
+		if (it != task) {
+			continue;
+		}
+
+		if (previous != NULL) {
+			previous->next = task->next;
+		}
+		else {
+			scheduler->readyHeads[task->priority] = task->next;
+		}
+
+		if (scheduler->readyTails[task->priority] == task) {
+			scheduler->readyTails[task->priority] = previous;
+		}
+
+		task->next = NULL;
+		return;
+	}
+}
+
+//the waiting list
+static void removeWaitingTask(Scheduler* scheduler, Task* task) {
+	for (Task** it = &scheduler->waitingHead; *it != NULL; it = &(*it)->next) {
+		if (*it == task) {
+			*it = task->next;
+			task->next = NULL;
+			scheduler->waiting--;
+			return;
+		}
+	}
+}
+
+//the task's token was completed, so it can take turns again
+static void wakeTask(void* userdata) {
+	Task* task = (Task*)userdata;
+
+	if (task->state != TASK_WAITING) {
+		return;
+	}
+
+	removeWaitingTask(task->scheduler, task);
+	task->state = TASK_READY;
+	pushReadyTask(task->scheduler, task);
+}
+
+//the task is over, one way or another
+static void finishTask(Scheduler* scheduler, Task* task, TaskState state) {
+	task->state = state;
+	scheduler->live--;
+
+	if (task->callback) {
+		task->callback(task->interpreter, task, task->userdata);
+	}
+
+	returnInterpreter(&scheduler->pool, task->interpreter);
+	task->interpreter = NULL;
+
+	if (task->callback) {
+		FREE(Task, task);
+	}
+}
+
+//exposed API
+void initScheduler(Scheduler* scheduler, int timeSlice, InterpreterSetupFn setup) {
+	initInterpreterPool(&scheduler->pool, setup);
+
+	for (int i = 0; i < SCHEDULER_PRIORITIES; i++) {
+		scheduler->readyHeads[i] = NULL;
+		scheduler->readyTails[i] = NULL;
+	}
+
+	scheduler->waitingHead = NULL;
+	scheduler->timeSlice = timeSlice > 0 ? timeSlice : 1;
+	scheduler->nextId = 0;
+	scheduler->live = 0;
+	scheduler->waiting = 0;
+	scheduler->switches = 0;
+}
+
+void freeScheduler(Scheduler* scheduler) {
+	//waiting tasks join the ready ones, then every live task is sitting in a ready queue
+	while (scheduler->waitingHead != NULL) {
+		Task* task = scheduler->waitingHead;
+		removeWaitingTask(scheduler, task);
+		task->state = TASK_READY;
+		pushReadyTask(scheduler, task);
+	}
+
+	Task* task = popReadyTask(scheduler);
+
+	while (task != NULL) {
+		Task* next = popReadyTask(scheduler);
+
+		cancelInterpreter(task->interpreter);
+		finishTask(scheduler, task, TASK_CANCELLED);
+
+		task = next;
+	}
+
+	freeInterpreterPool(&scheduler->pool);
+}
+
+Task* spawnTask(Scheduler* scheduler, Program* program, int priority, TaskCallback callback, void* userdata) {
+	Task* task = ALLOCATE(Task, 1);
+
+	if (priority < 0) {
+		priority = 0;
+	}
+	if (priority >= SCHEDULER_PRIORITIES) {
+		priority = SCHEDULER_PRIORITIES - 1;
+	}
+
+	task->program = program;
+	task->interpreter = checkoutInterpreter(&scheduler->pool);
+	task->callback = callback;
+	task->userdata = userdata;
+	task->id = scheduler->nextId++;
+	task->priority = priority;
+	task->state = TASK_READY;
+	task->started = false;
+	task->next = NULL;
+	task->scheduler = scheduler;
+	task->cpuTime = 0;
+	task->slices = 0;
+
+	setInterpreterFuel(task->interpreter, scheduler->timeSlice);
+	setInterpreterWake(task->interpreter, wakeTask, task);
+
+	pushReadyTask(scheduler, task);
+	scheduler->live++;
+
+	return callback ? NULL : task;
+}
+
+void releaseTask(Scheduler* scheduler, Task* task) {
+	if (task->state == TASK_READY || task->state == TASK_WAITING) {
+		if (task->state == TASK_READY) {
+			removeReadyTask(scheduler, task);
+		}
+		else {
+			removeWaitingTask(scheduler, task);
+		}
+
+		cancelInterpreter(task->interpreter);
+		finishTask(scheduler, task, TASK_CANCELLED);
+	}
+
+	FREE(Task, task);
+}
+
+bool stepScheduler(Scheduler* scheduler) {
+	Task* task = popReadyTask(scheduler);
+
+	if (task == NULL) {
+		return false;
+	}
+
+	double start = threadCpuTime();
+
+	if (!task->started) {
+		task->started = true;
+		runProgram(task->interpreter, task->program);
+	}
+	else {
+		resumeInterpreter(task->interpreter, scheduler->timeSlice);
+	}
+
+	task->cpuTime += threadCpuTime() - start;
+	task->slices++;
+	scheduler->switches++;
+
+	if (isInterpreterWaiting(task->interpreter)) {
+		//out of the line, until the token is completed
+		task->state = TASK_WAITING;
+		task->next = scheduler->waitingHead;
+		scheduler->waitingHead = task;
+		scheduler->waiting++;
+	}
+	else if (isInterpreterSuspended(task->interpreter)) {
+		//back of the line
+		pushReadyTask(scheduler, task);
+	}
+	else {
+		finishTask(scheduler, task, task->interpreter->panic ? TASK_FAILED : TASK_FINISHED);
+	}
+
+	return true;
+}
+
+void runScheduler(Scheduler* scheduler) {
+	while (stepScheduler(scheduler)) {
+		//NO OP
+	}
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "toy_common.h"
+#include "interpreter.h"
+#include "interpreter_pool.h"
+
+//tasks at a higher priority always run first, tasks at the same priority take turns
+#define SCHEDULER_PRIORITIES 4
+
+typedef enum TaskState {
+	TASK_READY,
+	TASK_WAITING, //on an async native
+	TASK_FINISHED,
+	TASK_FAILED, //the script panicked
+	TASK_CANCELLED,
+} TaskState;
+
+typedef struct Task Task;
+
+//runs when the task is over, while the interpreter still holds its state
+typedef void (*TaskCallback)(Interpreter* interpreter, Task* task, void* userdata);
+
+//one script, interleaved with the others on the scheduler's thread
+struct Task {
+	Program* program; //read-only - shared with other tasks
+	Interpreter* interpreter; //checked out while the task is alive
+	TaskCallback callback;
+	void* userdata;
+	int id;
+	int priority;
+	TaskState state;
+	bool started;
+	Task* next; //in the ready queue, or the waiting list
+	struct Scheduler* scheduler;
+
+	//stats
+	double cpuTime; //seconds spent running, on the scheduler's thread only
+	int slices;
+};
+
+typedef struct Scheduler {
+	InterpreterPool pool;
+	Task* readyHeads[SCHEDULER_PRIORITIES];
+	Task* readyTails[SCHEDULER_PRIORITIES];
+	Task* waitingHead; //parked until their tokens are completed
+	int timeSlice; //instructions per turn
+	int nextId;
+
+	//stats
+	int live; //tasks that haven't finished
+	int waiting;
+	int switches;
+} Scheduler;
+
+TOY_API void initScheduler(Scheduler* scheduler, int timeSlice, InterpreterSetupFn setup); //setup can be NULL
+TOY_API void freeScheduler(Scheduler* scheduler); //cancels every task still alive - tasks without a callback still need releasing
+
+//the program must outlive the task - priority is clamped to [0, SCHEDULER_PRIORITIES)
+//tasks with a callback are released once it returns, the rest must be released by releaseTask()
+TOY_API Task* spawnTask(Scheduler* scheduler, Program* program, int priority, TaskCallback callback, void* userdata);
+TOY_API void releaseTask(Scheduler* scheduler, Task* task); //cancels the task if it's still alive
+
+TOY_API bool stepScheduler(Scheduler* scheduler); //gives one task a turn - false when nothing is ready
+TOY_API void runScheduler(Scheduler* scheduler); //until every task is over, or waiting on an async native
+
+//NOTE: a native can end its task's turn early with yieldInterpreter()
@@ -1,6 +1,78 @@
 #include "scope.h"
 
 #include "memory.h"
+#include "coroutine.h"
+#include "record.h"
+#include "packed_array.h"
+
+//don't hoard memory after a deep recursion
+#define SCOPE_POOL_MAX 64
+
+//the tables stay empty until something is declared
+static void initLazyDictionary(LiteralDictionary* dictionary) {
+	dictionary->entries = NULL;
+	dictionary->capacity = 0;
+	dictionary->contains = 0;
+	dictionary->count = 0;
+	dictionary->frozen = false;
+}
+
+static void releasePoolReference(ScopePool* pool) {
+	if (--pool->references > 0) {
+		return;
+	}
+
+	while (pool->freeList != NULL) {
+		Scope* next = pool->freeList->ancestor;
+		FREE(Scope, pool->freeList);
+		pool->freeList = next;
+	}
+
+	FREE(ScopePool, pool);
+}
+
+static Scope* allocateScope(ScopePool* pool) {
+	if (pool == NULL) {
+		Scope* scope = ALLOCATE(Scope, 1);
+		scope->pool = NULL;
+		return scope;
+	}
+
+	Scope* scope = pool->freeList;
+
+	if (scope != NULL) {
+		pool->freeList = scope->ancestor;
+		pool->count--;
+	}
+	else {
+		scope = ALLOCATE(Scope, 1);
+	}
+
+	scope->pool = pool;
+	pool->references++;
+
+	return scope;
+}
+
+static void deallocateScope(Scope* scope) {
+	ScopePool* pool = scope->pool;
+
+	if (pool == NULL) {
+		FREE(Scope, scope);
+		return;
+	}
+
+	if (pool->count < SCOPE_POOL_MAX) {
+		scope->ancestor = pool->freeList;
+		pool->freeList = scope;
+		pool->count++;
+	}
+	else {
+		FREE(Scope, scope);
+	}
+
+	releasePoolReference(pool);
+}
 
 //run up the ancestor chain, freeing anything with 0 references left
 static void freeAncestorChain(Scope* scope) {
@@ -18,10 +90,17 @@ static void freeAncestorChain(Scope* scope) {
 	freeLiteralDictionary(&scope->variables);
 	freeLiteralDictionary(&scope->types);
 
-	FREE(Scope, scope);
+	deallocateScope(scope);
 }
 
 //return false if invalid type
+//only the first write is logged, so the log holds the value from before any of them
+static void logScopeWrite(Scope* scope, Literal key, Literal original) {
+	if (scope->log != NULL && !existsLiteralDictionary(scope->log, key)) {
+		setLiteralDictionary(scope->log, key, original);
+	}
+}
+
 static bool checkType(Literal typeLiteral, Literal original, Literal value, bool constCheck) {
 	//for constants, fail if original != value
 	if (constCheck && AS_TYPE(typeLiteral).constant && !literalsAreEqual(original, value)) {
@@ -60,6 +139,16 @@ static bool checkType(Literal typeLiteral, Literal original, Literal value, bool
 		return false;
 	}
 
+	//packed arrays can only hold their element type, so there's nothing to check inside
+	if (IS_PACKED_ARRAY(value)) {
+		if (AS_TYPE(typeLiteral).typeOf != LITERAL_ARRAY) {
+			return false;
+		}
+
+		LiteralType subtype = AS_TYPE(typeLiteral).count > 0 ? AS_TYPE(((Literal*)(AS_TYPE(typeLiteral).subtypes))[0]).typeOf : LITERAL_ANY;
+		return subtype == LITERAL_ANY || subtype == AS_PACKED_ARRAY(value)->elementType;
+	}
+
 	if (AS_TYPE(typeLiteral).typeOf == LITERAL_ARRAY && !IS_ARRAY(value)) {
 		return false;
 	}
@@ -75,6 +164,14 @@ static bool checkType(Literal typeLiteral, Literal original, Literal value, bool
 			return true;
 		}
 
+		//replacing a packed array - the new one must pack too
+		if (IS_PACKED_ARRAY(original)) {
+			Literal packed = packLiteralArray(AS_ARRAY(value), AS_PACKED_ARRAY(original)->elementType);
+			bool fits = IS_PACKED_ARRAY(packed);
+			freeLiteral(packed);
+			return fits;
+		}
+
 		//check children
 		for (int i = 0; i < AS_ARRAY(value)->count; i++) {
 			if (AS_ARRAY(original)->count <= i) {
@@ -142,15 +239,51 @@ static bool checkType(Literal typeLiteral, Literal original, Literal value, bool
 		return false;
 	}
 
+	if (AS_TYPE(typeLiteral).typeOf == LITERAL_RECORD && !IS_RECORD(value)) {
+		return false;
+	}
+
+	if (IS_RECORD(value)) {
+		if (AS_TYPE(typeLiteral).typeOf != LITERAL_RECORD) {
+			return false;
+		}
+
+		//named record types carry a blank record, for its layout
+		if (AS_TYPE(typeLiteral).count > 0 && !sameRecordLayout(AS_RECORD(((Literal*)(AS_TYPE(typeLiteral).subtypes))[0])->layout, AS_RECORD(value)->layout)) {
+			return false;
+		}
+	}
+
 	return true;
 }
 
 //exposed functions
+ScopePool* createScopePool() {
+	ScopePool* pool = ALLOCATE(ScopePool, 1);
+	pool->freeList = NULL;
+	pool->count = 0;
+	pool->references = 1;
+	return pool;
+}
+
+void releaseScopePool(ScopePool* pool) {
+	if (pool == NULL) {
+		return;
+	}
+
+	releasePoolReference(pool);
+}
+
 Scope* pushScope(Scope* ancestor) {
-	Scope* scope = ALLOCATE(Scope, 1);
+	return pushScopeFromPool(ancestor != NULL ? ancestor->pool : NULL, ancestor);
+}
+
+Scope* pushScopeFromPool(ScopePool* pool, Scope* ancestor) {
+	Scope* scope = allocateScope(pool);
 	scope->ancestor = ancestor;
-	initLiteralDictionary(&scope->variables);
-	initLiteralDictionary(&scope->types);
+	initLazyDictionary(&scope->variables);
+	initLazyDictionary(&scope->types);
+	scope->log = NULL;
 
 	//tick up all scope reference counts
 	scope->references = 0;
@@ -180,6 +313,11 @@ Scope* popScope(Scope* scope) {
 			popScope(AS_FUNCTION(scope->variables.entries[i].value).scope);
 			AS_FUNCTION(scope->variables.entries[i].value).scope = NULL;
 		}
+
+		//coroutines hold their function's scopes too
+		if (IS_COROUTINE(scope->variables.entries[i].value)) {
+			detachCoroutineScope(AS_COROUTINE(scope->variables.entries[i].value), scope);
+		}
 	}
 
 	freeAncestorChain(scope);
@@ -188,10 +326,11 @@ Scope* popScope(Scope* scope) {
 }
 
 Scope* copyScope(Scope* original) {
-	Scope* scope = ALLOCATE(Scope, 1);
+	Scope* scope = allocateScope(original->pool);
 	scope->ancestor = original->ancestor;
-	initLiteralDictionary(&scope->variables);
-	initLiteralDictionary(&scope->types);
+	initLazyDictionary(&scope->variables);
+	initLazyDictionary(&scope->types);
+	scope->log = NULL;
 
 	//tick up all scope reference counts
 	scope->references = 0;
@@ -254,22 +393,39 @@ bool setScopeVariable(Scope* scope, Literal key, Literal value, bool constCheck)
 		return setScopeVariable(scope->ancestor, key, value, constCheck);
 	}
 
-	//type checking
-	Literal typeLiteral = getLiteralDictionary(&scope->types, key);
-	Literal original = getLiteralDictionary(&scope->variables, key);
+	//type checking - in place, since copying the original could mean copying a whole compound
+	Literal* typeRef = getLiteralDictionaryRef(&scope->types, key);
+	Literal* original = getLiteralDictionaryRef(&scope->variables, key);
 
-	if (!checkType(typeLiteral, original, value, constCheck)) {
-		freeLiteral(typeLiteral);
-		freeLiteral(original);
+	if (typeRef == NULL || original == NULL || !checkType(*typeRef, *original, value, constCheck)) {
 		return false;
 	}
 
+	logScopeWrite(scope, key, *original);
+
+	//arrays typed [int] or [float] are stored unboxed, when every element fits
+	LiteralType elementType = packedElementType(*typeRef);
+
+	if (elementType != LITERAL_NULL && IS_ARRAY(value)) {
+		Literal packed = packLiteralArray(AS_ARRAY(value), elementType);
+
+		if (IS_PACKED_ARRAY(packed)) {
+			freeLiteral(*original);
+			*original = packed; //moved in
+			return true;
+		}
+	}
+
+	//any other variable holds a plain array
+	if (IS_PACKED_ARRAY(value) && elementType != AS_PACKED_ARRAY(value)->elementType) {
+		freeLiteral(*original);
+		*original = unpackLiteralArray(AS_PACKED_ARRAY(value));
+		return true;
+	}
+
 	//actually assign
 	setLiteralDictionary(&scope->variables, key, value);
 
-	freeLiteral(typeLiteral);
-	freeLiteral(original);
-
 	return true;
 }
 
@@ -288,6 +444,35 @@ bool getScopeVariable(Scope* scope, Literal key, Literal* valueHandle) {
 	return true;
 }
 
+Literal* getScopeVariableRef(Scope* scope, Literal key) {
+	for (Scope* ptr = scope; ptr != NULL; ptr = ptr->ancestor) {
+		Literal* ref = getLiteralDictionaryRef(&ptr->variables, key);
+
+		if (ref != NULL) {
+			return ref;
+		}
+	}
+
+	return NULL;
+}
+
+Literal* getScopeVariableWriteRef(Scope* scope, Literal key) {
+	for (Scope* ptr = scope; ptr != NULL; ptr = ptr->ancestor) {
+		Literal* ref = getLiteralDictionaryRef(&ptr->variables, key);
+
+		if (ref != NULL) {
+			logScopeWrite(ptr, key, *ref);
+			return ref;
+		}
+	}
+
+	return NULL;
+}
+
+bool checkLiteralType(Literal type, Literal original, Literal value, bool constCheck) {
+	return checkType(type, original, value, constCheck);
+}
+
 Literal getScopeType(Scope* scope, Literal key) {
 	//dead end
 	if (scope == NULL) {
@@ -4,13 +4,26 @@
 #include "literal_dictionary.h"
 
 typedef struct Scope {
-	LiteralDictionary variables; //only allow identifiers as the keys
-	LiteralDictionary types; //the types, indexed by identifiers
+	LiteralDictionary variables; //only allow identifiers as the keys - allocated on the first declaration
+	LiteralDictionary types; //the types, indexed by identifiers - allocated on the first declaration
 	struct Scope* ancestor;
+	struct ScopePool* pool; //where this scope is returned to, can be NULL
 	int references; //how many scopes point here
+	LiteralDictionary* log; //when set, each variable's value before its first write lands here - can be NULL
 } Scope;
 
-Scope* pushScope(Scope* scope);
+//recycles released scopes, rather than returning them to the allocator
+typedef struct ScopePool {
+	Scope* freeList; //chained through the ancestor pointers
+	int count;
+	int references; //the owner, plus every live scope drawn from this pool
+} ScopePool;
+
+ScopePool* createScopePool();
+void releaseScopePool(ScopePool* pool); //the pool is actually freed once the last live scope is gone
+
+Scope* pushScope(Scope* scope); //draws from the ancestor's pool, if any
+Scope* pushScopeFromPool(ScopePool* pool, Scope* ancestor);
 Scope* popScope(Scope* scope);
 Scope* copyScope(Scope* original);
 
@@ -21,5 +34,10 @@ bool isDelcaredScopeVariable(Scope* scope, Literal key);
 //return false if undefined
 bool setScopeVariable(Scope* scope, Literal key, Literal value, bool constCheck);
 bool getScopeVariable(Scope* scope, Literal key, Literal* value);
+Literal* getScopeVariableRef(Scope* scope, Literal key); //no copy or type check, for reading in place - the pointer only lasts until the scope's variables change
+Literal* getScopeVariableWriteRef(Scope* scope, Literal key); //as above, for writing in place
+
+//for values kept outside of scopes (i.e. record fields)
+bool checkLiteralType(Literal type, Literal original, Literal value, bool constCheck);
 
 Literal getScopeType(Scope* scope, Literal key);
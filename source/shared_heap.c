@@ -0,0 +1,145 @@
+#include "shared_heap.h"
+
+#include "memory.h"
+#include "packed_array.h"
+
+#include "console_colors.h"
+
+#include <stdio.h>
+
+//utils
+static bool isShareable(Literal literal) {
+	switch(literal.type) {
+		case LITERAL_NULL:
+		case LITERAL_BOOLEAN:
+		case LITERAL_INTEGER:
+		case LITERAL_FLOAT:
+		case LITERAL_STRING:
+		case LITERAL_PACKED_ARRAY:
+			return true;
+
+		case LITERAL_ARRAY:
+			for (int i = 0; i < AS_ARRAY(literal)->count; i++) {
+				if (!isShareable(AS_ARRAY(literal)->literals[i])) {
+					return false;
+				}
+			}
+			return true;
+
+		case LITERAL_DICTIONARY:
+			for (int i = 0; i < AS_DICTIONARY(literal)->capacity; i++) {
+				if (!IS_NULL(AS_DICTIONARY(literal)->entries[i].key) && (!isShareable(AS_DICTIONARY(literal)->entries[i].key) || !isShareable(AS_DICTIONARY(literal)->entries[i].value))) {
+					return false;
+				}
+			}
+			return true;
+
+		default:
+			return false;
+	}
+}
+
+//a deep copy that shares nothing, not even frozen values
+static Literal copyValue(Literal literal) {
+	switch(literal.type) {
+		case LITERAL_STRING:
+			return TO_STRING_LITERAL(createRefStringLength(toCString(AS_STRING(literal)), lengthRefString(AS_STRING(literal))));
+
+		case LITERAL_ARRAY: {
+			LiteralArray* array = ALLOCATE(LiteralArray, 1);
+			initLiteralArray(array);
+
+			for (int i = 0; i < AS_ARRAY(literal)->count; i++) {
+				Literal element = copyValue(AS_ARRAY(literal)->literals[i]);
+				pushLiteralArray(array, element);
+				freeLiteral(element);
+			}
+
+			return TO_ARRAY_LITERAL(array);
+		}
+
+		//shared values are frozen in place, which only plain arrays know how to do
+		case LITERAL_PACKED_ARRAY:
+			return unpackLiteralArray(AS_PACKED_ARRAY(literal));
+
+		case LITERAL_DICTIONARY: {
+			LiteralDictionary* dictionary = ALLOCATE(LiteralDictionary, 1);
+			initLiteralDictionary(dictionary);
+
+			for (int i = 0; i < AS_DICTIONARY(literal)->capacity; i++) {
+				if (!IS_NULL(AS_DICTIONARY(literal)->entries[i].key)) {
+					Literal key = copyValue(AS_DICTIONARY(literal)->entries[i].key);
+					Literal value = copyValue(AS_DICTIONARY(literal)->entries[i].value);
+					setLiteralDictionary(dictionary, key, value);
+					freeLiteral(key);
+					freeLiteral(value);
+				}
+			}
+
+			return TO_DICTIONARY_LITERAL(dictionary);
+		}
+
+		default:
+			return literal;
+	}
+}
+
+//exposed API
+void initSharedHeap(SharedHeap* heap) {
+	initLiteralDictionary(&heap->values);
+	initLiteralDictionary(&heap->types);
+}
+
+void freeSharedHeap(SharedHeap* heap) {
+	//thaw everything, so it can be freed normally
+	for (int i = 0; i < heap->values.capacity; i++) {
+		freezeLiteral(heap->values.entries[i].key, false, true);
+		freezeLiteral(heap->values.entries[i].value, false, true);
+	}
+
+	freeLiteralDictionary(&heap->values);
+	freeLiteralDictionary(&heap->types);
+}
+
+bool setSharedHeapValue(SharedHeap* heap, char* name, Literal value) {
+	if (!isShareable(value)) {
+		fprintf(stderr, ERROR "ERROR: Only plain data can be put in a shared heap\n" RESET);
+		return false;
+	}
+
+	Literal key = TO_IDENTIFIER_LITERAL(createRefString(name));
+
+	if (existsLiteralDictionary(&heap->values, key)) {
+		fprintf(stderr, ERROR "ERROR: Can't redefine a shared value\n" RESET);
+		freeLiteral(key);
+		return false;
+	}
+
+	//a fresh copy, that nothing else holds a reference to
+	Literal frozen = copyValue(value);
+	Literal type = TO_TYPE_LITERAL(LITERAL_ANY, true);
+
+	//the type table counts its reference to the key, the values table takes over this one
+	setLiteralDictionary(&heap->types, key, type);
+
+	freezeLiteral(key, true, true);
+	freezeLiteral(frozen, true, true);
+
+	setLiteralDictionary(&heap->values, key, frozen);
+
+	return true;
+}
+
+void attachSharedHeap(SharedHeap* heap, Interpreter* interpreter) {
+	for (int i = 0; i < heap->values.capacity; i++) {
+		if (!IS_NULL(heap->values.entries[i].key)) {
+			Literal type = getLiteralDictionary(&heap->types, heap->values.entries[i].key);
+
+			//copying frozen values only copies the handle
+			setLiteralDictionary(interpreter->exports, heap->values.entries[i].key, heap->values.entries[i].value);
+			setLiteralDictionary(interpreter->exportTypes, heap->values.entries[i].key, type);
+
+			freeLiteral(type);
+		}
+	}
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "toy_common.h"
+#include "interpreter.h"
+
+//reference data that any number of interpreters, on any thread, can import without copying
+//values are frozen when added, so there's only ever one copy of them - writes from scripts go to a private copy
+typedef struct SharedHeap {
+	LiteralDictionary values;
+	LiteralDictionary types;
+} SharedHeap;
+
+TOY_API void initSharedHeap(SharedHeap* heap);
+TOY_API void freeSharedHeap(SharedHeap* heap); //NOTE: free every interpreter using the heap first
+
+TOY_API bool setSharedHeapValue(SharedHeap* heap, char* name, Literal value); //the value is copied, functions can't be shared
+TOY_API void attachSharedHeap(SharedHeap* heap, Interpreter* interpreter); //exposes the values to import
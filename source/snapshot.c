@@ -0,0 +1,485 @@
+#include "snapshot.h"
+
+#include "memory.h"
+#include "scope.h"
+#include "packed_array.h"
+
+#include <string.h>
+
+//NOTE: the layout is the version, then the global variables, the global types, the exports and the export types
+//each section is a varint count of key/value pairs, and each literal is its type byte followed by its payload
+
+typedef struct SnapshotWriter {
+	unsigned char* bytes;
+	int capacity;
+	int count;
+	Scope* global; //functions may only close over this
+	LiteralDictionary* natives; //name -> native function
+	PrintFn errorOutput;
+	bool error;
+} SnapshotWriter;
+
+typedef struct SnapshotReader {
+	unsigned char* bytes;
+	int length;
+	int count;
+	Scope* global;
+	LiteralDictionary* natives;
+	bool error;
+} SnapshotReader;
+
+//suppress the scratch interpreter's output
+static void noOutput(const char* output) {
+	//NO OP
+}
+
+//every native the interpreter could know about: the builtins, plus whatever the hooks inject
+static void collectNatives(Interpreter* interpreter, Interpreter* scratch) {
+	initInterpreter(scratch);
+	setInterpreterPrint(scratch, noOutput);
+	setInterpreterAssert(scratch, noOutput);
+	setInterpreterError(scratch, noOutput);
+
+	for (int i = 0; i < interpreter->hooks->capacity; i++) {
+		_entry* entry = &interpreter->hooks->entries[i];
+		if (IS_NULL(entry->key)) {
+			continue;
+		}
+
+		HookFn hook = (HookFn)AS_FUNCTION(entry->value).bytecode;
+		hook(scratch, entry->key, TO_NULL_LITERAL);
+	}
+}
+
+//writing
+static void writeByte(SnapshotWriter* writer, unsigned char byte) {
+	if (writer->count + 1 > writer->capacity) {
+		int oldCapacity = writer->capacity;
+		writer->capacity = GROW_CAPACITY_FAST(oldCapacity);
+		writer->bytes = GROW_ARRAY(unsigned char, writer->bytes, oldCapacity, writer->capacity);
+	}
+
+	writer->bytes[writer->count++] = byte;
+}
+
+static void writeBytes(SnapshotWriter* writer, const void* bytes, int length) {
+	for (int i = 0; i < length; i++) {
+		writeByte(writer, ((unsigned char*)bytes)[i]);
+	}
+}
+
+static void writeVarint(SnapshotWriter* writer, unsigned int value) {
+	do {
+		unsigned char byte = value & 0x7F;
+		value >>= 7;
+		if (value) {
+			byte |= 0x80;
+		}
+		writeByte(writer, byte);
+	} while (value);
+}
+
+static void writeRefString(SnapshotWriter* writer, RefString* refString) {
+	writeVarint(writer, lengthRefString(refString));
+	writeBytes(writer, toCString(refString), lengthRefString(refString));
+}
+
+static void writeLiteral(SnapshotWriter* writer, Literal literal);
+
+static void writeDictionary(SnapshotWriter* writer, LiteralDictionary* dictionary) {
+	writeVarint(writer, dictionary->count);
+
+	for (int i = 0; i < dictionary->capacity; i++) {
+		if (IS_NULL(dictionary->entries[i].key)) {
+			continue;
+		}
+
+		writeLiteral(writer, dictionary->entries[i].key);
+		writeLiteral(writer, dictionary->entries[i].value);
+	}
+}
+
+static void writeLiteral(SnapshotWriter* writer, Literal literal) {
+	writeByte(writer, (unsigned char)literal.type);
+
+	switch(literal.type) {
+		case LITERAL_NULL:
+		case LITERAL_ANY:
+			break;
+
+		case LITERAL_BOOLEAN:
+			writeByte(writer, AS_BOOLEAN(literal));
+			break;
+
+		case LITERAL_INTEGER: {
+			int value = AS_INTEGER(literal);
+			writeBytes(writer, &value, sizeof(int));
+		}
+		break;
+
+		case LITERAL_FLOAT: {
+			float value = AS_FLOAT(literal);
+			writeBytes(writer, &value, sizeof(float));
+		}
+		break;
+
+		case LITERAL_STRING:
+			writeRefString(writer, AS_STRING(literal));
+			break;
+
+		case LITERAL_IDENTIFIER:
+			writeRefString(writer, AS_IDENTIFIER(literal));
+			break;
+
+		case LITERAL_ARRAY:
+			writeVarint(writer, AS_ARRAY(literal)->count);
+			for (int i = 0; i < AS_ARRAY(literal)->count; i++) {
+				writeLiteral(writer, AS_ARRAY(literal)->literals[i]);
+			}
+			break;
+
+		case LITERAL_DICTIONARY:
+			writeDictionary(writer, AS_DICTIONARY(literal));
+			break;
+
+		case LITERAL_PACKED_ARRAY:
+			//the buffer is written as is
+			writeByte(writer, (unsigned char)AS_PACKED_ARRAY(literal)->elementType);
+			writeVarint(writer, AS_PACKED_ARRAY(literal)->count);
+			writeBytes(writer, AS_PACKED_ARRAY(literal)->as.integers, sizeof(int) * AS_PACKED_ARRAY(literal)->count);
+			break;
+
+		case LITERAL_TYPE:
+			writeByte(writer, (unsigned char)AS_TYPE(literal).typeOf);
+			writeByte(writer, AS_TYPE(literal).constant);
+			writeVarint(writer, AS_TYPE(literal).count);
+			for (int i = 0; i < AS_TYPE(literal).count; i++) {
+				writeLiteral(writer, ((Literal*)(AS_TYPE(literal).subtypes))[i]);
+			}
+			break;
+
+		case LITERAL_FUNCTION: {
+			//only functions declared at the top level can be stored
+			Scope* scope = (Scope*)AS_FUNCTION(literal).scope;
+			if (scope != NULL && (scope->ancestor != writer->global || scope->variables.count > 0)) {
+				writer->errorOutput("Can't snapshot a function that closes over a local scope\n");
+				writer->error = true;
+				return;
+			}
+
+			writeVarint(writer, AS_FUNCTION(literal).length);
+			writeBytes(writer, AS_FUNCTION(literal).bytecode, AS_FUNCTION(literal).length);
+		}
+		break;
+
+		case LITERAL_FUNCTION_NATIVE: {
+			//find the name this native is known by
+			for (int i = 0; i < writer->natives->capacity; i++) {
+				_entry* entry = &writer->natives->entries[i];
+				if (entry->value.type == LITERAL_FUNCTION_NATIVE && AS_FUNCTION(entry->value).bytecode == AS_FUNCTION(literal).bytecode) {
+					writeRefString(writer, AS_IDENTIFIER(entry->key));
+					return;
+				}
+			}
+
+			writer->errorOutput("Can't snapshot a native function that no hook provides\n");
+			writer->error = true;
+		}
+		break;
+
+		default:
+			writer->errorOutput("Can't snapshot that literal type\n");
+			writer->error = true;
+			break;
+	}
+}
+
+//reading
+static bool hasBytes(SnapshotReader* reader, int length) {
+	if (reader->error || length < 0 || reader->count + length > reader->length) {
+		reader->error = true;
+		return false;
+	}
+
+	return true;
+}
+
+static unsigned char readByte(SnapshotReader* reader) {
+	if (!hasBytes(reader, 1)) {
+		return 0;
+	}
+
+	return reader->bytes[reader->count++];
+}
+
+static unsigned int readVarint(SnapshotReader* reader) {
+	unsigned int ret = 0;
+	int shift = 0;
+	unsigned char byte;
+
+	do {
+		byte = readByte(reader);
+		if (shift < 32) {
+			ret |= (unsigned int)(byte & 0x7F) << shift;
+		}
+		shift += 7;
+	} while ((byte & 0x80) && !reader->error);
+
+	return ret;
+}
+
+static RefString* readRefString(SnapshotReader* reader) {
+	int length = (int)readVarint(reader);
+	if (!hasBytes(reader, length)) {
+		return NULL;
+	}
+
+	RefString* refString = createRefStringLength((char*)(reader->bytes + reader->count), length);
+	reader->count += length;
+
+	return refString;
+}
+
+static Literal readLiteral(SnapshotReader* reader);
+
+static void readDictionary(SnapshotReader* reader, LiteralDictionary* dictionary) {
+	int count = (int)readVarint(reader);
+
+	for (int i = 0; i < count && !reader->error; i++) {
+		Literal key = readLiteral(reader);
+		Literal value = readLiteral(reader);
+
+		if (!reader->error) {
+			setLiteralDictionary(dictionary, key, value);
+		}
+
+		freeLiteral(key);
+		freeLiteral(value);
+	}
+}
+
+static Literal readLiteral(SnapshotReader* reader) {
+	LiteralType type = (LiteralType)readByte(reader);
+
+	if (reader->error) {
+		return TO_NULL_LITERAL;
+	}
+
+	switch(type) {
+		case LITERAL_NULL:
+			return TO_NULL_LITERAL;
+
+		case LITERAL_ANY: {
+			Literal literal = TO_NULL_LITERAL;
+			literal.type = LITERAL_ANY;
+			return literal;
+		}
+
+		case LITERAL_BOOLEAN:
+			return TO_BOOLEAN_LITERAL(readByte(reader));
+
+		case LITERAL_INTEGER: {
+			int value = 0;
+			if (hasBytes(reader, sizeof(int))) {
+				memcpy(&value, reader->bytes + reader->count, sizeof(int));
+				reader->count += sizeof(int);
+			}
+			return TO_INTEGER_LITERAL(value);
+		}
+
+		case LITERAL_FLOAT: {
+			float value = 0;
+			if (hasBytes(reader, sizeof(float))) {
+				memcpy(&value, reader->bytes + reader->count, sizeof(float));
+				reader->count += sizeof(float);
+			}
+			return TO_FLOAT_LITERAL(value);
+		}
+
+		case LITERAL_STRING: {
+			RefString* refString = readRefString(reader);
+			return refString ? TO_STRING_LITERAL(refString) : TO_NULL_LITERAL;
+		}
+
+		case LITERAL_IDENTIFIER: {
+			RefString* refString = readRefString(reader);
+			return refString ? TO_IDENTIFIER_LITERAL(refString) : TO_NULL_LITERAL;
+		}
+
+		case LITERAL_ARRAY: {
+			LiteralArray* array = ALLOCATE(LiteralArray, 1);
+			initLiteralArray(array);
+
+			int count = (int)readVarint(reader);
+			for (int i = 0; i < count && !reader->error; i++) {
+				Literal element = readLiteral(reader);
+				pushLiteralArray(array, element);
+				freeLiteral(element);
+			}
+
+			return TO_ARRAY_LITERAL(array);
+		}
+
+		case LITERAL_DICTIONARY: {
+			LiteralDictionary* dictionary = ALLOCATE(LiteralDictionary, 1);
+			initLiteralDictionary(dictionary);
+
+			readDictionary(reader, dictionary);
+
+			return TO_DICTIONARY_LITERAL(dictionary);
+		}
+
+		case LITERAL_PACKED_ARRAY: {
+			LiteralType elementType = (LiteralType)readByte(reader);
+			int count = (int)readVarint(reader);
+
+			if ((elementType != LITERAL_INTEGER && elementType != LITERAL_FLOAT) || count < 0 || count > (reader->length - reader->count) / (int)sizeof(int)) {
+				reader->error = true;
+				return TO_NULL_LITERAL;
+			}
+
+			PackedArray* array = createPackedArray(elementType);
+
+			for (int i = 0; i < count; i++) {
+				int integer = 0;
+				float number = 0;
+
+				if (elementType == LITERAL_INTEGER) {
+					memcpy(&integer, reader->bytes + reader->count, sizeof(int));
+					pushPackedArray(array, TO_INTEGER_LITERAL(integer));
+				}
+				else {
+					memcpy(&number, reader->bytes + reader->count, sizeof(float));
+					pushPackedArray(array, TO_FLOAT_LITERAL(number));
+				}
+
+				reader->count += sizeof(int);
+			}
+
+			return TO_PACKED_ARRAY_LITERAL(array);
+		}
+
+		case LITERAL_TYPE: {
+			LiteralType typeOf = (LiteralType)readByte(reader);
+			bool constant = readByte(reader);
+			Literal literal = TO_TYPE_LITERAL(typeOf, constant);
+
+			int count = (int)readVarint(reader);
+			for (int i = 0; i < count && !reader->error; i++) {
+				TYPE_PUSH_SUBTYPE(&literal, readLiteral(reader));
+			}
+
+			return literal;
+		}
+
+		case LITERAL_FUNCTION: {
+			int length = (int)readVarint(reader);
+			if (!hasBytes(reader, length)) {
+				return TO_NULL_LITERAL;
+			}
+
+			unsigned char* bytecode = ALLOCATE(unsigned char, length);
+			memcpy(bytecode, reader->bytes + reader->count, length);
+			reader->count += length;
+
+			//the same as a fresh declaration in the global scope
+			Literal literal = TO_FUNCTION_LITERAL(bytecode, length);
+			AS_FUNCTION(literal).scope = pushScope(reader->global);
+
+			return literal;
+		}
+
+		case LITERAL_FUNCTION_NATIVE: {
+			RefString* name = readRefString(reader);
+			if (!name) {
+				return TO_NULL_LITERAL;
+			}
+
+			Literal identifier = TO_IDENTIFIER_LITERAL(name);
+			Literal native = getLiteralDictionary(reader->natives, identifier);
+			freeLiteral(identifier);
+
+			if (native.type != LITERAL_FUNCTION_NATIVE) {
+				freeLiteral(native);
+				reader->error = true;
+				return TO_NULL_LITERAL;
+			}
+
+			return native;
+		}
+
+		default:
+			reader->error = true;
+			return TO_NULL_LITERAL;
+	}
+}
+
+//exposed functions
+unsigned char* snapshotInterpreter(Interpreter* interpreter, int* size) {
+	Interpreter scratch;
+	collectNatives(interpreter, &scratch);
+
+	SnapshotWriter writer;
+	writer.bytes = NULL;
+	writer.capacity = 0;
+	writer.count = 0;
+	writer.global = interpreter->scope;
+	writer.natives = &scratch.scope->variables;
+	writer.errorOutput = interpreter->errorOutput;
+	writer.error = false;
+
+	//version, so a stale snapshot is never restored
+	writeByte(&writer, TOY_VERSION_MAJOR);
+	writeByte(&writer, TOY_VERSION_MINOR);
+	writeByte(&writer, TOY_VERSION_PATCH);
+
+	writeDictionary(&writer, &interpreter->scope->variables);
+	writeDictionary(&writer, &interpreter->scope->types);
+	writeDictionary(&writer, interpreter->exports);
+	writeDictionary(&writer, interpreter->exportTypes);
+
+	freeInterpreter(&scratch);
+
+	if (writer.error) {
+		FREE_ARRAY(unsigned char, writer.bytes, writer.capacity);
+		return NULL;
+	}
+
+	writer.bytes = SHRINK_ARRAY(unsigned char, writer.bytes, writer.capacity, writer.count);
+	*size = writer.count;
+
+	return writer.bytes;
+}
+
+bool restoreInterpreter(Interpreter* interpreter, unsigned char* snapshot, int size) {
+	if (size < 3 || snapshot[0] != TOY_VERSION_MAJOR || snapshot[1] != TOY_VERSION_MINOR || snapshot[2] != TOY_VERSION_PATCH) {
+		interpreter->errorOutput("Interpreter/snapshot version mismatch\n");
+		return false;
+	}
+
+	Interpreter scratch;
+	collectNatives(interpreter, &scratch);
+
+	SnapshotReader reader;
+	reader.bytes = snapshot;
+	reader.length = size;
+	reader.count = 3;
+	reader.global = interpreter->scope;
+	reader.natives = &scratch.scope->variables;
+	reader.error = false;
+
+	//existing entries, such as the builtins, are overwritten
+	readDictionary(&reader, &interpreter->scope->variables);
+	readDictionary(&reader, &interpreter->scope->types);
+	readDictionary(&reader, interpreter->exports);
+	readDictionary(&reader, interpreter->exportTypes);
+
+	freeInterpreter(&scratch);
+
+	if (reader.error || reader.count != reader.length) {
+		interpreter->errorOutput("Failed to restore a damaged snapshot\n");
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include "toy_common.h"
+#include "interpreter.h"
+
+//a snapshot holds an interpreter's global scope and exports, so warm-up scripts only need to run once
+//native functions are stored by name, and re-bound through the builtins and the injected hooks when restored
+//NOTE: opaque values, and functions that close over anything but the global scope, can't be stored
+
+TOY_API unsigned char* snapshotInterpreter(Interpreter* interpreter, int* size); //returns NULL on failure
+TOY_API bool restoreInterpreter(Interpreter* interpreter, unsigned char* snapshot, int size); //call after the hooks are injected, the snapshot is only borrowed
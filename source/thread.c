@@ -0,0 +1,186 @@
+#include "thread.h"
+
+#include "memory.h"
+
+#if defined(_WIN32) || defined(WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+struct Thread {
+	ThreadFn fn;
+	void* userdata;
+
+#if defined(_WIN32) || defined(WIN32)
+	HANDLE handle;
+#else
+	pthread_t handle;
+#endif
+};
+
+struct Mutex {
+#if defined(_WIN32) || defined(WIN32)
+	SRWLOCK lock;
+#else
+	pthread_mutex_t lock;
+#endif
+};
+
+struct Condition {
+#if defined(_WIN32) || defined(WIN32)
+	CONDITION_VARIABLE condition;
+#else
+	pthread_cond_t condition;
+#endif
+};
+
+#if defined(_WIN32) || defined(WIN32)
+
+static DWORD WINAPI threadEntry(LPVOID arg) {
+	Thread* thread = (Thread*)arg;
+	thread->fn(thread->userdata);
+	return 0;
+}
+
+Thread* startThread(ThreadFn fn, void* userdata) {
+	Thread* thread = ALLOCATE(Thread, 1);
+
+	thread->fn = fn;
+	thread->userdata = userdata;
+	thread->handle = CreateThread(NULL, 0, threadEntry, thread, 0, NULL);
+
+	if (thread->handle == NULL) {
+		FREE(Thread, thread);
+		return NULL;
+	}
+
+	return thread;
+}
+
+void joinThread(Thread* thread) {
+	WaitForSingleObject(thread->handle, INFINITE);
+	CloseHandle(thread->handle);
+	FREE(Thread, thread);
+}
+
+void yieldThread() {
+	SwitchToThread();
+}
+
+Mutex* createMutex() {
+	Mutex* mutex = ALLOCATE(Mutex, 1);
+	InitializeSRWLock(&mutex->lock);
+	return mutex;
+}
+
+void freeMutex(Mutex* mutex) {
+	//slim locks need no cleanup
+	FREE(Mutex, mutex);
+}
+
+void lockMutex(Mutex* mutex) {
+	AcquireSRWLockExclusive(&mutex->lock);
+}
+
+void unlockMutex(Mutex* mutex) {
+	ReleaseSRWLockExclusive(&mutex->lock);
+}
+
+Condition* createCondition() {
+	Condition* condition = ALLOCATE(Condition, 1);
+	InitializeConditionVariable(&condition->condition);
+	return condition;
+}
+
+void freeCondition(Condition* condition) {
+	FREE(Condition, condition);
+}
+
+void waitCondition(Condition* condition, Mutex* mutex) {
+	SleepConditionVariableSRW(&condition->condition, &mutex->lock, INFINITE, 0);
+}
+
+void signalCondition(Condition* condition) {
+	WakeConditionVariable(&condition->condition);
+}
+
+void broadcastCondition(Condition* condition) {
+	WakeAllConditionVariable(&condition->condition);
+}
+
+#else
+
+static void* threadEntry(void* arg) {
+	Thread* thread = (Thread*)arg;
+	thread->fn(thread->userdata);
+	return NULL;
+}
+
+Thread* startThread(ThreadFn fn, void* userdata) {
+	Thread* thread = ALLOCATE(Thread, 1);
+
+	thread->fn = fn;
+	thread->userdata = userdata;
+
+	if (pthread_create(&thread->handle, NULL, threadEntry, thread) != 0) {
+		FREE(Thread, thread);
+		return NULL;
+	}
+
+	return thread;
+}
+
+void joinThread(Thread* thread) {
+	pthread_join(thread->handle, NULL);
+	FREE(Thread, thread);
+}
+
+void yieldThread() {
+	sched_yield();
+}
+
+Mutex* createMutex() {
+	Mutex* mutex = ALLOCATE(Mutex, 1);
+	pthread_mutex_init(&mutex->lock, NULL);
+	return mutex;
+}
+
+void freeMutex(Mutex* mutex) {
+	pthread_mutex_destroy(&mutex->lock);
+	FREE(Mutex, mutex);
+}
+
+void lockMutex(Mutex* mutex) {
+	pthread_mutex_lock(&mutex->lock);
+}
+
+void unlockMutex(Mutex* mutex) {
+	pthread_mutex_unlock(&mutex->lock);
+}
+
+Condition* createCondition() {
+	Condition* condition = ALLOCATE(Condition, 1);
+	pthread_cond_init(&condition->condition, NULL);
+	return condition;
+}
+
+void freeCondition(Condition* condition) {
+	pthread_cond_destroy(&condition->condition);
+	FREE(Condition, condition);
+}
+
+void waitCondition(Condition* condition, Mutex* mutex) {
+	pthread_cond_wait(&condition->condition, &mutex->lock);
+}
+
+void signalCondition(Condition* condition) {
+	pthread_cond_signal(&condition->condition);
+}
+
+void broadcastCondition(Condition* condition) {
+	pthread_cond_broadcast(&condition->condition);
+}
+
+#endif
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "toy_common.h"
+
+//a thin layer over the platform's threads, so headers don't need pthreads or windows.h
+typedef struct Thread Thread;
+typedef struct Mutex Mutex;
+typedef struct Condition Condition;
+
+typedef void (*ThreadFn)(void* userdata);
+
+Thread* startThread(ThreadFn fn, void* userdata); //NULL if the thread couldn't be started
+void joinThread(Thread* thread); //waits for the thread to finish, then releases it
+void yieldThread(); //lets another thread run, for spinning waits
+
+Mutex* createMutex();
+void freeMutex(Mutex* mutex);
+void lockMutex(Mutex* mutex);
+void unlockMutex(Mutex* mutex);
+
+Condition* createCondition();
+void freeCondition(Condition* condition);
+void waitCondition(Condition* condition, Mutex* mutex); //the mutex must be locked, and can wake spuriously
+void signalCondition(Condition* condition);
+void broadcastCondition(Condition* condition);
@@ -36,6 +36,11 @@ typedef enum TokenType {
 	TOKEN_TYPEOF,
 	TOKEN_VAR,
 	TOKEN_WHILE,
+	TOKEN_YIELD,
+	TOKEN_STRUCT,
+	TOKEN_SWITCH,
+	TOKEN_CASE,
+	TOKEN_DEFAULT,
 
 	//literal values
 	TOKEN_IDENTIFIER,
@@ -30,6 +30,7 @@ void initCommand(int argc, const char* argv[]) {
 	command.compilefile = NULL;
 	command.outfile = "out.tb";
 	command.source = NULL;
+	command.cachedir = NULL;
 	command.verbose = false;
 
 	for (int i = 1; i < argc; i++) { //start at 1 to skip the program name
@@ -81,6 +82,13 @@ void initCommand(int argc, const char* argv[]) {
 			continue;
 		}
 
+		if ((!strcmp(argv[i], "-k") || !strcmp(argv[i], "--cache")) && i + 1 < argc) {
+			command.cachedir = (char*)argv[i + 1];
+			i++;
+			command.error = false;
+			continue;
+		}
+
 		//option without a flag + ending in .tb = binary input
 		if (i < argc) {
 			if (strncmp(&(argv[i][strlen(argv[i]) - 3]), ".tb", 3) == 0) {
@@ -96,7 +104,7 @@ void initCommand(int argc, const char* argv[]) {
 }
 
 void usageCommand(int argc, const char* argv[]) {
-	printf("Usage: %s [<file.tb> | -h | -v | [-d][-f file | -i source | -c file [-o outfile]]]\n\n", argv[0]);
+	printf("Usage: %s [<file.tb> | -h | -v | [-d][-k dir][-f file | -i source | -c file [-o outfile]]]\n\n", argv[0]);
 }
 
 void helpCommand(int argc, const char* argv[]) {
@@ -110,6 +118,7 @@ void helpCommand(int argc, const char* argv[]) {
 	printf("-i\t| --input source\tParse, compile and execute this given string of source code.\n\n");
 	printf("-c\t| --compile filename\tParse and compile the specified source file into an output file.\n\n");
 	printf("-o\t| --output outfile\tName of the output file built with --compile (default: out.tb).\n\n");
+	printf("-k\t| --cache dirname\tReuse bytecode compiled by earlier runs of --file and --input, stored in this directory.\n\n");
 }
 
 void copyrightCommand(int argc, const char* argv[]) {
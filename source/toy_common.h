@@ -5,8 +5,8 @@
 #include <stdint.h>
 
 #define TOY_VERSION_MAJOR 0
-#define TOY_VERSION_MINOR 6
-#define TOY_VERSION_PATCH 5
+#define TOY_VERSION_MINOR 7
+#define TOY_VERSION_PATCH 0
 #define TOY_VERSION_BUILD __DATE__ " " __TIME__
 
 //NOTE: I don't know why the time headers are here, need to try moving them back to the correct spots again
@@ -28,6 +28,13 @@
 
 #endif
 
+//the runtime's own state is kept per-thread, so interpreters can run on several threads at once
+#if defined(_MSC_VER)
+#define TOY_THREAD_LOCAL __declspec(thread)
+#else
+#define TOY_THREAD_LOCAL _Thread_local
+#endif
+
 #ifndef TOY_EXPORT
 //for processing the command line arguments
 typedef struct {
@@ -39,6 +46,7 @@ typedef struct {
 	char* compilefile;
 	char* outfile; //defaults to out.tb
 	char* source;
+	char* cachedir; //optional on-disk compile cache
 	bool verbose;
 } Command;
 
@@ -53,3 +61,7 @@ void copyrightCommand(int argc, const char* argv[]);
 
 //NOTE: assigning to a byte from a short loses data
 #define AS_USHORT(value) (*(unsigned short*)(&(value)))
+#define AS_UINT(value) (*(unsigned int*)(&(value)))
+
+//bytecode operands: indexes, counts and sizes are LEB128 varints, jump targets are 32-bit
+#define TOY_VARINT_MAX 5
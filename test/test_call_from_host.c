@@ -66,14 +66,12 @@ unsigned char* compileString(char* source, size_t* size) {
 		//pack up and leave
 		if (node->type == AST_NODE_ERROR) {
 			printf(ERROR "error node detected\n" RESET);
-			freeASTNode(node);
 			freeCompiler(&compiler);
 			freeParser(&parser);
 			return NULL;
 		}
 
 		writeCompiler(&compiler, node);
-		freeASTNode(node);
 		node = scanParser(&parser);
 	}
 
@@ -0,0 +1,342 @@
+#include "lib_channel.h"
+
+#include "lexer.h"
+#include "parser.h"
+#include "compiler.h"
+#include "interpreter.h"
+
+#include "console_colors.h"
+
+#include "memory.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+#define PRODUCER_COUNT 4
+#define CONSUMER_COUNT 4
+#define MESSAGE_COUNT 20000
+
+static void failFn(const char* output) {
+	fprintf(stderr, ERROR "Script failure: %s\n" RESET, output);
+}
+
+static int expectedFailures = 0;
+static void countFailureFn(const char* output) {
+	expectedFailures++;
+}
+
+//compilation functions
+unsigned char* compileString(char* source, size_t* size) {
+	Lexer lexer;
+	Parser parser;
+	Compiler compiler;
+
+	initLexer(&lexer, source);
+	initParser(&parser, &lexer);
+	initCompiler(&compiler);
+
+	//run the parser until the end of the source
+	ASTNode* node = scanParser(&parser);
+	while(node != NULL) {
+		//pack up and leave
+		if (node->type == AST_NODE_ERROR) {
+			printf(ERROR "error node detected\n" RESET);
+			freeCompiler(&compiler);
+			freeParser(&parser);
+			return NULL;
+		}
+
+		writeCompiler(&compiler, node);
+		node = scanParser(&parser);
+	}
+
+	//get the bytecode dump
+	unsigned char* tb = collateCompiler(&compiler, (int*)(size));
+
+	//cleanup
+	freeCompiler(&compiler);
+	freeParser(&parser);
+	//no lexer to clean up
+
+	//finally
+	return tb;
+}
+
+static double secondsSince(struct timeval* start) {
+	struct timeval end;
+	gettimeofday(&end, NULL);
+	return (end.tv_sec - start->tv_sec) + (end.tv_usec - start->tv_usec) / 1000000.0;
+}
+
+//C to C, through the host API
+static Channel* numbers;
+static long long receivedSum[CONSUMER_COUNT];
+static int receivedCount[CONSUMER_COUNT];
+static int producersDone = 0;
+static pthread_mutex_t doneLock = PTHREAD_MUTEX_INITIALIZER;
+
+static void* produceNumbers(void* arg) {
+	for (int i = 0; i < MESSAGE_COUNT; i++) {
+		while (!trySendChannel(numbers, TO_INTEGER_LITERAL(i))) {
+			sched_yield();
+		}
+	}
+
+	//the last producer out closes the channel
+	pthread_mutex_lock(&doneLock);
+	if (++producersDone == PRODUCER_COUNT) {
+		closeChannel(numbers);
+	}
+	pthread_mutex_unlock(&doneLock);
+
+	return NULL;
+}
+
+static void* consumeNumbers(void* arg) {
+	int index = (int)(long)arg;
+	Literal literal;
+
+	for (;;) {
+		if (tryReceiveChannel(numbers, &literal)) {
+			receivedSum[index] += AS_INTEGER(literal);
+			receivedCount[index]++;
+			continue;
+		}
+
+		//drained and closed
+		pthread_mutex_lock(&doneLock);
+		bool finished = producersDone == PRODUCER_COUNT;
+		pthread_mutex_unlock(&doneLock);
+
+		if (finished && !tryReceiveChannel(numbers, &literal)) {
+			break;
+		}
+		else if (finished) {
+			receivedSum[index] += AS_INTEGER(literal);
+			receivedCount[index]++;
+		}
+
+		sched_yield();
+	}
+
+	return NULL;
+}
+
+//script to script
+typedef struct Worker {
+	pthread_t thread;
+	Program* program;
+	Literal channel;
+	int count;
+} Worker;
+
+static void* runScript(void* arg) {
+	Worker* worker = (Worker*)arg;
+
+	Interpreter interpreter;
+	initInterpreter(&interpreter);
+	setInterpreterAssert(&interpreter, failFn);
+	setInterpreterError(&interpreter, failFn);
+	injectNativeHook(&interpreter, "channel", hookChannel);
+
+	//hand the channel over
+	Literal name = TO_IDENTIFIER_LITERAL(createRefString("messages"));
+	Literal type = TO_TYPE_LITERAL(LITERAL_OPAQUE, false);
+	setLiteralDictionary(interpreter.exports, name, worker->channel);
+	setLiteralDictionary(interpreter.exportTypes, name, type);
+	freeLiteral(name);
+
+	runProgram(&interpreter, worker->program);
+
+	//read back the consumer's count
+	Literal countName = TO_IDENTIFIER_LITERAL(createRefString("count"));
+	Literal count = getLiteralDictionary(interpreter.exports, countName);
+	worker->count = IS_INTEGER(count) ? AS_INTEGER(count) : -1;
+	freeLiteral(count);
+	freeLiteral(countName);
+
+	freeInterpreter(&interpreter);
+
+	return NULL;
+}
+
+static Program* compileProgram(char* source) {
+	size_t size = 0;
+	unsigned char* tb = compileString(source, &size);
+
+	Program* program = ALLOCATE(Program, 1);
+	if (!initProgram(program, tb, size)) {
+		fprintf(stderr, ERROR "ERROR: initProgram() failed\n" RESET);
+		exit(-1);
+	}
+
+	return program;
+}
+
+int main() {
+	{
+		//many producers, many consumers
+		numbers = createChannel(256);
+
+		struct timeval start;
+		gettimeofday(&start, NULL);
+
+		pthread_t producers[PRODUCER_COUNT];
+		pthread_t consumers[CONSUMER_COUNT];
+
+		for (int i = 0; i < CONSUMER_COUNT; i++) {
+			pthread_create(&consumers[i], NULL, consumeNumbers, (void*)(long)i);
+		}
+
+		for (int i = 0; i < PRODUCER_COUNT; i++) {
+			pthread_create(&producers[i], NULL, produceNumbers, NULL);
+		}
+
+		for (int i = 0; i < PRODUCER_COUNT; i++) {
+			pthread_join(producers[i], NULL);
+		}
+
+		for (int i = 0; i < CONSUMER_COUNT; i++) {
+			pthread_join(consumers[i], NULL);
+		}
+
+		double seconds = secondsSince(&start);
+
+		long long sum = 0;
+		int count = 0;
+		for (int i = 0; i < CONSUMER_COUNT; i++) {
+			sum += receivedSum[i];
+			count += receivedCount[i];
+		}
+
+		long long expected = (long long)PRODUCER_COUNT * MESSAGE_COUNT * (MESSAGE_COUNT - 1) / 2;
+		if (count != PRODUCER_COUNT * MESSAGE_COUNT || sum != expected) {
+			fprintf(stderr, ERROR "ERROR: lost messages (%d received, sum %lld, expected %lld)\n" RESET, count, sum, expected);
+			return -1;
+		}
+
+		printf(NOTICE "host to host: %.0f messages/s\n" RESET, count / seconds);
+
+		freeChannel(numbers);
+	}
+
+	{
+		//one script produces, the others consume
+		Program* producer = compileProgram(
+			"import channel;\n"
+			"import messages;\n"
+			"for (var i: int = 0; i < 2000; i++) {\n"
+			"	messages.sendChannel(\"record\");\n"
+			"	messages.sendChannel([\"id\": i]);\n"
+			"}\n"
+			"messages.closeChannel();\n"
+		);
+
+		Program* consumer = compileProgram(
+			"import channel;\n"
+			"import messages;\n"
+			"var count: int = 0;\n"
+			"while (messages.receiveChannel() != null) {\n"
+			"	count++;\n"
+			"}\n"
+			"export count;\n"
+		);
+
+		Channel* channel = createChannel(64);
+		Literal channelLiteral = TO_OPAQUE_LITERAL(channel, CHANNEL_TAG);
+
+		Worker workers[3] = {
+			{ .program = producer, .channel = channelLiteral },
+			{ .program = consumer, .channel = channelLiteral },
+			{ .program = consumer, .channel = channelLiteral },
+		};
+
+		struct timeval start;
+		gettimeofday(&start, NULL);
+
+		for (int i = 0; i < 3; i++) {
+			pthread_create(&workers[i].thread, NULL, runScript, &workers[i]);
+		}
+
+		for (int i = 0; i < 3; i++) {
+			pthread_join(workers[i].thread, NULL);
+		}
+
+		double seconds = secondsSince(&start);
+
+		freeChannel(channel);
+		freeProgram(producer);
+		freeProgram(consumer);
+		FREE(Program, producer);
+		FREE(Program, consumer);
+
+		int count = workers[1].count + workers[2].count;
+		if (workers[1].count < 0 || workers[2].count < 0 || count != 4000) {
+			fprintf(stderr, ERROR "ERROR: consumers got %d and %d messages\n" RESET, workers[1].count, workers[2].count);
+			return -1;
+		}
+
+		printf(NOTICE "script to script: %.0f messages/s\n" RESET, count / seconds);
+	}
+
+	{
+		//messages outlive the program that sent them
+		Program* producer = compileProgram(
+			"import channel;\n"
+			"import messages;\n"
+			"messages.sendChannel(\"constant\");\n"
+			"messages.sendChannel([\"alpha\", \"beta\"]);\n"
+		);
+
+		Channel* channel = createChannel(4);
+		Worker worker = { .program = producer, .channel = TO_OPAQUE_LITERAL(channel, CHANNEL_TAG) };
+
+		runScript(&worker);
+		freeProgram(producer);
+		FREE(Program, producer);
+
+		Literal string = TO_NULL_LITERAL;
+		Literal array = TO_NULL_LITERAL;
+
+		if (!tryReceiveChannel(channel, &string) || !tryReceiveChannel(channel, &array) || !IS_STRING(string) || strcmp(toCString(AS_STRING(string)), "constant") || !IS_ARRAY(array) || AS_ARRAY(array)->count != 2 || strcmp(toCString(AS_STRING(AS_ARRAY(array)->literals[1])), "beta")) {
+			fprintf(stderr, ERROR "ERROR: messages didn't survive the sender's program\n" RESET);
+			return -1;
+		}
+
+		freeLiteral(string);
+		freeLiteral(array);
+		freeChannel(channel);
+	}
+
+	{
+		//other opaque values aren't mistaken for channels
+		int notAChannel = 0;
+
+		Interpreter interpreter;
+		initInterpreter(&interpreter);
+		setInterpreterError(&interpreter, countFailureFn);
+		injectNativeHook(&interpreter, "channel", hookChannel);
+
+		Literal name = TO_IDENTIFIER_LITERAL(createRefString("messages"));
+		Literal type = TO_TYPE_LITERAL(LITERAL_OPAQUE, false);
+		setLiteralDictionary(interpreter.exports, name, TO_OPAQUE_LITERAL(&notAChannel, 0));
+		setLiteralDictionary(interpreter.exportTypes, name, type);
+		freeLiteral(name);
+
+		size_t size = 0;
+		unsigned char* tb = compileString("import channel;\nimport messages;\nmessages.trySendChannel(5);\n", &size);
+		runInterpreter(&interpreter, tb, size);
+		freeInterpreter(&interpreter);
+
+		if (expectedFailures == 0 || notAChannel != 0) {
+			fprintf(stderr, ERROR "ERROR: a foreign opaque value was used as a channel\n" RESET);
+			return -1;
+		}
+	}
+
+	printf(NOTICE "All good\n" RESET);
+	return 0;
+}
@@ -0,0 +1,139 @@
+#include "compile_cache.h"
+
+#include "lexer.h"
+#include "parser.h"
+#include "compiler.h"
+#include "interpreter.h"
+
+#include "memory.h"
+#include "console_colors.h"
+
+#include <stdio.h>
+#include <string.h>
+
+//compilation functions
+unsigned char* compileString(char* source, size_t* size) {
+	Lexer lexer;
+	Parser parser;
+	Compiler compiler;
+
+	initLexer(&lexer, source);
+	initParser(&parser, &lexer);
+	initCompiler(&compiler);
+
+	//run the parser until the end of the source
+	ASTNode* node = scanParser(&parser);
+	while(node != NULL) {
+		//pack up and leave
+		if (node->type == AST_NODE_ERROR) {
+			printf(ERROR "error node detected\n" RESET);
+			freeCompiler(&compiler);
+			freeParser(&parser);
+			return NULL;
+		}
+
+		writeCompiler(&compiler, node);
+		node = scanParser(&parser);
+	}
+
+	//get the bytecode dump
+	unsigned char* tb = collateCompiler(&compiler, (int*)(size));
+
+	//cleanup
+	freeCompiler(&compiler);
+	freeParser(&parser);
+	//no lexer to clean up
+
+	//finally
+	return tb;
+}
+
+int main() {
+	{
+		//test init & cleanup
+		CompileCache cache;
+		initCompileCache(&cache, 4);
+		freeCompileCache(&cache);
+	}
+
+	{
+		//the same source always compiles to the same bytes
+		char* source = "fn f(x) { return x * 2; } var a = [1, 2, 3]; var d = [\"a\": 1, \"b\": 2]; assert f(a[1]) == 4, \"determinism\";";
+
+		size_t firstSize = 0, secondSize = 0;
+		unsigned char* first = compileString(source, &firstSize);
+		unsigned char* second = compileString(source, &secondSize);
+
+		if (firstSize != secondSize || memcmp(first, second, firstSize) != 0) {
+			fprintf(stderr, ERROR "ERROR: bytecode output is not deterministic\n" RESET);
+			return -1;
+		}
+
+		FREE_ARRAY(unsigned char, first, firstSize);
+		FREE_ARRAY(unsigned char, second, secondSize);
+	}
+
+	{
+		//test lookups, hits and least recently used eviction
+		char* sources[] = {
+			"print 1;",
+			"print 2;",
+			"print 3;",
+		};
+
+		CompileCache cache;
+		initCompileCache(&cache, 2);
+
+		size_t size = 0;
+		if (lookupCompileCache(&cache, sources[0], &size) != NULL) {
+			fprintf(stderr, ERROR "ERROR: empty cache returned an entry\n" RESET);
+			return -1;
+		}
+
+		for (int i = 0; i < 2; i++) {
+			unsigned char* tb = compileString(sources[i], &size);
+			insertCompileCache(&cache, sources[i], tb, size);
+			FREE_ARRAY(unsigned char, tb, size);
+		}
+
+		//touch the first, so the second is evicted next
+		unsigned char* hit = lookupCompileCache(&cache, sources[0], &size);
+		if (hit == NULL || hit[0] != TOY_VERSION_MAJOR || hit[1] != TOY_VERSION_MINOR || hit[2] != TOY_VERSION_PATCH) {
+			fprintf(stderr, ERROR "ERROR: cache lookup failed\n" RESET);
+			return -1;
+		}
+
+		unsigned char* tb = compileString(sources[2], &size);
+		insertCompileCache(&cache, sources[2], tb, size);
+		FREE_ARRAY(unsigned char, tb, size);
+
+		if (cache.count != 2 || lookupCompileCache(&cache, sources[1], &size) != NULL || lookupCompileCache(&cache, sources[0], &size) == NULL || lookupCompileCache(&cache, sources[2], &size) == NULL) {
+			fprintf(stderr, ERROR "ERROR: cache eviction failed\n" RESET);
+			return -1;
+		}
+
+		//the cached bytecode can be run without being copied
+		Interpreter interpreter;
+		initInterpreter(&interpreter);
+		runInterpreterBorrowed(&interpreter, lookupCompileCache(&cache, sources[2], &size), size);
+		freeInterpreter(&interpreter);
+
+		freeCompileCache(&cache);
+
+		if (cache.head != NULL || cache.tail != NULL || cache.count != 0) {
+			fprintf(stderr, ERROR "ERROR: cache not cleared\n" RESET);
+			return -1;
+		}
+	}
+
+	{
+		//the key depends on the whole source
+		if (hashCompileCacheKey("print 1;", 8) == hashCompileCacheKey("print 2;", 8)) {
+			fprintf(stderr, ERROR "ERROR: cache keys collided\n" RESET);
+			return -1;
+		}
+	}
+
+	printf(NOTICE "All good\n" RESET);
+	return 0;
+}
@@ -76,7 +76,6 @@ int main() {
 
 		//cleanup
 		FREE_ARRAY(unsigned char, bytecode, size);
-		freeASTNode(node);
 		freeParser(&parser);
 		freeCompiler(&compiler);
 	}
@@ -104,7 +103,6 @@ int main() {
 
 			//write
 			writeCompiler(&compiler, node);
-			freeASTNode(node);
 
 			node = scanParser(&parser);
 		}
@@ -120,6 +118,41 @@ int main() {
 		freeCompiler(&compiler);
 	}
 
+	{
+		//source
+		char* source = "print 1; print 1; print 1.0; print \"foo\"; print \"foo\"; print [1, 2]; print [1, 2]; print [\"foo\": 1.0]; print [\"foo\": 1.0];";
+
+		//test constant deduplication
+		Lexer lexer;
+		Parser parser;
+		Compiler compiler;
+
+		initLexer(&lexer, source);
+		initParser(&parser, &lexer);
+		initCompiler(&compiler);
+
+		ASTNode* node = scanParser(&parser);
+		while (node != NULL) {
+			if (node->type == AST_NODE_ERROR) {
+				fprintf(stderr, ERROR "ERROR: Error node found" RESET);
+				return -1;
+			}
+
+			writeCompiler(&compiler, node);
+			node = scanParser(&parser);
+		}
+
+		//1, 1.0, "foo", 2, [1, 2], ["foo": 1.0]
+		if (compiler.literalCache.count != 6) {
+			fprintf(stderr, ERROR "ERROR: Unexpected literal cache size: %d" RESET, compiler.literalCache.count);
+			return -1;
+		}
+
+		//cleanup
+		freeParser(&parser);
+		freeCompiler(&compiler);
+	}
+
 	printf(NOTICE "All good\n" RESET);
 	return 0;
 }
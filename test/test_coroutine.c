@@ -0,0 +1,249 @@
+#include "coroutine.h"
+
+#include "lexer.h"
+#include "parser.h"
+#include "compiler.h"
+
+#include "console_colors.h"
+
+#include "memory.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+//suppress the print output
+static void noPrintFn(const char* output) {
+	//NO OP
+}
+
+int failedAsserts = 0;
+static void assertWrapper(const char* output) {
+	failedAsserts++;
+	fprintf(stderr, ERROR "Assertion failure: ");
+	fprintf(stderr, "%s", output);
+	fprintf(stderr, "\n" RESET); //default new line
+}
+
+int errors = 0;
+static void errorWrapper(const char* output) {
+	errors++;
+}
+
+//compilation functions
+unsigned char* compileString(char* source, size_t* size) {
+	Lexer lexer;
+	Parser parser;
+	Compiler compiler;
+
+	initLexer(&lexer, source);
+	initParser(&parser, &lexer);
+	initCompiler(&compiler);
+
+	//run the parser until the end of the source
+	ASTNode* node = scanParser(&parser);
+	while(node != NULL) {
+		//pack up and leave
+		if (node->type == AST_NODE_ERROR) {
+			printf(ERROR "error node detected\n" RESET);
+			freeCompiler(&compiler);
+			freeParser(&parser);
+			return NULL;
+		}
+
+		writeCompiler(&compiler, node);
+		node = scanParser(&parser);
+	}
+
+	//get the bytecode dump
+	unsigned char* tb = collateCompiler(&compiler, (int*)(size));
+
+	//cleanup
+	freeCompiler(&compiler);
+	freeParser(&parser);
+	//no lexer to clean up
+
+	//finally
+	return tb;
+}
+
+static void initTestInterpreter(Interpreter* interpreter) {
+	initInterpreter(interpreter);
+	setInterpreterPrint(interpreter, noPrintFn);
+	setInterpreterAssert(interpreter, assertWrapper);
+	setInterpreterError(interpreter, errorWrapper);
+}
+
+static void runString(Interpreter* interpreter, char* source) {
+	size_t size = 0;
+	unsigned char* tb = compileString(source, &size);
+	runInterpreter(interpreter, tb, size);
+}
+
+//resume a global coroutine through the callLiteralFn() path
+static Literal resumeByName(Interpreter* interpreter, char* name) {
+	LiteralArray arguments;
+	LiteralArray returns;
+	initLiteralArray(&arguments);
+	initLiteralArray(&returns);
+
+	callFn(interpreter, name, &arguments, &returns);
+
+	Literal result = returns.count > 0 ? popLiteralArray(&returns) : TO_NULL_LITERAL;
+
+	freeLiteralArray(&arguments);
+	freeLiteralArray(&returns);
+
+	return result;
+}
+
+int main() {
+	{
+		//the host can drive a coroutine made by a script
+		Interpreter interpreter;
+		initTestInterpreter(&interpreter);
+
+		runString(&interpreter,
+			"fn squares(limit: int) {\n"
+			"	for (var i: int = 1; i <= limit; i++) {\n"
+			"		yield i * i;\n"
+			"	}\n"
+			"}\n"
+			"var gen = _coroutine(squares, 3);\n"
+		);
+
+		int total = 0;
+		for (int i = 0; i < 3; i++) {
+			Literal result = resumeByName(&interpreter, "gen");
+			total += IS_INTEGER(result) ? AS_INTEGER(result) : -1000;
+			freeLiteral(result);
+		}
+
+		Literal last = resumeByName(&interpreter, "gen");
+
+		if (total != 14 || !IS_NULL(last) || interpreter.panic || failedAsserts > 0 || errors > 0) {
+			fprintf(stderr, ERROR "ERROR: host-driven coroutine failed (total %d)\n" RESET, total);
+			return -1;
+		}
+
+		//the global coroutine closes over the global scope, which is released regardless
+		freeInterpreter(&interpreter);
+	}
+
+	{
+		//the host can make coroutines too
+		Interpreter interpreter;
+		initTestInterpreter(&interpreter);
+
+		runString(&interpreter,
+			"fn echo(a, b) {\n"
+			"	yield a;\n"
+			"	yield b;\n"
+			"	return a + b;\n"
+			"}\n"
+		);
+
+		Literal key = TO_IDENTIFIER_LITERAL(createRefString("echo"));
+		Literal func = TO_NULL_LITERAL;
+		getScopeVariable(interpreter.scope, key, &func);
+		freeLiteral(key);
+
+		LiteralArray arguments;
+		initLiteralArray(&arguments);
+		Literal a = TO_INTEGER_LITERAL(4);
+		Literal b = TO_INTEGER_LITERAL(5);
+		pushLiteralArray(&arguments, a);
+		pushLiteralArray(&arguments, b);
+
+		Literal coroutine = createCoroutine(&interpreter, func, &arguments);
+		freeLiteralArray(&arguments);
+		freeLiteral(func);
+
+		int results[3];
+		for (int i = 0; i < 3; i++) {
+			Literal result = TO_NULL_LITERAL;
+			resumeCoroutine(&interpreter, coroutine, &result);
+			results[i] = IS_INTEGER(result) ? AS_INTEGER(result) : -1;
+			freeLiteral(result);
+		}
+
+		if (results[0] != 4 || results[1] != 5 || results[2] != 9 || !isCoroutineFinished(coroutine)) {
+			fprintf(stderr, ERROR "ERROR: host-made coroutine failed (%d, %d, %d)\n" RESET, results[0], results[1], results[2]);
+			return -1;
+		}
+
+		freeLiteral(coroutine);
+
+		//only functions can become coroutines
+		Literal half = createCoroutine(&interpreter, TO_NULL_LITERAL, NULL);
+		if (!IS_NULL(half) || errors != 1) {
+			fprintf(stderr, ERROR "ERROR: expected createCoroutine() to reject a non-function\n" RESET);
+			return -1;
+		}
+		errors = 0;
+
+		//abandoned part way through - the suspended call is unwound
+		runString(&interpreter,
+			"var held = _coroutine(echo, \"left\", \"right\");\n"
+			"assert held.resume() == \"left\", \"held coroutine failed\";\n"
+		);
+
+		freeInterpreter(&interpreter);
+
+		if (failedAsserts > 0 || errors > 0) {
+			fprintf(stderr, ERROR "ERROR: unexpected failure (%d asserts, %d errors)\n" RESET, failedAsserts, errors);
+			return -1;
+		}
+	}
+
+	{
+		//yield only works inside a coroutine
+		Interpreter interpreter;
+		initTestInterpreter(&interpreter);
+
+		runString(&interpreter, "yield 1;\n");
+
+		if (errors != 1) {
+			fprintf(stderr, ERROR "ERROR: expected an error for a stray yield\n" RESET);
+			return -1;
+		}
+		errors = 0;
+
+		freeInterpreter(&interpreter);
+	}
+
+	{
+		//coroutines can be preempted part way through their body
+		Interpreter interpreter;
+		initTestInterpreter(&interpreter);
+		setInterpreterFuel(&interpreter, 20);
+
+		runString(&interpreter,
+			"fn slow() {\n"
+			"	var total: int = 0;\n"
+			"	for (var i: int = 0; i < 100; i++) {\n"
+			"		total += i;\n"
+			"	}\n"
+			"	yield total;\n"
+			"}\n"
+			"var gen = _coroutine(slow);\n"
+			"var value = gen.resume();\n"
+			"assert value == 4950, \"preempted coroutine failed\";\n"
+		);
+
+		int suspensions = 0;
+		while (isInterpreterSuspended(&interpreter)) {
+			suspensions++;
+			resumeInterpreter(&interpreter, 20);
+		}
+
+		if (suspensions < 10 || interpreter.panic || failedAsserts > 0 || errors > 0) {
+			fprintf(stderr, ERROR "ERROR: preempted coroutine failed (%d suspensions)\n" RESET, suspensions);
+			return -1;
+		}
+
+		freeInterpreter(&interpreter);
+	}
+
+	printf(NOTICE "All good\n" RESET);
+	return 0;
+}
@@ -0,0 +1,345 @@
+#include "event_loop.h"
+
+#include "../repl/lib_timer.h"
+
+#include "lexer.h"
+#include "parser.h"
+#include "compiler.h"
+
+#include "console_colors.h"
+
+#include "memory.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+
+//suppress the print output
+static void noPrintFn(const char* output) {
+	//NO OP
+}
+
+int failedAsserts = 0;
+static void assertWrapper(const char* output) {
+	failedAsserts++;
+	fprintf(stderr, ERROR "Assertion failure: ");
+	fprintf(stderr, "%s", output);
+	fprintf(stderr, "\n" RESET); //default new line
+}
+
+int errors = 0;
+static void errorWrapper(const char* output) {
+	errors++;
+}
+
+//compilation functions
+unsigned char* compileString(char* source, size_t* size) {
+	Lexer lexer;
+	Parser parser;
+	Compiler compiler;
+
+	initLexer(&lexer, source);
+	initParser(&parser, &lexer);
+	initCompiler(&compiler);
+
+	//run the parser until the end of the source
+	ASTNode* node = scanParser(&parser);
+	while(node != NULL) {
+		//pack up and leave
+		if (node->type == AST_NODE_ERROR) {
+			printf(ERROR "error node detected\n" RESET);
+			freeCompiler(&compiler);
+			freeParser(&parser);
+			return NULL;
+		}
+
+		writeCompiler(&compiler, node);
+		node = scanParser(&parser);
+	}
+
+	//get the bytecode dump
+	unsigned char* tb = collateCompiler(&compiler, (int*)(size));
+
+	//cleanup
+	freeCompiler(&compiler);
+	freeParser(&parser);
+	//no lexer to clean up
+
+	//finally
+	return tb;
+}
+
+//a pipe, and a socket pair, that the scripts wait on
+static int pipeFds[2];
+static int socketFds[2];
+
+static void finishRead(EventLoop* loop, bool ok, void* userdata) {
+	AsyncToken* token = (AsyncToken*)userdata;
+
+	unsigned char byte = 0;
+	if (!ok || read(pipeFds[0], &byte, 1) != 1) {
+		completeAsync(token, TO_NULL_LITERAL);
+		return;
+	}
+
+	Literal result = TO_INTEGER_LITERAL(byte);
+	completeAsync(token, result);
+}
+
+static int readPipeNative(Interpreter* interpreter, LiteralArray* arguments) {
+	AsyncToken* token = beginAsync(interpreter);
+
+	if (token == NULL || !watchEventFd(getCurrentEventLoop(), pipeFds[0], EVENT_READABLE, finishRead, token)) {
+		interpreter->errorOutput("readPipe() can't wait\n");
+		return -1;
+	}
+
+	return NATIVE_PENDING;
+}
+
+//a socket read, completed from another thread
+typedef struct Reader {
+	pthread_t thread;
+	EventLoop* loop;
+	AsyncToken* token;
+} Reader;
+
+static Reader reader;
+
+static void* runReader(void* userdata) {
+	Reader* self = (Reader*)userdata;
+
+	unsigned char byte = 0;
+	Literal result = TO_NULL_LITERAL;
+	if (read(socketFds[0], &byte, 1) == 1) {
+		result = TO_INTEGER_LITERAL(byte);
+	}
+
+	postAsyncCompletion(self->loop, self->token, result);
+
+	return NULL;
+}
+
+static int readSocketNative(Interpreter* interpreter, LiteralArray* arguments) {
+	reader.loop = getCurrentEventLoop();
+	reader.token = beginAsync(interpreter);
+
+	if (reader.token == NULL) {
+		interpreter->errorOutput("readSocket() can't wait\n");
+		return -1;
+	}
+
+	pthread_create(&reader.thread, NULL, runReader, &reader);
+
+	return NATIVE_PENDING;
+}
+
+//the writers
+static void writePipe(EventLoop* loop, bool ok, void* userdata) {
+	unsigned char byte = 42;
+	if (ok && write(pipeFds[1], &byte, 1) != 1) {
+		fprintf(stderr, ERROR "ERROR: couldn't write to the pipe\n" RESET);
+	}
+}
+
+static void writeSocket(EventLoop* loop, bool ok, void* userdata) {
+	unsigned char byte = 7;
+	if (ok && write(socketFds[1], &byte, 1) != 1) {
+		fprintf(stderr, ERROR "ERROR: couldn't write to the socket\n" RESET);
+	}
+}
+
+static void setupTask(Interpreter* interpreter) {
+	setInterpreterPrint(interpreter, noPrintFn);
+	setInterpreterAssert(interpreter, assertWrapper);
+	setInterpreterError(interpreter, errorWrapper);
+	injectNativeHook(interpreter, "timer", hookTimer);
+	injectNativeFn(interpreter, "readPipe", readPipeNative);
+	injectNativeFn(interpreter, "readSocket", readSocketNative);
+}
+
+static bool initProgramFromString(Program* program, char* source) {
+	size_t size = 0;
+	unsigned char* tb = compileString(source, &size);
+	return initProgram(program, tb, size);
+}
+
+//the order tasks finish in
+static int finished[64];
+static int finishedCount = 0;
+static void recordTask(Interpreter* interpreter, Task* task, void* userdata) {
+	if (task->state == TASK_FINISHED) {
+		finished[finishedCount++] = *(int*)userdata;
+	}
+}
+
+static int cancelled = 0;
+static void countCancelled(Interpreter* interpreter, Task* task, void* userdata) {
+	if (task->state == TASK_CANCELLED) {
+		cancelled++;
+	}
+}
+
+int main() {
+	if (pipe(pipeFds) != 0 || socketpair(AF_UNIX, SOCK_STREAM, 0, socketFds) != 0) {
+		fprintf(stderr, ERROR "ERROR: couldn't open the pipe and sockets\n" RESET);
+		return -1;
+	}
+
+	{
+		//natives can't wait outside of a budgeted run
+		Interpreter interpreter;
+		initInterpreter(&interpreter);
+		setInterpreterError(&interpreter, errorWrapper);
+
+		if (beginAsync(&interpreter) != NULL || isInterpreterWaiting(&interpreter)) {
+			fprintf(stderr, ERROR "ERROR: beginAsync() should fail without a budget\n" RESET);
+			return -1;
+		}
+
+		freeInterpreter(&interpreter);
+	}
+
+	{
+		//sleeping scripts don't hold up the others
+		Program sleepers[3];
+		int sleeps[3] = { 40, 5, 20 };
+		int ids[4] = { 0, 1, 2, 3 };
+
+		for (int i = 0; i < 3; i++) {
+			char source[256];
+			snprintf(source, 256,
+				"import timer;\n"
+				"var before: int = 1;\n"
+				"sleep(%d);\n"
+				"var after: int = before + 1;\n"
+				"assert after == 2, \"state lost while sleeping\";\n"
+			, sleeps[i]);
+
+			if (!initProgramFromString(&sleepers[i], source)) {
+				fprintf(stderr, ERROR "ERROR: couldn't decode the sleeper program\n" RESET);
+				return -1;
+			}
+		}
+
+		//a busy script, which runs while the others sleep
+		Program busy;
+		if (!initProgramFromString(&busy,
+			"var total: int = 0;\n"
+			"for (var i: int = 0; i < 200; i++) {\n"
+			"	total += i;\n"
+			"}\n"
+			"assert total == 19900, \"wrong total\";\n"
+		)) {
+			fprintf(stderr, ERROR "ERROR: couldn't decode the busy program\n" RESET);
+			return -1;
+		}
+
+		EventLoop loop;
+		if (!initEventLoop(&loop, 50, setupTask)) {
+			fprintf(stderr, ERROR "ERROR: couldn't start the event loop\n" RESET);
+			return -1;
+		}
+
+		for (int i = 0; i < 3; i++) {
+			spawnTask(&loop.scheduler, &sleepers[i], 1, recordTask, &ids[i]);
+		}
+		spawnTask(&loop.scheduler, &busy, 1, recordTask, &ids[3]);
+
+		runEventLoop(&loop);
+
+		if (finishedCount != 4 || finished[0] != 3 || finished[1] != 1 || finished[2] != 2 || finished[3] != 0 || loop.events != 3 || failedAsserts > 0 || errors > 0) {
+			fprintf(stderr, ERROR "ERROR: sleepers finished out of order (%d finished, %d events)\n" RESET, finishedCount, loop.events);
+			return -1;
+		}
+
+		freeEventLoop(&loop);
+
+		for (int i = 0; i < 3; i++) {
+			freeProgram(&sleepers[i]);
+		}
+		freeProgram(&busy);
+	}
+
+	{
+		//waiting on a pipe, and on a socket read by another thread
+		Program program;
+		if (!initProgramFromString(&program,
+			"fn twice(x) {\n"
+			"	return x * 2;\n"
+			"}\n"
+			"var a = readPipe();\n"
+			"var b = twice(readSocket());\n"
+			"assert a == 42, \"readPipe() failed\";\n"
+			"assert b == 14, \"readSocket() failed\";\n"
+		)) {
+			fprintf(stderr, ERROR "ERROR: couldn't decode the reader program\n" RESET);
+			return -1;
+		}
+
+		EventLoop loop;
+		initEventLoop(&loop, 50, setupTask);
+
+		finishedCount = 0;
+		int id = 0;
+		spawnTask(&loop.scheduler, &program, 0, recordTask, &id);
+
+		startEventTimer(&loop, 5, writePipe, NULL);
+		startEventTimer(&loop, 10, writeSocket, NULL);
+
+		runEventLoop(&loop);
+		pthread_join(reader.thread, NULL);
+
+		if (finishedCount != 1 || failedAsserts > 0 || errors > 0) {
+			fprintf(stderr, ERROR "ERROR: reading through the event loop failed\n" RESET);
+			return -1;
+		}
+
+		freeEventLoop(&loop);
+		freeProgram(&program);
+	}
+
+	{
+		//tasks still waiting are cancelled with the loop, and their tokens completed
+		Program program;
+		initProgramFromString(&program, "import timer;\nsleep(60000);\nassert false, \"sleep wasn't cancelled\";\n");
+
+		EventLoop loop;
+		initEventLoop(&loop, 50, setupTask);
+
+		spawnTask(&loop.scheduler, &program, 0, countCancelled, NULL);
+		Task* task = spawnTask(&loop.scheduler, &program, 0, NULL, NULL);
+
+		for (int i = 0; i < 5; i++) {
+			stepEventLoop(&loop, 0);
+		}
+
+		if (loop.scheduler.waiting != 2 || task->state != TASK_WAITING || loop.watchCount != 2) {
+			fprintf(stderr, ERROR "ERROR: expected both tasks to be waiting (%d waiting)\n" RESET, loop.scheduler.waiting);
+			return -1;
+		}
+
+		//released while waiting
+		releaseTask(&loop.scheduler, task);
+
+		freeEventLoop(&loop);
+
+		if (cancelled != 1 || loop.watchCount != 0 || failedAsserts > 0) {
+			fprintf(stderr, ERROR "ERROR: waiting tasks weren't cancelled\n" RESET);
+			return -1;
+		}
+
+		freeProgram(&program);
+	}
+
+	close(pipeFds[0]);
+	close(pipeFds[1]);
+	close(socketFds[0]);
+	close(socketFds[1]);
+
+	printf(NOTICE "All good\n" RESET);
+	return 0;
+}
@@ -0,0 +1,318 @@
+#include "executor.h"
+
+#include "lexer.h"
+#include "parser.h"
+#include "compiler.h"
+
+#include "console_colors.h"
+
+#include "memory.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "../repl/lib_standard.h"
+
+//suppress the print output
+static void noPrintFn(const char* output) {
+	//NO OP
+}
+
+static void failFn(const char* output) {
+	fprintf(stderr, ERROR "Script failure: %s\n" RESET, output);
+}
+
+//compilation functions
+unsigned char* compileString(char* source, size_t* size) {
+	Lexer lexer;
+	Parser parser;
+	Compiler compiler;
+
+	initLexer(&lexer, source);
+	initParser(&parser, &lexer);
+	initCompiler(&compiler);
+
+	//run the parser until the end of the source
+	ASTNode* node = scanParser(&parser);
+	while(node != NULL) {
+		//pack up and leave
+		if (node->type == AST_NODE_ERROR) {
+			printf(ERROR "error node detected\n" RESET);
+			freeCompiler(&compiler);
+			freeParser(&parser);
+			return NULL;
+		}
+
+		writeCompiler(&compiler, node);
+		node = scanParser(&parser);
+	}
+
+	//get the bytecode dump
+	unsigned char* tb = collateCompiler(&compiler, (int*)(size));
+
+	//cleanup
+	freeCompiler(&compiler);
+	freeParser(&parser);
+	//no lexer to clean up
+
+	//finally
+	return tb;
+}
+
+static void setupWorker(Interpreter* interpreter) {
+	setInterpreterPrint(interpreter, noPrintFn);
+	setInterpreterAssert(interpreter, failFn);
+	setInterpreterError(interpreter, failFn);
+	injectNativeHook(interpreter, "standard", hookStandard);
+}
+
+static char* source =
+	"import n;\n"
+	"import label;\n"
+	"fn fib(x) { if (x < 2) { return x; } return fib(x - 1) + fib(x - 2); }\n"
+	"var result = fib(n);\n"
+	"var message = label + \": done\";\n"
+	"export result;\n"
+	"export message;\n"
+;
+
+static int fibOf(int n) {
+	return n < 2 ? n : fibOf(n - 1) + fibOf(n - 2);
+}
+
+static Job* submitFib(Executor* executor, Program* program, int n) {
+	LiteralDictionary inputs;
+	initLiteralDictionary(&inputs);
+
+	Literal nKey = TO_IDENTIFIER_LITERAL(createRefString("n"));
+	Literal labelKey = TO_IDENTIFIER_LITERAL(createRefString("label"));
+	Literal label = TO_STRING_LITERAL(createRefString("fib"));
+
+	setLiteralDictionary(&inputs, nKey, TO_INTEGER_LITERAL(n));
+	setLiteralDictionary(&inputs, labelKey, label);
+
+	Job* job = submitJob(executor, program, &inputs, NULL, NULL);
+
+	freeLiteral(nKey);
+	freeLiteral(labelKey);
+	freeLiteral(label);
+	freeLiteralDictionary(&inputs);
+
+	return job;
+}
+
+static int callbackCount = 0;
+static pthread_mutex_t callbackLock = PTHREAD_MUTEX_INITIALIZER;
+static void countCallback(Interpreter* interpreter, bool ok, void* userdata) {
+	Literal key = TO_IDENTIFIER_LITERAL(createRefString("result"));
+	Literal result = getLiteralDictionary(interpreter->exports, key);
+
+	if (ok && IS_INTEGER(result) && AS_INTEGER(result) == *(int*)userdata) {
+		pthread_mutex_lock(&callbackLock);
+		callbackCount++;
+		pthread_mutex_unlock(&callbackLock);
+	}
+
+	freeLiteral(result);
+	freeLiteral(key);
+}
+
+static int order[8];
+static int orderCount = 0;
+static void orderCallback(Interpreter* interpreter, bool ok, void* userdata) {
+	//a single worker runs these, one after another
+	order[orderCount++] = *(int*)userdata;
+}
+
+int main() {
+	size_t size = 0;
+	unsigned char* tb = compileString(source, &size);
+
+	Program program;
+	if (!initProgram(&program, tb, size)) {
+		fprintf(stderr, ERROR "ERROR: initProgram() failed\n" RESET);
+		return -1;
+	}
+
+	{
+		//futures
+		Executor executor;
+		initExecutor(&executor, 4, setupWorker);
+
+		Job* jobs[32];
+		for (int i = 0; i < 32; i++) {
+			jobs[i] = submitFib(&executor, &program, i % 12);
+		}
+
+		for (int i = 0; i < 32; i++) {
+			LiteralDictionary results;
+			if (!waitJob(jobs[i], &results)) {
+				fprintf(stderr, ERROR "ERROR: job %d failed\n" RESET, i);
+				return -1;
+			}
+
+			Literal resultKey = TO_IDENTIFIER_LITERAL(createRefString("result"));
+			Literal messageKey = TO_IDENTIFIER_LITERAL(createRefString("message"));
+			Literal result = getLiteralDictionary(&results, resultKey);
+			Literal message = getLiteralDictionary(&results, messageKey);
+
+			if (!IS_INTEGER(result) || AS_INTEGER(result) != fibOf(i % 12) || !IS_STRING(message) || strcmp(toCString(AS_STRING(message)), "fib: done")) {
+				fprintf(stderr, ERROR "ERROR: job %d gave the wrong results\n" RESET, i);
+				return -1;
+			}
+
+			freeLiteral(result);
+			freeLiteral(message);
+			freeLiteral(resultKey);
+			freeLiteral(messageKey);
+			freeLiteralDictionary(&results);
+		}
+
+		//callbacks
+		int expected = fibOf(10);
+		for (int i = 0; i < 16; i++) {
+			LiteralDictionary inputs;
+			initLiteralDictionary(&inputs);
+
+			Literal nKey = TO_IDENTIFIER_LITERAL(createRefString("n"));
+			Literal labelKey = TO_IDENTIFIER_LITERAL(createRefString("label"));
+			setLiteralDictionary(&inputs, nKey, TO_INTEGER_LITERAL(10));
+
+			Literal label = TO_STRING_LITERAL(createRefString("callback"));
+			setLiteralDictionary(&inputs, labelKey, label);
+			freeLiteral(label);
+
+			if (submitJob(&executor, &program, &inputs, countCallback, &expected) != NULL) {
+				fprintf(stderr, ERROR "ERROR: callback jobs shouldn't be returned\n" RESET);
+				return -1;
+			}
+
+			freeLiteral(nKey);
+			freeLiteral(labelKey);
+			freeLiteralDictionary(&inputs);
+		}
+
+		//drains the queue
+		freeExecutor(&executor);
+
+		if (callbackCount != 16) {
+			fprintf(stderr, ERROR "ERROR: expected 16 callbacks, got %d\n" RESET, callbackCount);
+			return -1;
+		}
+	}
+
+	{
+		//jobs run in the order they were submitted
+		size_t emptySize = 0;
+		unsigned char* emptyTb = compileString("var x = 1;\n", &emptySize);
+
+		Program emptyProgram;
+		if (!initProgram(&emptyProgram, emptyTb, emptySize)) {
+			fprintf(stderr, ERROR "ERROR: initProgram() failed\n" RESET);
+			return -1;
+		}
+
+		Executor executor;
+		initExecutor(&executor, 1, setupWorker);
+
+		int ids[8];
+		for (int i = 0; i < 8; i++) {
+			ids[i] = i;
+			submitJob(&executor, &emptyProgram, NULL, orderCallback, &ids[i]);
+		}
+
+		freeExecutor(&executor);
+		freeProgram(&emptyProgram);
+
+		for (int i = 0; i < 8; i++) {
+			if (orderCount != 8 || order[i] != i) {
+				fprintf(stderr, ERROR "ERROR: job %d ran out of order\n" RESET, i);
+				return -1;
+			}
+		}
+	}
+
+	{
+		//results outlive the program that made them
+		size_t constantSize = 0;
+		unsigned char* constantTb = compileString("var greeting = \"hello world\";\nvar words = [\"alpha\", \"beta\"];\nexport greeting;\nexport words;\n", &constantSize);
+
+		Program constantProgram;
+		if (!initProgram(&constantProgram, constantTb, constantSize)) {
+			fprintf(stderr, ERROR "ERROR: initProgram() failed\n" RESET);
+			return -1;
+		}
+
+		Executor executor;
+		initExecutor(&executor, 1, setupWorker);
+
+		LiteralDictionary results;
+		bool ok = waitJob(submitJob(&executor, &constantProgram, NULL, NULL, NULL), &results);
+
+		freeExecutor(&executor);
+		freeProgram(&constantProgram);
+
+		Literal greetingKey = TO_IDENTIFIER_LITERAL(createRefString("greeting"));
+		Literal wordsKey = TO_IDENTIFIER_LITERAL(createRefString("words"));
+		Literal greeting = getLiteralDictionary(&results, greetingKey);
+		Literal words = getLiteralDictionary(&results, wordsKey);
+
+		if (!ok || !IS_STRING(greeting) || strcmp(toCString(AS_STRING(greeting)), "hello world") || !IS_ARRAY(words) || AS_ARRAY(words)->count != 2 || strcmp(toCString(AS_STRING(AS_ARRAY(words)->literals[1])), "beta")) {
+			fprintf(stderr, ERROR "ERROR: results didn't survive the program\n" RESET);
+			return -1;
+		}
+
+		freeLiteral(greeting);
+		freeLiteral(words);
+		freeLiteral(greetingKey);
+		freeLiteral(wordsKey);
+		freeLiteralDictionary(&results);
+	}
+
+	{
+		//throughput across 1..N workers
+		int cores = (int)sysconf(_SC_NPROCESSORS_ONLN);
+		if (cores > 8) {
+			cores = 8;
+		}
+
+		for (int workers = 1; workers <= cores; workers++) {
+			Executor executor;
+			initExecutor(&executor, workers, setupWorker);
+
+			struct timeval start;
+			gettimeofday(&start, NULL);
+
+			const int jobCount = 64;
+			Job* jobs[64];
+			for (int i = 0; i < jobCount; i++) {
+				jobs[i] = submitFib(&executor, &program, 14);
+			}
+
+			for (int i = 0; i < jobCount; i++) {
+				waitJob(jobs[i], NULL);
+			}
+
+			struct timeval end;
+			gettimeofday(&end, NULL);
+
+			int stolen = 0;
+			for (int i = 0; i < workers; i++) {
+				stolen += executor.workers[i].stolen;
+			}
+
+			freeExecutor(&executor);
+
+			double seconds = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1000000.0;
+			printf(NOTICE "%d worker(s): %.0f jobs/s, %d stolen\n" RESET, workers, jobCount / seconds, stolen);
+		}
+	}
+
+	freeProgram(&program);
+
+	printf(NOTICE "All good\n" RESET);
+	return 0;
+}
@@ -0,0 +1,267 @@
+#include "interpreter.h"
+
+#include "lexer.h"
+#include "parser.h"
+#include "compiler.h"
+
+#include "console_colors.h"
+
+#include "memory.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+//suppress the print output
+static void noPrintFn(const char* output) {
+	//NO OP
+}
+
+int failedAsserts = 0;
+static void assertWrapper(const char* output) {
+	failedAsserts++;
+	fprintf(stderr, ERROR "Assertion failure: ");
+	fprintf(stderr, "%s", output);
+	fprintf(stderr, "\n" RESET); //default new line
+}
+
+int errors = 0;
+static void errorWrapper(const char* output) {
+	errors++;
+}
+
+//compilation functions
+unsigned char* compileString(char* source, size_t* size) {
+	Lexer lexer;
+	Parser parser;
+	Compiler compiler;
+
+	initLexer(&lexer, source);
+	initParser(&parser, &lexer);
+	initCompiler(&compiler);
+
+	//run the parser until the end of the source
+	ASTNode* node = scanParser(&parser);
+	while(node != NULL) {
+		//pack up and leave
+		if (node->type == AST_NODE_ERROR) {
+			printf(ERROR "error node detected\n" RESET);
+			freeCompiler(&compiler);
+			freeParser(&parser);
+			return NULL;
+		}
+
+		writeCompiler(&compiler, node);
+		node = scanParser(&parser);
+	}
+
+	//get the bytecode dump
+	unsigned char* tb = collateCompiler(&compiler, (int*)(size));
+
+	//cleanup
+	freeCompiler(&compiler);
+	freeParser(&parser);
+	//no lexer to clean up
+
+	//finally
+	return tb;
+}
+
+static void initFuelInterpreter(Interpreter* interpreter) {
+	initInterpreter(interpreter);
+	setInterpreterPrint(interpreter, noPrintFn);
+	setInterpreterAssert(interpreter, assertWrapper);
+	setInterpreterError(interpreter, errorWrapper);
+}
+
+static void runString(Interpreter* interpreter, char* source) {
+	size_t size = 0;
+	unsigned char* tb = compileString(source, &size);
+	runInterpreter(interpreter, tb, size);
+}
+
+//resume in slices until the run is over
+static int drain(Interpreter* interpreter, int fuel) {
+	int suspensions = 0;
+
+	while (isInterpreterSuspended(interpreter)) {
+		suspensions++;
+		resumeInterpreter(interpreter, fuel);
+	}
+
+	return suspensions;
+}
+
+int main() {
+	{
+		//a long loop is cut into slices, and picks up where it left off
+		Interpreter interpreter;
+		initFuelInterpreter(&interpreter);
+		setInterpreterFuel(&interpreter, 1000);
+
+		runString(&interpreter,
+			"var total: int = 0;\n"
+			"for (var i: int = 0; i < 5000; i++) {\n"
+			"	total += i;\n"
+			"}\n"
+			"assert total == 12497500, \"wrong total after resuming\";\n"
+		);
+
+		if (!isInterpreterSuspended(&interpreter)) {
+			fprintf(stderr, ERROR "ERROR: the run should have been suspended\n" RESET);
+			return -1;
+		}
+
+		int suspensions = drain(&interpreter, 1000);
+
+		if (suspensions < 10 || interpreter.panic || failedAsserts > 0 || errors > 0) {
+			fprintf(stderr, ERROR "ERROR: unexpected suspended run (%d suspensions, %d asserts, %d errors)\n" RESET, suspensions, failedAsserts, errors);
+			return -1;
+		}
+
+		freeInterpreter(&interpreter);
+	}
+
+	{
+		//suspension works from deep inside nested calls
+		Interpreter interpreter;
+		initFuelInterpreter(&interpreter);
+		setInterpreterFuel(&interpreter, 7);
+
+		runString(&interpreter,
+			"fn sum(n: int) {\n"
+			"	if (n == 0) {\n"
+			"		return 0;\n"
+			"	}\n"
+			"	return n + sum(n - 1);\n"
+			"}\n"
+			"fn apply(f) {\n"
+			"	return f(50);\n"
+			"}\n"
+			"assert apply(sum) == 1275, \"wrong sum after resuming\";\n"
+		);
+
+		int suspensions = drain(&interpreter, 3);
+
+		if (suspensions < 50 || interpreter.panic || failedAsserts > 0 || errors > 0) {
+			fprintf(stderr, ERROR "ERROR: unexpected nested run (%d suspensions, %d asserts, %d errors)\n" RESET, suspensions, failedAsserts, errors);
+			return -1;
+		}
+
+		freeInterpreter(&interpreter);
+	}
+
+	{
+		//budgeted runs have a fiber stack deep enough for the recursion limit
+		Interpreter interpreter;
+		initFuelInterpreter(&interpreter);
+		setInterpreterFuel(&interpreter, 1000000);
+
+		runString(&interpreter,
+			"fn depth(n) {\n"
+			"	if (n <= 0) {\n"
+			"		return 0;\n"
+			"	}\n"
+			"	return depth(n - 1) + 1;\n"
+			"}\n"
+			"assert depth(198) == 198, \"wrong depth\";\n"
+		);
+
+		if (isInterpreterSuspended(&interpreter) || interpreter.panic || failedAsserts > 0 || errors > 0) {
+			fprintf(stderr, ERROR "ERROR: unexpected deep run (%d asserts, %d errors)\n" RESET, failedAsserts, errors);
+			return -1;
+		}
+
+		freeInterpreter(&interpreter);
+	}
+
+	{
+		//an endless run can be cancelled, and the interpreter used again
+		Interpreter interpreter;
+		initFuelInterpreter(&interpreter);
+		setInterpreterFuel(&interpreter, 100);
+
+		runString(&interpreter,
+			"var held = [\"a\", \"b\"];\n"
+			"fn spin() {\n"
+			"	var local = [\"key\": \"value\"];\n"
+			"	while (true) {\n"
+			"		var s = \"str\" + \"ing\";\n"
+			"	}\n"
+			"}\n"
+			"spin();\n"
+		);
+
+		for (int i = 0; i < 20; i++) {
+			resumeInterpreter(&interpreter, 100);
+		}
+
+		if (!isInterpreterSuspended(&interpreter)) {
+			fprintf(stderr, ERROR "ERROR: the endless run should still be suspended\n" RESET);
+			return -1;
+		}
+
+		cancelInterpreter(&interpreter);
+
+		if (isInterpreterSuspended(&interpreter) || !interpreter.panic) {
+			fprintf(stderr, ERROR "ERROR: the cancelled run should have unwound\n" RESET);
+			return -1;
+		}
+
+		//with enough fuel, nothing is suspended
+		resetInterpreter(&interpreter);
+		setInterpreterFuel(&interpreter, 1000000);
+		runString(&interpreter, "var x: int = 42;\nassert x == 42, \"fresh run failed\";\n");
+
+		if (isInterpreterSuspended(&interpreter) || interpreter.panic || failedAsserts > 0 || errors > 0) {
+			fprintf(stderr, ERROR "ERROR: the interpreter didn't recover from the cancelled run\n" RESET);
+			return -1;
+		}
+
+		//freeing a suspended interpreter cancels the run
+		runString(&interpreter, "while (true) { var s = \"spin\"; }\n");
+		freeInterpreter(&interpreter);
+	}
+
+	{
+		//programs can be preempted too
+		size_t size = 0;
+		unsigned char* tb = compileString(
+			"var total: int = 0;\n"
+			"for (var i: int = 0; i < 1000; i++) {\n"
+			"	total += i;\n"
+			"}\n"
+			"assert total == 499500, \"wrong total from the program\";\n"
+		, &size);
+
+		Program program;
+		if (!initProgram(&program, tb, size)) {
+			fprintf(stderr, ERROR "ERROR: couldn't decode the program\n" RESET);
+			return -1;
+		}
+
+		Interpreter interpreter;
+		initFuelInterpreter(&interpreter);
+		setInterpreterFuel(&interpreter, 500);
+
+		runProgram(&interpreter, &program);
+		int suspensions = drain(&interpreter, 500);
+
+		//resetting while suspended abandons the run
+		resetInterpreter(&interpreter);
+		runProgram(&interpreter, &program);
+		resetInterpreter(&interpreter);
+		runProgram(&interpreter, &program);
+		drain(&interpreter, 500);
+
+		if (suspensions < 2 || interpreter.panic || failedAsserts > 0 || errors > 0) {
+			fprintf(stderr, ERROR "ERROR: unexpected program run (%d suspensions, %d asserts, %d errors)\n" RESET, suspensions, failedAsserts, errors);
+			return -1;
+		}
+
+		freeInterpreter(&interpreter);
+		freeProgram(&program);
+	}
+
+	printf(NOTICE "All good\n" RESET);
+	return 0;
+}
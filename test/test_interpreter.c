@@ -77,14 +77,12 @@ unsigned char* compileString(char* source, size_t* size) {
 		//pack up and leave
 		if (node->type == AST_NODE_ERROR) {
 			printf(ERROR "error node detected\n" RESET);
-			freeASTNode(node);
 			freeCompiler(&compiler);
 			freeParser(&parser);
 			return NULL;
 		}
 
 		writeCompiler(&compiler, node);
-		freeASTNode(node);
 		node = scanParser(&parser);
 	}
 
@@ -168,7 +166,6 @@ int main() {
 		runInterpreter(&interpreter, bytecode, size);
 
 		//cleanup
-		freeASTNode(node);
 		freeParser(&parser);
 		freeCompiler(&compiler);
 		freeInterpreter(&interpreter);
@@ -181,10 +178,12 @@ int main() {
 			"casting.toy",
 			"coercions.toy",
 			"comparisons.toy",
+			"coroutines.toy",
 			"dot-and-matrix.toy",
 			"dot-assignments-bugfix.toy",
 			"dot-chaining.toy",
 			"dottify-bugfix.toy",
+			"for-in.toy",
 			"functions.toy",
 			"imports-and-exports.toy",
 			"index-arrays.toy",
@@ -192,12 +191,17 @@ int main() {
 			"index-strings.toy",
 			"jumps.toy",
 			"jumps-in-functions.toy",
+			"lazy-functions.toy",
 			"logicals.toy",
 			"long-array.toy",
 			"long-dictionary.toy",
 			"long-literals.toy",
 			"native-functions.toy",
+			"packed-arrays.toy",
 			"panic-within-functions.toy", 
+			"records.toy",
+			"scopes.toy",
+			"switch.toy",
 			"types.toy",
 			NULL
 		};
@@ -212,6 +216,88 @@ int main() {
 		}
 	}
 
+	{
+		//run bytecode the host still owns
+		size_t size = 0;
+		unsigned char* tb = compileString("var s = \"borrowed\"; fn f() { return s; } assert f() == \"borrowed\", \"borrowed run failed\";", &size);
+
+		Interpreter interpreter;
+		initInterpreter(&interpreter);
+		setInterpreterPrint(&interpreter, noPrintFn);
+		setInterpreterAssert(&interpreter, noAssertFn);
+
+		runInterpreterBorrowed(&interpreter, tb, size);
+
+		//the image is still ours, and can be run again
+		resetInterpreter(&interpreter);
+		runInterpreterBorrowed(&interpreter, tb, size);
+
+		freeInterpreter(&interpreter);
+		FREE_ARRAY(unsigned char, tb, size);
+	}
+
+	{
+		//compile once, run many times
+		size_t size = 0;
+		unsigned char* tb = compileString("var greeting = \"hello\"; var list = [greeting, \"world\"]; var dict = [\"key\": greeting]; fn f(x) { return x + \" world\"; } assert f(list[0]) == \"hello world\", \"program run failed\"; assert dict[\"key\"] == greeting, \"program dict failed\";", &size);
+
+		Program program;
+		if (!initProgram(&program, tb, size)) {
+			fprintf(stderr, ERROR "ERROR: failed to init the program\n" RESET);
+			return -1;
+		}
+
+		Interpreter first;
+		Interpreter second;
+		initInterpreter(&first);
+		initInterpreter(&second);
+		setInterpreterPrint(&first, noPrintFn);
+		setInterpreterAssert(&first, noAssertFn);
+		setInterpreterPrint(&second, noPrintFn);
+		setInterpreterAssert(&second, noAssertFn);
+
+		for (int i = 0; i < 3; i++) {
+			runProgram(&first, &program);
+			runProgram(&second, &program);
+			resetInterpreter(&first);
+			resetInterpreter(&second);
+		}
+
+		//the shared strings were never touched
+		for (int i = 0; i < program.literalCache.count; i++) {
+			if (IS_STRING(program.literalCache.literals[i]) && countRefString(AS_STRING(program.literalCache.literals[i])) >= 0) {
+				fprintf(stderr, ERROR "ERROR: program strings should stay frozen\n" RESET);
+				return -1;
+			}
+		}
+
+		freeInterpreter(&first);
+		freeInterpreter(&second);
+		freeProgram(&program);
+	}
+
+	{
+		//more than 64KiB of code, 65k constants and a 65k-element literal
+		const int elements = 70000;
+		size_t capacity = (size_t)elements * 32 + 1024;
+		char* source = malloc(capacity);
+		size_t length = 0;
+
+		length += snprintf(source + length, capacity - length, "var count = 0;\nvar last = 0;\nwhile (count < 2) {\n");
+		for (int i = 0; i < elements; i++) {
+			length += snprintf(source + length, capacity - length, "last = %d;\n", i);
+		}
+		length += snprintf(source + length, capacity - length, "count++;\n}\nassert count == 2, \"long jumps failed\";\nassert last == %d, \"long constants failed\";\nvar a = [", elements - 1);
+		for (int i = 0; i < elements; i++) {
+			length += snprintf(source + length, capacity - length, i ? ",%d" : "%d", i);
+		}
+		length += snprintf(source + length, capacity - length, "];\nassert a[%d] == %d, \"long array failed\";\n", elements - 1, elements - 1);
+
+		runSource(source);
+
+		free(source);
+	}
+
 	{
 		//read source
 		size_t dummy;
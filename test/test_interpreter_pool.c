@@ -0,0 +1,225 @@
+#include "interpreter_pool.h"
+
+#include "lexer.h"
+#include "parser.h"
+#include "compiler.h"
+
+#include "console_colors.h"
+
+#include "memory.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../repl/lib_standard.h"
+
+//suppress the print output
+static void noPrintFn(const char* output) {
+	//NO OP
+}
+
+int failedAsserts = 0;
+static void assertWrapper(const char* output) {
+	failedAsserts++;
+	fprintf(stderr, ERROR "Assertion failure: ");
+	fprintf(stderr, "%s", output);
+	fprintf(stderr, "\n" RESET); //default new line
+}
+
+int errors = 0;
+static void errorWrapper(const char* output) {
+	errors++;
+}
+
+//compilation functions
+unsigned char* compileString(char* source, size_t* size) {
+	Lexer lexer;
+	Parser parser;
+	Compiler compiler;
+
+	initLexer(&lexer, source);
+	initParser(&parser, &lexer);
+	initCompiler(&compiler);
+
+	//run the parser until the end of the source
+	ASTNode* node = scanParser(&parser);
+	while(node != NULL) {
+		//pack up and leave
+		if (node->type == AST_NODE_ERROR) {
+			printf(ERROR "error node detected\n" RESET);
+			freeCompiler(&compiler);
+			freeParser(&parser);
+			return NULL;
+		}
+
+		writeCompiler(&compiler, node);
+		node = scanParser(&parser);
+	}
+
+	//get the bytecode dump
+	unsigned char* tb = collateCompiler(&compiler, (int*)(size));
+
+	//cleanup
+	freeCompiler(&compiler);
+	freeParser(&parser);
+	//no lexer to clean up
+
+	//finally
+	return tb;
+}
+
+static int setups = 0;
+static void setupInterpreter(Interpreter* interpreter) {
+	setInterpreterPrint(interpreter, noPrintFn);
+	setInterpreterAssert(interpreter, assertWrapper);
+	setInterpreterError(interpreter, errorWrapper);
+	injectNativeHook(interpreter, "standard", hookStandard);
+
+	//preload the library into the template
+	Literal alias = TO_NULL_LITERAL;
+	hookStandard(interpreter, alias, alias);
+
+	setups++;
+}
+
+static void runString(Interpreter* interpreter, char* source) {
+	size_t size = 0;
+	unsigned char* tb = compileString(source, &size);
+	runInterpreter(interpreter, tb, size);
+}
+
+static void setupGlobals(Interpreter* interpreter) {
+	setupInterpreter(interpreter);
+
+	//declared in the template, so every checkout can see them
+	runString(interpreter, "var counter = 0;\nvar arr = [1];\nvar typed: [int] = [1];\n");
+}
+
+int main() {
+	{
+		//the same instance is handed out again, without anything from the previous request
+		InterpreterPool pool;
+		initInterpreterPool(&pool, setupInterpreter);
+
+		for (int i = 0; i < 10; i++) {
+			Interpreter* interpreter = checkoutInterpreter(&pool);
+
+			runString(interpreter,
+				"var start = clock();\n"
+				"var counter: int = 0;\n"
+				"fn increment() { counter++; return counter; }\n"
+				"assert increment() == 1, \"state leaked between requests\";\n"
+				"export increment;\n"
+			);
+
+			returnInterpreter(&pool, interpreter);
+		}
+
+		if (pool.created != 1 || setups != 1 || pool.checkouts != 10 || pool.inUse != 0 || pool.count != 1 || pool.peakInUse != 1) {
+			fprintf(stderr, ERROR "ERROR: unexpected pool stats (%d created, %d checkouts, %d in use, %d available, %d peak)\n" RESET, pool.created, pool.checkouts, pool.inUse, pool.count, pool.peakInUse);
+			return -1;
+		}
+
+		freeInterpreterPool(&pool);
+
+		if (failedAsserts > 0 || errors > 0) {
+			fprintf(stderr, ERROR "ERROR: pooled interpreter misbehaved (%d asserts, %d errors)\n" RESET, failedAsserts, errors);
+			return -1;
+		}
+	}
+
+	{
+		//concurrent checkouts get their own instances, which are kept for later
+		InterpreterPool pool;
+		initInterpreterPool(&pool, setupInterpreter);
+
+		Interpreter* first = checkoutInterpreter(&pool);
+		Interpreter* second = checkoutInterpreter(&pool);
+
+		if (first == second || pool.inUse != 2 || pool.peakInUse != 2) {
+			fprintf(stderr, ERROR "ERROR: concurrent checkouts share an interpreter\n" RESET);
+			return -1;
+		}
+
+		runString(first, "var shared = 1;\n");
+		runString(second, "var shared = 2;\n");
+
+		//a failed request doesn't poison the instance
+		runString(second, "var broken: int = \"text\";\n");
+
+		if (errors == 0) {
+			fprintf(stderr, ERROR "ERROR: expected the request to fail\n" RESET);
+			return -1;
+		}
+		errors = 0;
+
+		returnInterpreter(&pool, first);
+		returnInterpreter(&pool, second);
+
+		Interpreter* again = checkoutInterpreter(&pool);
+		if (again != second || again->panic) {
+			fprintf(stderr, ERROR "ERROR: the most recently returned interpreter should be reused\n" RESET);
+			return -1;
+		}
+
+		runString(again, "var shared = 3;\nassert shared == 3, \"redeclaration failed\";\n");
+		returnInterpreter(&pool, again);
+
+		if (pool.created != 2 || pool.count != 2 || failedAsserts > 0 || errors > 0) {
+			fprintf(stderr, ERROR "ERROR: reused interpreter misbehaved (%d created, %d available, %d asserts, %d errors)\n" RESET, pool.created, pool.count, failedAsserts, errors);
+			return -1;
+		}
+
+		freeInterpreterPool(&pool);
+	}
+
+	{
+		//assignments to the template's variables are undone on return
+		InterpreterPool pool;
+		initInterpreterPool(&pool, setupGlobals);
+
+		for (int i = 0; i < 3; i++) {
+			Interpreter* interpreter = checkoutInterpreter(&pool);
+
+			runString(interpreter,
+				"assert counter == 0, \"template variable leaked between requests\";\n"
+				"assert arr == [1], \"template array leaked between requests\";\n"
+				"assert typed == [1], \"template packed array leaked between requests\";\n"
+				"counter++;\n"
+				"arr.push(5);\n"
+				"typed.push(5);\n"
+				"typed[0] = 2;\n"
+				"assert counter == 1 && arr == [1, 5] && typed == [2, 5], \"template variables not writable\";\n"
+			);
+
+			//only the assigned variables are logged, however many times they're written
+			if (((PooledInterpreter*)interpreter)->writes.count != 3) {
+				fprintf(stderr, ERROR "ERROR: expected 3 logged writes, found %d\n" RESET, ((PooledInterpreter*)interpreter)->writes.count);
+				return -1;
+			}
+
+			returnInterpreter(&pool, interpreter);
+		}
+
+		//reading doesn't log anything
+		Interpreter* interpreter = checkoutInterpreter(&pool);
+		runString(interpreter, "assert counter == 0 && arr[0] == 1 && typed[0] == 1, \"template variables not restored\";\n");
+
+		if (((PooledInterpreter*)interpreter)->writes.count != 0) {
+			fprintf(stderr, ERROR "ERROR: reads were logged as writes\n" RESET);
+			return -1;
+		}
+
+		returnInterpreter(&pool, interpreter);
+
+		if (pool.created != 1 || failedAsserts > 0 || errors > 0) {
+			fprintf(stderr, ERROR "ERROR: template variables misbehaved (%d created, %d asserts, %d errors)\n" RESET, pool.created, failedAsserts, errors);
+			return -1;
+		}
+
+		freeInterpreterPool(&pool);
+	}
+
+	printf(NOTICE "All good\n" RESET);
+	return 0;
+}
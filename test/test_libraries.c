@@ -13,6 +13,9 @@
 
 #include "../repl/lib_standard.h"
 #include "../repl/lib_timer.h"
+#include "../repl/lib_channel.h"
+#include "../repl/lib_vector.h"
+#include "../repl/lib_matrix.h"
 
 //supress the print output
 static void noPrintFn(const char* output) {
@@ -81,14 +84,12 @@ unsigned char* compileString(char* source, size_t* size) {
 		//pack up and leave
 		if (node->type == AST_NODE_ERROR) {
 			printf(ERROR "error node detected\n" RESET);
-			freeASTNode(node);
 			freeCompiler(&compiler);
 			freeParser(&parser);
 			return NULL;
 		}
 
 		writeCompiler(&compiler, node);
-		freeASTNode(node);
 		node = scanParser(&parser);
 	}
 
@@ -104,7 +105,30 @@ unsigned char* compileString(char* source, size_t* size) {
 	return tb;
 }
 
-void runBinaryWithLibrary(unsigned char* tb, size_t size, char* library, HookFn hook) {
+//scripts can't make their own channels, so the host hands some over
+static Channel* channels[3];
+static void exportChannels(Interpreter* interpreter) {
+	char* names[] = {"fourSlots", "twoSlots", "oneSlot"};
+	int capacities[] = {4, 2, 1};
+
+	for (int i = 0; i < 3; i++) {
+		channels[i] = createChannel(capacities[i]);
+
+		Literal name = TO_IDENTIFIER_LITERAL(createRefString(names[i]));
+		Literal type = TO_TYPE_LITERAL(LITERAL_OPAQUE, false);
+		setLiteralDictionary(interpreter->exports, name, TO_OPAQUE_LITERAL(channels[i], CHANNEL_TAG));
+		setLiteralDictionary(interpreter->exportTypes, name, type);
+		freeLiteral(name);
+	}
+}
+
+static void freeChannels() {
+	for (int i = 0; i < 3; i++) {
+		freeChannel(channels[i]);
+	}
+}
+
+void runBinaryWithLibrary(unsigned char* tb, size_t size, char* library, HookFn hook, void (*setup)(Interpreter*)) {
 	Interpreter interpreter;
 	initInterpreter(&interpreter);
 
@@ -116,6 +140,10 @@ void runBinaryWithLibrary(unsigned char* tb, size_t size, char* library, HookFn
 	//inject the standard libraries into this interpreter
 	injectNativeHook(&interpreter, library, hook);
 
+	if (setup) {
+		setup(&interpreter);
+	}
+
 	runInterpreter(&interpreter, tb, size);
 	freeInterpreter(&interpreter);
 }
@@ -124,16 +152,21 @@ typedef struct Payload {
 	char* fname;
 	char* libname;
 	HookFn hook;
+	void (*setup)(Interpreter*); //can be NULL
+	void (*teardown)(); //can be NULL
 } Payload;
 
 int main() {
 	{
 		//run each file in test/scripts
 		Payload payloads[] = {
-			{"interactions.toy", "standard", hookStandard}, //interactions needs standard
-			{"standard.toy", "standard", hookStandard},
-			{"timer.toy", "timer", hookTimer},
-			{NULL, NULL, NULL}
+			{"interactions.toy", "standard", hookStandard, NULL, NULL}, //interactions needs standard
+			{"standard.toy", "standard", hookStandard, NULL, NULL},
+			{"timer.toy", "timer", hookTimer, NULL, NULL},
+			{"channel.toy", "channel", hookChannel, exportChannels, freeChannels},
+			{"vector.toy", "vector", hookVector, NULL, NULL},
+			{"matrix.toy", "matrix", hookMatrix, NULL, NULL},
+			{NULL, NULL, NULL, NULL, NULL}
 		};
 
 		for (int i = 0; payloads[i].fname; i++) {
@@ -152,7 +185,11 @@ int main() {
 				printf(ERROR "Failed to compile file: %s" RESET, fname);
 			}
 
-			runBinaryWithLibrary(tb, size, payloads[i].libname, payloads[i].hook);
+			runBinaryWithLibrary(tb, size, payloads[i].libname, payloads[i].hook, payloads[i].setup);
+
+			if (payloads[i].teardown) {
+				payloads[i].teardown();
+			}
 		}
 	}
 
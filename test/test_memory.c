@@ -1,9 +1,16 @@
 #include "memory.h"
+#include "memory_pool.h"
+
+#include "lexer.h"
+#include "parser.h"
+#include "compiler.h"
+#include "interpreter.h"
 
 #include "console_colors.h"
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 //the test allocator
 static int callCount = 0;
@@ -58,6 +65,16 @@ void testMemoryAllocation() {
 	}
 }
 
+//suppress the print output
+static void noPrintFn(const char* output) {
+	//NO OP
+}
+
+static int assertionFailures = 0;
+static void countAssertFn(const char* output) {
+	assertionFailures++;
+}
+
 int main() {
 	//test the default allocator
 	testMemoryAllocation();
@@ -71,6 +88,131 @@ int main() {
 		return -1;
 	}
 
+	{
+		//test the memory pool
+		MemoryPool pool;
+		initMemoryPool(&pool);
+		setMemoryPool(&pool);
+
+		testMemoryAllocation();
+
+		//released blocks are recycled within a size class
+		int* first = ALLOCATE(int, 3);
+		FREE_ARRAY(int, first, 3);
+		int* second = ALLOCATE(int, 4);
+
+		if (first != second) {
+			fprintf(stderr, ERROR "Memory pool didn't recycle a block" RESET);
+			return -1;
+		}
+
+		//growing between classes preserves the contents
+		second[3] = 42;
+		second = GROW_ARRAY(int, second, 4, 128);
+
+		if (second[3] != 42) {
+			fprintf(stderr, ERROR "Memory pool lost data while growing" RESET);
+			return -1;
+		}
+
+		FREE_ARRAY(int, second, 128);
+
+		if (pool.chunkCount != 1) {
+			fprintf(stderr, ERROR "Unexpected chunk count for memory pool; was %d" RESET, pool.chunkCount);
+			return -1;
+		}
+
+		freeMemoryPool(&pool);
+	}
+
+	{
+		//test the memory pool behind a full run
+		MemoryPool pool;
+		initMemoryPool(&pool);
+		setMemoryPool(&pool);
+
+		char* source = "var a = [1, 2, 3]; var b = [\"foo\": 1]; fn f(x) { return x * 2; } var c = f(a[1]); var d = b[\"foo\"]; assert c + d == 5, \"pooled run failed\";";
+
+		Lexer lexer;
+		Parser parser;
+		Compiler compiler;
+		Interpreter interpreter;
+
+		initLexer(&lexer, source);
+		initParser(&parser, &lexer);
+		initCompiler(&compiler);
+		initInterpreter(&interpreter);
+		setInterpreterPrint(&interpreter, noPrintFn);
+		setInterpreterAssert(&interpreter, countAssertFn);
+
+		ASTNode* node = scanParser(&parser);
+		while (node != NULL) {
+			writeCompiler(&compiler, node);
+			node = scanParser(&parser);
+		}
+
+		int size = 0;
+		unsigned char* bytecode = collateCompiler(&compiler, &size);
+
+		runInterpreter(&interpreter, bytecode, size);
+
+		freeParser(&parser);
+		freeCompiler(&compiler);
+		freeInterpreter(&interpreter);
+
+		//everything small is released at once
+		freeMemoryPool(&pool);
+
+		if (assertionFailures != 0) {
+			fprintf(stderr, ERROR "Script failed behind the memory pool" RESET);
+			return -1;
+		}
+	}
+
+	{
+		//blocks let go of under another allocator, as on another thread, go back to their own pool
+		MemoryPool first;
+		MemoryPool second;
+		initMemoryPool(&first);
+		initMemoryPool(&second);
+
+		setMemoryPool(NULL);
+		int* plain = ALLOCATE(int, 4);
+
+		setMemoryPool(&first);
+		int* moved = ALLOCATE(int, 4);
+		int* grown = ALLOCATE(int, 4);
+		grown[3] = 42;
+
+		setMemoryPool(&second);
+		FREE_ARRAY(int, moved, 4);
+		FREE_ARRAY(int, plain, 4);
+
+		setMemoryPool(NULL);
+		grown = GROW_ARRAY(int, grown, 4, 8);
+
+		if (grown[3] != 42 || second.freeLists[0] != NULL || first.freeLists[0] != NULL || first.remoteFreeLists[0] == NULL) {
+			fprintf(stderr, ERROR "Memory pool block wasn't returned to its own pool" RESET);
+			return -1;
+		}
+
+		FREE_ARRAY(int, grown, 8);
+
+		//the returned blocks are reused once the chunk runs out
+		setMemoryPool(&first);
+		for (int i = 0; i < (MEMORY_POOL_CHUNK_SIZE - MEMORY_POOL_GRANULARITY) / MEMORY_POOL_GRANULARITY; i++) {
+			ALLOCATE(int, 4);
+		}
+
+		if (first.chunkCount != 1 || first.remoteFreeLists[0] != NULL) {
+			fprintf(stderr, ERROR "Memory pool didn't reuse returned blocks; %d chunks" RESET, first.chunkCount);
+			return -1;
+		}
+
+		freeMemoryPool(&second);
+		freeMemoryPool(&first);
+	}
+
 	printf(NOTICE "All good\n" RESET);
 	return 0;
 }
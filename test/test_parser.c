@@ -83,7 +83,6 @@ int main() {
 		}
 
 		//cleanup
-		freeASTNode(node);
 		freeParser(&parser);
 	}
 
@@ -106,7 +105,6 @@ int main() {
 				return -1;
 			}
 
-			freeASTNode(node);
 			node = scanParser(&parser);
 		}
 
@@ -115,6 +113,51 @@ int main() {
 		free((void*)source);
 	}
 
+	{
+		//source
+		char* source = "var a = [1, 2, 3]; { var b = \"foo\"; print b; } fn f(x) { return x; }";
+
+		//test the nodes come from the parser's arena
+		Lexer lexer;
+		Parser parser;
+		initLexer(&lexer, source);
+		initParser(&parser, &lexer);
+
+		int count = 0;
+		ASTNode* node = scanParser(&parser);
+
+		while (node != NULL) {
+			if (node->type == AST_NODE_ERROR) {
+				fprintf(stderr, ERROR "ERROR: Error node detected" RESET);
+				return -1;
+			}
+
+			count++;
+			node = scanParser(&parser);
+		}
+
+		if (count != 3 || parser.rootCount != 3 || parser.arena.chunkCount != 1) {
+			fprintf(stderr, ERROR "ERROR: Unexpected arena state (%d nodes, %d roots, %d chunks)" RESET, count, parser.rootCount, parser.arena.chunkCount);
+			return -1;
+		}
+
+		//freeing a tree the parser owns is harmless
+		freeASTNode(parser.roots[0]);
+
+		if (parser.roots[0]->type != AST_NODE_VAR_DECL) {
+			fprintf(stderr, ERROR "ERROR: Freeing an arena node released it" RESET);
+			return -1;
+		}
+
+		//everything is released at once
+		freeParser(&parser);
+
+		if (parser.arena.chunkCount != 0 || parser.roots != NULL) {
+			fprintf(stderr, ERROR "ERROR: Parser arena wasn't released" RESET);
+			return -1;
+		}
+	}
+
 	printf(NOTICE "All good\n" RESET);
 	return 0;
 }
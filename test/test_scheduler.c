@@ -0,0 +1,377 @@
+#include "scheduler.h"
+#include "event_loop.h"
+
+#include "lexer.h"
+#include "parser.h"
+#include "compiler.h"
+
+#include "console_colors.h"
+
+#include "memory.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "../repl/lib_channel.h"
+
+//suppress the print output
+static void noPrintFn(const char* output) {
+	//NO OP
+}
+
+int failedAsserts = 0;
+static void assertWrapper(const char* output) {
+	failedAsserts++;
+	fprintf(stderr, ERROR "Assertion failure: ");
+	fprintf(stderr, "%s", output);
+	fprintf(stderr, "\n" RESET); //default new line
+}
+
+int errors = 0;
+static void errorWrapper(const char* output) {
+	errors++;
+}
+
+//compilation functions
+unsigned char* compileString(char* source, size_t* size) {
+	Lexer lexer;
+	Parser parser;
+	Compiler compiler;
+
+	initLexer(&lexer, source);
+	initParser(&parser, &lexer);
+	initCompiler(&compiler);
+
+	//run the parser until the end of the source
+	ASTNode* node = scanParser(&parser);
+	while(node != NULL) {
+		//pack up and leave
+		if (node->type == AST_NODE_ERROR) {
+			printf(ERROR "error node detected\n" RESET);
+			freeCompiler(&compiler);
+			freeParser(&parser);
+			return NULL;
+		}
+
+		writeCompiler(&compiler, node);
+		node = scanParser(&parser);
+	}
+
+	//get the bytecode dump
+	unsigned char* tb = collateCompiler(&compiler, (int*)(size));
+
+	//cleanup
+	freeCompiler(&compiler);
+	freeParser(&parser);
+	//no lexer to clean up
+
+	//finally
+	return tb;
+}
+
+static int pauseNative(Interpreter* interpreter, LiteralArray* arguments) {
+	yieldInterpreter(interpreter);
+	return 0;
+}
+
+static void setupTask(Interpreter* interpreter) {
+	setInterpreterPrint(interpreter, noPrintFn);
+	setInterpreterAssert(interpreter, assertWrapper);
+	setInterpreterError(interpreter, errorWrapper);
+	injectNativeFn(interpreter, "pause", pauseNative);
+}
+
+//every task sees the same channel
+static Channel* sharedChannel = NULL;
+static void setupChannelTask(Interpreter* interpreter) {
+	setupTask(interpreter);
+	injectNativeHook(interpreter, "channel", hookChannel);
+
+	Literal name = TO_IDENTIFIER_LITERAL(createRefString("messages"));
+	Literal type = TO_TYPE_LITERAL(LITERAL_OPAQUE, false);
+	Literal channel = TO_OPAQUE_LITERAL(sharedChannel, CHANNEL_TAG);
+
+	declareScopeVariable(interpreter->scope, name, type);
+	setScopeVariable(interpreter->scope, name, channel, false);
+
+	freeLiteral(name);
+	freeLiteral(type);
+}
+
+//feeds the shared channel from another thread
+static void* produceMessages(void* arg) {
+	for (int i = 0; i < 10; i++) {
+		while (!trySendChannel(sharedChannel, TO_INTEGER_LITERAL(i))) {
+			//NO OP
+		}
+	}
+
+	closeChannel(sharedChannel);
+	return NULL;
+}
+
+static bool initProgramFromString(Program* program, char* source) {
+	size_t size = 0;
+	unsigned char* tb = compileString(source, &size);
+	return initProgram(program, tb, size);
+}
+
+//the order tasks finish in
+static int finished[64];
+static int finishedCount = 0;
+static void recordTask(Interpreter* interpreter, Task* task, void* userdata) {
+	if (task->state == TASK_FINISHED) {
+		finished[finishedCount++] = task->id;
+	}
+}
+
+static int cancelled = 0;
+static void countCancelled(Interpreter* interpreter, Task* task, void* userdata) {
+	if (task->state == TASK_CANCELLED) {
+		cancelled++;
+	}
+}
+
+int main() {
+	Program loop;
+	if (!initProgramFromString(&loop,
+		"var total: int = 0;\n"
+		"for (var i: int = 0; i < 500; i++) {\n"
+		"	total += i;\n"
+		"}\n"
+		"assert total == 124750, \"wrong total\";\n"
+	)) {
+		fprintf(stderr, ERROR "ERROR: couldn't decode the loop program\n" RESET);
+		return -1;
+	}
+
+	Program endless;
+	if (!initProgramFromString(&endless, "while (true) { var s = \"spin\"; }\n")) {
+		fprintf(stderr, ERROR "ERROR: couldn't decode the endless program\n" RESET);
+		return -1;
+	}
+
+	{
+		//tasks take turns, and each one gets its own stats
+		Scheduler scheduler;
+		initScheduler(&scheduler, 200, setupTask);
+
+		Task* tasks[16];
+		for (int i = 0; i < 16; i++) {
+			tasks[i] = spawnTask(&scheduler, &loop, 1, NULL, NULL);
+		}
+
+		//every task has had a turn before the first one finishes
+		for (int i = 0; i < 16; i++) {
+			stepScheduler(&scheduler);
+		}
+
+		for (int i = 0; i < 16; i++) {
+			if (tasks[i]->state != TASK_READY || tasks[i]->slices != 1) {
+				fprintf(stderr, ERROR "ERROR: task %d didn't get exactly one turn\n" RESET, i);
+				return -1;
+			}
+		}
+
+		runScheduler(&scheduler);
+
+		double cpuTime = 0;
+		for (int i = 0; i < 16; i++) {
+			if (tasks[i]->state != TASK_FINISHED || tasks[i]->slices < 5) {
+				fprintf(stderr, ERROR "ERROR: task %d ended badly (state %d, %d slices)\n" RESET, i, tasks[i]->state, tasks[i]->slices);
+				return -1;
+			}
+			cpuTime += tasks[i]->cpuTime;
+			releaseTask(&scheduler, tasks[i]);
+		}
+
+		if (scheduler.live != 0 || scheduler.pool.created != 16 || cpuTime <= 0 || failedAsserts > 0 || errors > 0) {
+			fprintf(stderr, ERROR "ERROR: unexpected scheduler state (%d live, %d created, %d asserts, %d errors)\n" RESET, scheduler.live, scheduler.pool.created, failedAsserts, errors);
+			return -1;
+		}
+
+		freeScheduler(&scheduler);
+	}
+
+	{
+		//higher priorities go first, even when spawned last
+		Scheduler scheduler;
+		initScheduler(&scheduler, 100, setupTask);
+
+		for (int i = 0; i < 4; i++) {
+			spawnTask(&scheduler, &loop, 0, recordTask, NULL);
+		}
+		spawnTask(&scheduler, &loop, 3, recordTask, NULL);
+		spawnTask(&scheduler, &loop, SCHEDULER_PRIORITIES + 10, recordTask, NULL); //clamped
+
+		runScheduler(&scheduler);
+
+		if (finishedCount != 6 || finished[0] != 4 || finished[1] != 5 || finished[2] != 0) {
+			fprintf(stderr, ERROR "ERROR: tasks finished in the wrong order\n" RESET);
+			return -1;
+		}
+
+		freeScheduler(&scheduler);
+	}
+
+	{
+		//natives can hand over the rest of the turn
+		Program pausing;
+		if (!initProgramFromString(&pausing, "pause();\npause();\npause();\nvar done: bool = true;\n")) {
+			fprintf(stderr, ERROR "ERROR: couldn't decode the pausing program\n" RESET);
+			return -1;
+		}
+
+		Scheduler scheduler;
+		initScheduler(&scheduler, 1000000, setupTask);
+
+		Task* task = spawnTask(&scheduler, &pausing, 0, NULL, NULL);
+		runScheduler(&scheduler);
+
+		if (task->state != TASK_FINISHED || task->slices != 4) {
+			fprintf(stderr, ERROR "ERROR: expected 4 slices, got %d\n" RESET, task->slices);
+			return -1;
+		}
+
+		releaseTask(&scheduler, task);
+		freeScheduler(&scheduler);
+		freeProgram(&pausing);
+	}
+
+	{
+		//endless tasks can be cancelled, by hand or when the scheduler goes
+		Scheduler scheduler;
+		initScheduler(&scheduler, 100, setupTask);
+
+		Task* task = spawnTask(&scheduler, &endless, 0, NULL, NULL);
+		spawnTask(&scheduler, &endless, 0, countCancelled, NULL);
+		spawnTask(&scheduler, &endless, 2, countCancelled, NULL);
+
+		for (int i = 0; i < 30; i++) {
+			stepScheduler(&scheduler);
+		}
+
+		releaseTask(&scheduler, task);
+
+		if (scheduler.live != 2) {
+			fprintf(stderr, ERROR "ERROR: expected 2 live tasks, got %d\n" RESET, scheduler.live);
+			return -1;
+		}
+
+		freeScheduler(&scheduler);
+
+		if (cancelled != 2 || failedAsserts > 0 || errors > 0) {
+			fprintf(stderr, ERROR "ERROR: expected 2 cancelled tasks, got %d\n" RESET, cancelled);
+			return -1;
+		}
+	}
+
+	{
+		//in an event loop, a full channel parks the sender, so the receiver on the same thread can drain it
+		Program producer;
+		Program consumer;
+
+		if (!initProgramFromString(&producer,
+			"import channel;\n"
+			"for (var i: int = 0; i < 10; i++) {\n"
+			"	assert messages.sendChannel(i), \"send failed\";\n"
+			"}\n"
+			"messages.closeChannel();\n"
+		) || !initProgramFromString(&consumer,
+			"import channel;\n"
+			"var total: int = 0;\n"
+			"var message = messages.receiveChannel();\n"
+			"while (message != null) {\n"
+			"	total += message;\n"
+			"	message = messages.receiveChannel();\n"
+			"}\n"
+			"assert total == 45, \"wrong total received\";\n"
+		)) {
+			fprintf(stderr, ERROR "ERROR: couldn't decode the channel programs\n" RESET);
+			return -1;
+		}
+
+		sharedChannel = createChannel(2);
+
+		EventLoop eventLoop;
+		if (!initEventLoop(&eventLoop, 100, setupChannelTask)) {
+			fprintf(stderr, ERROR "ERROR: couldn't start the event loop\n" RESET);
+			return -1;
+		}
+
+		spawnTask(&eventLoop.scheduler, &producer, 0, recordTask, NULL);
+		spawnTask(&eventLoop.scheduler, &consumer, 0, recordTask, NULL);
+
+		finishedCount = 0;
+		runEventLoop(&eventLoop);
+
+		if (eventLoop.scheduler.live != 0 || finishedCount != 2 || failedAsserts > 0 || errors > 0) {
+			fprintf(stderr, ERROR "ERROR: channel tasks didn't finish (%d live, %d finished)\n" RESET, eventLoop.scheduler.live, finishedCount);
+			return -1;
+		}
+
+		freeEventLoop(&eventLoop);
+		freeChannel(sharedChannel);
+
+		//without an event loop, nothing on another thread could wake a parked task, so it waits in place
+		sharedChannel = createChannel(2);
+
+		Scheduler scheduler;
+		initScheduler(&scheduler, 100, setupChannelTask);
+		spawnTask(&scheduler, &consumer, 0, recordTask, NULL);
+
+		pthread_t host;
+		pthread_create(&host, NULL, produceMessages, NULL);
+
+		finishedCount = 0;
+		runScheduler(&scheduler);
+		pthread_join(host, NULL);
+
+		if (scheduler.live != 0 || finishedCount != 1 || failedAsserts > 0 || errors > 0) {
+			fprintf(stderr, ERROR "ERROR: channel task fed from another thread didn't finish (%d live, %d finished)\n" RESET, scheduler.live, finishedCount);
+			return -1;
+		}
+
+		freeScheduler(&scheduler);
+		freeChannel(sharedChannel);
+		freeProgram(&producer);
+		freeProgram(&consumer);
+	}
+
+	{
+		//many idle-ish tasks on one thread
+		Scheduler scheduler;
+		initScheduler(&scheduler, 50, setupTask);
+
+		struct timeval start;
+		gettimeofday(&start, NULL);
+
+		const int taskCount = 1000;
+		for (int i = 0; i < taskCount; i++) {
+			spawnTask(&scheduler, &loop, i % SCHEDULER_PRIORITIES, countCancelled, NULL);
+		}
+
+		int peak = scheduler.pool.inUse;
+		runScheduler(&scheduler);
+
+		struct timeval end;
+		gettimeofday(&end, NULL);
+
+		double seconds = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1000000.0;
+		printf(NOTICE "%d tasks: %.0f switches/s, %d interpreters\n" RESET, taskCount, scheduler.switches / seconds, peak);
+
+		if (scheduler.live != 0 || failedAsserts > 0 || errors > 0) {
+			fprintf(stderr, ERROR "ERROR: not every task finished\n" RESET);
+			return -1;
+		}
+
+		freeScheduler(&scheduler);
+	}
+
+	freeProgram(&loop);
+	freeProgram(&endless);
+
+	printf(NOTICE "All good\n" RESET);
+	return 0;
+}
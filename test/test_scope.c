@@ -118,6 +118,55 @@ int main() {
 		freeLiteral(type);
 	}
 
+	{
+		//test pooled scopes
+		ScopePool* pool = createScopePool();
+
+		Scope* scope = pushScopeFromPool(pool, NULL);
+
+		//tables are only allocated on the first declaration
+		if (scope->variables.capacity != 0 || scope->types.capacity != 0) {
+			printf(ERROR "Scope tables were allocated eagerly" RESET);
+			return -1;
+		}
+
+		//inner scopes draw from the same pool
+		Scope* inner = pushScope(scope);
+
+		if (inner->pool != pool) {
+			printf(ERROR "Inner scope didn't inherit the pool" RESET);
+			return -1;
+		}
+
+		//lookups in an empty scope fall through to the ancestor
+		Literal identifier = TO_IDENTIFIER_LITERAL(createRefString("foobar"));
+		Literal type = TO_TYPE_LITERAL(LITERAL_INTEGER, false);
+
+		if (!declareScopeVariable(scope, identifier, type) || !setScopeVariable(inner, identifier, TO_INTEGER_LITERAL(42), true)) {
+			printf(ERROR "Failed to set through an empty scope" RESET);
+			return -1;
+		}
+
+		//released scopes are recycled
+		Scope* released = inner;
+		popScope(inner);
+		inner = pushScope(scope);
+
+		if (inner != released) {
+			printf(ERROR "Scope wasn't recycled by the pool" RESET);
+			return -1;
+		}
+
+		//the pool outlives its owner while scopes remain
+		releaseScopePool(pool);
+
+		inner = popScope(inner);
+		scope = popScope(scope);
+
+		freeLiteral(identifier);
+		freeLiteral(type);
+	}
+
 	printf(NOTICE "All good\n" RESET);
 	return 0;
 }
@@ -0,0 +1,216 @@
+#include "shared_heap.h"
+
+#include "lexer.h"
+#include "parser.h"
+#include "compiler.h"
+#include "interpreter.h"
+
+#include "console_colors.h"
+
+#include "memory.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#define THREAD_COUNT 4
+#define ITERATION_COUNT 25
+
+//suppress the print output
+static void noPrintFn(const char* output) {
+	//NO OP
+}
+
+static TOY_THREAD_LOCAL int failures = 0;
+static void failFn(const char* output) {
+	failures++;
+	fprintf(stderr, ERROR "Script failure: %s\n" RESET, output);
+}
+
+//compilation functions
+unsigned char* compileString(char* source, size_t* size) {
+	Lexer lexer;
+	Parser parser;
+	Compiler compiler;
+
+	initLexer(&lexer, source);
+	initParser(&parser, &lexer);
+	initCompiler(&compiler);
+
+	//run the parser until the end of the source
+	ASTNode* node = scanParser(&parser);
+	while(node != NULL) {
+		//pack up and leave
+		if (node->type == AST_NODE_ERROR) {
+			printf(ERROR "error node detected\n" RESET);
+			freeCompiler(&compiler);
+			freeParser(&parser);
+			return NULL;
+		}
+
+		writeCompiler(&compiler, node);
+		node = scanParser(&parser);
+	}
+
+	//get the bytecode dump
+	unsigned char* tb = collateCompiler(&compiler, (int*)(size));
+
+	//cleanup
+	freeCompiler(&compiler);
+	freeParser(&parser);
+	//no lexer to clean up
+
+	//finally
+	return tb;
+}
+
+static void prepInterpreter(Interpreter* interpreter) {
+	initInterpreter(interpreter);
+	setInterpreterPrint(interpreter, noPrintFn);
+	setInterpreterAssert(interpreter, failFn);
+	setInterpreterError(interpreter, failFn);
+}
+
+static void runString(Interpreter* interpreter, char* source) {
+	size_t size = 0;
+	unsigned char* tb = compileString(source, &size);
+	runInterpreter(interpreter, tb, size);
+}
+
+//the rule 110 lookup table, as reference data
+static char* builderSource =
+	"var lookup = [\n"
+	"	\"*\": [\"*\": [\"*\": \" \", \" \": \"*\"], \" \": [\"*\": \"*\", \" \": \" \"]],\n"
+	"	\" \": [\"*\": [\"*\": \"*\", \" \": \"*\"], \" \": [\"*\": \"*\", \" \": \" \"]]\n"
+	"];\n"
+	"var names: [string] = [\"first\", \"second\", \"third\"];\n"
+	"export lookup;\n"
+	"export names;\n"
+;
+
+static char* readerSource =
+	"import lookup;\n"
+	"import names;\n"
+	"var cell = lookup[\" \"][\"*\"][\"*\"];\n"
+	"assert cell == \"*\", \"lookup failed\";\n"
+	"assert names[1] == \"second\", \"names failed\";\n"
+	"var local = lookup;\n"
+	"local[\"extra\"] = \"value\";\n"
+	"assert local[\"extra\"] == \"value\", \"local write failed\";\n"
+	"var localNames = names;\n"
+	"localNames.push(\"fourth\");\n"
+	"assert localNames.length() == 4, \"local push failed\";\n"
+;
+
+static SharedHeap heap;
+static Program reader;
+
+static void* runReader(void* arg) {
+	Interpreter interpreter;
+	prepInterpreter(&interpreter);
+
+	for (int i = 0; i < ITERATION_COUNT; i++) {
+		attachSharedHeap(&heap, &interpreter);
+		runProgram(&interpreter, &reader);
+		resetInterpreter(&interpreter);
+	}
+
+	freeInterpreter(&interpreter);
+
+	*(int*)arg = failures;
+	return NULL;
+}
+
+int main() {
+	initSharedHeap(&heap);
+
+	{
+		//build the reference data once
+		Interpreter builder;
+		prepInterpreter(&builder);
+		runString(&builder, builderSource);
+
+		char* names[] = {"lookup", "names", NULL};
+		for (int i = 0; names[i]; i++) {
+			Literal key = TO_IDENTIFIER_LITERAL(createRefString(names[i]));
+			Literal value = getLiteralDictionary(builder.exports, key);
+
+			if (!setSharedHeapValue(&heap, names[i], value)) {
+				fprintf(stderr, ERROR "ERROR: setSharedHeapValue() failed\n" RESET);
+				return -1;
+			}
+
+			freeLiteral(value);
+			freeLiteral(key);
+		}
+
+		//the builder is no longer needed
+		freeInterpreter(&builder);
+	}
+
+	{
+		//imports share the heap's copy, and writes don't reach it
+		Interpreter interpreter;
+		prepInterpreter(&interpreter);
+		attachSharedHeap(&heap, &interpreter);
+		runString(&interpreter, readerSource);
+
+		Literal key = TO_IDENTIFIER_LITERAL(createRefString("lookup"));
+		Literal imported = TO_NULL_LITERAL;
+		Literal shared = getLiteralDictionary(&heap.values, key);
+
+		if (!getScopeVariable(interpreter.scope, key, &imported) || !IS_DICTIONARY(imported) || AS_DICTIONARY(imported) != AS_DICTIONARY(shared)) {
+			fprintf(stderr, ERROR "ERROR: the import was copied\n" RESET);
+			return -1;
+		}
+
+		if (AS_DICTIONARY(shared)->count != 2) {
+			fprintf(stderr, ERROR "ERROR: a script wrote to the shared heap\n" RESET);
+			return -1;
+		}
+
+		freeLiteral(imported);
+		freeLiteral(shared);
+		freeLiteral(key);
+
+		freeInterpreter(&interpreter);
+
+		if (failures > 0) {
+			return -1;
+		}
+	}
+
+	{
+		//many interpreters, many threads, one copy
+		size_t size = 0;
+		unsigned char* tb = compileString(readerSource, &size);
+
+		if (!initProgram(&reader, tb, size)) {
+			fprintf(stderr, ERROR "ERROR: initProgram() failed\n" RESET);
+			return -1;
+		}
+
+		pthread_t threads[THREAD_COUNT];
+		int results[THREAD_COUNT];
+
+		for (int i = 0; i < THREAD_COUNT; i++) {
+			pthread_create(&threads[i], NULL, runReader, &results[i]);
+		}
+
+		for (int i = 0; i < THREAD_COUNT; i++) {
+			pthread_join(threads[i], NULL);
+
+			if (results[i] != 0) {
+				fprintf(stderr, ERROR "ERROR: thread %d failed\n" RESET, i);
+				return -1;
+			}
+		}
+
+		freeProgram(&reader);
+	}
+
+	freeSharedHeap(&heap);
+
+	printf(NOTICE "All good\n" RESET);
+	return 0;
+}
@@ -0,0 +1,192 @@
+#include "snapshot.h"
+
+#include "lexer.h"
+#include "parser.h"
+#include "compiler.h"
+#include "interpreter.h"
+
+#include "console_colors.h"
+
+#include "memory.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../repl/lib_standard.h"
+
+//suppress the print output
+static void noPrintFn(const char* output) {
+	//NO OP
+}
+
+int failedAsserts = 0;
+static void assertWrapper(const char* output) {
+	failedAsserts++;
+	fprintf(stderr, ERROR "Assertion failure: ");
+	fprintf(stderr, "%s", output);
+	fprintf(stderr, "\n" RESET); //default new line
+}
+
+int errors = 0;
+static void errorWrapper(const char* output) {
+	errors++;
+}
+
+//compilation functions
+unsigned char* compileString(char* source, size_t* size) {
+	Lexer lexer;
+	Parser parser;
+	Compiler compiler;
+
+	initLexer(&lexer, source);
+	initParser(&parser, &lexer);
+	initCompiler(&compiler);
+
+	//run the parser until the end of the source
+	ASTNode* node = scanParser(&parser);
+	while(node != NULL) {
+		//pack up and leave
+		if (node->type == AST_NODE_ERROR) {
+			printf(ERROR "error node detected\n" RESET);
+			freeCompiler(&compiler);
+			freeParser(&parser);
+			return NULL;
+		}
+
+		writeCompiler(&compiler, node);
+		node = scanParser(&parser);
+	}
+
+	//get the bytecode dump
+	unsigned char* tb = collateCompiler(&compiler, (int*)(size));
+
+	//cleanup
+	freeCompiler(&compiler);
+	freeParser(&parser);
+	//no lexer to clean up
+
+	//finally
+	return tb;
+}
+
+static int nativeUnknown(Interpreter* interpreter, LiteralArray* arguments) {
+	return 0;
+}
+
+static void prepInterpreter(Interpreter* interpreter) {
+	initInterpreter(interpreter);
+	setInterpreterPrint(interpreter, noPrintFn);
+	setInterpreterAssert(interpreter, assertWrapper);
+	setInterpreterError(interpreter, errorWrapper);
+	injectNativeHook(interpreter, "standard", hookStandard);
+}
+
+static void runString(Interpreter* interpreter, char* source) {
+	size_t size = 0;
+	unsigned char* tb = compileString(source, &size);
+	runInterpreter(interpreter, tb, size);
+}
+
+int main() {
+	{
+		//warm an interpreter up, then restore it into a fresh one
+		Interpreter warm;
+		prepInterpreter(&warm);
+
+		runString(&warm,
+			"import standard;\n"
+			"import standard as std;\n"
+			"var table: [string : int] = [\"one\": 1, \"two\": 2];\n"
+			"var list = [1.5, true, null, \"text\"];\n"
+			"var limit: int const = 10;\n"
+			"fn double(x) { return x * 2; }\n"
+			"export double;\n"
+		);
+
+		int size = 0;
+		unsigned char* snapshot = snapshotInterpreter(&warm, &size);
+		freeInterpreter(&warm);
+
+		if (!snapshot) {
+			fprintf(stderr, ERROR "ERROR: snapshotInterpreter() failed\n" RESET);
+			return -1;
+		}
+
+		Interpreter cold;
+		prepInterpreter(&cold);
+
+		if (!restoreInterpreter(&cold, snapshot, size)) {
+			fprintf(stderr, ERROR "ERROR: restoreInterpreter() failed\n" RESET);
+			return -1;
+		}
+
+		runString(&cold,
+			"assert table[\"two\"] == 2, \"table not restored\";\n"
+			"assert list[0] == 1.5, \"list not restored\";\n"
+			"assert list[3] == \"text\", \"list string not restored\";\n"
+			"assert double(limit) == 20, \"function not restored\";\n"
+			"var start = clock();\n"
+			"var aliased = std[\"clock\"];\n"
+		);
+
+		//the declared types came along too
+		Literal limit = TO_IDENTIFIER_LITERAL(createRefString("limit"));
+		Literal limitType = getScopeType(cold.scope, limit);
+		if (AS_TYPE(limitType).typeOf != LITERAL_INTEGER || !AS_TYPE(limitType).constant) {
+			fprintf(stderr, ERROR "ERROR: types not restored\n" RESET);
+			return -1;
+		}
+		freeLiteral(limitType);
+		freeLiteral(limit);
+
+		//and the exports
+		Literal exported = TO_IDENTIFIER_LITERAL(createRefString("double"));
+		if (!existsLiteralDictionary(cold.exports, exported)) {
+			fprintf(stderr, ERROR "ERROR: exports not restored\n" RESET);
+			return -1;
+		}
+		freeLiteral(exported);
+
+		freeInterpreter(&cold);
+
+		//damaged snapshots are refused
+		Interpreter damaged;
+		prepInterpreter(&damaged);
+
+		if (restoreInterpreter(&damaged, snapshot, size - 1)) {
+			fprintf(stderr, ERROR "ERROR: a damaged snapshot was restored\n" RESET);
+			return -1;
+		}
+
+		freeInterpreter(&damaged);
+
+		FREE_ARRAY(unsigned char, snapshot, size);
+
+		if (failedAsserts > 0 || errors != 1) {
+			fprintf(stderr, ERROR "ERROR: restored interpreter misbehaved (%d asserts, %d errors)\n" RESET, failedAsserts, errors);
+			return -1;
+		}
+	}
+
+	{
+		//natives that no hook provides can't be stored
+		Interpreter interpreter;
+		initInterpreter(&interpreter);
+		setInterpreterError(&interpreter, errorWrapper);
+
+		injectNativeFn(&interpreter, "unknown", nativeUnknown);
+
+		int size = 0;
+		errors = 0;
+		if (snapshotInterpreter(&interpreter, &size) != NULL || errors != 1) {
+			fprintf(stderr, ERROR "ERROR: snapshot of an unknown native should fail\n" RESET);
+			return -1;
+		}
+
+		freeInterpreter(&interpreter);
+	}
+
+	printf(NOTICE "All good\n" RESET);
+	return 0;
+}
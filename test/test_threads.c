@@ -0,0 +1,165 @@
+#include "lexer.h"
+#include "parser.h"
+#include "compiler.h"
+#include "interpreter.h"
+#include "memory_pool.h"
+
+#include "console_colors.h"
+
+#include "memory.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "../repl/lib_standard.h"
+
+#define THREAD_COUNT 8
+#define ITERATION_COUNT 20
+
+//each thread counts its own output
+static TOY_THREAD_LOCAL int prints = 0;
+static void countPrintFn(const char* output) {
+	prints++;
+}
+
+static TOY_THREAD_LOCAL int failures = 0;
+static void countFailureFn(const char* output) {
+	failures++;
+}
+
+//compilation functions
+unsigned char* compileString(char* source, size_t* size) {
+	Lexer lexer;
+	Parser parser;
+	Compiler compiler;
+
+	initLexer(&lexer, source);
+	initParser(&parser, &lexer);
+	initCompiler(&compiler);
+
+	//run the parser until the end of the source
+	ASTNode* node = scanParser(&parser);
+	while(node != NULL) {
+		//pack up and leave
+		if (node->type == AST_NODE_ERROR) {
+			printf(ERROR "error node detected\n" RESET);
+			freeCompiler(&compiler);
+			freeParser(&parser);
+			return NULL;
+		}
+
+		writeCompiler(&compiler, node);
+		node = scanParser(&parser);
+	}
+
+	//get the bytecode dump
+	unsigned char* tb = collateCompiler(&compiler, (int*)(size));
+
+	//cleanup
+	freeCompiler(&compiler);
+	freeParser(&parser);
+	//no lexer to clean up
+
+	//finally
+	return tb;
+}
+
+static char* source =
+	"import standard;\n"
+	"var start = clock();\n"
+	"var table: [string : int] = [\"one\": 1, \"two\": 2];\n"
+	"var list: [int] = [];\n"
+	"fn fib(n) { if (n < 2) { return n; } return fib(n - 1) + fib(n - 2); }\n"
+	"for (var i = 0; i < 10; i++) { list.push(fib(i)); }\n"
+	"assert list[9] == 34, \"fib failed\";\n"
+	"assert table[\"two\"] == 2, \"table failed\";\n"
+	"print list;\n"
+	"print table;\n"
+;
+
+static Program sharedProgram;
+
+typedef struct Worker {
+	pthread_t thread;
+	int prints;
+	int failures;
+} Worker;
+
+static void prepInterpreter(Interpreter* interpreter) {
+	initInterpreter(interpreter);
+	setInterpreterPrint(interpreter, countPrintFn);
+	setInterpreterAssert(interpreter, countFailureFn);
+	setInterpreterError(interpreter, countFailureFn);
+	injectNativeHook(interpreter, "standard", hookStandard);
+}
+
+static void* runWorker(void* arg) {
+	Worker* worker = (Worker*)arg;
+
+	//every thread has its own allocator
+	MemoryPool pool;
+	initMemoryPool(&pool);
+	setMemoryPool(&pool);
+
+	Interpreter interpreter;
+	prepInterpreter(&interpreter);
+
+	for (int i = 0; i < ITERATION_COUNT; i++) {
+		//compiled on this thread
+		size_t size = 0;
+		unsigned char* tb = compileString(source, &size);
+		runInterpreter(&interpreter, tb, size);
+		resetInterpreter(&interpreter);
+
+		//shared between threads
+		runProgram(&interpreter, &sharedProgram);
+		resetInterpreter(&interpreter);
+	}
+
+	freeInterpreter(&interpreter);
+	freeMemoryPool(&pool);
+
+	worker->prints = prints;
+	worker->failures = failures;
+
+	return NULL;
+}
+
+int main() {
+	{
+		//run several interpreters at once
+		size_t size = 0;
+		unsigned char* tb = compileString(source, &size);
+
+		if (!initProgram(&sharedProgram, tb, size)) {
+			fprintf(stderr, ERROR "ERROR: initProgram() failed\n" RESET);
+			return -1;
+		}
+
+		Worker workers[THREAD_COUNT];
+
+		for (int i = 0; i < THREAD_COUNT; i++) {
+			if (pthread_create(&workers[i].thread, NULL, runWorker, &workers[i]) != 0) {
+				fprintf(stderr, ERROR "ERROR: couldn't start a thread\n" RESET);
+				return -1;
+			}
+		}
+
+		for (int i = 0; i < THREAD_COUNT; i++) {
+			pthread_join(workers[i].thread, NULL);
+		}
+
+		freeProgram(&sharedProgram);
+
+		for (int i = 0; i < THREAD_COUNT; i++) {
+			if (workers[i].failures != 0 || workers[i].prints != ITERATION_COUNT * 2 * 2) {
+				fprintf(stderr, ERROR "ERROR: thread %d misbehaved (%d prints, %d failures)\n" RESET, i, workers[i].prints, workers[i].failures);
+				return -1;
+			}
+		}
+	}
+
+	printf(NOTICE "All good\n" RESET);
+	return 0;
+}